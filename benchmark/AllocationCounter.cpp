@@ -0,0 +1,93 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace {
+  std::atomic<bool> countAllocations {false};
+  std::atomic<uint64_t> numAllocations {0};
+  std::atomic<int64_t> heapBytes {0};
+
+  // Size of the block allocator actually reserved, so freeing it subtracts the same amount
+  inline size_t allocationSize(void* pointer) {
+#if defined(_WIN32)
+    return _msize(pointer);
+#elif defined(__APPLE__)
+    return malloc_size(pointer);
+#else
+    return malloc_usable_size(pointer);
+#endif
+  }
+}
+
+// Replace global allocation functions so that allocations can be counted. Otherwise they behave the same as the default ones, which
+// array and sized versions forward to.
+void* operator new(std::size_t size) {
+  if (void* pointer = std::malloc(size != 0 ? size : 1)) {
+    if (countAllocations.load(std::memory_order_relaxed)) {
+      numAllocations.fetch_add(1, std::memory_order_relaxed);
+      heapBytes.fetch_add(allocationSize(pointer), std::memory_order_relaxed);
+    }
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  if (pointer != nullptr && countAllocations.load(std::memory_order_relaxed)) {
+    heapBytes.fetch_sub(allocationSize(pointer), std::memory_order_relaxed);
+  }
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+namespace papyrus {
+
+  AllocationCounter::AllocationCounter() {
+    numAllocations = 0;
+    heapBytes = 0;
+    countAllocations = true;
+  }
+
+  AllocationCounter::~AllocationCounter() {
+    countAllocations = false;
+  }
+
+  uint64_t AllocationCounter::count() const {
+    return numAllocations;
+  }
+
+  int64_t AllocationCounter::bytesInUse() const {
+    return heapBytes;
+  }
+
+} // namespace
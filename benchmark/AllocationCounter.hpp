@@ -0,0 +1,38 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace papyrus {
+
+  // Count allocations made on all threads during its lifetime, since lexer may lex on worker threads, and heap memory they still
+  // hold. Global allocation functions are only replaced in benchmark programs, so the plugin itself allocates as usual. Memory in use
+  // is only accurate for memory allocated after counting starts.
+  class AllocationCounter {
+    public:
+      AllocationCounter();
+      ~AllocationCounter();
+
+      uint64_t count() const;
+      int64_t bytesInUse() const;
+  };
+
+} // namespace
@@ -0,0 +1,47 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace papyrus {
+
+  using Clock = std::chrono::steady_clock;
+
+  inline double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // Format with printf-style arguments, since not every compiler the benchmarks are built with has std::format
+  template <typename... Args>
+  std::string formatString(const char* format, Args... args) {
+    int length = std::snprintf(nullptr, 0, format, args...);
+    if (length <= 0) {
+      return std::string();
+    }
+
+    std::string text(length, '\0');
+    std::snprintf(text.data(), text.length() + 1, format, args...);
+    return text;
+  }
+
+} // namespace
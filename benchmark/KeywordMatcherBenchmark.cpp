@@ -0,0 +1,254 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "KeywordMatcherBenchmark.hpp"
+
+#include "BenchmarkUtil.hpp"
+#include "LexerBenchmark.hpp"
+
+#include "Plugin/KeywordMatcher/BlockMatcher.hpp"
+#include "Plugin/KeywordMatcher/KeywordMatcherSettings.hpp"
+#include "Plugin/KeywordMatcher/MemoryMatcherDocument.hpp"
+#include "Plugin/KeywordMatcher/OccurrenceMatcher.hpp"
+#include "Plugin/Lexer/Lexer.hpp"
+#include "Plugin/Lexer/LexerData.hpp"
+#include "Plugin/Lexer/MemoryDocument.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  namespace {
+    constexpr int NESTED_IF_DEPTH = 10000;
+    constexpr int ELSEIF_CHAIN_LENGTH = 100000;
+    constexpr Sci_Position UNMATCHED_SCRIPT_LINES = 20000;
+    constexpr Sci_Position OCCURRENCE_SCRIPT_LINES = 50000;
+    constexpr Sci_Position VISIBLE_LINES = 60;
+  }
+
+  std::vector<KeywordMatcherBenchmark::Result> KeywordMatcherBenchmark::run(int iterations, uint32_t seed) {
+    std::vector<Result> results;
+    if (!lexerData || !lexerData->usable) {
+      return results;
+    }
+
+    std::vector<Sci_Position> keywordLines;
+    std::string script = generateNestedIfs(NESTED_IF_DEPTH, keywordLines);
+    results.push_back(runMatch(formatString("%d nested If blocks", NESTED_IF_DEPTH), script, keywordLines, iterations));
+
+    keywordLines.clear();
+    script = generateElseIfChain(ELSEIF_CHAIN_LENGTH, keywordLines);
+    results.push_back(runMatch(formatString("If block with %d ElseIf", ELSEIF_CHAIN_LENGTH), script, keywordLines, iterations));
+
+    keywordLines.clear();
+    script = generateUnmatched(UNMATCHED_SCRIPT_LINES, seed, keywordLines);
+    results.push_back(runMatch("Unmatched keywords at start and end of script", script, keywordLines, iterations));
+
+    script = LexerBenchmark::generateScript(OCCURRENCE_SCRIPT_LINES, seed);
+    results.push_back(runOccurrences("Occurrences of names in a long script", script, iterations));
+    return results;
+  }
+
+  std::string KeywordMatcherBenchmark::format(const std::vector<Result>& results) {
+    std::string report;
+    for (const auto& result : results) {
+      double matches = static_cast<double>(std::max(result.matches, static_cast<uint64_t>(1)));
+      report += formatString("%s: %llu lines, %llu bytes\n", result.name.c_str(), static_cast<unsigned long long>(result.lines),
+        static_cast<unsigned long long>(result.bytes));
+      if (result.highlightsOccurrences) {
+        report += formatString("    %.1f us/highlight, %.1f us max, %llu highlights, %.1f ranges highlighted/highlight\n",
+          result.seconds * 1e6 / matches, result.maxSeconds * 1e6, static_cast<unsigned long long>(result.matches), result.highlightedRanges / matches);
+        continue;
+      }
+      report += formatString("    First match in %.1f ms, complete in %.1f ms at most\n", result.firstMatchSeconds * 1e3, result.completeSeconds * 1e3);
+      report += formatString("    %.1f us/match, %.1f us max, %llu matches, %llu with paired keyword, %.1f ranges highlighted/match\n",
+        result.seconds * 1e6 / matches, result.maxSeconds * 1e6, static_cast<unsigned long long>(result.matches),
+        static_cast<unsigned long long>(result.matchedKeywords), result.highlightedRanges / matches);
+    }
+    return report;
+  }
+
+  std::string KeywordMatcherBenchmark::generateNestedIfs(int depth, std::vector<Sci_Position>& keywordLines) {
+    // Blocks aren't indented, otherwise indentation alone would make the script grow quadratically
+    std::string script = "ScriptName Bench:NestedIfs\nFunction Nested(Int x)\n";
+    Sci_Position firstIfLine = 2;
+    for (int i = 0; i < depth; ++i) {
+      script += "If x > " + std::to_string(i) + "\n";
+    }
+    script += "x += 1\n";
+    for (int i = 0; i < depth; ++i) {
+      script += "EndIf\n";
+    }
+    script += "EndFunction\n";
+
+    // Outermost, middle and innermost If, and outermost EndIf
+    keywordLines = { firstIfLine, firstIfLine + depth / 2, firstIfLine + depth - 1, firstIfLine + 2 * depth };
+    return script;
+  }
+
+  std::string KeywordMatcherBenchmark::generateElseIfChain(int length, std::vector<Sci_Position>& keywordLines) {
+    std::string script = "ScriptName Bench:ElseIfChain\nFunction Chain(Int x)\nIf x == 0\n";
+    Sci_Position ifLine = 2;
+    for (int i = 1; i <= length; ++i) {
+      script += "ElseIf x == " + std::to_string(i) + "\n";
+    }
+    script += "EndIf\nEndFunction\n";
+
+    // If, ElseIf in the middle of the chain, and EndIf
+    keywordLines = { ifLine, ifLine + length / 2, ifLine + length + 1 };
+    return script;
+  }
+
+  std::string KeywordMatcherBenchmark::generateUnmatched(Sci_Position numLines, uint32_t seed, std::vector<Sci_Position>& keywordLines) {
+    // An If whose close keyword is missing can only be told unmatched once the whole script is styled
+    std::string script = "If Unmatched\n" + LexerBenchmark::generateScript(numLines, seed);
+    Sci_Position functionLine = std::count(script.begin(), script.end(), '\n');
+    script += "Function Unmatched(Int x)\nWhile x > 0\nIf x == 1\n";
+
+    // If at start, and Function, While and If at end, without their close keywords
+    keywordLines = { 0, functionLine, functionLine + 1, functionLine + 2 };
+    return script;
+  }
+
+  // Private methods
+  //
+
+  KeywordMatcherBenchmark::Result KeywordMatcherBenchmark::runMatch(const std::string& name, const std::string& script, const std::vector<Sci_Position>& keywordLines, int iterations) {
+    Result result {
+      .name = name
+    };
+
+    // Match each keyword in a newly opened document, which is styled until its visible lines by the time caret is on the keyword
+    for (Sci_Position line : keywordLines) {
+      MemoryDocument document(script);
+      auto lexer = LexerBenchmark::createLexer();
+      MemoryMatcherDocument matcherDocument(document, *lexer);
+      matcherDocument.setVisibleLines(line, line + VISIBLE_LINES);
+      matcherDocument.styleLines(line + VISIBLE_LINES);
+
+      auto start = Clock::now();
+      Sci_Position position = document.LineStart(line);
+      BlockMatcher::styleVisibleLines(matcherDocument, position);
+      auto target = BlockMatcher::findTarget(matcherDocument, position, KEYWORD_ALL);
+      if (target) {
+        BlockMatcher::Result matchResult = BlockMatcher::match(matcherDocument, *target);
+        result.firstMatchSeconds = std::max(result.firstMatchSeconds, secondsSince(start));
+        while (!matchResult.complete) {
+          matcherDocument.styleLines(BlockMatcher::STYLE_STEP_LINES);
+          matchResult = BlockMatcher::match(matcherDocument, *target);
+        }
+      }
+      result.completeSeconds = std::max(result.completeSeconds, secondsSince(start));
+    }
+
+    // Then match keywords repeatedly in a styled document
+    MemoryDocument document(script);
+    auto lexer = LexerBenchmark::createLexer();
+    MemoryMatcherDocument matcherDocument(document, *lexer);
+    while (!matcherDocument.styleLines(BlockMatcher::STYLE_STEP_LINES)) {
+    }
+    result.lines = document.getLineCount();
+    result.bytes = document.Length();
+
+    // Each match clears ranges highlighted by the previous one, as caret moves between keywords
+    std::vector<Sci_CharacterRange> drawnRanges;
+    for (int i = 0; i < iterations; ++i) {
+      for (Sci_Position line : keywordLines) {
+        auto matchStart = Clock::now();
+        for (const auto& range : drawnRanges) {
+          matcherDocument.clearIndicator(range.cpMin, range.cpMax - range.cpMin);
+        }
+        drawnRanges.clear();
+
+        auto target = BlockMatcher::findTarget(matcherDocument, document.LineStart(line), KEYWORD_ALL);
+        if (target) {
+          BlockMatcher::Result matchResult = BlockMatcher::match(matcherDocument, *target);
+          for (const auto& range : matchResult.ranges) {
+            matcherDocument.fillIndicator(range.cpMin, range.cpMax - range.cpMin);
+          }
+          if (matchResult.matched) {
+            result.matchedKeywords++;
+          }
+          result.highlightedRanges += matchResult.ranges.size();
+          drawnRanges = std::move(matchResult.ranges);
+        }
+
+        double seconds = secondsSince(matchStart);
+        result.seconds += seconds;
+        result.maxSeconds = std::max(result.maxSeconds, seconds);
+        result.matches++;
+      }
+    }
+    return result;
+  }
+
+  KeywordMatcherBenchmark::Result KeywordMatcherBenchmark::runOccurrences(const std::string& name, const std::string& script, int iterations) {
+    Result result {
+      .name = name,
+      .highlightsOccurrences = true
+    };
+
+    MemoryDocument document(script);
+    auto lexer = LexerBenchmark::createLexer();
+    MemoryMatcherDocument matcherDocument(document, *lexer);
+    while (!matcherDocument.styleLines(BlockMatcher::STYLE_STEP_LINES)) {
+    }
+    result.lines = document.getLineCount();
+    result.bytes = document.Length();
+
+    // Caret on a variable used on most lines, a local variable, a function, and a property, at start, middle and end of the script
+    std::vector<Sci_Position> positions;
+    Sci_Position numLines = document.getLineCount();
+    for (Sci_Position line : {static_cast<Sci_Position>(0), numLines / 2, numLines - VISIBLE_LINES}) {
+      for (const char* word : {"count ", "helper ", "Trace(", "Count1 "}) {
+        if (size_t position = script.find(word, document.LineStart(line)); position != std::string::npos) {
+          positions.push_back(static_cast<Sci_Position>(position));
+        }
+      }
+    }
+
+    // Each highlight clears ranges highlighted by the previous one, as caret moves between names
+    std::vector<Sci_CharacterRange> drawnRanges;
+    for (int i = 0; i < iterations; ++i) {
+      for (Sci_Position position : positions) {
+        Sci_Position line = document.LineFromPosition(position);
+        matcherDocument.setVisibleLines(std::max(line - VISIBLE_LINES / 2, static_cast<Sci_Position>(0)), line + VISIBLE_LINES / 2);
+
+        auto highlightStart = Clock::now();
+        for (const auto& range : drawnRanges) {
+          matcherDocument.clearIndicator(range.cpMin, range.cpMax - range.cpMin);
+        }
+
+        OccurrenceMatcher::Result highlightResult = OccurrenceMatcher::match(matcherDocument, position);
+        for (const auto& range : highlightResult.ranges) {
+          matcherDocument.fillIndicator(range.cpMin, range.cpMax - range.cpMin);
+        }
+        result.highlightedRanges += highlightResult.ranges.size();
+        drawnRanges = std::move(highlightResult.ranges);
+
+        double seconds = secondsSince(highlightStart);
+        result.seconds += seconds;
+        result.maxSeconds = std::max(result.maxSeconds, seconds);
+        result.matches++;
+      }
+    }
+    return result;
+  }
+
+} // namespace
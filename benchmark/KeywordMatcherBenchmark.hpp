@@ -0,0 +1,66 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>  // Scintilla's Sci_Position.h uses intptr_t without including it
+
+#include "external/scintilla/Sci_Position.h"
+
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  // Measure keyword matching latency on pathological scripts held in memory, without involving Notepad++ or Scintilla: deeply nested
+  // blocks, long ElseIf chains, and keywords left unmatched at the start and end of a script. Occurrence highlighting is measured on
+  // a long script as well, with caret on names used all over it.
+  class KeywordMatcherBenchmark {
+    public:
+      struct Result {
+        std::string name;
+        uint64_t lines {0};
+        uint64_t bytes {0};
+        double firstMatchSeconds {0.0}; // Longest time to show the first, possibly provisional, match, including styling it needs
+        double completeSeconds {0.0};   // Longest time until the match is complete, i.e. close keyword is found or document is styled
+        uint64_t matches {0};           // Number of times a keyword is matched
+        uint64_t matchedKeywords {0};   // Number of matches that found the paired keyword
+        uint64_t highlightedRanges {0};
+        double seconds {0.0};
+        double maxSeconds {0.0};
+        bool highlightsOccurrences {false};  // Whether matches are occurrence highlighting rather than keyword matching
+      };
+
+      // Run benchmarks, matching keywords on each script a number of times
+      static std::vector<Result> run(int iterations = 20, uint32_t seed = 1);
+
+      // Format results as a readable report
+      static std::string format(const std::vector<Result>& results);
+
+      // Generate scripts, returning line numbers of keywords to match
+      static std::string generateNestedIfs(int depth, std::vector<Sci_Position>& keywordLines);
+      static std::string generateElseIfChain(int length, std::vector<Sci_Position>& keywordLines);
+      static std::string generateUnmatched(Sci_Position numLines, uint32_t seed, std::vector<Sci_Position>& keywordLines);
+
+    private:
+      static Result runMatch(const std::string& name, const std::string& script, const std::vector<Sci_Position>& keywordLines, int iterations);
+      static Result runOccurrences(const std::string& name, const std::string& script, int iterations);
+  };
+
+} // namespace
@@ -0,0 +1,559 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LexerBenchmark.hpp"
+
+#include "AllocationCounter.hpp"
+#include "BenchmarkUtil.hpp"
+
+#include "Plugin/Common/Game.hpp"
+#include "Plugin/Common/StringUtil.hpp"
+#include "Plugin/Lexer/KeywordTable.hpp"
+#include "Plugin/Lexer/Lexer.hpp"
+#include "Plugin/Lexer/LexerData.hpp"
+#include "Plugin/Lexer/MemoryDocument.hpp"
+
+#include "external/lexilla/WordList.h"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <random>
+#include <thread>
+
+namespace papyrus {
+
+  namespace {
+    // Same as keyword lists in lexer's config file, in the order of Lexer's word lists
+    constexpr const char* WORD_LISTS[] {
+      "( ) [ ] , = + - * / % . ! > < | & as is",
+      "if else elseif endif while endwhile",
+      "bool float int string var",
+      "scriptname extends import debugonly betaonly default event endevent state endstate function endfunction global native struct endstruct "
+        "property endproperty auto autoreadonly conditional hidden const mandatory group endgroup collapsed collapsedonref collapsedonbase "
+        "new return length",
+      "none parent self true false",
+      "if while function struct property group event state",
+      "else elseif",
+      "endif endwhile endfunction native endstruct endproperty auto autoreadonly endgroup endevent endstate"
+    };
+
+    constexpr int TOKENIZE_ITERATIONS = 5;
+    constexpr int FULL_LEX_ITERATIONS = 5;
+    constexpr int KEYWORD_LOOKUP_ITERATIONS = 20;
+    constexpr int NUM_OPEN_BUFFERS = 100;
+    constexpr Sci_Position OPEN_BUFFER_LINES = 500;
+    constexpr int NUM_EDITS = 2000;
+    constexpr Sci_Position VISIBLE_LINES = 60;
+    constexpr Sci_Position EDIT_DISTANCE = 1000;
+
+    // Texts inserted by incremental lex benchmark, including ones that change state of the rest of the document
+    constexpr const char* EDIT_TEXTS[] {
+      "x", " ", "\n", "\r\n", "Count", "(", ")", "\"", "{", "}", ";", ";/", "/;", "If x\n", "EndIf\n", "Int Property Added Auto\n"
+    };
+  }
+
+  std::vector<LexerBenchmark::Result> LexerBenchmark::run(Sci_Position numLines, uint32_t seed) {
+    std::vector<Result> results;
+    if (!lexerData || !lexerData->usable) {
+      return results;
+    }
+
+    // Class names are only looked up when game is known. Use FO4 since the script uses its namespaces.
+    if (lexerData->currentGame == Game::Auto) {
+      lexerData->currentGame = Game::Fallout4;
+    }
+
+    std::string script = generateScript(numLines, seed);
+    results.push_back(runTokenize(script, TOKENIZE_ITERATIONS));
+    results.push_back(runFullLex(script, FULL_LEX_ITERATIONS));
+    results.push_back(runParallelLex(script, FULL_LEX_ITERATIONS, std::clamp(std::thread::hardware_concurrency(), 2u, 8u)));
+    results.push_back(runIncrementalLex(script, NUM_EDITS, seed));
+    results.push_back(runOpenBuffers(generateScript(OPEN_BUFFER_LINES, seed), NUM_OPEN_BUFFERS));
+
+    ScriptWords scriptWords = splitWords(script);
+    results.push_back(runWordListLookup(scriptWords, KEYWORD_LOOKUP_ITERATIONS));
+    results.push_back(runKeywordTableLookup(scriptWords, KEYWORD_LOOKUP_ITERATIONS));
+    return results;
+  }
+
+  uint64_t LexerBenchmark::countTokenizerAllocations(Sci_Position numLines, uint32_t seed) {
+    // First iteration grows tokenizer's buffers to the longest line, second one is measured
+    Result result = runTokenize(generateScript(numLines, seed), 2);
+    return result.allocations;
+  }
+
+  std::string LexerBenchmark::format(const std::vector<Result>& results) {
+    std::string report;
+    for (const auto& result : results) {
+      double lines = static_cast<double>(std::max(result.lines, static_cast<uint64_t>(1)));
+      report += formatString("%s: %llu lines, %llu bytes, %llu runs\n", result.name.c_str(),
+        static_cast<unsigned long long>(result.lines), static_cast<unsigned long long>(result.bytes), static_cast<unsigned long long>(result.operations));
+      report += formatString("    %.1f ns/line, %.2f MB/s, %.3f allocations/line\n", result.seconds * 1e9 / lines,
+        result.seconds > 0 ? result.bytes / result.seconds / (1024 * 1024) : 0.0, result.allocations / lines);
+      if (result.memoryPerBuffer > 0) {
+        report += formatString("    %.1f KB heap memory per buffer\n", result.memoryPerBuffer / 1024.0);
+      }
+      if (result.keywordLookups > 0) {
+        report += formatString("    %llu words looked up, %llu in word lists\n",
+          static_cast<unsigned long long>(result.keywordLookups), static_cast<unsigned long long>(result.keywordMatches));
+      } else if (result.classNameLookups > 0) {
+        report += formatString("    Class name cache hit rate: %.1f%% (%llu/%llu)\n", 100.0 * result.classNameCacheHits / result.classNameLookups,
+          static_cast<unsigned long long>(result.classNameCacheHits), static_cast<unsigned long long>(result.classNameLookups));
+      } else {
+        report += "    Class name cache not used\n";
+      }
+    }
+    return report;
+  }
+
+  std::string LexerBenchmark::generateScript(Sci_Position numLines, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::string script;
+    Sci_Position lines = 0;
+    auto addLine = [&](int indent, const std::string& line) {
+      script.append(indent * 2, ' ');
+      script += line;
+      script += '\n';
+      ++lines;
+    };
+
+    addLine(0, "ScriptName Bench:Generated:Script" + std::to_string(seed) + " extends Quest Conditional");
+    addLine(0, "{ Synthetic script for lexer benchmark.");
+    addLine(2, "Documentation comments may span lines, and contain UTF-8 texts: Grüße, 漢字, Ελληνικά }");
+    addLine(0, "Import Debug");
+    addLine(0, "Import Bench:Utility");
+    addLine(0, "");
+
+    int numProperties = 0;
+    int numFunctions = 0;
+
+    // Recursively add nested If/While blocks
+    auto addBlock = [&](auto& self, int indent, int depth) -> void {
+      int property = numProperties > 0 ? static_cast<int>(random() % numProperties) : 0;
+      bool isWhile = false;
+      switch (random() % 6) {
+        case 0:
+          addLine(indent, "If count > Count" + std::to_string(property) + " && ratio < 2.5 ; compare with property");
+          break;
+        case 1:
+          addLine(indent, "While count < Count" + std::to_string(property) + " \\");
+          addLine(indent + 2, "&& !Self.IsDisabled()");
+          isWhile = true;
+          break;
+        case 2:
+          addLine(indent, "If Helper" + std::to_string(property) + " != None");
+          break;
+        case 3:
+          addLine(indent, ";/ Multi-line comment before a block,");
+          addLine(indent, "   mentioning If, While and \"strings\" that aren't code");
+          addLine(indent, "   and UTF-8 text: Größe, 文字列, Ωμέγα /;");
+          addLine(indent, "If !Busy");
+          break;
+        case 4:
+          addLine(indent, "Bench:Generated:Helper" + std::to_string(property % 50) + " helper = Helper" + std::to_string(property) + " as Bench:Generated:Helper" + std::to_string(property % 50));
+          addLine(indent, "If helper");
+          break;
+        default:
+          addLine(indent, "Trace(\"Block \\\"" + std::to_string(lines) + "\\\" at depth " + std::to_string(depth) + ": Ünïcödé\") ; trace");
+          addLine(indent, "If true");
+          break;
+      }
+
+      int numStatements = 1 + random() % 3;
+      for (int i = 0; i < numStatements; ++i) {
+        if (depth < 8 && random() % 3 == 0) {
+          self(self, indent + 1, depth + 1);
+        } else {
+          addLine(indent + 1, "count += " + std::to_string(1 + random() % 10) + " ; increment");
+        }
+      }
+      if (!isWhile && random() % 2 == 0) {
+        addLine(indent, "ElseIf count == -1");
+        addLine(indent + 1, "ratio = " + std::to_string(random() % 100) + "." + std::to_string(random() % 100));
+      }
+      addLine(indent, isWhile ? "EndWhile" : "EndIf");
+    };
+
+    while (lines < numLines) {
+      switch (random() % 4) {
+        case 0:
+          // A batch of properties
+          for (int i = 0; i < 10; ++i, ++numProperties) {
+            addLine(0, "Int Property Count" + std::to_string(numProperties) + " = " + std::to_string(random() % 1000) + " Auto");
+            addLine(0, "Bench:Generated:Helper" + std::to_string(numProperties % 50) + " Property Helper" + std::to_string(numProperties) + " Auto Const");
+            addLine(0, "String Property Name" + std::to_string(numProperties) + " = \"Name " + std::to_string(numProperties) + " 名前\" AutoReadOnly");
+          }
+          break;
+
+        case 1:
+          // A long comment
+          addLine(0, "{");
+          for (int i = 0, numCommentLines = 5 + random() % 20; i < numCommentLines; ++i) {
+            addLine(1, "Documentation line " + std::to_string(i) + ": Function Fake" + std::to_string(i) + "() EndFunction, \"not a string\", ; not a comment, ÄÖÜ");
+          }
+          addLine(0, "}");
+          break;
+
+        default:
+          // A function with nested blocks
+          addLine(0, "Float Function Work" + std::to_string(numFunctions) + "(Int count, Float ratio = 1.0, Bench:Generated:Helper" + std::to_string(numFunctions % 50) + " helper = None)");
+          for (int i = 0, numBlocks = 1 + random() % 3; i < numBlocks; ++i) {
+            addBlock(addBlock, 1, 1);
+          }
+          addLine(1, "Return ratio * Count" + std::to_string(numProperties > 0 ? random() % numProperties : 0));
+          addLine(0, "EndFunction");
+          addLine(0, "");
+          ++numFunctions;
+          break;
+      }
+    }
+
+    // Properties used before their declarations
+    addLine(0, "Int Property LateProperty Auto");
+    return script;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runTokenize(const std::string& script, int iterations) {
+    Result result {
+      .name = "Tokenize"
+    };
+
+    // Lex once so that each line is tokenized in the state it starts in, as Lex does
+    MemoryDocument document(script);
+    auto lexer = createLexer();
+    lexDocument(*lexer, document);
+
+    Lexer::Tokenizer tokenizer;
+    Accessor accessor(&document, nullptr);
+    Sci_Position lineCount = document.getLineCount();
+    for (int i = 0; i < iterations; ++i) {
+      // Allocations are counted after buffers have grown, i.e. from the second iteration
+      std::optional<AllocationCounter> allocationCounter;
+      if (i > 0) {
+        allocationCounter.emplace();
+      }
+      auto start = Clock::now();
+      for (Sci_Position line = 0; line < lineCount; ++line) {
+        auto state = static_cast<Lexer::State>(line > 0 ? accessor.GetLineState(line - 1) & Lexer::LINE_STATE_MASK : 0);
+        tokenizer.tokenize(accessor, line, state);
+      }
+      if (i > 0) {
+        result.seconds += secondsSince(start);
+        result.allocations += allocationCounter->count();
+        result.operations++;
+        result.lines += lineCount;
+        result.bytes += document.Length();
+      }
+    }
+    return result;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runFullLex(const std::string& script, int iterations) {
+    Result result {
+      .name = "Full lex"
+    };
+
+    MemoryDocument document(script);
+    auto lexer = createLexer();
+    for (int i = 0; i < iterations; ++i) {
+      AllocationCounter allocationCounter;
+      auto start = Clock::now();
+      lexDocument(*lexer, document);
+      result.seconds += secondsSince(start);
+      result.allocations += allocationCounter.count();
+
+      result.operations++;
+      result.lines += document.getLineCount();
+      result.bytes += document.Length();
+    }
+
+    result.classNameLookups = lexer->statistics.classNameLookups;
+    result.classNameCacheHits = lexer->statistics.classNameCacheHits;
+    return result;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runParallelLex(const std::string& script, int iterations, unsigned int numLexers) {
+    Result result {
+      .name = "Full lex with " + std::to_string(numLexers) + " lexers in parallel"
+    };
+
+    // Lexers subscribe to topics when they are created, which is not thread-safe, so only lexing is done in parallel
+    std::vector<std::unique_ptr<MemoryDocument>> documents;
+    std::vector<std::unique_ptr<Lexer>> lexers;
+    for (unsigned int i = 0; i < numLexers; ++i) {
+      documents.push_back(std::make_unique<MemoryDocument>(script));
+      lexers.push_back(createLexer());
+    }
+
+    AllocationCounter allocationCounter;
+    auto start = Clock::now();
+    {
+      std::vector<std::jthread> threads;
+      for (unsigned int i = 0; i < numLexers; ++i) {
+        threads.emplace_back([&, i] {
+          for (int j = 0; j < iterations; ++j) {
+            lexDocument(*lexers[i], *documents[i]);
+          }
+        });
+      }
+    }
+
+    // Time is wall clock time of all lexers, so ns/line reflects overall throughput
+    result.seconds = secondsSince(start);
+    result.allocations = allocationCounter.count();
+    for (unsigned int i = 0; i < numLexers; ++i) {
+      result.operations += iterations;
+      result.lines += static_cast<uint64_t>(documents[i]->getLineCount()) * iterations;
+      result.bytes += static_cast<uint64_t>(documents[i]->Length()) * iterations;
+      result.classNameLookups += lexers[i]->statistics.classNameLookups;
+      result.classNameCacheHits += lexers[i]->statistics.classNameCacheHits;
+    }
+    return result;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runIncrementalLex(const std::string& script, int numEdits, uint32_t seed) {
+    Result result {
+      .name = "Incremental lex"
+    };
+
+    MemoryDocument document(script);
+    auto lexer = createLexer();
+    lexDocument(*lexer, document);
+    lexer->statistics = {};
+
+    std::mt19937 random(seed);
+    Sci_Position position = 0;
+    for (int i = 0; i < numEdits; ++i) {
+      // Mostly edit near the last edit like typing, sometimes jump to another place in the document. Then restyle the same way
+      // Scintilla does: from the first line not styled to the end of visible lines, assuming the edit is at the top of the view.
+      if (i % 50 == 0) {
+        position = random() % (document.Length() + 1);
+      } else {
+        position = std::clamp(position + static_cast<Sci_Position>(random() % (2 * EDIT_DISTANCE + 1)) - EDIT_DISTANCE, static_cast<Sci_Position>(0), document.Length());
+      }
+      Sci_Position line = document.LineFromPosition(position);
+      Sci_Position linesAdded;
+      if (random() % 3 == 0) {
+        linesAdded = document.deleteText(position, 1 + random() % 8);
+      } else {
+        linesAdded = document.insertText(position, EDIT_TEXTS[random() % std::size(EDIT_TEXTS)]);
+      }
+      lexer->handleLinesChange(line, linesAdded);
+
+      Sci_Position startPos = document.LineStart(document.LineFromPosition(document.getEndStyled()));
+      Sci_Position endPos = document.LineStart(line + VISIBLE_LINES);
+      if (endPos > startPos) {
+        AllocationCounter allocationCounter;
+        auto start = Clock::now();
+        lexer->Lex(startPos, endPos - startPos, 0, &document);
+        lexer->Fold(startPos, endPos - startPos, 0, &document);
+        result.seconds += secondsSince(start);
+        result.allocations += allocationCounter.count();
+
+        result.lines += document.LineFromPosition(endPos - 1) - document.LineFromPosition(startPos) + 1;
+        result.bytes += endPos - startPos;
+      }
+      result.operations++;
+    }
+
+    result.classNameLookups = lexer->statistics.classNameLookups;
+    result.classNameCacheHits = lexer->statistics.classNameCacheHits;
+    return result;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runOpenBuffers(const std::string& script, int numBuffers) {
+    Result result {
+      .name = "Open " + std::to_string(numBuffers) + " buffers"
+    };
+
+    // Documents are Scintilla's memory rather than the lexer's, so they are created before counting
+    std::vector<std::unique_ptr<MemoryDocument>> documents;
+    for (int i = 0; i < numBuffers; ++i) {
+      documents.push_back(std::make_unique<MemoryDocument>(script));
+    }
+
+    // Lex the script once beforehand, so that names it references are already cached, which are shared by all buffers
+    {
+      MemoryDocument document(script);
+      auto lexer = createLexer();
+      lexDocument(*lexer, document);
+      waitForDeclarations(*lexer);
+    }
+
+    std::vector<std::unique_ptr<Lexer>> lexers;
+    AllocationCounter allocationCounter;
+    auto start = Clock::now();
+    for (int i = 0; i < numBuffers; ++i) {
+      lexers.push_back(createLexer());
+      lexDocument(*lexers.back(), *documents[i]);
+    }
+    result.seconds = secondsSince(start);
+    for (const auto& lexer : lexers) {
+      waitForDeclarations(*lexer);
+    }
+    result.allocations = allocationCounter.count();
+    result.memoryPerBuffer = std::max(allocationCounter.bytesInUse(), static_cast<int64_t>(0)) / numBuffers;
+
+    for (int i = 0; i < numBuffers; ++i) {
+      result.operations++;
+      result.lines += documents[i]->getLineCount();
+      result.bytes += documents[i]->Length();
+      result.classNameLookups += lexers[i]->statistics.classNameLookups;
+      result.classNameCacheHits += lexers[i]->statistics.classNameCacheHits;
+    }
+    return result;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runWordListLookup(const ScriptWords& scriptWords, int iterations) {
+    Result result {
+      .name = "Keyword lookup with word lists"
+    };
+
+    // Same as lexer before keyword table was added, which checked each word list in turn
+    Lexilla::WordList wordLists[std::size(WORD_LISTS)];
+    for (size_t i = 0; i < std::size(WORD_LISTS); ++i) {
+      wordLists[i].Set(WORD_LISTS[i]);
+    }
+
+    AllocationCounter allocationCounter;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (const auto& word : scriptWords.words) {
+        const char* text = scriptWords.text.c_str() + word.offset;
+        KeywordTable::category_mask_t categories = 0;
+        for (size_t n = 0; n < std::size(wordLists); ++n) {
+          if (wordLists[n].InList(text)) {
+            categories |= 1 << n;
+          }
+        }
+        if (categories != 0) {
+          result.keywordMatches++;
+        }
+      }
+    }
+    result.seconds = secondsSince(start);
+    result.allocations = allocationCounter.count();
+
+    result.operations = iterations;
+    result.lines = scriptWords.lines * iterations;
+    result.bytes = scriptWords.bytes * iterations;
+    result.keywordLookups = scriptWords.words.size() * iterations;
+    return result;
+  }
+
+  LexerBenchmark::Result LexerBenchmark::runKeywordTableLookup(const ScriptWords& scriptWords, int iterations) {
+    Result result {
+      .name = "Keyword lookup with keyword table"
+    };
+
+    // Same as SimpleLexerBase, category bit n is set for words in word list n
+    KeywordTable keywordTable;
+    for (size_t n = 0; n < std::size(WORD_LISTS); ++n) {
+      std::string_view wordList = WORD_LISTS[n];
+      for (size_t start = wordList.find_first_not_of(' '); start != std::string_view::npos; start = wordList.find_first_not_of(' ', start)) {
+        size_t end = std::min(wordList.find(' ', start), wordList.length());
+        keywordTable.add(wordList.substr(start, end - start), 1 << n);
+        start = end;
+      }
+    }
+    keywordTable.build();
+
+    AllocationCounter allocationCounter;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (const auto& word : scriptWords.words) {
+        if (keywordTable.lookup(std::string_view(scriptWords.text).substr(word.offset, word.length), word.hash) != 0) {
+          result.keywordMatches++;
+        }
+      }
+    }
+    result.seconds = secondsSince(start);
+    result.allocations = allocationCounter.count();
+
+    result.operations = iterations;
+    result.lines = scriptWords.lines * iterations;
+    result.bytes = scriptWords.bytes * iterations;
+    result.keywordLookups = scriptWords.words.size() * iterations;
+    return result;
+  }
+
+  LexerBenchmark::ScriptWords LexerBenchmark::splitWords(const std::string& script) {
+    ScriptWords scriptWords;
+    auto addWord = [&](size_t start, size_t end) {
+      Word word {
+        .offset = static_cast<uint32_t>(scriptWords.text.length()),
+        .length = static_cast<uint32_t>(end - start)
+      };
+      for (size_t i = start; i < end; ++i) {
+        scriptWords.text += static_cast<char>(std::tolower(static_cast<unsigned char>(script[i])));
+      }
+      word.hash = utility::hashOf(std::string_view(scriptWords.text).substr(word.offset, word.length));
+      scriptWords.text += '\0';
+      scriptWords.words.push_back(word);
+    };
+
+    for (size_t i = 0; i < script.length();) {
+      unsigned char ch = script[i];
+      if (std::isalpha(ch) || ch == '_') {
+        size_t start = i;
+        while (i < script.length() && (std::isalnum(static_cast<unsigned char>(script[i])) || script[i] == '_' || script[i] == ':')) {
+          ++i;
+        }
+        addWord(start, i);
+      } else if (std::isdigit(ch)) {
+        while (i < script.length() && (std::isalnum(static_cast<unsigned char>(script[i])) || script[i] == '.')) {
+          ++i;
+        }
+      } else {
+        if (ch == '\n') {
+          scriptWords.lines++;
+        } else if (ch < 128 && !std::isspace(ch)) {
+          addWord(i, i + 1);
+        }
+        ++i;
+      }
+    }
+    scriptWords.bytes = script.length();
+    return scriptWords;
+  }
+
+  std::unique_ptr<Lexer> LexerBenchmark::createLexer() {
+    auto lexer = std::make_unique<Lexer>();
+    lexer->detached = true;
+    for (int i = 0; i < static_cast<int>(std::size(WORD_LISTS)); ++i) {
+      lexer->WordListSet(i, WORD_LISTS[i]);
+    }
+    return lexer;
+  }
+
+  void LexerBenchmark::lexDocument(Lexer& lexer, MemoryDocument& document) {
+    document.clearStyling();
+    lexer.fullLexRequested = true;
+    lexer.Lex(0, document.Length(), 0, &document);
+    lexer.Fold(0, document.Length(), 0, &document);
+  }
+
+  void LexerBenchmark::waitForDeclarations(const Lexer& lexer) {
+    while (!lexer.declarationScanner.getDeclarations()) {
+      std::this_thread::yield();
+    }
+  }
+
+} // namespace
@@ -0,0 +1,104 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>  // Scintilla's Sci_Position.h uses intptr_t without including it
+
+#include "external/scintilla/Sci_Position.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  class Lexer;
+  class MemoryDocument;
+
+  // Measure Lexer's Lex and Fold performance on a synthetic script held in memory, without involving Notepad++ or Scintilla. The script
+  // and the edits made to it only depend on the seed, so results are repeatable and can be used to validate lexer optimizations.
+  class LexerBenchmark {
+    public:
+      struct Result {
+        std::string name;
+        uint64_t operations {0};        // Number of times whole document is lexed (full lex), or number of edits (incremental lex)
+        uint64_t lines {0};             // Number of lines requested to be lexed
+        uint64_t bytes {0};             // Number of bytes requested to be lexed
+        double seconds {0.0};
+        uint64_t allocations {0};
+        uint64_t memoryPerBuffer {0};   // Heap memory held by each lexer after lexing its buffer, when measured
+        uint64_t classNameLookups {0};
+        uint64_t classNameCacheHits {0};
+        uint64_t keywordLookups {0};    // Number of words looked up, when measuring keyword lookup alone
+        uint64_t keywordMatches {0};    // Number of looked up words that belong to any word list
+      };
+
+      // Run tokenizer, full lex and incremental lex benchmarks on a script with given number of lines, measure memory used by lexers of
+      // many open buffers, and compare keyword lookup with keyword table against lookup with a chain of word lists
+      static std::vector<Result> run(Sci_Position numLines = 20000, uint32_t seed = 1);
+
+      // Tokenize a script with given number of lines once to warm up, then again. Returns allocations made by the second pass, which
+      // are expected to be none since tokenizer reuses its buffers.
+      static uint64_t countTokenizerAllocations(Sci_Position numLines = 2000, uint32_t seed = 1);
+
+      // Format results as a readable report
+      static std::string format(const std::vector<Result>& results);
+
+      // Generate a synthetic script with deep nesting, long comments, many properties, FO4's namespaces and UTF-8 texts
+      static std::string generateScript(Sci_Position numLines, uint32_t seed);
+
+      // Create a lexer that is not attached to any Notepad++ buffer, with the same word lists as lexer's config file
+      static std::unique_ptr<Lexer> createLexer();
+
+    private:
+      struct Word {
+        uint32_t offset {0};
+        uint32_t length {0};
+        uint32_t hash {0};
+      };
+
+      // Case-folded words of a script in the order lexer looks them up. Each word is null-terminated in text.
+      struct ScriptWords {
+        std::string text;
+        std::vector<Word> words;
+        uint64_t lines {0};
+        uint64_t bytes {0};
+      };
+
+      static Result runTokenize(const std::string& script, int iterations);
+      static Result runFullLex(const std::string& script, int iterations);
+      static Result runParallelLex(const std::string& script, int iterations, unsigned int numLexers);
+      static Result runIncrementalLex(const std::string& script, int numEdits, uint32_t seed);
+      static Result runOpenBuffers(const std::string& script, int numBuffers);
+      static Result runWordListLookup(const ScriptWords& scriptWords, int iterations);
+      static Result runKeywordTableLookup(const ScriptWords& scriptWords, int iterations);
+
+      // Split script into identifiers and other single ASCII characters, which are what lexer looks up in word lists. Unlike lexer,
+      // words in comments and strings are included as well.
+      static ScriptWords splitWords(const std::string& script);
+
+      // Lex and fold the whole document from scratch
+      static void lexDocument(Lexer& lexer, MemoryDocument& document);
+
+      // Wait until lexer's declaration scanner finishes its first scan, so memory it holds is accounted for
+      static void waitForDeclarations(const Lexer& lexer);
+  };
+
+} // namespace
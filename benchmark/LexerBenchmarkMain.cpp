@@ -0,0 +1,74 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LexerBenchmark.hpp"
+
+#include "Plugin/Lexer/LexerData.hpp"
+#include "Plugin/Lexer/LexerSettings.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace papyrus {
+
+  std::unique_ptr<LexerData> lexerData;
+
+} // namespace
+
+// Run lexer benchmark with the same lexer settings as a default configuration, and print its report.
+//
+//   LexerBenchmark [--lines <number>] [--seed <number>] [--check-allocations]
+//
+// With --check-allocations, only check that tokenizer doesn't allocate once its buffers have grown, and fail if it does.
+int main(int argc, char* argv[]) {
+  using namespace papyrus;
+
+  Sci_Position numLines = 20000;
+  uint32_t seed = 1;
+  bool checkAllocations = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+      numLines = std::strtol(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--check-allocations") == 0) {
+      checkAllocations = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--lines <number>] [--seed <number>] [--check-allocations]" << std::endl;
+      return 2;
+    }
+  }
+
+  LexerSettings settings;
+  settings.enableClassNameCache = true;
+  settings.classNameCacheSize = DEFAULT_CLASS_NAME_CACHE_SIZE;
+  lexerData = std::make_unique<LexerData>(settings);
+
+  if (checkAllocations) {
+    uint64_t allocations = LexerBenchmark::countTokenizerAllocations(numLines, seed);
+    std::cout << "Tokenizer allocations after warm-up: " << allocations << std::endl;
+    return allocations == 0 ? 0 : 1;
+  }
+
+  auto results = LexerBenchmark::run(numLines, seed);
+  std::cout << LexerBenchmark::format(results);
+  return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DirectoryWatcher.hpp"
+
+#ifdef _WIN32
+#include "..\..\external\gsl\include\gsl\util"
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstdint>
+#include <unordered_map>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace utility {
+
+#ifdef _WIN32
+  namespace {
+    constexpr DWORD BUFFER_SIZE = 64 * 1024;  // Max size for watching network shares
+  }
+#elif defined(__linux__)
+  namespace {
+    constexpr size_t BUFFER_SIZE = 64 * 1024;
+    constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+    // Watched directories by watch descriptor, with their paths relative to the watched tree
+    using watches_t = std::unordered_map<int, std::filesystem::path>;
+
+    bool isWithin(const std::filesystem::path& path, const std::filesystem::path& directory) {
+      return std::mismatch(directory.begin(), directory.end(), path.begin(), path.end()).first == directory.end();
+    }
+
+    // Watch a directory and all directories in it, since inotify doesn't watch subdirectories. Returns false if any of them can't be
+    // watched, e.g. when running out of inotify watches.
+    bool addWatches(int notifyFd, const std::filesystem::path& root, const std::filesystem::path& relativePath, watches_t& watches) {
+      int watchDescriptor = ::inotify_add_watch(notifyFd, (root / relativePath).c_str(), WATCH_MASK);
+      if (watchDescriptor < 0) {
+        // Directory may have been removed or replaced by a file already, which will be reported on its parent
+        return errno == ENOENT || errno == ENOTDIR;
+      }
+      watches[watchDescriptor] = relativePath;
+
+      std::error_code errorCode;
+      auto iter = std::filesystem::directory_iterator(root / relativePath, std::filesystem::directory_options::skip_permission_denied, errorCode);
+      for (; !errorCode && iter != std::filesystem::directory_iterator(); iter.increment(errorCode)) {
+        std::error_code fileErrorCode;
+        if (iter->is_directory(fileErrorCode) && !iter->is_symlink(fileErrorCode)
+          && !addWatches(notifyFd, root, relativePath / iter->path().filename(), watches)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Stop watching a directory moved elsewhere, and all directories in it. Their watch descriptors would otherwise keep reporting
+    // changes with their old paths.
+    void removeWatches(int notifyFd, const std::filesystem::path& relativePath, watches_t& watches) {
+      for (auto iter = watches.begin(); iter != watches.end();) {
+        if (isWithin(iter->second, relativePath)) {
+          ::inotify_rm_watch(notifyFd, iter->first);
+          iter = watches.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+    }
+  }
+#endif
+
+  DirectoryWatcher::DirectoryWatcher(std::wstring directory, change_callback_t&& changeCallback)
+    : directory(std::move(directory)), changeCallback(std::move(changeCallback)) {
+    worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+  }
+
+  DirectoryWatcher::~DirectoryWatcher() {
+    // Make sure worker thread has finished before members are destroyed
+    worker = std::jthread();
+  }
+
+  // Private methods
+  //
+
+  void DirectoryWatcher::run(std::stop_token stopToken) {
+    if (!watch(stopToken) && !stopToken.stop_requested()) {
+      poll(stopToken);
+    }
+  }
+
+  bool DirectoryWatcher::watch([[maybe_unused]] std::stop_token stopToken) {
+#ifdef _WIN32
+    HANDLE directoryHandle = ::CreateFile(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+      FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directoryHandle == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+
+    OVERLAPPED overlapped {};
+    overlapped.hEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    HANDLE stopEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    auto autoCleanup = gsl::finally([&] {
+      ::CloseHandle(stopEvent);
+      ::CloseHandle(overlapped.hEvent);
+      ::CloseHandle(directoryHandle);
+    });
+    if (overlapped.hEvent == nullptr || stopEvent == nullptr) {
+      return false;
+    }
+    std::stop_callback stopCallback(stopToken, [&] { ::SetEvent(stopEvent); });
+
+    // Buffer must be DWORD-aligned
+    std::vector<DWORD> buffer(BUFFER_SIZE / sizeof(DWORD));
+    bool watching = false;
+    while (!stopToken.stop_requested()) {
+      ::ResetEvent(overlapped.hEvent);
+      if (!::ReadDirectoryChangesW(directoryHandle, buffer.data(), BUFFER_SIZE, TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME, nullptr, &overlapped, nullptr)) {
+        break;
+      }
+      watching = true;
+
+      HANDLE handles[] {overlapped.hEvent, stopEvent};
+      DWORD bytesReturned = 0;
+      if (::WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+        // Buffer and OVERLAPPED must stay valid until the cancelled request completes
+        ::CancelIoEx(directoryHandle, &overlapped);
+        ::GetOverlappedResult(directoryHandle, &overlapped, &bytesReturned, TRUE);
+        return true;
+      }
+      if (!::GetOverlappedResult(directoryHandle, &overlapped, &bytesReturned, FALSE)) {
+        // E.g. the directory itself was removed
+        break;
+      }
+      if (bytesReturned == 0) {
+        // Too many changes to fit in buffer
+        changeCallback(Change::Overflow, std::filesystem::path());
+        continue;
+      }
+
+      auto data = reinterpret_cast<const BYTE*>(buffer.data());
+      while (true) {
+        auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data);
+        std::filesystem::path relativePath(std::wstring_view(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+        switch (info->Action) {
+          case FILE_ACTION_ADDED:
+          case FILE_ACTION_RENAMED_NEW_NAME:
+            changeCallback(Change::Added, relativePath);
+            break;
+
+          case FILE_ACTION_REMOVED:
+          case FILE_ACTION_RENAMED_OLD_NAME:
+            changeCallback(Change::Removed, relativePath);
+            break;
+        }
+
+        if (info->NextEntryOffset == 0) {
+          break;
+        }
+        data += info->NextEntryOffset;
+      }
+    }
+
+    // Changes after watching stopped working are unknown until polling takes over
+    if (watching && !stopToken.stop_requested()) {
+      changeCallback(Change::Overflow, std::filesystem::path());
+    }
+    return false;
+#elif defined(__linux__)
+    int notifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notifyFd < 0) {
+      return false;
+    }
+    int stopFd = ::eventfd(0, EFD_CLOEXEC);
+    if (stopFd < 0) {
+      ::close(notifyFd);
+      return false;
+    }
+
+    bool stopped = watchTree(notifyFd, stopFd, stopToken);
+    ::close(stopFd);
+    ::close(notifyFd);
+    return stopped;
+#else
+    return false;
+#endif
+  }
+
+#if !defined(_WIN32) && defined(__linux__)
+  bool DirectoryWatcher::watchTree(int notifyFd, int stopFd, std::stop_token stopToken) {
+    std::filesystem::path root(directory);
+    watches_t watches;
+    if (!addWatches(notifyFd, root, std::filesystem::path(), watches)) {
+      return false;
+    }
+    std::stop_callback stopCallback(stopToken, [&] {
+      uint64_t value = 1;
+      [[maybe_unused]] auto written = ::write(stopFd, &value, sizeof(value));
+    });
+
+    // Buffer must be aligned for inotify_event
+    std::vector<inotify_event> buffer(BUFFER_SIZE / sizeof(inotify_event));
+    pollfd fds[] {{notifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+    while (!stopToken.stop_requested()) {
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      if (fds[1].revents != 0) {
+        return true;
+      }
+
+      ssize_t size = ::read(notifyFd, buffer.data(), buffer.size() * sizeof(inotify_event));
+      if (size < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+          continue;
+        }
+        break;
+      }
+
+      bool watching = true;
+      auto data = reinterpret_cast<const char*>(buffer.data());
+      for (ssize_t offset = 0; offset < size && watching;) {
+        auto event = reinterpret_cast<const inotify_event*>(data + offset);
+        offset += sizeof(inotify_event) + event->len;
+        if (event->mask & IN_Q_OVERFLOW) {
+          changeCallback(Change::Overflow, std::filesystem::path());
+          continue;
+        }
+
+        auto iter = watches.find(event->wd);
+        if (iter == watches.end()) {
+          continue;
+        }
+        if (event->mask & IN_IGNORED) {
+          // Watched directory was removed. If it's the directory itself, polling takes over like on Windows.
+          watching = !iter->second.empty();
+          watches.erase(iter);
+          continue;
+        }
+
+        std::filesystem::path relativePath = iter->second / event->name;
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          // Files added to a new directory before it's watched are missed, but an added directory means everything in it is new anyway
+          if ((event->mask & IN_ISDIR) && !addWatches(notifyFd, root, relativePath, watches)) {
+            watching = false;
+          }
+          changeCallback(Change::Added, relativePath);
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+          if ((event->mask & (IN_ISDIR | IN_MOVED_FROM)) == (IN_ISDIR | IN_MOVED_FROM)) {
+            removeWatches(notifyFd, relativePath, watches);
+          }
+          changeCallback(Change::Removed, relativePath);
+        }
+      }
+      if (!watching) {
+        break;
+      }
+    }
+
+    // Changes after watching stopped working are unknown until polling takes over
+    if (!stopToken.stop_requested()) {
+      changeCallback(Change::Overflow, std::filesystem::path());
+    }
+    return false;
+  }
+#endif
+
+  void DirectoryWatcher::poll(std::stop_token stopToken) {
+    std::mutex mutex;
+    std::condition_variable_any stopped;
+    std::set<std::filesystem::path> files;
+    bool hasPreviousScan = false;
+    while (!stopToken.stop_requested()) {
+      std::set<std::filesystem::path> currentFiles;
+      std::error_code errorCode;
+      auto iter = std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, errorCode);
+      for (; !errorCode && iter != std::filesystem::recursive_directory_iterator(); iter.increment(errorCode)) {
+        if (stopToken.stop_requested()) {
+          return;
+        }
+
+        std::error_code fileErrorCode;
+        if (iter->is_regular_file(fileErrorCode)) {
+          currentFiles.insert(iter->path().lexically_relative(directory));
+        }
+      }
+
+      // First scan is only the baseline to compare with
+      if (hasPreviousScan) {
+        std::vector<std::filesystem::path> changedFiles;
+        std::set_difference(currentFiles.begin(), currentFiles.end(), files.begin(), files.end(), std::back_inserter(changedFiles));
+        for (const auto& file : changedFiles) {
+          changeCallback(Change::Added, file);
+        }
+
+        changedFiles.clear();
+        std::set_difference(files.begin(), files.end(), currentFiles.begin(), currentFiles.end(), std::back_inserter(changedFiles));
+        for (const auto& file : changedFiles) {
+          changeCallback(Change::Removed, file);
+        }
+      }
+      files = std::move(currentFiles);
+      hasPreviousScan = true;
+
+      std::unique_lock<std::mutex> lock(mutex);
+      stopped.wait_for(lock, stopToken, POLL_INTERVAL, [] { return false; });
+    }
+  }
+
+} // namespace
@@ -0,0 +1,78 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+namespace utility {
+
+  // Watch a directory tree for files and directories being added, removed or renamed, on a worker thread. Changes are reported as soon
+  // as the system reports them, via ReadDirectoryChangesW on Windows and inotify on Linux. If the directory can't be watched that way,
+  // e.g. on some network shares or when running out of inotify watches, it's polled periodically instead, which only reports files.
+  // On other platforms, it's always polled.
+  //
+  class DirectoryWatcher {
+    public:
+      enum class Change {
+        Added,
+        Removed,
+        Overflow  // Changes were lost, so everything in the directory needs to be checked again
+      };
+
+      // Callback is called on the worker thread with path relative to watched directory, which is empty for Overflow
+      using change_callback_t = std::function<void(Change change, const std::filesystem::path& relativePath)>;
+
+      DirectoryWatcher(std::wstring directory, change_callback_t&& changeCallback);
+
+      // Disable all copy/move constructors/assignment operators
+      DirectoryWatcher(DirectoryWatcher&& other) = delete;
+
+      // Destructor will stop watching and wait for worker thread to finish
+      ~DirectoryWatcher();
+
+      inline const std::wstring& getDirectory() const noexcept { return directory; }
+
+    private:
+      static constexpr auto POLL_INTERVAL = std::chrono::seconds(5);
+
+      void run(std::stop_token stopToken);
+
+      // Watch with ReadDirectoryChangesW or inotify until stopped. Returns false if it's not supported for the directory, or stops
+      // working, so polling should take over.
+      bool watch(std::stop_token stopToken);
+#if !defined(_WIN32) && defined(__linux__)
+      // Watch the directory tree with given inotify instance, until stopped or an event is written to stopFd. Same result as watch.
+      bool watchTree(int notifyFd, int stopFd, std::stop_token stopToken);
+#endif
+      void poll(std::stop_token stopToken);
+
+      // Private members
+      //
+      std::wstring directory;
+      change_callback_t changeCallback;
+      std::jthread worker;
+  };
+
+} // namespace
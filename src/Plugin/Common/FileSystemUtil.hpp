@@ -21,13 +21,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <string>
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
 
 namespace utility {
 
   inline bool fileExists(const std::wstring& filePath) {
+#ifdef _WIN32
     DWORD dwAttrib = ::GetFileAttributes(filePath.c_str());
     return (dwAttrib != INVALID_FILE_ATTRIBUTES && !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+#else
+    std::error_code ec;
+    return std::filesystem::is_regular_file(filePath, ec);
+#endif
   }
 
 } // namespace
@@ -21,8 +21,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "FileSystemUtil.hpp"
 
-#include "..\..\external\gsl\include\gsl\util"
-
 #include <fstream>
 #include <sstream>
 
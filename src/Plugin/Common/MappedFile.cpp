@@ -0,0 +1,103 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MappedFile.hpp"
+
+#ifndef _WIN32
+#include <cstdint>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utility {
+
+#ifdef _WIN32
+  MappedFile::MappedFile(const std::wstring& filePath) noexcept
+    : filePath(filePath) {
+    // Others can still read the file, but can't change it while it's mapped
+    fileHandle = ::CreateFile(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+      return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0 || static_cast<unsigned long long>(fileSize.QuadPart) > SIZE_MAX) {
+      return;
+    }
+
+    mappingHandle = ::CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+      return;
+    }
+
+    view = ::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view != nullptr) {
+      viewSize = static_cast<size_t>(fileSize.QuadPart);
+    }
+  }
+
+  MappedFile::~MappedFile() {
+    if (view != nullptr) {
+      ::UnmapViewOfFile(view);
+    }
+    if (mappingHandle != nullptr) {
+      ::CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+      ::CloseHandle(fileHandle);
+    }
+  }
+#else
+  MappedFile::MappedFile(const std::wstring& filePath) noexcept
+    : filePath(filePath) {
+    int fileDescriptor;
+    try {
+      fileDescriptor = ::open(std::filesystem::path(filePath).c_str(), O_RDONLY | O_CLOEXEC);
+    } catch (...) {
+      // File path can't be converted to native encoding
+      return;
+    }
+    if (fileDescriptor < 0) {
+      return;
+    }
+
+    // Mapping stays valid after file descriptor is closed
+    struct stat fileStatus;
+    if (::fstat(fileDescriptor, &fileStatus) == 0 && fileStatus.st_size > 0 && static_cast<unsigned long long>(fileStatus.st_size) <= SIZE_MAX) {
+      void* mapping = ::mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+      if (mapping != MAP_FAILED) {
+        view = mapping;
+        viewSize = static_cast<size_t>(fileStatus.st_size);
+      }
+    }
+    ::close(fileDescriptor);
+  }
+
+  MappedFile::~MappedFile() {
+    if (view != nullptr) {
+      ::munmap(const_cast<void*>(view), viewSize);
+    }
+  }
+#endif
+
+} // namespace
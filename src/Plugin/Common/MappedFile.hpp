@@ -0,0 +1,64 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace utility {
+
+  // A read-only view of a whole file mapped into memory. Contents are paged in by OS on access, so opening a large file is cheap and
+  // data can be used in place without copying. On Windows, the file can't be written to while it's mapped. Elsewhere it's mapped with
+  // mmap, and the file shouldn't be changed while it's mapped.
+  //
+  class MappedFile {
+    public:
+      // Map given file. Use isValid() to check whether it succeeded, e.g. the file may not exist or may be empty.
+      [[nodiscard]] explicit MappedFile(const std::wstring& filePath) noexcept;
+
+      // Disable all copy/move constructors/assignment operators
+      MappedFile(MappedFile&& other) = delete;
+
+      // Destructor will unmap the file and release file handles
+      ~MappedFile();
+
+      inline bool isValid() const noexcept { return view != nullptr; }
+      inline const char* data() const noexcept { return static_cast<const char*>(view); }
+      inline size_t size() const noexcept { return viewSize; }
+      inline std::string_view contents() const noexcept { return std::string_view(data(), viewSize); }
+      inline const std::wstring& getFilePath() const noexcept { return filePath; }
+
+    private:
+      // Private members
+      //
+      std::wstring filePath;
+#ifdef _WIN32
+      HANDLE fileHandle {INVALID_HANDLE_VALUE};
+      HANDLE mappingHandle {nullptr};
+#endif
+      const void* view {nullptr};
+      size_t viewSize {0};
+  };
+
+} // namespace
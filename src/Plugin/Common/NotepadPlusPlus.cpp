@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "..\..\external\npp\Notepad_plus_msgs.h"
 #include "..\..\external\npp\PluginInterface.h"
 
+#include <algorithm>
+
 namespace utility {
 
   std::wstring getFilePathFromBuffer(HWND nppHandle, npp_buffer_t bufferID) {
@@ -54,6 +56,21 @@ namespace utility {
     return bufferID;
   }
 
+  std::vector<npp_buffer_t> getOpenBufferIDs(HWND nppHandle) {
+    std::vector<npp_buffer_t> bufferIDs;
+    for (npp_view_t view : {MAIN_VIEW, SUB_VIEW}) {
+      npp_index_t numFiles = static_cast<npp_index_t>(::SendMessage(nppHandle, NPPM_GETNBOPENFILES, 0, view == MAIN_VIEW ? PRIMARY_VIEW : SECOND_VIEW));
+      for (npp_index_t docIndex = 0; docIndex < numFiles; ++docIndex) {
+        npp_buffer_t bufferID = static_cast<npp_buffer_t>(::SendMessage(nppHandle, NPPM_GETBUFFERIDFROMPOS, static_cast<WPARAM>(docIndex), static_cast<LPARAM>(view)));
+        if (bufferID != 0 && std::find(bufferIDs.begin(), bufferIDs.end(), bufferID) == bufferIDs.end()) {
+          bufferIDs.push_back(bufferID);
+        }
+      }
+    }
+
+    return bufferIDs;
+  }
+
   std::wstring getApplicableFilePathOnView(HWND nppHandle, npp_view_t view) {
     // Make sure it is a Papyrus script
     std::wstring filePath = getActiveFilePathOnView(nppHandle, view);
@@ -19,19 +19,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "NotepadPlusPlusTypes.hpp"
+
 #include <string>
+#include <vector>
 
 #include <windows.h>
 
-using npp_view_t      = int;
-using npp_lang_type_t = int;
-using npp_index_t     = int32_t;
-using npp_buffer_t    = intptr_t;
-using npp_size_t      = size_t;
-using npp_length_t    = intptr_t;
-using npp_position_t  = intptr_t;
-using npp_ptr_t       = void*;
-
 // These definitions are copied from Notepad++'s menuCmdID.h.
 // They are unlikely to change but make sure they are checked and updated as needed
 // with each new Notepad++ releases.
@@ -53,6 +47,9 @@ namespace utility {
   // Retrieve the Notepad++ buffer ID of the active document on a given view
   npp_buffer_t getActiveBufferIdOnView(HWND nppHandle, npp_view_t view);
 
+  // Retrieve the Notepad++ buffer IDs of all open documents on both views. A document open on both views is only listed once.
+  std::vector<npp_buffer_t> getOpenBufferIDs(HWND nppHandle);
+
   // Retrieve the full file path of the active document on a given view
   inline std::wstring getActiveFilePathOnView(HWND nppHandle, npp_view_t view) {
     npp_buffer_t bufferID = getActiveBufferIdOnView(nppHandle, view);
@@ -0,0 +1,34 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Types of Notepad++ messages' parameters and results. They don't depend on Windows API, so code that only needs to pass them along
+// can be built without it.
+using npp_view_t      = int;
+using npp_lang_type_t = int;
+using npp_index_t     = int32_t;
+using npp_buffer_t    = intptr_t;
+using npp_size_t      = size_t;
+using npp_length_t    = intptr_t;
+using npp_position_t  = intptr_t;
+using npp_ptr_t       = void*;
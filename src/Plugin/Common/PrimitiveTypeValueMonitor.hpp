@@ -22,16 +22,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Topic.hpp"
 
 #include <functional>
+#include <utility>
 
 namespace utility {
 
   template <class T>
   class PrimitiveTypeValueMonitor {
     public:
-      template <class T>
+      template <class V>
       struct ValueChangeEventData {
-        T oldValue;
-        T newValue;
+        V oldValue;
+        V newValue;
       };
 
       using event_data_t = ValueChangeEventData<T>;
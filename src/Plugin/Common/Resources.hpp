@@ -41,9 +41,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PPM_COMPILER_NOT_FOUND    (WM_USER + 3)
 #define PPM_OTHER_ERROR           (WM_USER + 4)
 #define PPM_JUMP_TO_ERROR         (WM_USER + 5)
+#define PPM_DECLARATIONS_SCANNED  (WM_USER + 6)
+#define PPM_CLASSES_CHANGED       (WM_USER + 7)
+#define PPM_MATCH_KEYWORD         (WM_USER + 8)
+#define PPM_BATCH_FILE_COMPILED   (WM_USER + 9)
+#define PPM_BATCH_FINISHED        (WM_USER + 10)
+#define PPM_COMPILATION_ERROR     (WM_USER + 11)
+#define PPM_BUILD_PLANNED         (WM_USER + 12)
 
 #define PARAM_COMPILATION_ONLY                0
 #define PARAM_COMPILATION_WITH_ANONYMIZATION  1
+#define PARAM_COMPILATION_CACHED              2
 
 //
 // Resources
@@ -90,6 +98,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IDS_SETTINGS_LEXER_FOLD_MIDDLE_TOOLTIP            (IDC_SETTINGS_LEXER_FOLD_MIDDLE + 1)
 #define IDC_SETTINGS_LEXER_CLASS_NAME_CACHING             (IDC_SETTINGS_LEXER_SCRIPT_GROUP + 11)
 #define IDS_SETTINGS_LEXER_CLASS_NAME_CACHING_TOOLTIP     (IDC_SETTINGS_LEXER_CLASS_NAME_CACHING + 1)
+#define IDC_SETTINGS_LEXER_CLASS_NAME_CACHE_SIZE_LABEL    (IDC_SETTINGS_LEXER_CLASS_NAME_CACHING + 2)
+#define IDC_SETTINGS_LEXER_CLASS_NAME_CACHE_SIZE          (IDC_SETTINGS_LEXER_CLASS_NAME_CACHING + 3)
 #define IDC_SETTINGS_LEXER_CLASS_LINK                     (IDC_SETTINGS_LEXER_SCRIPT_GROUP + 21)
 #define IDS_SETTINGS_LEXER_CLASS_LINK_TOOLTIP             (IDC_SETTINGS_LEXER_CLASS_LINK + 1)
 #define IDC_SETTINGS_LEXER_CLASS_LINK_UNDERLINE           (IDC_SETTINGS_LEXER_CLASS_LINK + 2)
@@ -130,6 +140,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IDC_SETTINGS_MATCHER_UNMATCHED_STYLE_LABEL        (IDC_SETTINGS_MATCHER + 41)
 #define IDC_SETTINGS_MATCHER_UNMATCHED_STYLE_DROPDOWN     (IDC_SETTINGS_MATCHER_UNMATCHED_STYLE_LABEL + 1)
 #define IDC_SETTINGS_MATCHER_UNMATCHED_FGCOLOR_LABEL      (IDC_SETTINGS_MATCHER_UNMATCHED_STYLE_LABEL + 2)
+#define IDC_SETTINGS_MATCHER_OCCURRENCES                  (IDC_SETTINGS_MATCHER + 51)
+#define IDS_SETTINGS_MATCHER_OCCURRENCES_TOOLTIP          (IDC_SETTINGS_MATCHER_OCCURRENCES + 1)
+#define IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_LABEL       (IDC_SETTINGS_MATCHER_OCCURRENCES + 2)
+#define IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_DROPDOWN    (IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_LABEL + 1)
+#define IDC_SETTINGS_MATCHER_OCCURRENCE_FGCOLOR_LABEL     (IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_LABEL + 2)
 
 #define IDC_SETTINGS_TAB_ERROR_ANNOTATOR                  18700
 #define IDC_SETTINGS_ANNOTATOR_ANNOTATION_GROUP           (IDC_SETTINGS_TAB_ERROR_ANNOTATOR + 1)
@@ -158,6 +173,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IDC_SETTINGS_COMPILER_RADIO_FO4                   (IDC_SETTINGS_COMPILER_GAMES_GROUP + 4)
 #define IDS_SETTINGS_COMPILER_RADIO_AUTO_TOOLTIP          (IDC_SETTINGS_COMPILER_GAMES_GROUP + 5)
 #define IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE      (IDC_SETTINGS_COMPILER_GAMES_GROUP + 10)
+#define IDC_SETTINGS_COMPILER_BATCH_JOBS_LABEL            (IDC_SETTINGS_COMPILER_GAMES_GROUP + 11)
+#define IDC_SETTINGS_COMPILER_BATCH_JOBS                  (IDC_SETTINGS_COMPILER_GAMES_GROUP + 12)
+#define IDS_SETTINGS_COMPILER_BATCH_JOBS_TOOLTIP          (IDC_SETTINGS_COMPILER_GAMES_GROUP + 13)
+#define IDC_SETTINGS_COMPILER_USE_CACHE                   (IDC_SETTINGS_COMPILER_GAMES_GROUP + 14)
+#define IDS_SETTINGS_COMPILER_USE_CACHE_TOOLTIP           (IDC_SETTINGS_COMPILER_GAMES_GROUP + 15)
 #define IDC_SETTINGS_COMPILER_AUTO_DEFAULT_GAME_LABEL     (IDC_SETTINGS_COMPILER_GAMES_GROUP + 30)
 #define IDC_SETTINGS_COMPILER_AUTO_DEFAULT_GAME_DROPDOWN  (IDC_SETTINGS_COMPILER_GAMES_GROUP + 31)
 #define IDC_SETTINGS_COMPILER_AUTO_DEFAULT_OUTPUT_LABEL   (IDC_SETTINGS_COMPILER_GAMES_GROUP + 32)
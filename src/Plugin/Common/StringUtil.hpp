@@ -20,17 +20,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <algorithm>
+#include <cctype>
 #include <cwctype>
-#include <format>
+#include <iterator>
 #include <sstream>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#ifdef _WIN32
+#include <format>
+
 #include <windows.h>
+#endif
 
 namespace utility {
 
-  // Conversion between string and other types
+#ifdef _WIN32
+  // Conversion between string and other types. Only settings use them, so they are left out of builds for other platforms.
   //
   inline bool strToBool(const std::wstring& str) noexcept {
     bool boolValue = false;
@@ -58,6 +66,7 @@ namespace utility {
     return ((color >> 16) & 0xFF) | (color & 0xFF00) | ((color & 0xFF) << 16);
   }
   inline std::wstring colorToHexStr(COLORREF color) noexcept { return std::format(L"{:06X}", (((color >> 16) & 0xFF) | (color & 0xFF00) | ((color & 0xFF) << 16))); } // COLORREF is BGR
+#endif
 
   // String utilities
   //
@@ -97,6 +106,15 @@ namespace utility {
     return compare(str1.substr(str1.length() - str2.length(), std::string::npos), str2, ignoreCase);
   }
 
+  // FNV-1a hash. Being constexpr, hash of a string literal can be calculated at compile time.
+  constexpr uint32_t hashOf(std::string_view str) noexcept {
+    uint32_t hash = 2166136261u;
+    for (char ch : str) {
+      hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+    }
+    return hash;
+  }
+
   size_t indexOf(const std::string& str1, const std::string& str2, size_t startIndex = 0, bool ignoreCase = true) noexcept;
   size_t indexOf(const std::wstring& str1, const std::wstring& str2, size_t startIndex = 0, bool ignoreCase = true) noexcept;
 
@@ -0,0 +1,72 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace utility {
+
+  using Lock = std::unique_lock<std::mutex>;
+
+  ThreadPool::ThreadPool(size_t numThreads) {
+    workers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+      workers.emplace_back([this](std::stop_token stopToken) { run(stopToken); });
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    for (auto& worker : workers) {
+      worker.request_stop();
+    }
+    workers.clear();
+  }
+
+  std::future<void> ThreadPool::submit(std::move_only_function<void()> task) {
+    std::packaged_task<void()> packagedTask(std::move(task));
+    auto future = packagedTask.get_future();
+    {
+      Lock lock(mutex);
+      tasks.push_back(std::move(packagedTask));
+    }
+    taskAvailable.notify_one();
+    return future;
+  }
+
+  size_t ThreadPool::hardwareConcurrency() noexcept {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  void ThreadPool::run(std::stop_token stopToken) {
+    while (true) {
+      std::packaged_task<void()> task;
+      {
+        Lock lock(mutex);
+        if (!taskAvailable.wait(lock, stopToken, [this] { return !tasks.empty(); }) || stopToken.stop_requested()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+} // namespace
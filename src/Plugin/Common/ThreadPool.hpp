@@ -0,0 +1,63 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace utility {
+
+  // A fixed number of worker threads running submitted tasks in the order they are submitted. Destroying the pool waits for running
+  // tasks to finish, and discards tasks that haven't started, whose futures then report a broken promise.
+  class ThreadPool {
+    public:
+      explicit ThreadPool(size_t numThreads);
+
+      // Disable all copy/move constructors/assignment operators
+      ThreadPool(ThreadPool&& other) = delete;
+
+      ~ThreadPool();
+
+      // Queue a task. Returned future becomes ready when the task finishes, and rethrows the exception thrown by it, if any.
+      std::future<void> submit(std::move_only_function<void()> task);
+
+      inline size_t size() const noexcept { return workers.size(); }
+
+      // Number of threads for CPU bound work, which is at least 1
+      static size_t hardwareConcurrency() noexcept;
+
+    private:
+      void run(std::stop_token stopToken);
+
+      // Private members
+      //
+      std::mutex mutex;
+      std::condition_variable_any taskAvailable;
+      std::deque<std::packaged_task<void()>> tasks;
+      std::vector<std::jthread> workers;
+  };
+
+} // namespace
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <list>
 #include <memory>
@@ -31,19 +32,19 @@ namespace utility {
       using handler_t = std::function<void(const T&)>;
 
       // Represents a subscription on the topic
-      template <class T>
+      template <class M>
       class Subscription {
-        friend class Topic<T>;
+        friend class Topic<M>;
 
         public:
-          using topic_t = Topic<T>;
+          using topic_t = Topic<M>;
           using handler_t = topic_t::handler_t;
 
           [[nodiscard]] inline Subscription(topic_t& topic, handler_t&& func) noexcept : topic(topic), handler(func), subscribed(true) {}
           inline ~Subscription() { unsubscribe(); }
 
           // Message from subscribed topic
-          inline void notify(const T& message) {
+          inline void notify(const M& message) {
             if (subscribed) {
               handler(message);
             }
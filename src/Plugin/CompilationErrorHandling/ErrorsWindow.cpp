@@ -64,26 +64,14 @@ namespace papyrus {
 
   void ErrorsWindow::show(const std::vector<Error>& compilationErrors) {
     errors = compilationErrors;
-    for (int i = 0; i < static_cast<int>(errors.size()); ++i) {
-      std::wstring filename = std::filesystem::path(errors[i].file).filename();
-      LVITEM item {
-        .mask = LVIF_TEXT,
-        .iItem = i,
-        .pszText = const_cast<LPWSTR>(filename.c_str())
-      };
-      ListView_InsertItem(listView, &item);
-      item.iSubItem = 1;
-      item.pszText = const_cast<LPWSTR>(errors[i].message.c_str());
-      ListView_SetItem(listView, &item);
-      item.iSubItem = 2;
-      std::wstring line = std::to_wstring(errors[i].line);
-      item.pszText = const_cast<LPWSTR>(line.c_str());
-      ListView_SetItem(listView, &item);
-      item.iSubItem = 3;
-      std::wstring column = std::to_wstring(errors[i].column);
-      item.pszText = const_cast<LPWSTR>(column.c_str());
-      ListView_SetItem(listView, &item);
-    }
+    insertItems(0);
+    display();
+  }
+
+  void ErrorsWindow::add(const std::vector<Error>& compilationErrors) {
+    size_t firstIndex = errors.size();
+    errors.insert(errors.end(), compilationErrors.begin(), compilationErrors.end());
+    insertItems(firstIndex);
     display();
   }
 
@@ -128,6 +116,29 @@ namespace papyrus {
     ListView_SetColumnWidth(listView, 1, messageColWidth);
   }
 
+  void ErrorsWindow::insertItems(size_t firstIndex) const {
+    for (int i = static_cast<int>(firstIndex); i < static_cast<int>(errors.size()); ++i) {
+      std::wstring filename = std::filesystem::path(errors[i].file).filename();
+      LVITEM item {
+        .mask = LVIF_TEXT,
+        .iItem = i,
+        .pszText = const_cast<LPWSTR>(filename.c_str())
+      };
+      ListView_InsertItem(listView, &item);
+      item.iSubItem = 1;
+      item.pszText = const_cast<LPWSTR>(errors[i].message.c_str());
+      ListView_SetItem(listView, &item);
+      item.iSubItem = 2;
+      std::wstring line = std::to_wstring(errors[i].line);
+      item.pszText = const_cast<LPWSTR>(line.c_str());
+      ListView_SetItem(listView, &item);
+      item.iSubItem = 3;
+      std::wstring column = std::to_wstring(errors[i].column);
+      item.pszText = const_cast<LPWSTR>(column.c_str());
+      ListView_SetItem(listView, &item);
+    }
+  }
+
   void ErrorsWindow::clear() {
     ListView_DeleteAllItems(listView);
     errors.clear();
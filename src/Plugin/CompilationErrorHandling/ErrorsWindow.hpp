@@ -37,6 +37,9 @@ namespace papyrus {
       ErrorsWindow(HINSTANCE instance, HWND parent, HWND pluginMessageWindow);
 
       void show(const std::vector<Error>& compilationErrors);
+
+      // Append errors to the list and show the window, e.g. errors of each script in a batch compilation
+      void add(const std::vector<Error>& compilationErrors);
       inline void hide() { display(false); }
       void clear();
 
@@ -46,6 +49,9 @@ namespace papyrus {
     private:
       void resize() const;
 
+      // Insert list items for errors starting from given index
+      void insertItems(size_t firstIndex) const;
+
       // Private members
       //
       HWND pluginMessageWindow;
@@ -0,0 +1,155 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BatchCompiler.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  using Lock = std::unique_lock<std::mutex>;
+
+  BatchCompiler::BatchCompiler(compile_function_t&& compileFunction, compiled_callback_t&& compiledCallback, finished_callback_t&& finishedCallback)
+    : compileFunction(std::move(compileFunction)), compiledCallback(std::move(compiledCallback)), finishedCallback(std::move(finishedCallback)) {
+  }
+
+  BatchCompiler::~BatchCompiler() {
+    {
+      // Waiting scripts are only started with lock held after checking cancellation, so none is started once lock is released.
+      Lock lock(mutex);
+      cancel();
+    }
+    threadPool.reset();
+  }
+
+  bool BatchCompiler::start(std::vector<CompilationRequest>&& newRequests, size_t maxJobs, std::vector<std::vector<size_t>>&& dependencies) {
+    if (isRunning() || newRequests.empty()) {
+      return false;
+    }
+
+    // Workers of last batch are idle once it's no longer running.
+    threadPool.reset();
+
+    requests = std::move(newRequests);
+    progress = Progress {
+      .total = requests.size()
+    };
+    dependants.assign(dependencies.empty() ? 0 : requests.size(), std::vector<size_t>());
+    waitingCounts.assign(requests.size(), 0);
+    dependencyFailed.assign(requests.size(), false);
+    for (size_t i = 0; i < dependencies.size(); ++i) {
+      waitingCounts[i] = dependencies[i].size();
+      for (size_t dependency : dependencies[i]) {
+        dependants[dependency].push_back(i);
+      }
+    }
+
+    // Find scripts ready to compile before starting any, as waiting counts change once they finish.
+    std::vector<size_t> readyIndexes;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      if (waitingCounts[i] == 0) {
+        readyIndexes.push_back(i);
+      }
+    }
+
+    cancelled.store(false, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+
+    threadPool = std::make_unique<utility::ThreadPool>(std::clamp<size_t>(maxJobs, 1, requests.size()));
+    for (size_t i : readyIndexes) {
+      threadPool->submit([this, i] { compile(i); });
+    }
+    return true;
+  }
+
+  void BatchCompiler::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+  }
+
+  // Private methods
+  //
+
+  void BatchCompiler::compile(size_t index) {
+    const CompilationRequest& request = requests[index];
+    bool skipped = cancelled.load(std::memory_order_relaxed);
+    CompilationResult result;
+    if (!skipped) {
+      try {
+        result = compileFunction(request);
+      } catch (...) {
+        result.status = CompilationResult::Status::OtherError;
+        result.message = L"Running compiler failed.";
+        result.title = L"Compilation stopped.";
+      }
+    }
+
+    Lock lock(mutex);
+    ++progress.completed;
+    if (skipped) {
+      ++progress.skipped;
+    } else if (result.status != CompilationResult::Status::Succeeded) {
+      ++progress.failed;
+    } else if (result.cached) {
+      ++progress.cached;
+    }
+    Progress compiledProgress = progress;
+
+    std::vector<size_t> skippedIndexes;
+    releaseDependants(index, !skipped && result.status == CompilationResult::Status::Succeeded, skippedIndexes);
+    while (!skippedIndexes.empty()) {
+      size_t skippedIndex = skippedIndexes.back();
+      skippedIndexes.pop_back();
+      ++progress.completed;
+      ++progress.skipped;
+      releaseDependants(skippedIndex, false, skippedIndexes);
+    }
+    Progress finalProgress = progress;
+
+    // Report with a copy of progress after releasing the lock, so that other workers and destructor don't wait for callbacks
+    Lock reportLock(reportMutex);
+    lock.unlock();
+    if (!skipped) {
+      compiledCallback(request, result, compiledProgress);
+    }
+    if (finalProgress.completed == finalProgress.total) {
+      finishedCallback(finalProgress);
+      running.store(false, std::memory_order_release);
+    }
+  }
+
+  void BatchCompiler::releaseDependants(size_t index, bool succeeded, std::vector<size_t>& skippedIndexes) {
+    if (dependants.empty()) {
+      return;
+    }
+
+    for (size_t dependant : dependants[index]) {
+      if (!succeeded) {
+        dependencyFailed[dependant] = true;
+      }
+      if (--waitingCounts[dependant] == 0) {
+        if (dependencyFailed[dependant] || cancelled.load(std::memory_order_relaxed)) {
+          skippedIndexes.push_back(dependant);
+        } else {
+          threadPool->submit([this, dependant] { compile(dependant); });
+        }
+      }
+    }
+  }
+
+} // namespace
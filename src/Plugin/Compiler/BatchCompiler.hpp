@@ -0,0 +1,98 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "CompilationRequest.hpp"
+#include "CompilationResult.hpp"
+
+#include "..\Common\ThreadPool.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace papyrus {
+
+  // Compile a batch of scripts, e.g. all scripts in a folder, with a bounded number of compilations running at the same time. Each
+  // script's result is reported as soon as it finishes, followed by a final report when all are done. Scripts can be given scripts of
+  // the batch they depend on, in which case they are only compiled after those are compiled successfully. This class doesn't depend
+  // on Windows API, and compiles through the given function, so it can run with a stand-in compiler.
+  //
+  // Reports are made one at a time on worker threads, in the order progress is made. They are made without holding the lock that
+  // guards progress, so callbacks can cancel the batch. Destructor waits for workers, so callbacks must not wait for the thread that
+  // destroys this instance, e.g. by sending a message to UI thread. Posting one is fine.
+  class BatchCompiler {
+    public:
+      struct Progress {
+        size_t total {0};
+        size_t completed {0};  // Including failed and skipped ones
+        size_t failed {0};
+        size_t cached {0};     // Unchanged, so output was restored from compile cache
+        size_t skipped {0};    // Not compiled since the batch was cancelled, or a script it depends on wasn't compiled
+      };
+
+      using compile_function_t = std::function<CompilationResult(const CompilationRequest&)>;
+      using compiled_callback_t = std::function<void(const CompilationRequest&, const CompilationResult&, const Progress&)>;
+      using finished_callback_t = std::function<void(const Progress&)>;
+
+      BatchCompiler(compile_function_t&& compileFunction, compiled_callback_t&& compiledCallback, finished_callback_t&& finishedCallback);
+      ~BatchCompiler();
+
+      // Disable all copy/move constructors/assignment operators
+      BatchCompiler(BatchCompiler&& other) = delete;
+
+      // Start compiling given scripts with at most maxJobs compilations at a time. If dependencies are given, each script waits for
+      // the scripts at listed indexes, which must come before it. Returns false if a batch is still running, or there is nothing to
+      // compile.
+      bool start(std::vector<CompilationRequest>&& requests, size_t maxJobs, std::vector<std::vector<size_t>>&& dependencies = {});
+
+      // Skip scripts not being compiled yet. Running compilations still finish and are reported.
+      void cancel();
+
+      // Whether a batch is running. It stays true until the final report returns.
+      inline bool isRunning() const noexcept { return running.load(std::memory_order_acquire); }
+
+    private:
+      void compile(size_t index);
+
+      // Start scripts that no longer wait for any script after given one finished, or add them to skipped ones if given one wasn't
+      // compiled successfully or the batch is cancelled. Must be called with lock held.
+      void releaseDependants(size_t index, bool succeeded, std::vector<size_t>& skippedIndexes);
+
+      // Private members
+      //
+      compile_function_t compileFunction;
+      compiled_callback_t compiledCallback;
+      finished_callback_t finishedCallback;
+      std::vector<CompilationRequest> requests;
+      std::mutex mutex;        // Guards progress and dependency states
+      std::mutex reportMutex;  // Serializes reports. Taken before mutex is released, so reports are in the same order as progress.
+      Progress progress;
+      std::vector<std::vector<size_t>> dependants;  // Indexes of scripts waiting for each script. Empty if there are no dependencies.
+      std::vector<size_t> waitingCounts;            // Number of scripts each script still waits for
+      std::vector<bool> dependencyFailed;
+      std::atomic<bool> running {false};
+      std::atomic<bool> cancelled {false};
+      std::unique_ptr<utility::ThreadPool> threadPool;
+  };
+
+} // namespace
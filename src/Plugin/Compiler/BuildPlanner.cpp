@@ -0,0 +1,245 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BuildPlanner.hpp"
+
+#include "..\Common\StringUtil.hpp"
+#include "..\Lexer\ClassLocator.hpp"
+#include "..\Lexer\DeclarationScanner.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+namespace papyrus {
+
+  namespace {
+    constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+    // Scripts of a build and all scripts they depend on, with strongly connected components, i.e. groups of scripts referencing each
+    // other, found in dependency order.
+    class DependencyGraph {
+      public:
+        struct Node {
+          std::wstring filePath;
+          std::filesystem::file_time_type lastWriteTime {};  // Latest possible time if it can't be read, so dependants are compiled
+          std::vector<size_t> dependencies {};               // Indexes of referenced nodes
+          const std::vector<std::wstring>* searchDirectories {nullptr};
+          size_t requestIndex {NONE};                        // Index in build's requests, or NONE if it's not part of the build
+          size_t component {NONE};
+
+          // Used while finding components
+          size_t visitIndex {NONE};
+          size_t lowLink {NONE};
+          size_t nextDependency {0};  // Index in dependencies of the next one to visit
+          bool onStack {false};
+        };
+
+        // Get index of the node of given file, adding it if it's new. Paths are compared case-insensitively, same as Windows does.
+        size_t addNode(const std::wstring& filePath, bool& added) {
+          auto [iter, inserted] = nodeIndexes.try_emplace(utility::toLower(std::filesystem::path(filePath).lexically_normal().wstring()), nodes.size());
+          added = inserted;
+          if (inserted) {
+            nodes.push_back(Node {
+              .filePath = filePath
+            });
+          }
+          return iter->second;
+        }
+
+        // Read the script of given node, and return the script name it declares and the names it references
+        References scan(size_t nodeIndex) {
+          Node& node = nodes[nodeIndex];
+          std::error_code errorCode;
+          node.lastWriteTime = std::filesystem::last_write_time(node.filePath, errorCode);
+          std::ifstream file(std::filesystem::path(node.filePath), std::ios::binary);
+          if (errorCode || !file) {
+            node.lastWriteTime = std::filesystem::file_time_type::max();
+            return References();
+          }
+          std::stringstream text;
+          text << file.rdbuf();
+          return DeclarationScanner::parseReferences(text.str());
+        }
+
+        // Find strongly connected components with Tarjan's algorithm. A component is only completed after all components it depends on,
+        // so they are in dependency order. Nodes being visited are kept on an explicit stack instead of recursing, since a long chain of
+        // dependencies could overflow the thread's stack.
+        void findComponents() {
+          std::vector<size_t> visiting;
+          for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].visitIndex != NONE) {
+              continue;
+            }
+
+            startVisit(i);
+            visiting.push_back(i);
+            while (!visiting.empty()) {
+              Node& node = nodes[visiting.back()];
+              if (node.nextDependency < node.dependencies.size()) {
+                size_t dependency = node.dependencies[node.nextDependency++];
+                if (nodes[dependency].visitIndex == NONE) {
+                  startVisit(dependency);
+                  visiting.push_back(dependency);
+                } else if (nodes[dependency].onStack) {
+                  node.lowLink = std::min(node.lowLink, nodes[dependency].visitIndex);
+                }
+                continue;
+              }
+
+              // All dependencies are visited, so the node is done, and its low link is passed on to the node that depends on it
+              size_t nodeIndex = visiting.back();
+              visiting.pop_back();
+              if (node.lowLink == node.visitIndex) {
+                completeComponent(nodeIndex);
+              }
+              if (!visiting.empty()) {
+                Node& dependant = nodes[visiting.back()];
+                dependant.lowLink = std::min(dependant.lowLink, node.lowLink);
+              }
+            }
+          }
+        }
+
+        std::vector<Node> nodes;
+        std::vector<std::vector<size_t>> components;  // Node indexes of each component
+
+      private:
+        void startVisit(size_t nodeIndex) {
+          nodes[nodeIndex].visitIndex = nodes[nodeIndex].lowLink = nextVisitIndex++;
+          nodes[nodeIndex].onStack = true;
+          stack.push_back(nodeIndex);
+        }
+
+        // Take the component of given root node off the stack
+        void completeComponent(size_t nodeIndex) {
+          std::vector<size_t> component;
+          size_t member;
+          do {
+            member = stack.back();
+            stack.pop_back();
+            nodes[member].onStack = false;
+            nodes[member].component = components.size();
+            component.push_back(member);
+          } while (member != nodeIndex);
+          components.push_back(std::move(component));
+        }
+
+        std::unordered_map<std::wstring, size_t> nodeIndexes;
+        std::vector<size_t> stack;
+        size_t nextVisitIndex {0};
+    };
+  }
+
+  BuildPlanner::Plan BuildPlanner::plan(std::vector<CompilationRequest>&& requests, const target_function_t& targetFunction, std::stop_token stopToken) {
+    DependencyGraph graph;
+    std::vector<CompilationTarget> targets(requests.size());
+    std::vector<size_t> pendingNodes;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      bool added;
+      size_t nodeIndex = graph.addNode(requests[i].filePath, added);
+      if (added) {
+        // Listed more than once otherwise, e.g. in a file list
+        graph.nodes[nodeIndex].requestIndex = i;
+        graph.nodes[nodeIndex].searchDirectories = &targets[i].searchDirectories;
+        pendingNodes.push_back(nodeIndex);
+      }
+    }
+
+    // Scan scripts of the build, and all scripts they reference. Referenced scripts outside of the build are resolved in directories of
+    // the first script found referencing them.
+    for (size_t i = 0; i < pendingNodes.size(); ++i) {
+      if (stopToken.stop_requested()) {
+        return Plan();
+      }
+
+      size_t nodeIndex = pendingNodes[i];
+      auto references = graph.scan(nodeIndex);
+      size_t requestIndex = graph.nodes[nodeIndex].requestIndex;
+      if (requestIndex != NONE) {
+        targets[requestIndex] = targetFunction(requests[requestIndex], references.scriptName);
+      }
+
+      const std::vector<std::wstring>& searchDirectories = *graph.nodes[nodeIndex].searchDirectories;
+      for (const auto& className : references.classNames) {
+        auto dependencyFilePath = ClassLocator::findTypeFile(className, searchDirectories);
+        if (!dependencyFilePath.empty()) {
+          bool added;
+          size_t dependency = graph.addNode(dependencyFilePath, added);
+          if (added) {
+            graph.nodes[dependency].searchDirectories = &searchDirectories;
+            pendingNodes.push_back(dependency);
+          }
+          if (dependency != nodeIndex) {
+            graph.nodes[nodeIndex].dependencies.push_back(dependency);
+          }
+        }
+      }
+    }
+    graph.findComponents();
+
+    // Go through components in dependency order. A script needs compiling if its .pex file is older than the newest source among its
+    // own component and all components that component depends on.
+    Plan plan;
+    std::vector<std::filesystem::file_time_type> newestSourceTimes(graph.components.size());
+    std::vector<std::vector<size_t>> compiledRequests(graph.components.size());  // Indexes in plan of each component's scripts
+    std::vector<std::vector<size_t>> awaitedRequests(graph.components.size());   // Indexes in plan a component's scripts wait for
+    for (size_t component = 0; component < graph.components.size(); ++component) {
+      auto& newestSourceTime = newestSourceTimes[component];
+      auto& awaited = awaitedRequests[component];
+      newestSourceTime = std::filesystem::file_time_type::min();
+      for (size_t nodeIndex : graph.components[component]) {
+        const auto& node = graph.nodes[nodeIndex];
+        newestSourceTime = std::max(newestSourceTime, node.lastWriteTime);
+        for (size_t dependency : node.dependencies) {
+          size_t dependencyComponent = graph.nodes[dependency].component;
+          if (dependencyComponent != component) {
+            newestSourceTime = std::max(newestSourceTime, newestSourceTimes[dependencyComponent]);
+
+            // Wait for the nearest scripts being compiled along each path of dependencies
+            const auto& dependencyRequests = compiledRequests[dependencyComponent].empty() ? awaitedRequests[dependencyComponent] : compiledRequests[dependencyComponent];
+            awaited.insert(awaited.end(), dependencyRequests.begin(), dependencyRequests.end());
+          }
+        }
+      }
+      std::sort(awaited.begin(), awaited.end());
+      awaited.erase(std::unique(awaited.begin(), awaited.end()), awaited.end());
+
+      for (size_t nodeIndex : graph.components[component]) {
+        size_t requestIndex = graph.nodes[nodeIndex].requestIndex;
+        if (requestIndex != NONE) {
+          std::error_code errorCode;
+          auto outputTime = std::filesystem::last_write_time(targets[requestIndex].outputFile, errorCode);
+          if (errorCode || outputTime < newestSourceTime) {
+            compiledRequests[component].push_back(plan.requests.size());
+            plan.requests.push_back(std::move(requests[requestIndex]));
+            plan.dependencies.push_back(awaited);
+          } else {
+            ++plan.upToDate;
+          }
+        }
+      }
+    }
+    return plan;
+  }
+
+} // namespace
@@ -0,0 +1,58 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "CompilationRequest.hpp"
+#include "CompilationTarget.hpp"
+
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  // Plan an incremental build of a set of scripts, e.g. all scripts under a project folder.
+  //
+  // Each script is scanned for the scripts it references (parent, imported scripts, and names used as types), which are resolved the
+  // same way the compiler does, i.e. in script's root directory first, then import directories. Referenced scripts outside of the set
+  // are scanned as well, so the graph covers everything a script depends on directly or indirectly. A script needs compiling if its
+  // .pex file is missing, or older than its own source or the source of any script it depends on.
+  //
+  // Scripts that need compiling are ordered so that the ones a script depends on come before it, and for each of them the nearest such
+  // scripts it must wait for are listed, so unrelated scripts can still be compiled at the same time. Scripts referencing each other
+  // have no order among themselves. This class doesn't depend on Windows API.
+  //
+  class BuildPlanner {
+    public:
+      struct Plan {
+        std::vector<CompilationRequest> requests;       // Scripts that need compiling, in dependency order
+        std::vector<std::vector<size_t>> dependencies;  // For each request, indexes of earlier requests it must wait for
+        size_t upToDate {0};                            // Number of scripts whose .pex files are already up to date
+      };
+
+      using target_function_t = std::function<CompilationTarget(const CompilationRequest& request, const std::string& scriptName)>;
+
+      // Plan a build of given scripts. It reads every script, so it's meant to run on a worker thread. If stop is requested before it's
+      // done, it returns an empty plan.
+      static Plan plan(std::vector<CompilationRequest>&& requests, const target_function_t& targetFunction, std::stop_token stopToken = {});
+  };
+
+} // namespace
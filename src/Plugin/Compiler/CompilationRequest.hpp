@@ -20,7 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include "..\Common\Game.hpp"
-#include "..\Common\NotepadPlusPlus.hpp"
+#include "..\Common\NotepadPlusPlusTypes.hpp"
 
 #include <string>
 
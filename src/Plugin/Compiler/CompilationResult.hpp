@@ -0,0 +1,47 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "..\CompilationErrorHandling\Error.hpp"
+
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  struct CompilationResult {
+    enum class Status {
+      Succeeded,
+      Failed,
+      AnonymizationFailed,
+      CompilerNotFound,
+      OtherError
+    };
+
+    Status status {Status::Succeeded};
+    bool anonymized {false};
+    bool cached {false};              // Output is restored from compile cache instead of compiled
+    std::vector<Error> errors;        // Compilation errors when failed
+    bool hasUnparsableLines {false};  // Some lines of compiler output can't be parsed as errors
+    std::wstring message;             // Reason of anonymization failure, or text of other error
+    std::wstring title;               // Title of other error
+  };
+
+} // namespace
@@ -0,0 +1,265 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CompileCache.hpp"
+
+#include "..\Lexer\ClassLocator.hpp"
+#include "..\Lexer\DeclarationScanner.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace papyrus {
+
+  using Lock = std::lock_guard<std::mutex>;
+
+  namespace {
+    // Bump when what goes into a key changes, so entries made before are not used
+    constexpr uint64_t KEY_VERSION = 1;
+
+    // How many entries are stored between checks for old entries to remove
+    constexpr size_t CLEANUP_INTERVAL = 64;
+
+    // 64-bit FNV-1a hash of a sequence of values. Strings are prefixed with their lengths, so different sequences of them don't join
+    // into the same bytes.
+    class Hasher {
+      public:
+        inline void add(std::string_view data) noexcept {
+          add(static_cast<uint64_t>(data.size()));
+          addBytes(data.data(), data.size());
+        }
+        inline void add(std::wstring_view data) noexcept {
+          add(static_cast<uint64_t>(data.size()));
+          addBytes(data.data(), data.size() * sizeof(wchar_t));
+        }
+        inline void add(uint64_t value) noexcept { addBytes(&value, sizeof(value)); }
+        inline uint64_t get() const noexcept { return hash; }
+
+      private:
+        inline void addBytes(const void* data, size_t size) noexcept {
+          const unsigned char* bytes = static_cast<const unsigned char*>(data);
+          for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+          }
+        }
+
+        uint64_t hash {14695981039346656037ull};
+    };
+
+    bool readFile(const std::filesystem::path& filePath, std::string& content) {
+      std::ifstream file(filePath, std::ios::binary);
+      if (!file) {
+        return false;
+      }
+      std::stringstream stream;
+      stream << file.rdbuf();
+      content = stream.str();
+      return !file.bad();
+    }
+  }
+
+  CompileCache::CompileCache(const std::wstring& directory)
+    : directory(directory) {
+  }
+
+  bool CompileCache::getKey(const std::wstring& filePath, const std::wstring& commandLine, const std::wstring& compilerPath, const std::wstring& flagFile, const std::vector<std::wstring>& searchDirectories, key_t& key) {
+    Hasher hasher;
+    hasher.add(KEY_VERSION);
+    hasher.add(commandLine);
+
+    auto compiler = getFileInfo(compilerPath, false);
+    if (!compiler) {
+      return false;
+    }
+    hasher.add(compiler->hash);
+
+    // Flags file is looked for in search directories unless it's an absolute path
+    std::filesystem::path flagFilePath(flagFile);
+    if (!flagFile.empty() && !flagFilePath.is_absolute()) {
+      auto iter = std::find_if(searchDirectories.begin(), searchDirectories.end(),
+        [&](const auto& searchDirectory) {
+          std::error_code errorCode;
+          return std::filesystem::is_regular_file(std::filesystem::path(searchDirectory) / flagFilePath, errorCode);
+        }
+      );
+      flagFilePath = (iter != searchDirectories.end()) ? std::filesystem::path(*iter) / flagFilePath : std::filesystem::path();
+    }
+    auto flags = flagFilePath.empty() ? nullptr : getFileInfo(flagFilePath, false);
+    hasher.add(flags ? flags->hash : 0);
+
+    auto script = getFileInfo(filePath, true);
+    if (!script) {
+      return false;
+    }
+    hasher.add(script->hash);
+
+    // Walk all scripts referenced directly or indirectly, with struct types resolved to scripts declaring them. Names are resolved
+    // every time, as adding a script can change what a name refers to, while contents of resolved scripts come from remembered file
+    // info unless they changed.
+    std::set<std::string> visitedNames;
+    std::map<std::string, uint64_t> dependencyHashes;
+    std::vector<std::shared_ptr<const FileInfo>> pendingScripts {script};
+    while (!pendingScripts.empty()) {
+      auto pendingScript = std::move(pendingScripts.back());
+      pendingScripts.pop_back();
+      for (const auto& className : pendingScript->classNames) {
+        if (!visitedNames.insert(className).second) {
+          continue;
+        }
+
+        auto dependencyFilePath = ClassLocator::findTypeFile(className, searchDirectories);
+        if (!dependencyFilePath.empty()) {
+          auto dependency = getFileInfo(dependencyFilePath, true);
+          if (!dependency) {
+            return false;
+          }
+          dependencyHashes[className] = dependency->hash;
+          pendingScripts.push_back(std::move(dependency));
+        }
+      }
+    }
+    for (const auto& [className, hash] : dependencyHashes) {
+      hasher.add(className);
+      hasher.add(hash);
+    }
+
+    key = hasher.get();
+    return true;
+  }
+
+  bool CompileCache::restore(key_t key, const std::wstring& outputFile) {
+    auto entryPath = getEntryPath(key);
+    std::string entry;
+    if (!readFile(entryPath, entry)) {
+      return false;
+    }
+
+    std::error_code errorCode;
+    std::filesystem::path outputFilePath(outputFile);
+    std::string output;
+    if (std::filesystem::file_size(outputFilePath, errorCode) != entry.size() || !readFile(outputFilePath, output) || output != entry) {
+      std::filesystem::create_directories(outputFilePath.parent_path(), errorCode);
+      std::ofstream file(outputFilePath, std::ios::binary | std::ios::trunc);
+      if (!file.write(entry.data(), entry.size()) || !file.flush()) {
+        return false;
+      }
+    }
+
+    // Output is now as new as if it was just compiled, and the entry is the most recently used one.
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(outputFilePath, now, errorCode);
+    std::filesystem::last_write_time(entryPath, now, errorCode);
+    return true;
+  }
+
+  void CompileCache::store(key_t key, const std::wstring& outputFile) {
+    // Copy to a file of this thread first, so other threads never see a partially written entry.
+    std::error_code errorCode;
+    auto entryPath = getEntryPath(key);
+    auto temporaryPath = entryPath;
+    temporaryPath += L"." + std::to_wstring(std::hash<std::thread::id>()(std::this_thread::get_id())) + L".tmp";
+    std::filesystem::create_directories(directory, errorCode);
+    if (std::filesystem::copy_file(outputFile, temporaryPath, std::filesystem::copy_options::overwrite_existing, errorCode)) {
+      std::filesystem::rename(temporaryPath, entryPath, errorCode);
+    }
+    if (errorCode) {
+      std::filesystem::remove(temporaryPath, errorCode);
+    }
+
+    bool cleanup = false;
+    {
+      Lock lock(mutex);
+      cleanup = (storeCount++ % CLEANUP_INTERVAL == 0);
+    }
+    if (cleanup) {
+      removeOldEntries();
+    }
+  }
+
+  // Private methods
+  //
+
+  std::shared_ptr<const CompileCache::FileInfo> CompileCache::getFileInfo(const std::filesystem::path& filePath, bool isScript) {
+    std::error_code errorCode;
+    auto lastWriteTime = std::filesystem::last_write_time(filePath, errorCode);
+    if (errorCode) {
+      return nullptr;
+    }
+    auto size = std::filesystem::file_size(filePath, errorCode);
+    if (errorCode) {
+      return nullptr;
+    }
+
+    {
+      Lock lock(mutex);
+      auto iter = files.find(filePath.wstring());
+      if (iter != files.end() && iter->second->lastWriteTime == lastWriteTime && iter->second->size == size) {
+        return iter->second;
+      }
+    }
+
+    std::string content;
+    if (!readFile(filePath, content)) {
+      return nullptr;
+    }
+    Hasher hasher;
+    hasher.add(content);
+    auto fileInfo = std::make_shared<const FileInfo>(FileInfo {
+      .lastWriteTime = lastWriteTime,
+      .size = size,
+      .hash = hasher.get(),
+      .classNames = isScript ? DeclarationScanner::parseReferences(content).classNames : std::vector<std::string>()
+    });
+
+    Lock lock(mutex);
+    files.insert_or_assign(filePath.wstring(), fileInfo);
+    return fileInfo;
+  }
+
+  std::filesystem::path CompileCache::getEntryPath(key_t key) const {
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016llx.pex", static_cast<unsigned long long>(key));
+    return directory / fileName;
+  }
+
+  void CompileCache::removeOldEntries() {
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+    std::error_code errorCode;
+    for (auto iter = std::filesystem::directory_iterator(directory, errorCode); !errorCode && iter != std::filesystem::directory_iterator(); iter.increment(errorCode)) {
+      std::error_code fileErrorCode;
+      if (iter->path().extension() == L".pex" && iter->is_regular_file(fileErrorCode)) {
+        entries.emplace_back(iter->last_write_time(fileErrorCode), iter->path());
+      }
+    }
+
+    if (entries.size() > MAX_ENTRIES) {
+      size_t removeCount = entries.size() - MAX_ENTRIES;
+      std::nth_element(entries.begin(), entries.begin() + removeCount, entries.end());
+      for (size_t i = 0; i < removeCount; ++i) {
+        std::filesystem::remove(entries[i].second, errorCode);
+      }
+    }
+  }
+
+} // namespace
@@ -0,0 +1,90 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace papyrus {
+
+  // A local cache of compiled scripts, so that compiling a script again when nothing it depends on has changed restores the .pex file
+  // produced last time, instead of running the compiler.
+  //
+  // Entries are keyed by a hash of everything that affects the output: the script's source, the compiler and its command line, the
+  // flags file, and sources of all scripts it references directly or indirectly, as found in directories the compiler searches. Each
+  // entry is a copy of the produced .pex file in the cache directory. Least recently used entries are removed once there are more than
+  // MAX_ENTRIES of them.
+  //
+  // Hashes and references of files are remembered along with their modification times and sizes, so only files that changed are read
+  // again. It can be used from multiple threads at the same time. This class doesn't depend on Windows API.
+  //
+  class CompileCache {
+    public:
+      using key_t = uint64_t;
+
+      static constexpr size_t MAX_ENTRIES = 4096;
+
+      explicit CompileCache(const std::wstring& directory);
+
+      // Disable all copy/move constructors/assignment operators
+      CompileCache(CompileCache&& other) = delete;
+
+      // Calculate the key of compiling given script with given command line. Search directories are where the compiler looks for
+      // referenced scripts and the flags file, i.e. script's root directory first, then import directories. Returns false if a file
+      // that affects the output can't be read.
+      bool getKey(const std::wstring& filePath, const std::wstring& commandLine, const std::wstring& compilerPath, const std::wstring& flagFile, const std::vector<std::wstring>& searchDirectories, key_t& key);
+
+      // Restore output file from the entry of given key. If output file already has the same content, it's left as is. Either way its
+      // modification time is updated, same as if it was compiled. Returns false if there is no such entry or it can't be restored.
+      bool restore(key_t key, const std::wstring& outputFile);
+
+      // Keep a copy of given output file as the entry of given key
+      void store(key_t key, const std::wstring& outputFile);
+
+    private:
+      struct FileInfo {
+        std::filesystem::file_time_type lastWriteTime;
+        uintmax_t size;
+        uint64_t hash;
+        std::vector<std::string> classNames;  // Names that may refer to other scripts, only for scripts
+      };
+
+      // Get hash of a file, and references if it's a script, reading it only if it changed since last time. Returns nullptr if it can't
+      // be read.
+      std::shared_ptr<const FileInfo> getFileInfo(const std::filesystem::path& filePath, bool isScript);
+
+      std::filesystem::path getEntryPath(key_t key) const;
+      void removeOldEntries();
+
+      // Private members
+      //
+      const std::filesystem::path directory;
+
+      std::mutex mutex;  // Guards members below
+      std::unordered_map<std::wstring, std::shared_ptr<const FileInfo>> files;
+      size_t storeCount {0};
+  };
+
+} // namespace
@@ -20,9 +20,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Compiler.hpp"
 
+#include "CompilerProcess.hpp"
+
 #include "..\Common\Logger.hpp"
 #include "..\Common\Resources.hpp"
 #include "..\Common\StringUtil.hpp"
+#include "..\Lexer\DeclarationScanner.hpp"
 #include "..\Lexer\Lexer.hpp"
 
 #include "..\..\external\gsl\include\gsl\util"
@@ -34,17 +37,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace papyrus {
 
-  constexpr DWORD STDOUT_PIPE_SIZE = 10 * 1024 * 1024;  // Allow up to 10 MiB data to be returned from stdout
-  constexpr DWORD STDERR_PIPE_SIZE = 500 * 1024 * 1024; // Allow up to 500 MiB data to be returned from stderr
-
-  Compiler::Compiler(HWND messageWindow, const CompilerSettings& settings)
+  Compiler::Compiler(HWND messageWindow, const CompilerSettings& settings, const std::wstring& cacheDirectory)
    : messageWindow(messageWindow), settings(settings) {
+    if (!cacheDirectory.empty()) {
+      compileCache = std::make_unique<CompileCache>(cacheDirectory);
+    }
   }
 
   void Compiler::start(const CompilationRequest& request) {
     try {
       if (!compilationThread.joinable()) {
-        compilationThread = std::thread([=]() { compile(request); }); // Capture the request by value due to asynchronous nature of thread
+        compilationThread = std::thread([=]() { run(request); }); // Capture the request by value due to asynchronous nature of thread
       } else {
         ::SendMessage(messageWindow, PPM_OTHER_ERROR, reinterpret_cast<WPARAM>(L"Compilation thread unusable."), reinterpret_cast<LPARAM>(L"Compilation aborted."));
       }
@@ -53,144 +56,179 @@ namespace papyrus {
     }
   }
 
-  // Private methods
-  //
-
-  void Compiler::compile(CompilationRequest request) {
+  CompilationResult Compiler::compile(const CompilationRequest& request, const ErrorParser::error_callback_t& errorCallback) const {
+    CompilationResult result;
     try {
       const CompilerSettings::GameSettings& gameSettings = settings.gameSettings(request.game);
       std::wstring path = gameSettings.compilerPath;
       if (std::ifstream(path).good()) {
-        // Determine output file directory
-        std::wstring outputDirectory = gameSettings.outputDirectory;
-        if (request.useAutoModeOutputDirectory) {
-          if (std::filesystem::path(settings.autoModeOutputDirectory).is_absolute()) {
-            outputDirectory = settings.autoModeOutputDirectory;
-          } else {
-            outputDirectory = std::filesystem::path(request.filePath).parent_path() / settings.autoModeOutputDirectory;
-          }
-        }
-
-        // Determine PapyrusCompiler's working directory
-        std::filesystem::path filePath = std::filesystem::path(request.filePath);
-        auto scriptName = Lexer::getScriptName(request.bufferID);
-        auto scriptNameComponents = utility::split(scriptName, ":");
-        for (size_t i = 0; i < scriptNameComponents.size(); ++i) {
-          filePath = filePath.parent_path();
-        }
-        LPCWSTR workingDirectory {filePath.c_str()};
+        CompilationTarget target = getTarget(request, getScriptName(request));
 
         // Define compiler process.
         std::wstring commandLine =
           L"\"" + path + L"\"" +
           L" \"" + request.filePath + L"\"" +
           L" -i=\"" + gameSettings.importDirectories + L"\"" +
-          L" -o=\"" + outputDirectory + L"\"" +
+          L" -o=\"" + target.outputDirectory + L"\"" +
           L" -f=\"" + gameSettings.flagFile + L"\"" +
           (gameSettings.optimizeFlag ? L" -op" : L"") +
           (gameSettings.releaseFlag ? L" -r" : L"") +
           (gameSettings.finalFlag ? L" -final" : L"") +
           L" " + gameSettings.additionalArguments;
-        STARTUPINFO startupInfo {
-          .dwFlags = STARTF_USESTDHANDLES
-        };
 
-        // Setup error output pipe.
-        HANDLE outputReadHandle {};
-        HANDLE errorReadHandle {};
-        SECURITY_ATTRIBUTES attr {};
-        attr.bInheritHandle = TRUE;
-        if (::CreatePipe(&outputReadHandle, &startupInfo.hStdOutput, &attr, STDOUT_PIPE_SIZE) && ::CreatePipe(&errorReadHandle, &startupInfo.hStdError, &attr, STDERR_PIPE_SIZE)) {
-          // Run the process.
-          PROCESS_INFORMATION compilationProcess {};
-          if (::CreateProcess(nullptr, const_cast<LPWSTR>(commandLine.c_str()), nullptr, nullptr, TRUE, CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT, nullptr, workingDirectory, &startupInfo, &compilationProcess)) {
-            if (::WaitForSingleObject(compilationProcess.hProcess, INFINITE) != WAIT_FAILED) {
-              DWORD size {};
-              if (::PeekNamedPipe(errorReadHandle, nullptr, 0, nullptr, &size, nullptr)) {
-                // Check if there are error reported by compiler on stderr.
-                if (size > 0) {
-                  // Read the error output from pipe.
-                  std::vector<char> data(size);
-                  if (::ReadFile(errorReadHandle, &data[0], size, nullptr, nullptr)) {
-                    std::wstring errorOutput(data.begin(), data.end());
-                    parseErrors(errorOutput, gameSettings, outputDirectory);
-                  } else {
-                    sendOtherErrorMessage(L"ReadFile failed. Compilation stopped.");
-                    closeProcess(compilationProcess, startupInfo);
-                    return;
-                  }
+        // Restore previous output if nothing that affects it has changed since.
+        CompileCache::key_t cacheKey {};
+        bool useCache = compileCache && settings.useCompileCache && compileCache->getKey(request.filePath, commandLine, path, gameSettings.flagFile, target.searchDirectories, cacheKey);
+        if (useCache && compileCache->restore(cacheKey, target.outputFile)) {
+          result.cached = true;
+          return result;
+        }
+
+        // Run the process. Errors reported on stderr are parsed as they arrive.
+        ErrorParser errorParser(gameSettings, target.outputDirectory, errorCallback);
+        CompilerOutput output;
+        std::wstring errorMsg;
+        unsigned long errorCode {};
+        auto outputCallback = [&](CompilerOutputStream stream, std::string_view data) {
+          if (stream == CompilerOutputStream::StandardError) {
+            errorParser.parse(data);
+          }
+        };
+        if (CompilerProcess::run(commandLine, target.workingDirectory, output, errorMsg, errorCode, outputCallback)) {
+          if (!output.standardError.empty()) {
+            // Errors reported by compiler on stderr.
+            errorParser.finish(output.standardError, result);
+          } else {
+            // Check stdout as well. This is for the rare case that compilation passed but somehow the compiler chokes at .pas file, when optimize flag is used.
+            if (output.standardOutput.find("compilation failed") != std::string::npos) {
+              ErrorParser outputParser(gameSettings, target.outputDirectory, errorCallback);
+              outputParser.parse(output.standardOutput);
+              outputParser.finish(output.standardOutput, result);
+            } else {
+              if (gameSettings.anonynmizeFlag) {
+                // No error, but anonymization is needed.
+                if (anonymizeOutput(target.outputFile, result.message)) {
+                  result.anonymized = true;
                 } else {
-                  // Check stdout as well. This is for the rare case that compilation passed but somehow the compiler chokes at .pas file, when optimize flag is used.
-                  if (::PeekNamedPipe(outputReadHandle, nullptr, 0, nullptr, &size, nullptr)) {
-                    bool hasError = false;
-                    if (size > 0) {
-                      std::vector<char> data(size);
-                      if (::ReadFile(outputReadHandle, &data[0], size, nullptr, nullptr)) {
-                        std::wstring stdOutput(data.begin(), data.end());
-                        if (stdOutput.find(L"compilation failed") != std::string::npos) {
-                          hasError = true;
-                          parseErrors(stdOutput, gameSettings, outputDirectory);
-                        }
-                      }
-                    }
-
-                    if (!hasError) {
-                      // No error, check if anonymization is needed.
-                      if (gameSettings.anonynmizeFlag) {
-                        // Output file has the same name as script name (relative path is determined by namepsace), with file extension set as ".pex".
-                        std::filesystem::path outputFile = std::filesystem::path(outputDirectory);
-                        for (const auto& scriptNameComponent : scriptNameComponents) {
-                          outputFile /= scriptNameComponent;
-                        }
-                        outputFile += ".pex";
-
-                        std::wstring errorMsg;
-                        if (anonymizeOutput(outputFile, errorMsg)) {
-                          ::SendMessage(messageWindow, PPM_COMPILATION_DONE, PARAM_COMPILATION_WITH_ANONYMIZATION, 0);
-                        } else {
-                          ::SendMessage(messageWindow, PPM_ANONYMIZATION_FAILED, reinterpret_cast<WPARAM>(&errorMsg), 0);
-                        }
-                      } else {
-                        ::SendMessage(messageWindow, PPM_COMPILATION_DONE, PARAM_COMPILATION_ONLY, 0);
-                      }
-                    }
-                  } else {
-                    sendOtherErrorMessage(L"PeekNamedPipe failed on stdout. Compilation stopped.");
-                    closeProcess(compilationProcess, startupInfo);
-                    return;
-                  }
+                  result.status = CompilationResult::Status::AnonymizationFailed;
                 }
-              } else {
-                sendOtherErrorMessage(L"PeekNamedPipe failed on stderr. Compilation stopped.");
-                closeProcess(compilationProcess, startupInfo);
-                return;
               }
-            } else {
-              sendOtherErrorMessage(L"WaitForSingleObject failed. Compilation stopped.");
-              closeProcess(compilationProcess, startupInfo);
-              return;
-            }
 
-            // Always close child process handles.
-            closeProcess(compilationProcess, startupInfo);
-          } else {
-            sendOtherErrorMessage(L"CreateProcess failed. Compilation stopped.");
-            return;
+              if (useCache && result.status == CompilationResult::Status::Succeeded) {
+                compileCache->store(cacheKey, target.outputFile);
+              }
+            }
           }
         } else {
-          sendOtherErrorMessage(L"CreatePipe failed. Compilation stopped.");
-          return;
+          result.status = CompilationResult::Status::OtherError;
+          result.message = L"Error code: " + std::to_wstring(errorCode);
+          result.title = errorMsg + L" Compilation stopped.";
         }
       } else {
-        ::SendMessage(messageWindow, PPM_COMPILER_NOT_FOUND, 0, 0);
+        result.status = CompilationResult::Status::CompilerNotFound;
       }
     } catch (...) {
       // In case of any exception
-      ::SendMessage(messageWindow, PPM_OTHER_ERROR, reinterpret_cast<WPARAM>(L"Running compiler in thread failed."), reinterpret_cast<LPARAM>(L"Compilation stopped."));
+      result.status = CompilationResult::Status::OtherError;
+      result.message = L"Running compiler failed.";
+      result.title = L"Compilation stopped.";
+    }
+    return result;
+  }
+
+  CompilationTarget Compiler::getTarget(const CompilationRequest& request, const std::string& scriptName) const {
+    const CompilerSettings::GameSettings& gameSettings = settings.gameSettings(request.game);
+    CompilationTarget target;
+
+    // Determine output file directory
+    target.outputDirectory = gameSettings.outputDirectory;
+    if (request.useAutoModeOutputDirectory) {
+      if (std::filesystem::path(settings.autoModeOutputDirectory).is_absolute()) {
+        target.outputDirectory = settings.autoModeOutputDirectory;
+      } else {
+        target.outputDirectory = (std::filesystem::path(request.filePath).parent_path() / settings.autoModeOutputDirectory).wstring();
+      }
     }
+
+    // Determine PapyrusCompiler's working directory
+    std::filesystem::path filePath = std::filesystem::path(request.filePath);
+    auto scriptNameComponents = utility::split(scriptName, ":");
+    for (size_t i = 0; i < scriptNameComponents.size(); ++i) {
+      filePath = filePath.parent_path();
+    }
+    target.workingDirectory = filePath.wstring();
+
+    // Compiler looks for referenced scripts in its working directory first, then import directories.
+    target.searchDirectories.push_back(target.workingDirectory);
+    std::wstringstream importDirectories(gameSettings.importDirectories);
+    std::wstring importDirectory;
+    while (std::getline(importDirectories, importDirectory, L';')) {
+      target.searchDirectories.push_back(importDirectory);
+    }
+
+    // Output file has the same name as script name (relative path is determined by namepsace), with file extension set as ".pex".
+    std::filesystem::path outputFile = std::filesystem::path(target.outputDirectory);
+    for (const auto& scriptNameComponent : scriptNameComponents) {
+      outputFile /= scriptNameComponent;
+    }
+    outputFile += ".pex";
+    target.outputFile = outputFile.wstring();
+    return target;
+  }
+
+  // Private methods
+  //
+
+  void Compiler::run(CompilationRequest request) {
+    sendResult(compile(request,
+      [&](const Error& error) {
+        ::SendMessage(messageWindow, PPM_COMPILATION_ERROR, reinterpret_cast<WPARAM>(&error), 0);
+      }
+    ));
     compilationThread.detach();
   }
 
+  void Compiler::sendResult(const CompilationResult& result) const {
+    switch (result.status) {
+      case CompilationResult::Status::Succeeded: {
+        ::SendMessage(messageWindow, PPM_COMPILATION_DONE, result.cached ? PARAM_COMPILATION_CACHED : result.anonymized ? PARAM_COMPILATION_WITH_ANONYMIZATION : PARAM_COMPILATION_ONLY, 0);
+        break;
+      }
+
+      case CompilationResult::Status::Failed: {
+        ::SendMessage(messageWindow, PPM_COMPILATION_FAILED, reinterpret_cast<WPARAM>(&result.errors), result.hasUnparsableLines);
+        break;
+      }
+
+      case CompilationResult::Status::AnonymizationFailed: {
+        ::SendMessage(messageWindow, PPM_ANONYMIZATION_FAILED, reinterpret_cast<WPARAM>(&result.message), 0);
+        break;
+      }
+
+      case CompilationResult::Status::CompilerNotFound: {
+        ::SendMessage(messageWindow, PPM_COMPILER_NOT_FOUND, 0, 0);
+        break;
+      }
+
+      case CompilationResult::Status::OtherError: {
+        ::SendMessage(messageWindow, PPM_OTHER_ERROR, reinterpret_cast<WPARAM>(result.message.c_str()), reinterpret_cast<LPARAM>(result.title.c_str()));
+        break;
+      }
+    }
+  }
+
+  std::string Compiler::getScriptName(const CompilationRequest& request) {
+    std::string scriptName = Lexer::getScriptName(request.bufferID);
+    if (scriptName.empty()) {
+      // Not open in a lexed buffer, e.g. compiled in a batch. Read it from the file instead.
+      std::ifstream file(request.filePath, std::ios::binary);
+      std::stringstream text;
+      text << file.rdbuf();
+      scriptName = DeclarationScanner::parse(text.str()).scriptName;
+    }
+    return scriptName;
+  }
+
   bool Compiler::anonymizeOutput(const std::wstring& outputFile, std::wstring& errorMsg) {
     bool noError = true;
     std::fstream file;
@@ -270,91 +308,4 @@ namespace papyrus {
     return size;
   }
 
-  void Compiler::parseErrors(const std::wstring& errorText, const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory) {
-    bool hasUnparsableLines = false;
-    std::vector<Error> errors;
-    std::wstringstream output(errorText);
-    std::wstring line;
-    while (std::getline(output, line)) {
-      try {
-        std::wstring lineError = line;
-        Error error;
-        bool isScriptError = false;
-        if (utility::startsWith(lineError, L"<unknown>")) {
-          error.file = L"<unknown>";
-          lineError.erase(0, 10);
-        } else {
-          size_t fileExtIndex = utility::indexOf(lineError, L".psc(");
-          if (fileExtIndex == std::string::npos && gameSettings.optimizeFlag) {
-            fileExtIndex = utility::indexOf(lineError, L".pas(");
-            isScriptError = true;
-          }
-
-          if (fileExtIndex != std::string::npos) {
-            error.file = lineError.substr(0, fileExtIndex + 4);
-            if (isScriptError) {
-              error.file = std::filesystem::path(outputDirectory) / error.file; // Papyrus compiler doesn't provide full path for .pas files
-            }
-            lineError.erase(0, fileExtIndex + 5);
-          }
-        }
-
-        if (!error.file.empty()) {
-          if (!isScriptError) { // .psc
-            size_t indexComma = lineError.find_first_of(L',');
-            error.line = std::stoi(lineError.substr(0, indexComma));
-
-            size_t indexParenthesis = lineError.find_first_of(L')');
-            error.column = std::stoi(lineError.substr(indexComma + 1, indexParenthesis - (indexComma - 1)));
-            error.message = lineError.substr(indexParenthesis + 3);
-          } else { // .pas
-            size_t indexParenthesis = lineError.find_first_of(L')');
-            error.line = std::stoi(lineError.substr(0, indexParenthesis));
-            error.column = 1; // Papyrus compiler doesn't provide column info for .pas files
-            error.message = lineError.substr(indexParenthesis + 4);
-          }
-
-          // Discard duplicate errors.
-          auto iter = std::find_if(errors.begin(), errors.end(),
-            [&](const auto& comparisionError) {
-              return comparisionError.file == error.file
-                && comparisionError.message == error.message
-                && comparisionError.line == error.line
-                && comparisionError.column == error.column;
-            }
-          );
-          if (iter == errors.end()) {
-            errors.push_back(error);
-          }
-        }
-      } catch (...) {
-        //log(line);
-        hasUnparsableLines = true;
-      }
-    }
-
-    if (errors.empty()) {
-      // In the rare case when error cannot be parsed (likely some errors dumped on stdout that are not related to specific files), send the whole output to error window.
-      errors.push_back(Error {
-        .message = errorText
-      });
-    }
-    ::SendMessage(messageWindow, PPM_COMPILATION_FAILED, reinterpret_cast<WPARAM>(&errors), hasUnparsableLines);
-  }
-
-  void Compiler::closeProcess(const PROCESS_INFORMATION& processInfo, const STARTUPINFO& startupInfo) {
-    // Properly close child process handles, i.e. hProcess and hThread
-    CloseHandle(processInfo.hProcess);
-    CloseHandle(processInfo.hThread);
-
-    // Close pipes assigned to child process.
-    CloseHandle(startupInfo.hStdOutput);
-    CloseHandle(startupInfo.hStdError);
-  }
-
-  void Compiler::sendOtherErrorMessage(const wchar_t* msg) {
-    std::wstring errorMsg(L"Error code: " + std::to_wstring(::GetLastError()));
-    ::SendMessage(messageWindow, PPM_OTHER_ERROR, reinterpret_cast<WPARAM>(errorMsg.c_str()), reinterpret_cast<LPARAM>(msg));
-  }
-
 } // namespace
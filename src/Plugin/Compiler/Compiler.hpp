@@ -21,12 +21,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include "CompilationRequest.hpp"
+#include "CompilationResult.hpp"
+#include "CompilationTarget.hpp"
+#include "CompileCache.hpp"
 #include "CompilerSettings.hpp"
+#include "ErrorParser.hpp"
 
-#include "..\CompilationErrorHandling\Error.hpp"
-
+#include <memory>
+#include <string>
 #include <thread>
-#include <vector>
 
 #include <windows.h>
 
@@ -34,36 +37,43 @@ namespace papyrus {
 
   class Compiler {
     public:
-      Compiler(HWND messageWindow, const CompilerSettings& settings);
+      // Outputs of compiled scripts are cached in given directory, if provided
+      Compiler(HWND messageWindow, const CompilerSettings& settings, const std::wstring& cacheDirectory = std::wstring());
 
+      // Compile the given script in a separate thread, and send the result to plugin message window
       void start(const CompilationRequest& request);
 
+      // Compile the given script on calling thread. It can be called from multiple threads at the same time. Errors are also passed to
+      // error callback as soon as the compiler reports them, while it's still running.
+      CompilationResult compile(const CompilationRequest& request, const ErrorParser::error_callback_t& errorCallback = {}) const;
+
+      // Get where the given script with given script name is compiled to, and where its references are looked for
+      CompilationTarget getTarget(const CompilationRequest& request, const std::string& scriptName) const;
+
     private:
-      // Compile the given script file in a separate thread
-      void compile(CompilationRequest request);
+      // Thread function of start()
+      void run(CompilationRequest request);
+
+      // Send compilation result to plugin message window
+      void sendResult(const CompilationResult& result) const;
+
+      // Get script name of the given script, from lexer if it's open, or from the file otherwise
+      static std::string getScriptName(const CompilationRequest& request);
 
       // Anonymize generated PEX script
-      bool anonymizeOutput(const std::wstring& outputFile, std::wstring& errorMsg);
+      static bool anonymizeOutput(const std::wstring& outputFile, std::wstring& errorMsg);
 
       // Anonymize a field that is at current location. This feild can be "Script path", or "User name", or "Host name"
-      void anonymizeCurrentField(std::fstream& file, bool isBigEndian);
+      static void anonymizeCurrentField(std::fstream& file, bool isBigEndian);
 
       // Read size of a field from PEX header. Skyrim & SSE use big endian, FO4 uses little endian
-      int readSize(std::fstream& file, bool isBigEndian);
-
-      // Parse compilation errors and send the result back to plugin message window
-      void parseErrors(const std::wstring& errorText, const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory);
-
-      // Close compilation process
-      void closeProcess(const PROCESS_INFORMATION& processInfo, const STARTUPINFO& startupInfo);
-
-      // Send any unexpected "other error message" to plugin main processor, along with last error code from Win32 API
-      void sendOtherErrorMessage(const wchar_t* msg);
+      static int readSize(std::fstream& file, bool isBigEndian);
 
       // Private members
       //
       const HWND messageWindow;
       const CompilerSettings& settings;
+      std::unique_ptr<CompileCache> compileCache;
       std::thread compilationThread;
   };
 
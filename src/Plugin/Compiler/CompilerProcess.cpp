@@ -0,0 +1,314 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CompilerProcess.hpp"
+
+#ifdef _WIN32
+#include "..\..\external\gsl\include\gsl\util"
+#endif
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace papyrus {
+
+  namespace {
+    constexpr size_t STDOUT_CAPTURE_SIZE = 10 * 1024 * 1024;   // Keep up to 10 MiB data returned from stdout
+    constexpr size_t STDERR_CAPTURE_SIZE = 500 * 1024 * 1024;  // Keep up to 500 MiB data returned from stderr
+
+#ifdef _WIN32
+    constexpr DWORD PIPE_BUFFER_SIZE = 64 * 1024;              // Pipes are drained while compiler runs, so they don't need to hold much
+
+    // Read from a pipe until all write ends are closed. Returns 0 on success, or system error code.
+    DWORD readPipe(HANDLE readHandle, CompilerOutputStream stream, std::string& data, size_t captureSize, const CompilerProcess::output_callback_t& outputCallback) {
+      std::vector<char> buffer(PIPE_BUFFER_SIZE);
+      DWORD size {};
+      while (::ReadFile(readHandle, &buffer[0], PIPE_BUFFER_SIZE, &size, nullptr)) {
+        if (size > 0) {
+          if (data.size() < captureSize) {
+            data.append(&buffer[0], std::min<size_t>(size, captureSize - data.size()));
+          }
+          if (outputCallback) {
+            outputCallback(stream, std::string_view(&buffer[0], size));
+          }
+        }
+      }
+
+      DWORD errorCode = ::GetLastError();
+      return (errorCode == ERROR_BROKEN_PIPE) ? 0 : errorCode;
+    }
+
+    // Write ends of output pipes have to be inheritable for compiler process to use them. Any other process created meanwhile with
+    // handle inheritance, e.g. compiler process of another script in a batch, would get them as well and keep them open, so reading
+    // from the pipes wouldn't end when the compiler exits. Each compiler process is only given its own pipes, and in case that can't be
+    // done, creating pipes and processes is serialized until the write ends are closed.
+    std::mutex processCreationMutex;
+#else
+    constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+
+    // Read from a pipe until all write ends are closed. Returns 0 on success, or errno.
+    int readPipe(int readFd, CompilerOutputStream stream, std::string& data, size_t captureSize, const CompilerProcess::output_callback_t& outputCallback) {
+      std::vector<char> buffer(READ_BUFFER_SIZE);
+      while (true) {
+        ssize_t size = ::read(readFd, &buffer[0], READ_BUFFER_SIZE);
+        if (size > 0) {
+          if (data.size() < captureSize) {
+            data.append(&buffer[0], std::min<size_t>(size, captureSize - data.size()));
+          }
+          if (outputCallback) {
+            outputCallback(stream, std::string_view(&buffer[0], size));
+          }
+        } else if (size == 0) {
+          return 0;
+        } else if (errno != EINTR) {
+          return errno;
+        }
+      }
+    }
+
+    void closeFd(int& fd) {
+      if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+#endif
+  }
+
+#ifdef _WIN32
+  bool CompilerProcess::run(const std::wstring& commandLine, const std::wstring& workingDirectory, CompilerOutput& output, std::wstring& errorMsg, unsigned long& errorCode, const output_callback_t& outputCallback) {
+    STARTUPINFOEX startupInfoEx {
+      .StartupInfo {
+        .cb = sizeof(STARTUPINFO),
+        .dwFlags = STARTF_USESTDHANDLES
+      }
+    };
+    STARTUPINFO& startupInfo = startupInfoEx.StartupInfo;
+
+    // Setup output pipes.
+    HANDLE outputReadHandle {};
+    HANDLE errorReadHandle {};
+    SECURITY_ATTRIBUTES attr {};
+    attr.bInheritHandle = TRUE;
+    std::thread outputReader;
+    std::thread errorReader;
+    auto autoCleanup = gsl::finally([&] {
+      // Close both ends of pipes, which also unblocks readers if the process is gone.
+      for (HANDLE handle : {startupInfo.hStdOutput, startupInfo.hStdError}) {
+        if (handle) {
+          ::CloseHandle(handle);
+        }
+      }
+      for (std::thread* reader : {&outputReader, &errorReader}) {
+        if (reader->joinable()) {
+          reader->join();
+        }
+      }
+      for (HANDLE handle : {outputReadHandle, errorReadHandle}) {
+        if (handle) {
+          ::CloseHandle(handle);
+        }
+      }
+    });
+
+    std::unique_lock<std::mutex> processCreationLock(processCreationMutex);
+    if (!::CreatePipe(&outputReadHandle, &startupInfo.hStdOutput, &attr, PIPE_BUFFER_SIZE) || !::CreatePipe(&errorReadHandle, &startupInfo.hStdError, &attr, PIPE_BUFFER_SIZE)
+      || !::SetHandleInformation(outputReadHandle, HANDLE_FLAG_INHERIT, 0) || !::SetHandleInformation(errorReadHandle, HANDLE_FLAG_INHERIT, 0)) {
+      errorCode = ::GetLastError();
+      errorMsg = L"CreatePipe failed.";
+      return false;
+    }
+
+    // Only let compiler process inherit write ends of its own pipes
+    HANDLE inheritedHandles[] {startupInfo.hStdOutput, startupInfo.hStdError};
+    SIZE_T attributeListSize {};
+    ::InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSize);
+    std::vector<BYTE> attributeListBuffer(attributeListSize);
+    auto attributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.data());
+    bool attributeListInitialized = !attributeListBuffer.empty() && ::InitializeProcThreadAttributeList(attributeList, 1, 0, &attributeListSize);
+    auto attributeListCleanup = gsl::finally([&] {
+      if (attributeListInitialized) {
+        ::DeleteProcThreadAttributeList(attributeList);
+      }
+    });
+    DWORD creationFlags = CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT;
+    if (attributeListInitialized && ::UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inheritedHandles, sizeof(inheritedHandles), nullptr, nullptr)) {
+      startupInfoEx.lpAttributeList = attributeList;
+      startupInfo.cb = sizeof(STARTUPINFOEX);
+      creationFlags |= EXTENDED_STARTUPINFO_PRESENT;
+    }
+
+    bool succeeded = false;
+    PROCESS_INFORMATION compilationProcess {};
+    if (::CreateProcess(nullptr, const_cast<LPWSTR>(commandLine.c_str()), nullptr, nullptr, TRUE, creationFlags, nullptr, workingDirectory.c_str(), &startupInfo, &compilationProcess)) {
+      // Only the child process may hold write ends now, so that reads end when it exits.
+      ::CloseHandle(startupInfo.hStdOutput);
+      ::CloseHandle(startupInfo.hStdError);
+      startupInfo.hStdOutput = startupInfo.hStdError = nullptr;
+      processCreationLock.unlock();
+
+      // Drain both pipes at the same time, otherwise the compiler blocks once the pipe it's writing to is full.
+      DWORD outputReadError {};
+      DWORD errorReadError {};
+      try {
+        outputReader = std::thread([&] { outputReadError = readPipe(outputReadHandle, CompilerOutputStream::StandardOutput, output.standardOutput, STDOUT_CAPTURE_SIZE, outputCallback); });
+        errorReader = std::thread([&] { errorReadError = readPipe(errorReadHandle, CompilerOutputStream::StandardError, output.standardError, STDERR_CAPTURE_SIZE, outputCallback); });
+      } catch (const std::system_error&) {
+        ::TerminateProcess(compilationProcess.hProcess, 1);
+        errorCode = ::GetLastError();
+        errorMsg = L"Starting output reader failed.";
+      }
+
+      if (errorReader.joinable()) {
+        if (::WaitForSingleObject(compilationProcess.hProcess, INFINITE) == WAIT_FAILED) {
+          errorCode = ::GetLastError();
+          errorMsg = L"WaitForSingleObject failed.";
+          ::TerminateProcess(compilationProcess.hProcess, 1); // Make sure readers can finish
+        } else {
+          outputReader.join();
+          errorReader.join();
+          if (errorReadError != 0) {
+            errorCode = errorReadError;
+            errorMsg = L"Reading stderr failed.";
+          } else if (outputReadError != 0) {
+            errorCode = outputReadError;
+            errorMsg = L"Reading stdout failed.";
+          } else {
+            errorCode = 0;
+            succeeded = true;
+          }
+        }
+      }
+
+      // Always close child process handles.
+      ::CloseHandle(compilationProcess.hProcess);
+      ::CloseHandle(compilationProcess.hThread);
+    } else {
+      errorCode = ::GetLastError();
+      errorMsg = L"CreateProcess failed.";
+    }
+
+    return succeeded;
+  }
+#else
+  // Command line is run by shell, which handles the double-quoted arguments compiler command lines are made of the same way Windows does.
+  // Pipes are created close-on-exec, so compiler processes started at the same time don't inherit each other's pipes.
+  bool CompilerProcess::run(const std::wstring& commandLine, const std::wstring& workingDirectory, CompilerOutput& output, std::wstring& errorMsg, unsigned long& errorCode, const output_callback_t& outputCallback) {
+    std::string command = std::filesystem::path(commandLine).string();
+    std::string directory = std::filesystem::path(workingDirectory).string();
+
+    int outputPipe[2] {-1, -1};
+    int errorPipe[2] {-1, -1};
+    if (::pipe2(outputPipe, O_CLOEXEC) != 0 || ::pipe2(errorPipe, O_CLOEXEC) != 0) {
+      errorCode = errno;
+      errorMsg = L"pipe2 failed.";
+      for (int* fd : {&outputPipe[0], &outputPipe[1], &errorPipe[0], &errorPipe[1]}) {
+        closeFd(*fd);
+      }
+      return false;
+    }
+
+    // Only async-signal-safe calls are made in child process, since other threads may hold locks at the time of fork
+    pid_t pid = ::fork();
+    if (pid == 0) {
+      if ((directory.empty() || ::chdir(directory.c_str()) == 0) && ::dup2(outputPipe[1], STDOUT_FILENO) >= 0 && ::dup2(errorPipe[1], STDERR_FILENO) >= 0) {
+        ::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+      }
+      ::_exit(127);
+    }
+
+    // Only the child process may hold write ends now, so that reads end when it exits.
+    closeFd(outputPipe[1]);
+    closeFd(errorPipe[1]);
+    if (pid < 0) {
+      errorCode = errno;
+      errorMsg = L"fork failed.";
+      closeFd(outputPipe[0]);
+      closeFd(errorPipe[0]);
+      return false;
+    }
+
+    // Drain both pipes at the same time, otherwise the compiler blocks once the pipe it's writing to is full.
+    bool succeeded = false;
+    int outputReadError {};
+    int errorReadError {};
+    std::thread outputReader;
+    std::thread errorReader;
+    try {
+      outputReader = std::thread([&] { outputReadError = readPipe(outputPipe[0], CompilerOutputStream::StandardOutput, output.standardOutput, STDOUT_CAPTURE_SIZE, outputCallback); });
+      errorReader = std::thread([&] { errorReadError = readPipe(errorPipe[0], CompilerOutputStream::StandardError, output.standardError, STDERR_CAPTURE_SIZE, outputCallback); });
+    } catch (const std::system_error& e) {
+      ::kill(pid, SIGKILL);  // Make sure the reader that did start can finish
+      errorCode = static_cast<unsigned long>(e.code().value());
+      errorMsg = L"Starting output reader failed.";
+    }
+    bool readersStarted = errorReader.joinable();
+    for (std::thread* reader : {&outputReader, &errorReader}) {
+      if (reader->joinable()) {
+        reader->join();
+      }
+    }
+    closeFd(outputPipe[0]);
+    closeFd(errorPipe[0]);
+
+    int status {};
+    while (::waitpid(pid, &status, 0) < 0) {
+      if (errno != EINTR) {
+        errorCode = errno;
+        errorMsg = L"waitpid failed.";
+        return false;
+      }
+    }
+
+    if (!readersStarted) {
+      return false;
+    }
+    if (errorReadError != 0) {
+      errorCode = errorReadError;
+      errorMsg = L"Reading stderr failed.";
+    } else if (outputReadError != 0) {
+      errorCode = outputReadError;
+      errorMsg = L"Reading stdout failed.";
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+      // Shell couldn't run the compiler, the same case as CreateProcess failing on Windows
+      errorCode = 127;
+      errorMsg = L"Running command failed.";
+    } else {
+      errorCode = 0;
+      succeeded = true;
+    }
+    return succeeded;
+  }
+#endif
+
+} // namespace
@@ -0,0 +1,52 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace papyrus {
+
+  enum class CompilerOutputStream {
+    StandardOutput,
+    StandardError
+  };
+
+  // Output captured from a compiler process. Each stream keeps at most a fixed amount of data, anything beyond that is only seen by
+  // output callback.
+  struct CompilerOutput {
+    std::string standardOutput;
+    std::string standardError;
+  };
+
+  // Run compiler process to completion and capture its output. This is the only part of compilation that starts processes, so the rest
+  // of it can run with a stand-in implementation.
+  class CompilerProcess {
+    public:
+      using output_callback_t = std::function<void(CompilerOutputStream stream, std::string_view data)>;
+
+      // Run given command line in given working directory. Output is drained while the process runs, and each chunk of it is passed to
+      // output callback as soon as it's read, on a reader thread of that stream. If the process can't be run, returns false with the
+      // failed step in errorMsg and system error code in errorCode.
+      static bool run(const std::wstring& commandLine, const std::wstring& workingDirectory, CompilerOutput& output, std::wstring& errorMsg, unsigned long& errorCode, const output_callback_t& outputCallback = {});
+  };
+
+} // namespace
@@ -26,12 +26,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdexcept>
 #include <string>
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace papyrus {
 
   using Game = game::Game;
 
+  constexpr int DEFAULT_BATCH_COMPILATION_JOBS = 4; // Maximum number of compiler processes running at the same time in batch compilation
+  constexpr int MAX_BATCH_COMPILATION_JOBS     = 64;
+
   struct CompilerSettings {
 
     struct GameSettings {
@@ -55,6 +60,8 @@ namespace papyrus {
     Game autoModeDefaultGame {Game::Auto};
     std::wstring autoModeOutputDirectory;
     utility::PrimitiveTypeValueMonitor<bool> allowUnmanagedSource;
+    utility::PrimitiveTypeValueMonitor<int> batchCompilationJobs;
+    utility::PrimitiveTypeValueMonitor<bool> useCompileCache;
 
     const GameSettings& gameSettings(Game game) const;
     GameSettings& gameSettings(Game game);
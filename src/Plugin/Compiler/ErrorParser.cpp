@@ -0,0 +1,126 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ErrorParser.hpp"
+
+#include "..\Common\StringUtil.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace papyrus {
+
+  ErrorParser::ErrorParser(const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory, const error_callback_t& errorCallback)
+    : gameSettings(gameSettings), outputDirectory(outputDirectory), errorCallback(errorCallback) {
+  }
+
+  void ErrorParser::parse(std::string_view output) {
+    size_t lineEnd;
+    while ((lineEnd = output.find('\n')) != std::string_view::npos) {
+      incompleteLine.append(output.substr(0, lineEnd));
+      parseLine(incompleteLine);
+      incompleteLine.clear();
+      output.remove_prefix(lineEnd + 1);
+    }
+    incompleteLine.append(output);
+  }
+
+  void ErrorParser::finish(const std::string& fullOutput, CompilationResult& result) {
+    if (!incompleteLine.empty()) {
+      parseLine(incompleteLine);
+      incompleteLine.clear();
+    }
+
+    result.status = CompilationResult::Status::Failed;
+    result.hasUnparsableLines = hasUnparsableLines;
+    result.errors = std::move(errors);
+    if (result.errors.empty()) {
+      // In the rare case when error cannot be parsed (likely some errors dumped on stdout that are not related to specific files), send the whole output to error window.
+      result.errors.push_back(Error {
+        .file = {},
+        .message = std::wstring(fullOutput.begin(), fullOutput.end())
+      });
+    }
+  }
+
+  // Private methods
+  //
+
+  void ErrorParser::parseLine(const std::string& line) {
+    try {
+      std::wstring lineError(line.begin(), line.end());
+      Error error;
+      bool isScriptError = false;
+      if (utility::startsWith(lineError, L"<unknown>")) {
+        error.file = L"<unknown>";
+        lineError.erase(0, 10);
+      } else {
+        size_t fileExtIndex = utility::indexOf(lineError, L".psc(");
+        if (fileExtIndex == std::string::npos && gameSettings.optimizeFlag) {
+          fileExtIndex = utility::indexOf(lineError, L".pas(");
+          isScriptError = true;
+        }
+
+        if (fileExtIndex != std::string::npos) {
+          error.file = lineError.substr(0, fileExtIndex + 4);
+          if (isScriptError) {
+            error.file = (std::filesystem::path(outputDirectory) / error.file).wstring(); // Papyrus compiler doesn't provide full path for .pas files
+          }
+          lineError.erase(0, fileExtIndex + 5);
+        }
+      }
+
+      if (!error.file.empty()) {
+        if (!isScriptError) { // .psc
+          size_t indexComma = lineError.find_first_of(L',');
+          error.line = std::stoi(lineError.substr(0, indexComma));
+
+          size_t indexParenthesis = lineError.find_first_of(L')');
+          error.column = std::stoi(lineError.substr(indexComma + 1, indexParenthesis - (indexComma - 1)));
+          error.message = lineError.substr(indexParenthesis + 3);
+        } else { // .pas
+          size_t indexParenthesis = lineError.find_first_of(L')');
+          error.line = std::stoi(lineError.substr(0, indexParenthesis));
+          error.column = 1; // Papyrus compiler doesn't provide column info for .pas files
+          error.message = lineError.substr(indexParenthesis + 4);
+        }
+
+        // Discard duplicate errors.
+        auto iter = std::find_if(errors.begin(), errors.end(),
+          [&](const auto& comparisionError) {
+            return comparisionError.file == error.file
+              && comparisionError.message == error.message
+              && comparisionError.line == error.line
+              && comparisionError.column == error.column;
+          }
+        );
+        if (iter == errors.end()) {
+          errors.push_back(error);
+          if (errorCallback) {
+            errorCallback(error);
+          }
+        }
+      }
+    } catch (...) {
+      //log(line);
+      hasUnparsableLines = true;
+    }
+  }
+
+} // namespace
@@ -0,0 +1,63 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "CompilationResult.hpp"
+#include "CompilerSettings.hpp"
+
+#include "..\CompilationErrorHandling\Error.hpp"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // Parse compiler output into errors. Output can be given in chunks as the compiler produces it, and every new error is reported as soon
+  // as its line is complete.
+  class ErrorParser {
+    public:
+      using error_callback_t = std::function<void(const Error& error)>;
+
+      ErrorParser(const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory, const error_callback_t& errorCallback = {});
+
+      // Parse all complete lines in the given output chunk. An incomplete last line is kept until the rest of it is given.
+      void parse(std::string_view output);
+
+      // Parse the remaining incomplete line and move all errors into the result. The whole output is used as error message when nothing
+      // can be parsed.
+      void finish(const std::string& fullOutput, CompilationResult& result);
+
+    private:
+      void parseLine(const std::string& line);
+
+      // Private members
+      //
+      const CompilerSettings::GameSettings& gameSettings;
+      const std::wstring outputDirectory;
+      const error_callback_t errorCallback;
+
+      std::string incompleteLine;
+      std::vector<Error> errors;
+      bool hasUnparsableLines {false};
+  };
+
+} // namespace
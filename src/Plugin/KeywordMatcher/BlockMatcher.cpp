@@ -0,0 +1,158 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BlockMatcher.hpp"
+
+#include "KeywordMatcherSettings.hpp"
+
+#include "..\Common\StringUtil.hpp"
+#include "..\Lexer\AtomTable.hpp"
+#include "..\Lexer\Lexer.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace papyrus {
+
+  // Internal static variables
+  namespace {
+    // Keywords that open and close a kind of block, and the setting that enables matching them
+    struct BlockKeywords {
+      int keyword;
+      const char* openWord;
+      word_list_t closeWords;
+    };
+
+    const BlockKeywords ifBlockKeywords { KEYWORD_IF, "If", { "EndIf" } };
+    const std::vector<BlockKeywords> blockKeywordsList {
+      { KEYWORD_FUNCTION, "Function", { "EndFunction", "Native" } },
+      { KEYWORD_STRUCT, "Struct", { "EndStruct" } },
+      { KEYWORD_PROPERTY, "Property", { "EndProperty", "Auto", "AutoReadOnly" } },
+      { KEYWORD_GROUP, "Group", { "EndGroup" } },
+      { KEYWORD_STATE, "State", { "EndState" } },
+      { KEYWORD_EVENT, "Event", { "EndEvent" } },
+      { KEYWORD_WHILE, "While", { "EndWhile" } },
+      ifBlockKeywords
+    };
+  }
+
+  void BlockMatcher::styleVisibleLines(MatcherDocument& document, Sci_Position caretPosition) {
+    // Caret isn't necessarily on a visible line, e.g. when view is scrolled with mouse wheel
+    Sci_Position lastLine = std::max(document.getLastVisibleLine(), document.getLineFromPosition(caretPosition)) + VIEW_MARGIN_LINES;
+    Sci_Position styledLine = document.getLineFromPosition(document.getEndStyled());
+    if (lastLine > styledLine) {
+      document.styleLines(lastLine - styledLine);
+    }
+  }
+
+  std::optional<BlockMatcher::Target> BlockMatcher::findTarget(const MatcherDocument& document, Sci_Position position, int enabledKeywords) {
+    Sci_Position wordStart = document.getWordStart(position);
+    Sci_Position wordEnd = document.getWordEnd(position);
+    if (wordEnd <= wordStart) {
+      return std::nullopt;
+    }
+
+    int style = document.getStyleAt(wordStart);
+    if (!Lexer::isKeyword(style) && !Lexer::isFlowControl(style)) {
+      return std::nullopt;
+    }
+
+    Sci_CharacterRange wordPos {
+      .cpMin = static_cast<Sci_PositionCR>(wordStart),
+      .cpMax = static_cast<Sci_PositionCR>(wordEnd)
+    };
+    std::string currentWord = document.getText(wordStart, wordEnd);
+    if (utility::compare(currentWord, "Else") || utility::compare(currentWord, "ElseIf")) {
+      if ((enabledKeywords & KEYWORD_IF) && (enabledKeywords & KEYWORD_ELSE)) {
+        return Target {wordPos, ifBlockKeywords.openWord, &ifBlockKeywords.closeWords, true};
+      }
+    } else {
+      auto iter = std::find_if(blockKeywordsList.begin(), blockKeywordsList.end(), [&](const auto& blockKeywords) {
+        return utility::compare(currentWord, blockKeywords.openWord)
+          || std::any_of(blockKeywords.closeWords.begin(), blockKeywords.closeWords.end(), [&](const char* closeWord) { return utility::compare(currentWord, closeWord); });
+      });
+      if (iter != blockKeywordsList.end() && (enabledKeywords & iter->keyword)) {
+        return Target {wordPos, iter->openWord, &iter->closeWords, iter->keyword == KEYWORD_IF && (enabledKeywords & KEYWORD_ELSE)};
+      }
+    }
+    return std::nullopt;
+  }
+
+  BlockMatcher::Result BlockMatcher::match(MatcherDocument& document, const Target& target) {
+    // Lexer styles a document from its start, so keywords before the close keyword of a block, which decide how it's paired, are
+    // already known once the close keyword is found
+    Result result;
+    result.complete = document.getEndStyled() >= document.getLength();
+    Sci_Position line = document.getLineFromPosition(target.wordPos.cpMin);
+    auto block = document.findBlock(line, target.wordPos.cpMin - document.getLineStart(line));
+    if (!block) {
+      return result;
+    }
+    result.complete = result.complete || block->close.has_value();
+
+    // Block index pairs keywords the same way they are folded, so the paired keyword needs to be the one expected for this block
+    AtomTable& atomTable = AtomTable::instance();
+    bool openMatched = block->open && utility::compare(std::string(atomTable.name(block->open->name)), target.openWord);
+    bool closeMatched = block->close && std::any_of(target.closeWords->begin(), target.closeWords->end(), [&](const char* closeWord) {
+      return utility::compare(std::string(atomTable.name(block->close->name)), closeWord);
+    });
+
+    // Current word is either the open or close keyword of the block, or one of its middle keywords
+    bool isOpen = block->open && getKeywordRange(document, *block->open).cpMin == target.wordPos.cpMin;
+    bool isClose = !isOpen && block->close && getKeywordRange(document, *block->close).cpMin == target.wordPos.cpMin;
+    if (isOpen) {
+      result.matched = closeMatched;
+    } else if (isClose) {
+      result.matched = openMatched;
+    } else {
+      result.matched = openMatched && closeMatched;
+    }
+
+    result.ranges.push_back(target.wordPos);
+    if (openMatched && !isOpen) {
+      result.ranges.push_back(getKeywordRange(document, *block->open));
+    }
+    if (closeMatched && !isClose) {
+      result.ranges.push_back(getKeywordRange(document, *block->close));
+    }
+    if (target.matchMiddle && openMatched) {
+      for (const auto& middle : block->middles) {
+        result.ranges.push_back(getKeywordRange(document, middle));
+      }
+    }
+
+    // Go to close keyword from open keyword, otherwise go to open keyword
+    if (result.matched) {
+      result.matchedPos = getKeywordRange(document, isOpen ? *block->close : *block->open).cpMin;
+    }
+    return result;
+  }
+
+  // Private methods
+  //
+
+  Sci_CharacterRange BlockMatcher::getKeywordRange(const MatcherDocument& document, const BlockIndex::Keyword& keyword) {
+    auto start = static_cast<Sci_PositionCR>(document.getLineStart(keyword.line) + keyword.column);
+    return Sci_CharacterRange {
+      .cpMin = start,
+      .cpMax = start + static_cast<Sci_PositionCR>(keyword.length)
+    };
+  }
+
+} // namespace
@@ -0,0 +1,75 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "MatcherDocument.hpp"
+
+#include "..\Lexer\BlockIndex.hpp"
+
+#include "..\..\external\scintilla\Scintilla.h"
+
+#include <optional>
+#include <vector>
+
+namespace papyrus {
+
+  using word_list_t = std::vector<const char*>;
+
+  // Matching logic of keyword matcher. Document is only accessed through MatcherDocument, so it doesn't depend on Scintilla.
+  class BlockMatcher {
+    public:
+      // Number of lines after visible lines that are styled before the first match
+      static constexpr Sci_Position VIEW_MARGIN_LINES = 1000;
+
+      // Number of lines styled at a time while a match waits for its close keyword to be found
+      static constexpr Sci_Position STYLE_STEP_LINES = 50000;
+
+      // Keyword to be matched, and the keywords expected for its kind of block
+      struct Target {
+        Sci_CharacterRange wordPos;
+        const char* openWord;
+        const word_list_t* closeWords;
+        bool matchMiddle;
+      };
+
+      struct Result {
+        bool matched {false};
+        bool complete {false};                    // Whether the result won't change as more of the document is styled
+        Sci_PositionCR matchedPos {0};
+        std::vector<Sci_CharacterRange> ranges;   // Ranges to highlight, starting with the keyword itself
+      };
+
+      // Style visible lines, caret's line, and a margin after them, so the first match only depends on the visible part of document
+      static void styleVisibleLines(MatcherDocument& document, Sci_Position caretPosition);
+
+      // Get the keyword at position if it's a block keyword enabled for matching, according to KEYWORD_* flags
+      static std::optional<Target> findTarget(const MatcherDocument& document, Sci_Position position, int enabledKeywords);
+
+      // Find keywords of target's block that are the expected ones for this kind of block, including its middle keywords when
+      // matchMiddle is set. Only keywords in the styled part of document are known to the lexer, so until block's close keyword is
+      // found or the whole document is styled, the result is provisional, and the document needs to be styled further.
+      static Result match(MatcherDocument& document, const Target& target);
+
+    private:
+      // Get document range of a keyword in block index
+      static Sci_CharacterRange getKeywordRange(const MatcherDocument& document, const BlockIndex::Keyword& keyword);
+  };
+
+} // namespace
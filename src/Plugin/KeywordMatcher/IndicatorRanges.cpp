@@ -0,0 +1,84 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IndicatorRanges.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  void IndicatorRanges::fill(MatcherDocument& document, std::vector<Sci_CharacterRange> newRanges) {
+    for (const auto& range : newRanges) {
+      document.fillIndicator(range.cpMin, range.cpMax - range.cpMin);
+    }
+    if (ranges.empty()) {
+      ranges = std::move(newRanges);
+    } else {
+      ranges.insert(ranges.end(), newRanges.begin(), newRanges.end());
+    }
+  }
+
+  void IndicatorRanges::clear(MatcherDocument& document, HWND handle, npp_buffer_t bufferID) {
+    if (handle == drawnHandle && bufferID == drawnBufferID) {
+      for (const auto& range : ranges) {
+        if (range.cpMax > range.cpMin) {
+          document.clearIndicator(range.cpMin, range.cpMax - range.cpMin);
+        }
+      }
+    } else {
+      // Document may still have indications from when it was shown before
+      document.clearIndicator(0, document.getLength());
+      drawnHandle = handle;
+      drawnBufferID = bufferID;
+    }
+    ranges.clear();
+  }
+
+  void IndicatorRanges::reset() {
+    drawnHandle = 0;
+    ranges.clear();
+  }
+
+  void IndicatorRanges::handleContentChange(HWND handle, Sci_Position position, Sci_Position length, bool inserted) {
+    if (handle != drawnHandle) {
+      return;
+    }
+
+    auto changePos = static_cast<Sci_PositionCR>(position);
+    auto changeLength = static_cast<Sci_PositionCR>(length);
+    for (auto& range : ranges) {
+      if (inserted) {
+        // Texts inserted inside a range may be highlighted as well, so the range is extended to cover them
+        if (range.cpMin >= changePos) {
+          range.cpMin += changeLength;
+        }
+        if (range.cpMax > changePos) {
+          range.cpMax += changeLength;
+        }
+      } else {
+        auto adjust = [&](Sci_PositionCR pos) {
+          return (pos < changePos) ? pos : std::max(pos - changeLength, changePos);
+        };
+        range.cpMin = adjust(range.cpMin);
+        range.cpMax = adjust(range.cpMax);
+      }
+    }
+  }
+
+} // namespace
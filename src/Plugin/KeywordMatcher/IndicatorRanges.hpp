@@ -0,0 +1,63 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "MatcherDocument.hpp"
+
+#include "..\Common\NotepadPlusPlus.hpp"
+
+#include "..\..\external\scintilla\Scintilla.h"
+
+#include <vector>
+
+#include <windows.h>
+
+namespace papyrus {
+
+  // Ranges highlighted with an indicator and the document they were drawn in. Ranges move with texts as the document is edited, so
+  // they can be cleared later without clearing the whole document.
+  class IndicatorRanges {
+    public:
+      inline bool empty() const noexcept { return ranges.empty(); }
+      inline size_t size() const noexcept { return ranges.size(); }
+
+      // Highlight ranges in a document, which are then tracked with the ones already drawn
+      void fill(MatcherDocument& document, std::vector<Sci_CharacterRange> newRanges);
+
+      // Clear highlighted ranges, or the whole document if it isn't the one they were drawn in
+      void clear(MatcherDocument& document, HWND handle, npp_buffer_t bufferID);
+
+      // Forget highlighted ranges without clearing them, so the whole document gets cleared next time, e.g. when they were drawn with
+      // an indicator that is no longer used
+      void reset();
+
+      // Keep track of texts added/deleted. A document shown in both views notifies from both of them, so only changes from the view
+      // ranges were drawn in are applied.
+      void handleContentChange(HWND handle, Sci_Position position, Sci_Position length, bool inserted);
+
+    private:
+      // Private members
+      //
+      HWND drawnHandle {0};
+      npp_buffer_t drawnBufferID {0};
+      std::vector<Sci_CharacterRange> ranges;
+  };
+
+} // namespace
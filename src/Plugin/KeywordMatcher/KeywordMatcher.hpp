@@ -19,35 +19,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "BlockMatcher.hpp"
+#include "IndicatorRanges.hpp"
 #include "KeywordMatcherSettings.hpp"
+#include "ScintillaMatcherDocument.hpp"
 
 #include "..\Common\NotepadPlusPlus.hpp"
 
 #include "..\..\external\npp\PluginInterface.h"
 
-#include <string>
+#include <cstdint>
+#include <optional>
 #include <vector>
 
 namespace papyrus {
 
-  using word_list_t = std::vector<const char*>;
-  using result_list_t = std::vector<Sci_CharacterRange>;
-
+  // Highlights the keyword at caret together with the keywords of the same block. Blocks are looked up in the block index the lexer
+  // keeps for the document, so matching doesn't search the document. Matching itself is done by BlockMatcher, while this class
+  // handles Notepad++ views and buffers.
+  //
+  // Matching is skipped when neither the word at caret nor the document has changed since last time. A match first only looks at
+  // visible lines and a margin after them, and highlights what it finds there as matched. When the block's close keyword isn't found
+  // yet, the rest of the document is styled in steps posted to message window until it is, and a match that hasn't finished yet is
+  // dropped as soon as caret moves to another word.
   class KeywordMatcher {
     public:
-      struct SavedSearch {
-        SavedSearch(HWND handle);
-        ~SavedSearch();
-
-        HWND handle;
-        npp_position_t startPos;
-        npp_position_t endPos;
-        int flags;
-      };
-
-      KeywordMatcher(const NppData& nppData, const KeywordMatcherSettings& settings);
+      KeywordMatcher(const NppData& nppData, HWND messageWindow, const KeywordMatcherSettings& settings);
 
       bool match(HWND scintillaHandle);
+      inline bool isMatched() const { return matched; }
       inline void goToMatchedPos() const {
         if (handle != 0 && matched) {
           ::SendMessage(handle, SCI_GOTOPOS, matchedPos, 0);
@@ -55,18 +55,42 @@ namespace papyrus {
       }
       void clear();
 
+      // Keep track of texts added/deleted, so highlighted ranges can be cleared and matching redone
+      void handleContentChange(HWND scintillaHandle, Sci_Position position, Sci_Position length, bool inserted);
+
+      // Continue pending match when its message is received. Returns true if the match has completed.
+      bool resumeMatch();
+
     private:
-      enum class SearchWordType {
-        Keyword,
-        FlowControl
+      // Word at caret and the document it was matched in
+      struct MatchTarget {
+        HWND handle;
+        npp_buffer_t bufferID;
+        Sci_PositionCR wordStart;
+        Sci_PositionCR wordEnd;
+        uint64_t documentVersion;
+
+        bool operator==(const MatchTarget&) const = default;
       };
 
-      void match();
-      void matchKeyword(Sci_CharacterRange currentWordPos, const char* currentWord, word_list_t matchingWords, bool searchForward = true);
-      void matchFlowControl(Sci_CharacterRange currentWordPos, const char* currentWord, const char* matchingWord, word_list_t otherWords, bool searchForward = true);
-      Sci_CharacterRange matchFlowControl(Sci_CharacterRange currentWordPos, const char* currentWord, const char* matchingWord, word_list_t otherWords, result_list_t& otherWordsPosList, bool searchForward = true);
-      Sci_CharacterRange findText(const char* text, Sci_PositionCR start, Sci_PositionCR end, SearchWordType searchWordType, bool searchForward = true, int searchFlags = SCFIND_WHOLEWORD);
-      void findWords(Sci_PositionCR start, Sci_PositionCR end, word_list_t words, result_list_t& foundPosList, SearchWordType searchWordType, bool searchForward = true);
+      // Redo matching regardless of whether caret has moved, e.g. after settings change
+      void rematch();
+
+      // Match pending match's word with the part of document styled so far, after styling the next part of it when widen is set.
+      // If the result is provisional, post message to continue. Returns true if the match has completed.
+      bool continueMatch(bool widen);
+
+      // Provisional matches are shown as matched until they are known not to be
+      inline bool isShownAsMatched() const { return matched || provisional; }
+
+      // Post message to continue pending match, unless one is already posted
+      void postResumeMatch();
+
+      // Clear highlighted ranges, or the whole document if it isn't the one they were drawn in
+      void clearIndications();
+
+      // Access to current document
+      inline ScintillaMatcherDocument getDocument() const { return ScintillaMatcherDocument(handle, bufferID, indicatorID); }
 
       void setupIndicator();
       void showIndicator();
@@ -80,14 +104,23 @@ namespace papyrus {
       // Private members
       //
       const NppData& nppData;
+      HWND messageWindow;
       const KeywordMatcherSettings& settings;
       HWND handle {0};
-      Sci_PositionCR docLength {0};
+      npp_buffer_t bufferID {0};
+
+      uint64_t documentVersion {0};
+      std::optional<MatchTarget> lastTarget;
+      std::optional<BlockMatcher::Target> pendingMatch;
+      bool resumeMatchPosted {false};
+
+      IndicatorRanges drawnRanges;
 
       int indicatorID {0};
       int allocatedIndicatorID {0};
 
       bool matched {false};
+      bool provisional {false};
       Sci_PositionCR matchedPos {0};
   };
 
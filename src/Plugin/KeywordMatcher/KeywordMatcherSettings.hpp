@@ -21,9 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "..\Common\PrimitiveTypeValueMonitor.hpp"
 
+#include <cstdint>
 #include <string>
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+using COLORREF = uint32_t;  // Same layout as Windows, 0x00BBGGRR
+#endif
 
 namespace papyrus {
 
@@ -40,6 +45,7 @@ namespace papyrus {
   constexpr int KEYWORD_ALL      = KEYWORD_FUNCTION | KEYWORD_STATE | KEYWORD_EVENT | KEYWORD_PROPERTY | KEYWORD_GROUP | KEYWORD_STRUCT | KEYWORD_IF | KEYWORD_ELSE | KEYWORD_WHILE;
 
   constexpr int DEFAULT_MATCHER_INDICATOR = 17;
+  constexpr int DEFAULT_OCCURRENCE_INDICATOR = 18;
 
   struct KeywordMatcherSettings {
     utility::PrimitiveTypeValueMonitor<bool>     enableKeywordMatching;
@@ -50,6 +56,10 @@ namespace papyrus {
     utility::PrimitiveTypeValueMonitor<COLORREF> matchedIndicatorForegroundColor;
     utility::PrimitiveTypeValueMonitor<int>      unmatchedIndicatorStyle;
     utility::PrimitiveTypeValueMonitor<COLORREF> unmatchedIndicatorForegroundColor;
+    utility::PrimitiveTypeValueMonitor<bool>     enableOccurrenceHighlighting;
+    utility::PrimitiveTypeValueMonitor<int>      defaultOccurrenceIndicatorID;
+    utility::PrimitiveTypeValueMonitor<int>      occurrenceIndicatorStyle;
+    utility::PrimitiveTypeValueMonitor<COLORREF> occurrenceIndicatorForegroundColor;
   };
 
 } // namespace
@@ -0,0 +1,65 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "..\Lexer\BlockIndex.hpp"
+#include "..\Lexer\OccurrenceIndex.hpp"
+
+#include "..\..\external\scintilla\Sci_Position.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  // Access to a document and an indicator on it, which is all that keyword matching and occurrence highlighting logic needs. Implemented on top of Scintilla,
+  // and on top of an in-memory document so matching can be run without Notepad++, e.g. for benchmarking.
+  class MatcherDocument {
+    public:
+      virtual ~MatcherDocument() = default;
+
+      virtual Sci_Position getLength() const = 0;
+      virtual Sci_Position getEndStyled() const = 0;
+      virtual Sci_Position getFirstVisibleLine() const = 0;
+      virtual Sci_Position getLastVisibleLine() const = 0;
+      virtual Sci_Position getLineFromPosition(Sci_Position position) const = 0;
+      virtual Sci_Position getLineStart(Sci_Position line) const = 0;
+      virtual int getStyleAt(Sci_Position position) const = 0;
+      virtual std::string getText(Sci_Position start, Sci_Position end) const = 0;
+
+      // Start/end of the word at position, which only consists of word characters
+      virtual Sci_Position getWordStart(Sci_Position position) const = 0;
+      virtual Sci_Position getWordEnd(Sci_Position position) const = 0;
+
+      // Style the next given number of lines that haven't been styled yet. Returns true if the whole document is styled.
+      virtual bool styleLines(Sci_Position numLines) = 0;
+
+      // Get the block a fold keyword at given position belongs to, from blocks found by lexer
+      virtual std::optional<BlockIndex::Block> findBlock(Sci_Position line, Sci_Position column) = 0;
+
+      // Get occurrences of the identifier at given position on lines from firstLine to lastLine, from identifiers found by lexer
+      virtual std::vector<OccurrenceIndex::Occurrence> findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) = 0;
+
+      virtual void fillIndicator(Sci_Position start, Sci_Position length) = 0;
+      virtual void clearIndicator(Sci_Position start, Sci_Position length) = 0;
+  };
+
+} // namespace
@@ -0,0 +1,115 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MemoryMatcherDocument.hpp"
+
+#include "..\Lexer\Lexer.hpp"
+#include "..\Lexer\MemoryDocument.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  MemoryMatcherDocument::MemoryMatcherDocument(MemoryDocument& document, Lexer& lexer)
+    : document(document), lexer(lexer), indicators(document.Length(), 0) {
+  }
+
+  Sci_Position MemoryMatcherDocument::getLength() const {
+    return document.Length();
+  }
+
+  Sci_Position MemoryMatcherDocument::getEndStyled() const {
+    return document.getEndStyled();
+  }
+
+  Sci_Position MemoryMatcherDocument::getFirstVisibleLine() const {
+    return firstVisibleLine;
+  }
+
+  Sci_Position MemoryMatcherDocument::getLastVisibleLine() const {
+    return lastVisibleLine;
+  }
+
+  Sci_Position MemoryMatcherDocument::getLineFromPosition(Sci_Position position) const {
+    return document.LineFromPosition(position);
+  }
+
+  Sci_Position MemoryMatcherDocument::getLineStart(Sci_Position line) const {
+    return document.LineStart(line);
+  }
+
+  int MemoryMatcherDocument::getStyleAt(Sci_Position position) const {
+    return static_cast<unsigned char>(document.StyleAt(position));
+  }
+
+  std::string MemoryMatcherDocument::getText(Sci_Position start, Sci_Position end) const {
+    return document.getText().substr(start, end - start);
+  }
+
+  Sci_Position MemoryMatcherDocument::getWordStart(Sci_Position position) const {
+    while (position > 0 && isWordChar(position - 1)) {
+      --position;
+    }
+    return position;
+  }
+
+  Sci_Position MemoryMatcherDocument::getWordEnd(Sci_Position position) const {
+    while (position < document.Length() && isWordChar(position)) {
+      ++position;
+    }
+    return position;
+  }
+
+  bool MemoryMatcherDocument::styleLines(Sci_Position numLines) {
+    // Restyle from the start of the line styling stopped at, the same way Scintilla does
+    Sci_Position startLine = document.LineFromPosition(document.getEndStyled());
+    Sci_Position startPos = document.LineStart(startLine);
+    Sci_Position endPos = document.LineStart(std::min(startLine + numLines, document.getLineCount()));
+    if (endPos > startPos) {
+      lexer.Lex(startPos, endPos - startPos, 0, &document);
+      lexer.Fold(startPos, endPos - startPos, 0, &document);
+    }
+    return document.getEndStyled() >= document.Length();
+  }
+
+  std::optional<BlockIndex::Block> MemoryMatcherDocument::findBlock(Sci_Position line, Sci_Position column) {
+    return lexer.findBlock(line, column);
+  }
+
+  std::vector<OccurrenceIndex::Occurrence> MemoryMatcherDocument::findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) {
+    return lexer.findOccurrences(line, column, firstLine, lastLine);
+  }
+
+  void MemoryMatcherDocument::fillIndicator(Sci_Position start, Sci_Position length) {
+    std::fill_n(indicators.begin() + start, length, 1);
+  }
+
+  void MemoryMatcherDocument::clearIndicator(Sci_Position start, Sci_Position length) {
+    std::fill_n(indicators.begin() + start, length, 0);
+  }
+
+  // Private methods
+  //
+
+  bool MemoryMatcherDocument::isWordChar(Sci_Position position) const {
+    unsigned char ch = static_cast<unsigned char>(document.getText()[position]);
+    return ch >= 0x80 || ch == '_' || (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+  }
+
+} // namespace
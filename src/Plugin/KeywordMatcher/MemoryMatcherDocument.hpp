@@ -0,0 +1,69 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "MatcherDocument.hpp"
+
+#include <vector>
+
+namespace papyrus {
+
+  class Lexer;
+  class MemoryDocument;
+
+  // Keyword matcher's access to an in-memory document lexed by a lexer that isn't used on a Notepad++ buffer. Indicator is kept as
+  // a flag per position, and visible lines are set by its owner.
+  class MemoryMatcherDocument : public MatcherDocument {
+    public:
+      MemoryMatcherDocument(MemoryDocument& document, Lexer& lexer);
+
+      inline bool hasIndicator(Sci_Position position) const { return indicators[position] != 0; }
+      inline void setVisibleLines(Sci_Position firstLine, Sci_Position lastLine) { firstVisibleLine = firstLine; lastVisibleLine = lastLine; }
+
+      Sci_Position getLength() const override;
+      Sci_Position getEndStyled() const override;
+      Sci_Position getFirstVisibleLine() const override;
+      Sci_Position getLastVisibleLine() const override;
+      Sci_Position getLineFromPosition(Sci_Position position) const override;
+      Sci_Position getLineStart(Sci_Position line) const override;
+      int getStyleAt(Sci_Position position) const override;
+      std::string getText(Sci_Position start, Sci_Position end) const override;
+      Sci_Position getWordStart(Sci_Position position) const override;
+      Sci_Position getWordEnd(Sci_Position position) const override;
+      bool styleLines(Sci_Position numLines) override;
+      std::optional<BlockIndex::Block> findBlock(Sci_Position line, Sci_Position column) override;
+      std::vector<OccurrenceIndex::Occurrence> findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) override;
+      void fillIndicator(Sci_Position start, Sci_Position length) override;
+      void clearIndicator(Sci_Position start, Sci_Position length) override;
+
+    private:
+      // Same word characters as Scintilla's default
+      bool isWordChar(Sci_Position position) const;
+
+      // Private members
+      //
+      MemoryDocument& document;
+      Lexer& lexer;
+      std::vector<char> indicators;
+      Sci_Position firstVisibleLine {0};
+      Sci_Position lastVisibleLine {0};
+  };
+
+} // namespace
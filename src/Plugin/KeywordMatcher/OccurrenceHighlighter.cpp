@@ -0,0 +1,145 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OccurrenceHighlighter.hpp"
+
+#include "BlockMatcher.hpp"
+#include "OccurrenceMatcher.hpp"
+
+#include "..\..\external\npp\Common.h"
+
+namespace papyrus {
+
+  OccurrenceHighlighter::OccurrenceHighlighter(const NppData& nppData, const KeywordMatcherSettings& settings)
+   : nppData(nppData), settings(settings) {
+    // Subscribe to settings changes
+    KeywordMatcherSettings& subscribableSettings = const_cast<KeywordMatcherSettings&>(settings);
+    subscribableSettings.enableOccurrenceHighlighting.subscribe([&](auto) { rehighlight(); });
+    subscribableSettings.autoAllocateIndicatorID.subscribe([&](auto) { changeIndicator(); });
+    subscribableSettings.defaultOccurrenceIndicatorID.subscribe([&](auto) { changeIndicator(); });
+    subscribableSettings.occurrenceIndicatorStyle.subscribe([&](auto) { if (handle != 0 && !drawnRanges.empty()) { setupIndicator(); } });
+    subscribableSettings.occurrenceIndicatorForegroundColor.subscribe([&](auto) { if (handle != 0 && !drawnRanges.empty()) { setupIndicator(); } });
+   }
+
+  void OccurrenceHighlighter::highlight(HWND scintillaHandle) {
+    handle = scintillaHandle;
+    npp_view_t view = (handle == nppData._scintillaMainHandle) ? MAIN_VIEW : SUB_VIEW;
+    bufferID = utility::getActiveBufferIdOnView(nppData._nppHandle, view);
+
+    // Identifiers are only known on styled lines, so visible ones are styled first
+    ScintillaMatcherDocument document = getDocument();
+    Sci_Position currentPos = static_cast<Sci_Position>(::SendMessage(handle, SCI_GETCURRENTPOS, 0, 0));
+    if (settings.enableOccurrenceHighlighting) {
+      BlockMatcher::styleVisibleLines(document, currentPos);
+    }
+
+    // Nothing to do if caret is still on the same word, visible lines are still highlighted, and the document hasn't changed or been
+    // styled further
+    HighlightTarget target {
+      .handle = handle,
+      .bufferID = bufferID,
+      .wordStart = static_cast<Sci_PositionCR>(document.getWordStart(currentPos)),
+      .wordEnd = static_cast<Sci_PositionCR>(document.getWordEnd(currentPos)),
+      .documentVersion = documentVersion,
+      .endStyled = document.getEndStyled()
+    };
+    if (lastTarget == target && document.getFirstVisibleLine() >= highlightedFirstLine && document.getLastVisibleLine() <= highlightedLastLine) {
+      return;
+    }
+
+    clear();
+    lastTarget = target;
+
+    if (settings.enableOccurrenceHighlighting) {
+      OccurrenceMatcher::Result result = OccurrenceMatcher::match(document, currentPos);
+      highlightedFirstLine = result.firstLine;
+      highlightedLastLine = result.lastLine;
+      if (!result.ranges.empty()) {
+        drawnRanges.fill(document, std::move(result.ranges));
+        setupIndicator();
+      }
+    }
+  }
+
+  void OccurrenceHighlighter::clear() {
+    if (handle != 0) {
+      ScintillaMatcherDocument document = getDocument();
+      drawnRanges.clear(document, handle, bufferID);
+    }
+    lastTarget.reset();
+  }
+
+  void OccurrenceHighlighter::handleContentChange(HWND scintillaHandle, Sci_Position position, Sci_Position length, bool inserted) {
+    documentVersion++;
+    drawnRanges.handleContentChange(scintillaHandle, position, length, inserted);
+  }
+
+  // Private methods
+  //
+
+  void OccurrenceHighlighter::rehighlight() {
+    if (handle != 0) {
+      lastTarget.reset();
+      highlight(handle);
+    }
+  }
+
+  void OccurrenceHighlighter::setupIndicator() {
+    ::SendMessage(handle, SCI_INDICSETFORE, indicatorID, settings.occurrenceIndicatorForegroundColor);
+    ::SendMessage(handle, SCI_INDICSETOUTLINEALPHA, indicatorID, 255); // Always make indicator's outline opaque
+    ::SendMessage(handle, SCI_INDICSETSTYLE, indicatorID, settings.enableOccurrenceHighlighting ? static_cast<int>(settings.occurrenceIndicatorStyle) : INDIC_HIDDEN);
+  }
+
+  void OccurrenceHighlighter::changeIndicator() {
+    int oldIndicatorID = indicatorID;
+    if (settings.autoAllocateIndicatorID) {
+      if (allocatedIndicatorID == 0) {
+        if (!static_cast<bool>(::SendMessage(nppData._nppHandle, NPPM_ALLOCATEINDICATOR, 1, reinterpret_cast<LPARAM>(&allocatedIndicatorID)))) {
+          // Likely no available indicator ID left.
+          allocatedIndicatorID = -1;
+        }
+      }
+
+      if (allocatedIndicatorID > 0) {
+        indicatorID = allocatedIndicatorID;
+      } else if (settings.defaultOccurrenceIndicatorID > 0) {
+        indicatorID = settings.defaultOccurrenceIndicatorID;
+      }
+    } else if (settings.defaultOccurrenceIndicatorID > 0) {
+      indicatorID = settings.defaultOccurrenceIndicatorID;
+    }
+
+    if (indicatorID != oldIndicatorID) {
+      // Clear indications from both views if they are Papyrus scripts.
+      std::wstring mainViewFilePath = utility::getApplicableFilePathOnView(nppData._nppHandle, MAIN_VIEW);
+      if (!mainViewFilePath.empty()) {
+        utility::clearIndications(nppData._scintillaMainHandle, oldIndicatorID);
+      }
+      std::wstring secondViewFilePath = utility::getApplicableFilePathOnView(nppData._nppHandle, SUB_VIEW);
+      if (!secondViewFilePath.empty()) {
+        utility::clearIndications(nppData._scintillaSecondHandle, oldIndicatorID);
+      }
+
+      // Highlighted ranges were drawn with old indicator, so the whole document gets cleared with the new one
+      drawnRanges.reset();
+      rehighlight();
+    }
+  }
+
+} // namespace
@@ -0,0 +1,94 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "IndicatorRanges.hpp"
+#include "KeywordMatcherSettings.hpp"
+#include "ScintillaMatcherDocument.hpp"
+
+#include "..\Common\NotepadPlusPlus.hpp"
+
+#include "..\..\external\npp\PluginInterface.h"
+
+#include <cstdint>
+#include <optional>
+
+namespace papyrus {
+
+  // Highlights all occurrences of the identifier at caret with its own indicator. Occurrences are looked up in the occurrence index
+  // the lexer keeps for the document, so highlighting doesn't search the document, and names in comments and strings are never
+  // highlighted since the lexer doesn't index them. Matching itself is done by OccurrenceMatcher, while this class handles Notepad++
+  // views and buffers.
+  //
+  // Only occurrences on and around visible lines are highlighted. Like KeywordMatcher, highlighting is skipped when neither the word
+  // at caret nor the document has changed since last time, unless the view is scrolled past the highlighted lines, or more of the
+  // document is styled, since identifiers on newly styled lines are only known then.
+  class OccurrenceHighlighter {
+    public:
+      OccurrenceHighlighter(const NppData& nppData, const KeywordMatcherSettings& settings);
+
+      void highlight(HWND scintillaHandle);
+      void clear();
+
+      // Keep track of texts added/deleted, so highlighted ranges can be cleared and highlighting redone
+      void handleContentChange(HWND scintillaHandle, Sci_Position position, Sci_Position length, bool inserted);
+
+    private:
+      // Word at caret and the part of document it was matched in
+      struct HighlightTarget {
+        HWND handle;
+        npp_buffer_t bufferID;
+        Sci_PositionCR wordStart;
+        Sci_PositionCR wordEnd;
+        uint64_t documentVersion;
+        Sci_Position endStyled;
+
+        bool operator==(const HighlightTarget&) const = default;
+      };
+
+      // Redo highlighting regardless of whether caret has moved, e.g. after settings change
+      void rehighlight();
+
+      // Access to current document
+      inline ScintillaMatcherDocument getDocument() const { return ScintillaMatcherDocument(handle, bufferID, indicatorID); }
+
+      void setupIndicator();
+
+      // Change indicator ID. Same as keyword matcher, it is recommended to auto allocate, while by default 18 is used.
+      void changeIndicator();
+
+      // Private members
+      //
+      const NppData& nppData;
+      const KeywordMatcherSettings& settings;
+      HWND handle {0};
+      npp_buffer_t bufferID {0};
+
+      uint64_t documentVersion {0};
+      std::optional<HighlightTarget> lastTarget;
+      Sci_Position highlightedFirstLine {0};
+      Sci_Position highlightedLastLine {-1};
+      IndicatorRanges drawnRanges;
+
+      int indicatorID {0};
+      int allocatedIndicatorID {0};
+  };
+
+} // namespace
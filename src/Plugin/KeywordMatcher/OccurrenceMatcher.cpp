@@ -0,0 +1,79 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OccurrenceMatcher.hpp"
+
+#include "..\Common\StringUtil.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace papyrus {
+
+  OccurrenceMatcher::Result OccurrenceMatcher::match(MatcherDocument& document, Sci_Position position) {
+    Result result {
+      .firstLine = std::max(document.getFirstVisibleLine() - VIEW_MARGIN_LINES, static_cast<Sci_Position>(0)),
+      .lastLine = document.getLastVisibleLine() + VIEW_MARGIN_LINES,
+      .ranges = {}
+    };
+    Sci_Position wordStart = document.getWordStart(position);
+    if (wordStart == document.getWordEnd(position)) {
+      return result;
+    }
+
+    Sci_Position line = document.getLineFromPosition(wordStart);
+    Sci_Position column = wordStart - document.getLineStart(line);
+    auto occurrences = document.findOccurrences(line, column, result.firstLine, result.lastLine);
+    if (occurrences.empty()) {
+      return result;
+    }
+
+    // Identifiers are only indexed by the hash of their names, so get the name at position to tell other names with the same hash apart
+    std::string name;
+    for (const auto& occurrence : document.findOccurrences(line, column, line, line)) {
+      if (occurrence.column <= column && column < occurrence.column + occurrence.length) {
+        Sci_Position start = document.getLineStart(line) + occurrence.column;
+        name = document.getText(start, start + occurrence.length);
+        break;
+      }
+    }
+
+    // Occurrences are in document order, so each line's start only needs to be looked up once
+    auto& ranges = result.ranges;
+    ranges.reserve(occurrences.size());
+    Sci_Position lastLine = -1;
+    Sci_Position lineStart = 0;
+    for (const auto& occurrence : occurrences) {
+      if (occurrence.line != lastLine) {
+        lastLine = occurrence.line;
+        lineStart = document.getLineStart(lastLine);
+      }
+      if (static_cast<size_t>(occurrence.length) != name.length()
+        || !utility::compare(document.getText(lineStart + occurrence.column, lineStart + occurrence.column + occurrence.length), name)) {
+        continue;
+      }
+      ranges.push_back(Sci_CharacterRange {
+        .cpMin = static_cast<Sci_PositionCR>(lineStart + occurrence.column),
+        .cpMax = static_cast<Sci_PositionCR>(lineStart + occurrence.column + occurrence.length)
+      });
+    }
+    return result;
+  }
+
+} // namespace
@@ -0,0 +1,51 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "MatcherDocument.hpp"
+
+#include "..\..\external\scintilla\Scintilla.h"
+
+#include <vector>
+
+namespace papyrus {
+
+  // Occurrence highlighting logic. Like BlockMatcher, document is only accessed through MatcherDocument.
+  //
+  // Only occurrences on visible lines and a margin around them are highlighted, so a name used all over a long script costs no more
+  // than one used a few times.
+  class OccurrenceMatcher {
+    public:
+      // Number of lines before and after visible lines whose occurrences are highlighted as well, so scrolling within them doesn't
+      // need highlighting to be redone
+      static constexpr Sci_Position VIEW_MARGIN_LINES = 200;
+
+      struct Result {
+        Sci_Position firstLine {0};               // Lines occurrences were looked up on
+        Sci_Position lastLine {-1};
+        std::vector<Sci_CharacterRange> ranges;   // Ranges to highlight, in document order
+      };
+
+      // Find occurrences of the identifier at position. There are no ranges if there isn't an identifier there. Only identifiers in
+      // the styled part of document are known to the lexer.
+      static Result match(MatcherDocument& document, Sci_Position position);
+  };
+
+} // namespace
@@ -0,0 +1,115 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ScintillaMatcherDocument.hpp"
+
+#include "..\Lexer\Lexer.hpp"
+
+#include "..\..\external\scintilla\Scintilla.h"
+
+namespace papyrus {
+
+  ScintillaMatcherDocument::ScintillaMatcherDocument(HWND handle, npp_buffer_t bufferID, int indicatorID)
+    : handle(handle), bufferID(bufferID), indicatorID(indicatorID) {
+  }
+
+  Sci_Position ScintillaMatcherDocument::getLength() const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_GETLENGTH, 0, 0));
+  }
+
+  Sci_Position ScintillaMatcherDocument::getEndStyled() const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_GETENDSTYLED, 0, 0));
+  }
+
+  Sci_Position ScintillaMatcherDocument::getFirstVisibleLine() const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_DOCLINEFROMVISIBLE, ::SendMessage(handle, SCI_GETFIRSTVISIBLELINE, 0, 0), 0));
+  }
+
+  Sci_Position ScintillaMatcherDocument::getLastVisibleLine() const {
+    // Visible lines are counted with folded lines hidden and wrapped lines split, which need to be mapped back to document lines
+    Sci_Position lastVisibleLine = static_cast<Sci_Position>(::SendMessage(handle, SCI_GETFIRSTVISIBLELINE, 0, 0) + ::SendMessage(handle, SCI_LINESONSCREEN, 0, 0));
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_DOCLINEFROMVISIBLE, lastVisibleLine, 0));
+  }
+
+  Sci_Position ScintillaMatcherDocument::getLineFromPosition(Sci_Position position) const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_LINEFROMPOSITION, position, 0));
+  }
+
+  Sci_Position ScintillaMatcherDocument::getLineStart(Sci_Position line) const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_POSITIONFROMLINE, line, 0));
+  }
+
+  int ScintillaMatcherDocument::getStyleAt(Sci_Position position) const {
+    return static_cast<int>(::SendMessage(handle, SCI_GETSTYLEAT, position, 0));
+  }
+
+  std::string ScintillaMatcherDocument::getText(Sci_Position start, Sci_Position end) const {
+    std::string text(end - start, '\0');
+    Sci_TextRange textRange {
+      .chrg = {
+        .cpMin = static_cast<Sci_PositionCR>(start),
+        .cpMax = static_cast<Sci_PositionCR>(end)
+      },
+      .lpstrText = text.data()
+    };
+    // Scintilla writes a terminating NUL after the text, which std::string has room for
+    ::SendMessage(handle, SCI_GETTEXTRANGE, 0, reinterpret_cast<LPARAM>(&textRange));
+    return text;
+  }
+
+  Sci_Position ScintillaMatcherDocument::getWordStart(Sci_Position position) const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_WORDSTARTPOSITION, position, true));
+  }
+
+  Sci_Position ScintillaMatcherDocument::getWordEnd(Sci_Position position) const {
+    return static_cast<Sci_Position>(::SendMessage(handle, SCI_WORDENDPOSITION, position, true));
+  }
+
+  bool ScintillaMatcherDocument::styleLines(Sci_Position numLines) {
+    // Scintilla only styles the displayed part of a document, while keywords after it may be needed to tell which ones are paired
+    Sci_Position docLength = getLength();
+    Sci_Position endStyled = getEndStyled();
+    if (endStyled < docLength) {
+      Sci_Position stepLine = getLineFromPosition(endStyled) + numLines;
+      Sci_Position stepEnd = (stepLine < static_cast<Sci_Position>(::SendMessage(handle, SCI_GETLINECOUNT, 0, 0))) ? getLineStart(stepLine) : -1;
+      ::SendMessage(handle, SCI_COLOURISE, endStyled, stepEnd);
+      endStyled = getEndStyled();
+    }
+    return endStyled >= docLength;
+  }
+
+  std::optional<BlockIndex::Block> ScintillaMatcherDocument::findBlock(Sci_Position line, Sci_Position column) {
+    return Lexer::findBlock(bufferID, line, column);
+  }
+
+  std::vector<OccurrenceIndex::Occurrence> ScintillaMatcherDocument::findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) {
+    return Lexer::findOccurrences(bufferID, line, column, firstLine, lastLine);
+  }
+
+  void ScintillaMatcherDocument::fillIndicator(Sci_Position start, Sci_Position length) {
+    ::SendMessage(handle, SCI_SETINDICATORCURRENT, indicatorID, 0);
+    ::SendMessage(handle, SCI_INDICATORFILLRANGE, start, length);
+  }
+
+  void ScintillaMatcherDocument::clearIndicator(Sci_Position start, Sci_Position length) {
+    ::SendMessage(handle, SCI_SETINDICATORCURRENT, indicatorID, 0);
+    ::SendMessage(handle, SCI_INDICATORCLEARRANGE, start, length);
+  }
+
+} // namespace
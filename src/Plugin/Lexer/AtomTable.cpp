@@ -0,0 +1,122 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AtomTable.hpp"
+
+#include "..\Common\Logger.hpp"
+
+#include <string>
+
+namespace papyrus {
+
+  using Lock = std::lock_guard<std::mutex>;
+
+  AtomTable& AtomTable::instance() {
+    static AtomTable atomTable;
+    return atomTable;
+  }
+
+  AtomTable::AtomTable() {
+    indexes.push_back(std::make_unique<Index>(INITIAL_CAPACITY));
+    currentIndex.store(indexes.back().get(), std::memory_order_release);
+  }
+
+  atom_t AtomTable::intern(std::string_view name, uint32_t hash) {
+    if (atom_t atom = find(name, hash); atom != NO_ATOM) {
+      return atom;
+    }
+
+    Lock lock(writerMutex);
+
+    // Another thread may have interned the same name before the lock is acquired
+    if (atom_t atom = find(name, hash); atom != NO_ATOM) {
+      return atom;
+    }
+
+    size_t count = numAtoms.load(std::memory_order_relaxed);
+    if (count >= MAX_CHUNKS * CHUNK_SIZE) {
+      if (!fullReported) {
+        utility::logger.log(L"[AtomTable] Table is full with " + std::to_wstring(count) + L" names, new names are no longer interned");
+        fullReported = true;
+      }
+      return NO_ATOM;
+    }
+
+    // Store the name before publishing its slot, so that readers finding the slot can also read the name
+    size_t chunk = count >> CHUNK_BITS;
+    if (chunkStorage.size() <= chunk) {
+      chunkStorage.push_back(std::make_unique<std::string_view[]>(CHUNK_SIZE));
+      chunks[chunk].store(chunkStorage.back().get(), std::memory_order_release);
+    }
+    const std::string& storedName = nameStorage.emplace_back(name);
+    chunkStorage[chunk][count & (CHUNK_SIZE - 1)] = storedName;
+    atom_t atom = static_cast<atom_t>(count + 1);
+    numAtoms.store(count + 1, std::memory_order_release);
+
+    Index* index = indexes.back().get();
+    if ((count + 1) * 2 > index->mask + 1) {
+      auto newIndex = std::make_unique<Index>((index->mask + 1) * 2);
+      for (size_t i = 0; i <= index->mask; ++i) {
+        if (uint64_t slot = index->slots[i].load(std::memory_order_relaxed); slot != 0) {
+          insert(*newIndex, static_cast<uint32_t>(slot >> 32), static_cast<atom_t>(slot));
+        }
+      }
+      insert(*newIndex, hash, atom);
+      indexes.push_back(std::move(newIndex));
+      currentIndex.store(indexes.back().get(), std::memory_order_release);
+    } else {
+      insert(*index, hash, atom);
+    }
+    return atom;
+  }
+
+  atom_t AtomTable::find(std::string_view name, uint32_t hash) const noexcept {
+    const Index& index = *currentIndex.load(std::memory_order_acquire);
+    for (size_t i = slotIndex(hash) & index.mask;; i = (i + 1) & index.mask) {
+      uint64_t slot = index.slots[i].load(std::memory_order_acquire);
+      if (slot == 0) {
+        return NO_ATOM;
+      }
+      if (static_cast<uint32_t>(slot >> 32) == hash && this->name(static_cast<atom_t>(slot)) == name) {
+        return static_cast<atom_t>(slot);
+      }
+    }
+  }
+
+  std::string_view AtomTable::name(atom_t atom) const noexcept {
+    if (atom == NO_ATOM || atom > numAtoms.load(std::memory_order_acquire)) {
+      return {};
+    }
+
+    size_t i = atom - 1;
+    return chunks[i >> CHUNK_BITS].load(std::memory_order_acquire)[i & (CHUNK_SIZE - 1)];
+  }
+
+  // Private methods
+  //
+
+  void AtomTable::insert(Index& index, uint32_t hash, atom_t atom) noexcept {
+    size_t i = slotIndex(hash) & index.mask;
+    while (index.slots[i].load(std::memory_order_relaxed) != 0) {
+      i = (i + 1) & index.mask;
+    }
+    index.slots[i].store((static_cast<uint64_t>(hash) << 32) | atom, std::memory_order_release);
+  }
+
+} // namespace
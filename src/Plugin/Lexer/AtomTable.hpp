@@ -0,0 +1,107 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "..\Common\StringUtil.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // A process-wide table that interns case-folded identifiers as 4-byte atoms, so that name sets kept per document or per game store
+  // atoms instead of their own copies of strings, and compare them without touching their text. Lookups never lock, while interning a
+  // new name takes a lock.
+  //
+  // Atoms are never released, so only names that stay meaningful are interned: fold keywords, names declared in scripts, and names of
+  // classes found on disk. Other identifiers, e.g. ones being typed, are only looked up. The table still grows with every declaration
+  // made during a session, so it's capped at MAX_CHUNKS * CHUNK_SIZE names. Once it's full, new names get NO_ATOM, which name sets
+  // treat as a name they don't contain, so such names are styled as if they weren't declared.
+  class AtomTable {
+    public:
+      using atom_t = uint32_t;
+
+      // Atom of names that are never interned
+      static constexpr atom_t NO_ATOM = 0;
+
+      static AtomTable& instance();
+
+      // Disable all copy/move constructors/assignment operators
+      AtomTable(AtomTable&& other) = delete;
+
+      // Get atom of a case-folded name, interning it if needed, or NO_ATOM if the table is full, which is logged the first time it
+      // happens. Hash is calculated by utility::hashOf.
+      atom_t intern(std::string_view name, uint32_t hash);
+      inline atom_t intern(std::string_view name) { return intern(name, utility::hashOf(name)); }
+
+      // Get atom of a case-folded name, or NO_ATOM if it's never interned
+      atom_t find(std::string_view name, uint32_t hash) const noexcept;
+      inline atom_t find(std::string_view name) const noexcept { return find(name, utility::hashOf(name)); }
+
+      // Get name of an atom
+      std::string_view name(atom_t atom) const noexcept;
+
+      inline size_t size() const noexcept { return numAtoms.load(std::memory_order_acquire); }
+
+    private:
+      // Each slot packs hash of a name in its high 32 bits and its atom in low 32 bits, with 0 being an empty slot. Slots are only
+      // written once, so readers can probe without locking. The table is replaced by a larger one when half of its slots are used.
+      struct Index {
+        explicit Index(size_t capacity) : mask(capacity - 1), slots(std::make_unique<std::atomic<uint64_t>[]>(capacity)) {}
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+      };
+
+      // Names of atoms are kept in fixed size chunks that never move, so name of an atom can be read while more atoms are added
+      static constexpr size_t CHUNK_BITS = 12;
+      static constexpr size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+      static constexpr size_t MAX_CHUNKS = 8192;
+      static constexpr size_t INITIAL_CAPACITY = 4096;
+
+      AtomTable();
+
+      inline static size_t slotIndex(uint32_t hash) noexcept { return hash ^ (hash >> 15); }
+
+      // Put an atom into an index that has room for it
+      static void insert(Index& index, uint32_t hash, atom_t atom) noexcept;
+
+      // Private members
+      //
+      std::mutex writerMutex;
+      std::atomic<const Index*> currentIndex;
+      std::vector<std::unique_ptr<Index>> indexes;  // Replaced indexes are kept, since readers may still be probing them
+      std::array<std::atomic<const std::string_view*>, MAX_CHUNKS> chunks {};
+      std::vector<std::unique_ptr<std::string_view[]>> chunkStorage;
+      std::deque<std::string> nameStorage;
+      std::atomic<size_t> numAtoms {0};
+      bool fullReported {false};
+  };
+
+  using atom_t = AtomTable::atom_t;
+
+} // namespace
@@ -0,0 +1,374 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BlockIndex.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  void BlockIndex::replaceLines(Sci_Position firstLine, Sci_Position lastLine, const std::vector<Keyword>& lineKeywords) {
+    node_index_t before, replaced, after;
+    split(root, firstLine, before, after);
+    split(after, lastLine + 1, replaced, after);
+
+    // Lines usually have the same keywords after being lexed again
+    std::vector<Keyword> replacedKeywords;
+    collect(replaced, replacedKeywords);
+    if (!std::equal(replacedKeywords.begin(), replacedKeywords.end(), lineKeywords.begin(), lineKeywords.end(), [](const Keyword& keyword1, const Keyword& keyword2) {
+      return keyword1.line == keyword2.line && keyword1.column == keyword2.column && keyword1.length == keyword2.length
+        && keyword1.name == keyword2.name && keyword1.role == keyword2.role;
+    })) {
+      freeTree(replaced);
+      replaced = NIL;
+      for (const auto& keyword : lineKeywords) {
+        replaced = merge(replaced, allocateNode(keyword));
+      }
+    }
+
+    root = merge(merge(before, replaced), after);
+  }
+
+  void BlockIndex::updateLines(Sci_Position line, Sci_Position linesAdded) {
+    // Separate keywords on affected lines from keywords before and after them
+    Sci_Position lastLine = line + std::max(-linesAdded, static_cast<Sci_Position>(0));
+    node_index_t before, affected, after;
+    split(root, line, before, after);
+    split(after, lastLine + 1, affected, after);
+    freeTree(affected);
+
+    // Shift the rest of the keywords, which is only applied to the root of them for now
+    if (after != NIL && linesAdded != 0) {
+      nodes[after].keyword.line += linesAdded;
+      nodes[after].delta += linesAdded;
+    }
+
+    root = merge(before, after);
+  }
+
+  void BlockIndex::removeFrom(Sci_Position line) {
+    node_index_t removed;
+    split(root, line, root, removed);
+    freeTree(removed);
+  }
+
+  void BlockIndex::clear() {
+    nodes.clear();
+    freeNodes.clear();
+    root = NIL;
+  }
+
+  std::vector<BlockIndex::LineSummary> BlockIndex::getLineSummaries(Sci_Position firstLine, Sci_Position lastLine) {
+    std::vector<LineSummary> summaries(std::max(lastLine - firstLine + 1, static_cast<Sci_Position>(0)));
+    collectLines(root, firstLine, lastLine, summaries);
+    return summaries;
+  }
+
+  std::optional<BlockIndex::Block> BlockIndex::findBlock(Sci_Position line, Sci_Position column) {
+    int32_t depthBefore = 0;
+    node_index_t node = findAtOrBefore(Key {line, column}, depthBefore);
+    if (node == NIL || nodes[node].keyword.line != line || nodes[node].keyword.column + nodes[node].keyword.length <= column) {
+      return std::nullopt;
+    }
+
+    // Close keyword of a block is the first keyword after its open keyword where depth drops below the depth inside the block. Open
+    // keyword of a block that a keyword closes or is in the middle of is the one after the last keyword before it where depth is lower
+    // than the depth inside the block, or the first keyword when depth before the block is 0.
+    const Keyword& keyword = nodes[node].keyword;
+    node_index_t open = NIL;
+    node_index_t close = NIL;
+    int32_t depth = 0;  // Depth inside the block
+    int32_t depthAfter = 0;
+    switch (keyword.role) {
+      case Role::Open:
+        open = node;
+        depth = depthBefore + 1;
+        close = findFirstAfter(root, 0, keyOf(node), depth - 1, depthAfter);
+        break;
+
+      case Role::Middle:
+      case Role::Close:
+        depth = depthBefore;
+        if (keyword.role == Role::Close) {
+          close = node;
+        }
+        if (node_index_t last = findLastBefore(root, 0, keyOf(node), depth - 1, depthAfter); last != NIL) {
+          open = findFirstAfter(root, 0, keyOf(last), NO_DEPTH, depthAfter);
+        } else if (depth - 1 >= 0) {
+          open = findFirstAfter(root, 0, Key {-1, -1}, NO_DEPTH, depthAfter);
+        }
+        if (keyword.role == Role::Middle && open != NIL) {
+          close = findFirstAfter(root, 0, keyOf(node), depth - 1, depthAfter);
+        }
+        break;
+    }
+
+    Block block;
+    if (open != NIL) {
+      block.open = nodes[open].keyword;
+      collectMiddles(root, 0, keyOf(open), (close != NIL) ? std::optional<Key>(keyOf(close)) : std::nullopt, depth, block.middles);
+    }
+    if (close != NIL) {
+      block.close = nodes[close].keyword;
+    }
+    return block;
+  }
+
+  // Private methods
+  //
+
+  void BlockIndex::pushDown(node_index_t node) {
+    Node& current = nodes[node];
+    if (current.delta != 0) {
+      for (auto child : {current.left, current.right}) {
+        if (child != NIL) {
+          nodes[child].keyword.line += current.delta;
+          nodes[child].delta += current.delta;
+        }
+      }
+      current.delta = 0;
+    }
+  }
+
+  void BlockIndex::update(node_index_t node) {
+    Node& current = nodes[node];
+    int32_t leftDepthChange = 0;
+    current.minDepth = NO_DEPTH;
+    current.minMiddleDepth = NO_DEPTH;
+    if (current.left != NIL) {
+      const Node& left = nodes[current.left];
+      leftDepthChange = left.depthChange;
+      current.minDepth = left.minDepth;
+      current.minMiddleDepth = left.minMiddleDepth;
+    }
+
+    int32_t depth = leftDepthChange + depthChangeOf(current.keyword.role);
+    current.minDepth = std::min(current.minDepth, depth);
+    if (current.keyword.role == Role::Middle) {
+      current.minMiddleDepth = std::min(current.minMiddleDepth, depth);
+    }
+
+    current.depthChange = depth;
+    if (current.right != NIL) {
+      const Node& right = nodes[current.right];
+      current.depthChange += right.depthChange;
+      current.minDepth = std::min(current.minDepth, depth + right.minDepth);
+      current.minMiddleDepth = std::min(current.minMiddleDepth, depth + right.minMiddleDepth);
+    }
+  }
+
+  void BlockIndex::split(node_index_t tree, Sci_Position line, node_index_t& left, node_index_t& right) {
+    if (tree == NIL) {
+      left = right = NIL;
+      return;
+    }
+
+    pushDown(tree);
+    if (nodes[tree].keyword.line < line) {
+      split(nodes[tree].right, line, nodes[tree].right, right);
+      left = tree;
+    } else {
+      split(nodes[tree].left, line, left, nodes[tree].left);
+      right = tree;
+    }
+    update(tree);
+  }
+
+  BlockIndex::node_index_t BlockIndex::merge(node_index_t left, node_index_t right) {
+    if (left == NIL) {
+      return right;
+    }
+    if (right == NIL) {
+      return left;
+    }
+
+    if (nodes[left].priority > nodes[right].priority) {
+      pushDown(left);
+      nodes[left].right = merge(nodes[left].right, right);
+      update(left);
+      return left;
+    } else {
+      pushDown(right);
+      nodes[right].left = merge(left, nodes[right].left);
+      update(right);
+      return right;
+    }
+  }
+
+  BlockIndex::node_index_t BlockIndex::findAtOrBefore(Key key, int32_t& depthBefore) {
+    node_index_t found = NIL;
+    int32_t depth = 0;
+    for (node_index_t node = root; node != NIL;) {
+      pushDown(node);
+      int32_t leftDepthChange = (nodes[node].left != NIL) ? nodes[nodes[node].left].depthChange : 0;
+      if (keyOf(node) <= key) {
+        found = node;
+        depthBefore = depth + leftDepthChange;
+        depth += leftDepthChange + depthChangeOf(nodes[node].keyword.role);
+        node = nodes[node].right;
+      } else {
+        node = nodes[node].left;
+      }
+    }
+    return found;
+  }
+
+  BlockIndex::node_index_t BlockIndex::findFirstAfter(node_index_t tree, int32_t depthBefore, Key key, int32_t maxDepth, int32_t& depthAfter) {
+    if (tree == NIL || depthBefore + nodes[tree].minDepth > maxDepth) {
+      return NIL;
+    }
+
+    pushDown(tree);
+    const Node& current = nodes[tree];
+    int32_t leftDepthChange = (current.left != NIL) ? nodes[current.left].depthChange : 0;
+    int32_t depth = depthBefore + leftDepthChange + depthChangeOf(current.keyword.role);
+    if (key < keyOf(tree)) {
+      if (node_index_t found = findFirstAfter(current.left, depthBefore, key, maxDepth, depthAfter); found != NIL) {
+        return found;
+      }
+      if (depth <= maxDepth) {
+        depthAfter = depth;
+        return tree;
+      }
+    }
+    return findFirstAfter(current.right, depth, key, maxDepth, depthAfter);
+  }
+
+  BlockIndex::node_index_t BlockIndex::findLastBefore(node_index_t tree, int32_t depthBefore, Key key, int32_t maxDepth, int32_t& depthAfter) {
+    if (tree == NIL || depthBefore + nodes[tree].minDepth > maxDepth) {
+      return NIL;
+    }
+
+    pushDown(tree);
+    const Node& current = nodes[tree];
+    int32_t leftDepthChange = (current.left != NIL) ? nodes[current.left].depthChange : 0;
+    int32_t depth = depthBefore + leftDepthChange + depthChangeOf(current.keyword.role);
+    if (keyOf(tree) < key) {
+      if (node_index_t found = findLastBefore(current.right, depth, key, maxDepth, depthAfter); found != NIL) {
+        return found;
+      }
+      if (depth <= maxDepth) {
+        depthAfter = depth;
+        return tree;
+      }
+    }
+    return findLastBefore(current.left, depthBefore, key, maxDepth, depthAfter);
+  }
+
+  void BlockIndex::collectMiddles(node_index_t tree, int32_t depthBefore, Key start, std::optional<Key> end, int32_t depth, std::vector<Keyword>& result) {
+    // Depth between open and close keywords of a block never drops below the depth inside it, so only subtrees with middle keywords at
+    // that depth need to be visited
+    if (tree == NIL || depthBefore + nodes[tree].minMiddleDepth > depth) {
+      return;
+    }
+
+    pushDown(tree);
+    const Node& current = nodes[tree];
+    Key key = keyOf(tree);
+    int32_t leftDepthChange = (current.left != NIL) ? nodes[current.left].depthChange : 0;
+    int32_t depthAfter = depthBefore + leftDepthChange + depthChangeOf(current.keyword.role);
+    if (start < key) {
+      collectMiddles(current.left, depthBefore, start, end, depth, result);
+    }
+    if (start < key && (!end || key < *end) && current.keyword.role == Role::Middle && depthAfter == depth) {
+      result.push_back(current.keyword);
+    }
+    if (!end || key < *end) {
+      collectMiddles(current.right, depthAfter, start, end, depth, result);
+    }
+  }
+
+  void BlockIndex::collect(node_index_t tree, std::vector<Keyword>& result) {
+    if (tree != NIL) {
+      pushDown(tree);
+      collect(nodes[tree].left, result);
+      result.push_back(nodes[tree].keyword);
+      collect(nodes[tree].right, result);
+    }
+  }
+
+  void BlockIndex::collectLines(node_index_t tree, Sci_Position firstLine, Sci_Position lastLine, std::vector<LineSummary>& result) {
+    if (tree != NIL) {
+      pushDown(tree);
+      const Keyword& keyword = nodes[tree].keyword;
+      if (keyword.line >= firstLine) {
+        collectLines(nodes[tree].left, firstLine, lastLine, result);
+      }
+      if (keyword.line >= firstLine && keyword.line <= lastLine) {
+        LineSummary& summary = result[keyword.line - firstLine];
+        switch (keyword.role) {
+          case Role::Open:
+            summary.numOpen++;
+            break;
+
+          case Role::Middle:
+            summary.hasMiddle = true;
+            break;
+
+          case Role::Close:
+            summary.numClose++;
+            break;
+        }
+      }
+      if (keyword.line <= lastLine) {
+        collectLines(nodes[tree].right, firstLine, lastLine, result);
+      }
+    }
+  }
+
+  BlockIndex::node_index_t BlockIndex::allocateNode(const Keyword& keyword) {
+    node_index_t node;
+    if (!freeNodes.empty()) {
+      node = freeNodes.back();
+      freeNodes.pop_back();
+    } else {
+      node = static_cast<node_index_t>(nodes.size());
+      nodes.emplace_back();
+    }
+    nodes[node] = Node {
+      .keyword = keyword,
+      .delta = 0,
+      .priority = nextPriority(),
+      .left = NIL,
+      .right = NIL,
+      .depthChange = 0,
+      .minDepth = 0,
+      .minMiddleDepth = 0
+    };
+    update(node);
+    return node;
+  }
+
+  void BlockIndex::freeTree(node_index_t tree) {
+    if (tree != NIL) {
+      freeTree(nodes[tree].left);
+      freeTree(nodes[tree].right);
+      freeNodes.push_back(tree);
+    }
+  }
+
+  uint32_t BlockIndex::nextPriority() {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+  }
+
+} // namespace
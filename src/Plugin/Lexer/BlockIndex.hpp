@@ -0,0 +1,156 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AtomTable.hpp"
+
+#include "..\..\external\scintilla\Sci_Position.h"
+
+#include <climits>
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace papyrus {
+
+  // Block structure of a script, made of the fold keywords found by Lex, e.g. Function/EndFunction, If/ElseIf/Else/EndIf. Keywords are
+  // kept in a treap in document order, where shifting all lines after an edit is recorded as a pending delta on a subtree like in
+  // PropertyTable, so Lex only replaces keywords of lines it lexes. Each subtree also records how its keywords change nesting depth, so
+  // finding the keyword paired with another one, or the block a keyword is in, takes O(log n) regardless of the size of the document.
+  // Open and close keywords are paired the same way Fold nests them, so both fold levels and keyword matching read from here.
+  class BlockIndex {
+    public:
+      enum class Role : uint8_t {
+        Open,
+        Middle,
+        Close
+      };
+
+      struct Keyword {
+        Sci_Position line;
+        Sci_Position column;  // Offset from line start, in bytes
+        Sci_Position length;  // In bytes
+        atom_t name;          // Case-folded keyword
+        Role role;
+      };
+
+      // A block with its open and close keywords, either of which is missing when keywords aren't balanced, and middle keywords that
+      // aren't in nested blocks
+      struct Block {
+        std::optional<Keyword> open;
+        std::optional<Keyword> close;
+        std::vector<Keyword> middles;
+      };
+
+      // Fold keywords on a line
+      struct LineSummary {
+        int numOpen {0};
+        int numClose {0};
+        bool hasMiddle {false};
+      };
+
+      // Replace keywords on lines from firstLine to lastLine with given ones, which are in document order and on those lines
+      void replaceLines(Sci_Position firstLine, Sci_Position lastLine, const std::vector<Keyword>& lineKeywords);
+
+      // Update keywords after lines are added (linesAdded > 0) or deleted (linesAdded < 0) at a line, or the line is changed
+      // (linesAdded == 0). Keywords on deleted or changed lines are removed, since Lex will add them back if they are still there.
+      void updateLines(Sci_Position line, Sci_Position linesAdded);
+
+      // Remove keywords on and after a line, e.g. ones left from lines deleted without notifying block index
+      void removeFrom(Sci_Position line);
+
+      // Remove all keywords
+      void clear();
+
+      // Get fold keywords on each line from firstLine to lastLine
+      std::vector<LineSummary> getLineSummaries(Sci_Position firstLine, Sci_Position lastLine);
+
+      // Get the block a keyword at given position opens, closes or is in the middle of, or nothing if there isn't a keyword there
+      std::optional<Block> findBlock(Sci_Position line, Sci_Position column);
+
+      inline size_t size() const noexcept { return nodes.size() - freeNodes.size(); }
+
+    private:
+      using node_index_t = int32_t;
+      static constexpr node_index_t NIL = -1;
+
+      // Depth of empty subtrees, or ones without middle keywords. It's far from any depth, while adding depths to it can't overflow.
+      static constexpr int32_t NO_DEPTH = INT32_MAX / 4;
+
+      struct Node {
+        Keyword keyword;      // Line doesn't include pending deltas of ancestors
+        Sci_Position delta;   // Pending line delta of both subtrees
+        uint32_t priority;
+        node_index_t left;
+        node_index_t right;
+
+        // Change of nesting depth over the subtree, where open keywords add 1 and close keywords subtract 1, and the lowest depth
+        // after any keyword, or after any middle keyword, relative to depth before the subtree
+        int32_t depthChange;
+        int32_t minDepth;
+        int32_t minMiddleDepth;
+      };
+
+      // Position of a keyword, to order keywords
+      struct Key {
+        Sci_Position line;
+        Sci_Position column;
+
+        inline auto operator<=>(const Key& other) const = default;
+      };
+
+      inline static int32_t depthChangeOf(Role role) noexcept { return (role == Role::Open) ? 1 : (role == Role::Close) ? -1 : 0; }
+      inline Key keyOf(node_index_t node) const noexcept { return Key {nodes[node].keyword.line, nodes[node].keyword.column}; }
+
+      // Treap operations. Split puts nodes with line < given line to left tree, and the rest to right tree.
+      void pushDown(node_index_t node);
+      void update(node_index_t node);
+      void split(node_index_t tree, Sci_Position line, node_index_t& left, node_index_t& right);
+      node_index_t merge(node_index_t left, node_index_t right);
+
+      // Find the last keyword at or before a position, and nesting depth before it. Returns NIL if there isn't one.
+      node_index_t findAtOrBefore(Key key, int32_t& depthBefore);
+
+      // Find the first keyword after a position whose depth after it is at most given depth, or the last one before a position.
+      // depthBefore is the depth before the tree, and depthAfter is set to the depth after the found keyword.
+      node_index_t findFirstAfter(node_index_t tree, int32_t depthBefore, Key key, int32_t maxDepth, int32_t& depthAfter);
+      node_index_t findLastBefore(node_index_t tree, int32_t depthBefore, Key key, int32_t maxDepth, int32_t& depthAfter);
+
+      // Collect middle keywords between two positions whose depth is given depth. There's no end position when end is nullopt.
+      void collectMiddles(node_index_t tree, int32_t depthBefore, Key start, std::optional<Key> end, int32_t depth, std::vector<Keyword>& result);
+
+      // Get keywords in a tree, with pending deltas applied
+      void collect(node_index_t tree, std::vector<Keyword>& result);
+      void collectLines(node_index_t tree, Sci_Position firstLine, Sci_Position lastLine, std::vector<LineSummary>& result);
+
+      node_index_t allocateNode(const Keyword& keyword);
+      void freeTree(node_index_t tree);
+      uint32_t nextPriority();
+
+      // Private members
+      //
+      std::vector<Node> nodes;
+      std::vector<node_index_t> freeNodes;
+      node_index_t root {NIL};
+      uint32_t randomState {2463534242u};
+  };
+
+} // namespace
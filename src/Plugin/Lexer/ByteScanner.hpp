@@ -0,0 +1,86 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <bit>
+#include <string_view>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PAPYRUS_BYTE_SCANNER_SSE2
+#endif
+
+namespace papyrus {
+
+  // Byte scanning utilities to quickly skip through comments, strings and white spaces. When SSE2 is available, 16 bytes are checked
+  // at a time. Since only ASCII bytes are searched, they are safe for UTF-8 and single byte encodings, but not DBCS, whose trail bytes
+  // may be in ASCII range.
+  //
+  namespace byte_scanner {
+
+    // Find the first occurrence of given byte, starting at "from". Returns std::string_view::npos if not found.
+    inline size_t find(std::string_view text, size_t from, char target) noexcept {
+      const char* data = text.data();
+      size_t length = text.length();
+      size_t i = from;
+#ifdef PAPYRUS_BYTE_SCANNER_SSE2
+      const __m128i pattern = _mm_set1_epi8(target);
+      for (; i + 16 <= length; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), pattern));
+        if (mask != 0) {
+          return i + std::countr_zero(static_cast<unsigned int>(mask));
+        }
+      }
+#endif
+      for (; i < length; ++i) {
+        if (data[i] == target) {
+          return i;
+        }
+      }
+      return std::string_view::npos;
+    }
+
+    // Find the first byte that is not a blank (space or tab), starting at "from". Returns text length if not found.
+    inline size_t skipBlanks(std::string_view text, size_t from) noexcept {
+      const char* data = text.data();
+      size_t length = text.length();
+      size_t i = from;
+#ifdef PAPYRUS_BYTE_SCANNER_SSE2
+      const __m128i spaces = _mm_set1_epi8(' ');
+      const __m128i tabs = _mm_set1_epi8('\t');
+      for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = ~_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, spaces), _mm_cmpeq_epi8(bytes, tabs))) & 0xFFFF;
+        if (mask != 0) {
+          return i + std::countr_zero(static_cast<unsigned int>(mask));
+        }
+      }
+#endif
+      for (; i < length; ++i) {
+        if (data[i] != ' ' && data[i] != '\t') {
+          return i;
+        }
+      }
+      return length;
+    }
+
+  } // namespace
+
+} // namespace
@@ -0,0 +1,221 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClassIndex.hpp"
+
+#include "ClassLocator.hpp"
+
+#include <cctype>
+#include <system_error>
+
+namespace papyrus {
+
+  void ClassIndex::build(std::vector<std::wstring> newDirectories, std::wstring newDatabaseFilePath, changed_callback_t&& newChangedCallback) {
+    // Watchers and worker use current directories, so stop them first. Assigning a new worker stops and joins previous one, which checks
+    // stop token for each file so it won't take long.
+    watchers.clear();
+    worker = std::jthread();
+    index.store(nullptr);
+    database.store(nullptr);
+    changedClassFiles.store(nullptr);
+    {
+      Lock lock(changesMutex);
+      changes = Changes();
+    }
+    directories = std::move(newDirectories);
+    databaseFilePath = std::move(newDatabaseFilePath);
+    changedCallback = std::move(newChangedCallback);
+
+    // Start watching before scanning, so that no change is missed in between
+    if (changedCallback) {
+      for (const auto& directory : directories) {
+        watchers.push_back(std::make_unique<utility::DirectoryWatcher>(directory, [this](auto change, const auto& relativePath) {
+          handleDirectoryChange(change, relativePath);
+        }));
+      }
+    }
+
+    if (databaseFilePath.empty()) {
+      worker = std::jthread(scan, directories, std::ref(index));
+      return;
+    }
+
+    // Opening only maps the file, so it's cheap enough to do here. Database of different directories can't serve lookups, but scripts
+    // in directories that are still used can be reused when updating it.
+    auto existingDatabase = SymbolDatabase::open(databaseFilePath);
+    if (existingDatabase && existingDatabase->isBuiltFrom(directories)) {
+      database.store(existingDatabase);
+    }
+    worker = std::jthread([this](std::stop_token stopToken, std::shared_ptr<const SymbolDatabase> previous) {
+      updateDatabase(stopToken, std::move(previous));
+    }, std::move(existingDatabase));
+  }
+
+  ClassIndex::Changes ClassIndex::takeChanges() {
+    Changes takenChanges;
+    {
+      Lock lock(changesMutex);
+      std::swap(takenChanges, changes);
+    }
+
+    if (takenChanges.overflowed) {
+      build(directories, databaseFilePath, changed_callback_t(changedCallback));
+    }
+    return takenChanges;
+  }
+
+  ClassIndex::Result ClassIndex::find(std::string_view className, std::wstring* filePath) const {
+    if (auto currentChangedClassFiles = changedClassFiles.load()) {
+      auto iter = currentChangedClassFiles->find(className);
+      if (iter != currentChangedClassFiles->end()) {
+        if (iter->second.empty()) {
+          return Result::NotFound;
+        }
+
+        if (filePath != nullptr) {
+          *filePath = iter->second;
+        }
+        return Result::Found;
+      }
+    }
+
+    if (auto currentDatabase = database.load()) {
+      auto script = currentDatabase->findScript(className);
+      if (!script) {
+        return Result::NotFound;
+      }
+
+      if (filePath != nullptr) {
+        *filePath = std::filesystem::path(std::u8string_view(reinterpret_cast<const char8_t*>(script->filePath.data()), script->filePath.size())).wstring();
+      }
+      return Result::Found;
+    }
+
+    auto currentIndex = index.load();
+    if (!currentIndex) {
+      return Result::NotReady;
+    }
+
+    auto iter = currentIndex->find(className);
+    if (iter == currentIndex->end()) {
+      return Result::NotFound;
+    }
+
+    if (filePath != nullptr) {
+      *filePath = iter->second;
+    }
+    return Result::Found;
+  }
+
+  size_t ClassIndex::size() const {
+    if (auto currentDatabase = database.load()) {
+      return currentDatabase->scriptCount();
+    }
+    auto currentIndex = index.load();
+    return currentIndex ? currentIndex->size() : 0;
+  }
+
+  std::string ClassIndex::getClassName(const std::filesystem::path& relativePath) {
+    std::string className;
+    auto extension = relativePath.extension().u8string();
+    if (extension.length() != 4 || extension[0] != '.' || std::tolower(extension[1]) != 'p' || std::tolower(extension[2]) != 's' || std::tolower(extension[3]) != 'c') {
+      return className;
+    }
+
+    // Sub-directories are namespaces
+    for (auto iter = relativePath.begin(); iter != relativePath.end(); ++iter) {
+      auto component = (std::next(iter) == relativePath.end()) ? iter->stem().u8string() : iter->u8string();
+      if (!className.empty()) {
+        className.push_back(':');
+      }
+      for (auto ch : component) {
+        className.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+      }
+    }
+    return className;
+  }
+
+  void ClassIndex::scan(std::stop_token stopToken, std::vector<std::wstring> directories, std::atomic<std::shared_ptr<const index_t>>& index) {
+    auto newIndex = std::make_shared<index_t>();
+    for (const auto& directory : directories) {
+      std::error_code errorCode;
+      auto iter = std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, errorCode);
+      for (; !errorCode && iter != std::filesystem::recursive_directory_iterator(); iter.increment(errorCode)) {
+        if (stopToken.stop_requested()) {
+          return;
+        }
+
+        if (iter->is_regular_file(errorCode)) {
+          auto className = getClassName(iter->path().lexically_relative(directory));
+          if (!className.empty()) {
+            newIndex->try_emplace(std::move(className), iter->path().wstring());
+          }
+        }
+      }
+    }
+
+    if (!stopToken.stop_requested()) {
+      index.store(std::move(newIndex));
+    }
+  }
+
+  void ClassIndex::updateDatabase(std::stop_token stopToken, std::shared_ptr<const SymbolDatabase> previous) {
+    auto updatedDatabase = SymbolDatabase::update(stopToken, databaseFilePath, directories, std::move(previous));
+    if (updatedDatabase) {
+      database.store(std::move(updatedDatabase));
+    } else if (!stopToken.stop_requested() && !database.load()) {
+      // Database can't be written, e.g. config directory is read-only, so fall back to in-memory index
+      scan(stopToken, directories, index);
+    }
+  }
+
+  void ClassIndex::handleDirectoryChange(utility::DirectoryWatcher::Change change, const std::filesystem::path& relativePath) {
+    // A path without extension is most likely a directory, and all scripts in it are affected
+    std::string className;
+    if (change != utility::DirectoryWatcher::Change::Overflow && relativePath.has_extension()) {
+      className = getClassName(relativePath);
+      if (className.empty()) {
+        return;
+      }
+    }
+
+    bool notify = false;
+    {
+      Lock lock(changesMutex);
+      notify = !changes.overflowed && changes.classNames.empty();
+      if (className.empty()) {
+        changes.overflowed = true;
+      } else {
+        // Another directory may still have the class, or may have had it before this one
+        auto newChangedClassFiles = std::make_shared<index_t>();
+        if (auto currentChangedClassFiles = changedClassFiles.load()) {
+          *newChangedClassFiles = *currentChangedClassFiles;
+        }
+        newChangedClassFiles->insert_or_assign(className, ClassLocator::findClassFile(className, directories));
+        changedClassFiles.store(std::move(newChangedClassFiles));
+        changes.classNames.push_back(std::move(className));
+      }
+    }
+
+    if (notify) {
+      changedCallback();
+    }
+  }
+
+} // namespace
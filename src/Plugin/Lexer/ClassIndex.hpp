@@ -0,0 +1,130 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "SymbolDatabase.hpp"
+
+#include "..\Common\DirectoryWatcher.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace papyrus {
+
+  // An in-memory index of all scripts (.psc files) under a list of directories, mapping class names to file paths, so a class can be
+  // resolved with a single hash lookup instead of checking file system. Class names are case-folded, and scripts in sub-directories
+  // are named with FO4's namespaces, e.g. "namespace:name".
+  //
+  // The index is built on a worker thread. Until it's ready, lookups return NotReady so callers can fall back to checking file system.
+  // When a symbol database file is provided, lookups are served from the database left by last session right away, while the worker
+  // thread only needs to update it with scripts that changed since.
+  //
+  // When a change callback is provided, directories are watched so that scripts added or removed afterwards are reflected right away.
+  // Such changes are kept as a small overlay on top of the index, and collected for the owner to update what depends on them.
+  //
+  class ClassIndex {
+    public:
+      enum class Result {
+        NotReady,
+        Found,
+        NotFound
+      };
+
+      using changed_callback_t = std::function<void()>;
+
+      // Classes added or removed since changes were last taken
+      struct Changes {
+        std::vector<std::string> classNames;
+        bool overflowed {false};  // Some changes are unknown, e.g. a directory was renamed, so the index has been rebuilt
+      };
+
+      ClassIndex() = default;
+
+      // Disable all copy/move constructors/assignment operators
+      ClassIndex(ClassIndex&& other) = delete;
+
+      // Start building index of given directories on a worker thread. If multiple directories have the same class, the first one wins,
+      // same as how the compiler searches import directories. Any build in progress is abandoned. If database file path is provided,
+      // a persistent symbol database is kept there, otherwise only an in-memory index is built. Change callback is called on a watcher
+      // thread when there are new changes to take, and isn't called again until they are taken.
+      void build(std::vector<std::wstring> directories, std::wstring databaseFilePath = std::wstring(), changed_callback_t&& changedCallback = nullptr);
+
+      // Take changes reported by directory watchers. If some changes were lost, the index is rebuilt.
+      Changes takeChanges();
+
+      // Look up a case-folded class name. File path is filled in when found and filePath is provided.
+      Result find(std::string_view className, std::wstring* filePath = nullptr) const;
+
+      // Directories this index is built from
+      inline const std::vector<std::wstring>& getDirectories() const noexcept { return directories; }
+
+      // Number of indexed classes, 0 if index is not ready
+      size_t size() const;
+
+      // Symbol database of the directories, nullptr if there isn't one or it's not ready
+      inline std::shared_ptr<const SymbolDatabase> getDatabase() const { return database.load(); }
+
+      // Get case-folded class name from a script's path relative to the directory it's in. Returns empty string if it's not a script.
+      static std::string getClassName(const std::filesystem::path& relativePath);
+
+    private:
+      struct NameHash {
+        using is_transparent = void;
+        inline size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>()(name); }
+      };
+      using index_t = std::unordered_map<std::string, std::wstring, NameHash, std::equal_to<>>;
+      using Lock = std::lock_guard<std::mutex>;
+
+      static void scan(std::stop_token stopToken, std::vector<std::wstring> directories, std::atomic<std::shared_ptr<const index_t>>& index);
+      void updateDatabase(std::stop_token stopToken, std::shared_ptr<const SymbolDatabase> previous);
+
+      // Called on watcher threads
+      void handleDirectoryChange(utility::DirectoryWatcher::Change change, const std::filesystem::path& relativePath);
+
+      // Private members
+      //
+      std::vector<std::wstring> directories;
+      std::wstring databaseFilePath;
+      changed_callback_t changedCallback;
+      std::atomic<std::shared_ptr<const index_t>> index;
+      std::atomic<std::shared_ptr<const SymbolDatabase>> database;
+
+      // Classes added or removed after index was built, mapped to their files. Removed ones are mapped to empty string.
+      std::atomic<std::shared_ptr<const index_t>> changedClassFiles;
+
+      std::mutex changesMutex;
+      Changes changes;
+
+      std::jthread worker;
+
+      // Watchers use this instance, so they are destroyed first
+      std::vector<std::unique_ptr<utility::DirectoryWatcher>> watchers;
+  };
+
+} // namespace
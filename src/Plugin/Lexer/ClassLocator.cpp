@@ -0,0 +1,59 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClassLocator.hpp"
+
+#include <filesystem>
+#include <system_error>
+
+namespace papyrus {
+
+  std::wstring ClassLocator::findClassFile(std::string_view className, const std::vector<std::wstring>& directories) {
+    // Namespaces are sub-directories
+    std::filesystem::path relativePath;
+    size_t start = 0;
+    for (size_t end = className.find(':'); end != std::string_view::npos; start = end + 1, end = className.find(':', start)) {
+      relativePath /= className.substr(start, end - start);
+    }
+    relativePath /= std::string(className.substr(start)) + ".psc";
+
+    for (const auto& directory : directories) {
+      auto candidateFilePath = std::filesystem::path(directory) / relativePath;
+      std::error_code errorCode;
+      if (std::filesystem::is_regular_file(candidateFilePath, errorCode)) {
+        return candidateFilePath.wstring();
+      }
+    }
+    return std::wstring();
+  }
+
+  std::wstring ClassLocator::findTypeFile(std::string_view typeName, const std::vector<std::wstring>& directories) {
+    if (size_t separator = typeName.find('#'); separator != std::string_view::npos) {
+      return findClassFile(typeName.substr(0, separator), directories);
+    }
+
+    // "a:b" is either script b in namespace a, or if there is no such script, struct b in script a
+    auto filePath = findClassFile(typeName, directories);
+    if (size_t separator = typeName.rfind(':'); filePath.empty() && separator != std::string_view::npos) {
+      filePath = findClassFile(typeName.substr(0, separator), directories);
+    }
+    return filePath;
+  }
+
+} // namespace
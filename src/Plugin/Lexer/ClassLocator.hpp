@@ -0,0 +1,41 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // Find scripts on file system the same way the compiler does, i.e. the first of given directories that has a script wins. Names are
+  // case-folded, and namespaces are sub-directories, e.g. "namespace:name" is "namespace\name.psc". This class doesn't depend on
+  // Windows API.
+  class ClassLocator {
+    public:
+      // Find the script of given class. Returns empty string if none has it.
+      static std::wstring findClassFile(std::string_view className, const std::vector<std::wstring>& directories);
+
+      // Find the script that declares given type. For a struct, i.e. "<script>#<struct>" or "<script>:<struct>" in Fallout 4, it's the
+      // script the struct is declared in. Returns empty string if none has it.
+      static std::wstring findTypeFile(std::string_view typeName, const std::vector<std::wstring>& directories);
+  };
+
+} // namespace
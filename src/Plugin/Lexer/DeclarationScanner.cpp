@@ -0,0 +1,341 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DeclarationScanner.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <set>
+#include <vector>
+
+namespace papyrus {
+
+  using Lock = std::lock_guard<std::mutex>;
+
+  namespace {
+    // Keywords that start a statement that isn't a variable declaration, even though it may look like "<type> <name>"
+    constexpr std::array<std::string_view, 24> NON_DECLARATION_KEYWORDS {
+      "auto", "customevent", "else", "elseif", "endevent", "endfunction", "endgroup", "endif", "endproperty", "endstate", "endstruct",
+      "endwhile", "event", "function", "group", "if", "import", "new", "property", "return", "scriptname", "state", "struct", "while"
+    };
+
+    // Words that can be where a type is expected, or next to one, but never refer to a script
+    constexpr std::array<std::string_view, 13> NON_CLASS_WORDS {
+      "as", "bool", "false", "float", "int", "is", "length", "none", "parent", "self", "string", "true", "var"
+    };
+
+    inline bool isIdentifierStart(char ch) {
+      return std::isalpha(static_cast<unsigned char>(ch)) || ch == '_';
+    }
+
+    // Namespaced names and struct types ("<script>:<struct>", or "<script>#<struct>" in Fallout 4) are single tokens
+    inline bool isIdentifierChar(char ch) {
+      return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == ':' || ch == '#';
+    }
+
+    inline bool isIdentifier(std::string_view token) {
+      return !token.empty() && isIdentifierStart(token[0]);
+    }
+
+    inline void addName(Declarations::names_t& names, std::string_view name) {
+      if (atom_t atom = AtomTable::instance().intern(name); atom != AtomTable::NO_ATOM) {
+        names.emplace(atom);
+      }
+    }
+
+    // Skip an optional array suffix "[]" after a type
+    inline size_t skipArraySuffix(const std::vector<std::string_view>& tokens, size_t index) {
+      return (index + 1 < tokens.size() && tokens[index] == "[" && tokens[index + 1] == "]") ? index + 2 : index;
+    }
+
+    // Add parameters in "(<type> <name> [= <default>], ...)" that follows a function or an event name
+    void addParameters(const std::vector<std::string_view>& tokens, size_t index, Declarations& declarations) {
+      if (index >= tokens.size() || tokens[index] != "(") {
+        return;
+      }
+
+      bool expectingType = true;
+      for (++index; index < tokens.size() && tokens[index] != ")"; ++index) {
+        if (tokens[index] == ",") {
+          expectingType = true;
+        } else if (expectingType && isIdentifier(tokens[index])) {
+          size_t nameIndex = skipArraySuffix(tokens, index + 1);
+          if (nameIndex < tokens.size() && isIdentifier(tokens[nameIndex])) {
+            addName(declarations.variables, tokens[nameIndex]);
+            index = nameIndex;
+          }
+          expectingType = false;
+        }
+      }
+    }
+
+    // Check a statement, i.e. all tokens of a logical line, for declarations
+    void parseStatement(const std::vector<std::string_view>& tokens, Declarations& declarations) {
+      if (tokens.empty()) {
+        return;
+      }
+
+      if (tokens[0] == "scriptname") {
+        if (tokens.size() > 1 && isIdentifier(tokens[1])) {
+          declarations.scriptName = tokens[1];
+        }
+        return;
+      }
+
+      size_t index = (tokens[0] == "auto") ? 1 : 0;
+      if (index < tokens.size() && tokens[index] == "state") {
+        if (index + 1 < tokens.size() && isIdentifier(tokens[index + 1])) {
+          addName(declarations.states, tokens[index + 1]);
+        }
+        return;
+      }
+
+      if (tokens[0] == "event") {
+        // Remote events are declared as "Event <type>.<name>(...)", so the name is the last identifier before "("
+        auto iter = std::find(tokens.begin(), tokens.end(), std::string_view("("));
+        if (iter != tokens.begin() + 1 && isIdentifier(*std::prev(iter))) {
+          addName(declarations.events, *std::prev(iter));
+          addParameters(tokens, iter - tokens.begin(), declarations);
+        }
+        return;
+      }
+
+      // Function and property may be preceded by a type: "[<type>[[]]] Function <name>(...)", "<type>[[]] Property <name>"
+      index = 0;
+      if (isIdentifier(tokens[0]) && tokens[0] != "function" && tokens[0] != "property") {
+        index = skipArraySuffix(tokens, 1);
+      }
+      if (index + 1 < tokens.size() && isIdentifier(tokens[index + 1])) {
+        if (tokens[index] == "function") {
+          addName(declarations.functions, tokens[index + 1]);
+          addParameters(tokens, index + 2, declarations);
+          return;
+        } else if (tokens[index] == "property") {
+          addName(declarations.properties, tokens[index + 1]);
+          return;
+        }
+      }
+
+      // Variable: "<type>[[]] <name>", optionally followed by "= <value>" and/or flags
+      if (isIdentifier(tokens[0]) && std::find(NON_DECLARATION_KEYWORDS.begin(), NON_DECLARATION_KEYWORDS.end(), tokens[0]) == NON_DECLARATION_KEYWORDS.end()) {
+        index = skipArraySuffix(tokens, 1);
+        if (index < tokens.size() && isIdentifier(tokens[index]) && (index + 1 == tokens.size() || tokens[index + 1] == "=" || isIdentifier(tokens[index + 1]))) {
+          addName(declarations.variables, tokens[index]);
+        }
+      }
+    }
+
+    inline bool isKeyword(std::string_view token) {
+      return std::find(NON_DECLARATION_KEYWORDS.begin(), NON_DECLARATION_KEYWORDS.end(), token) != NON_DECLARATION_KEYWORDS.end()
+        || std::find(NON_CLASS_WORDS.begin(), NON_CLASS_WORDS.end(), token) != NON_CLASS_WORDS.end();
+    }
+
+    // Check a statement for names that may refer to other scripts
+    void addReferences(const std::vector<std::string_view>& tokens, References& references, std::set<std::string_view>& classNames) {
+      if (tokens[0] == "scriptname") {
+        if (tokens.size() > 1 && isIdentifier(tokens[1])) {
+          references.scriptName = tokens[1];
+        }
+        if (tokens.size() > 3 && tokens[2] == "extends" && isIdentifier(tokens[3])) {
+          references.parentName = tokens[3];
+          classNames.insert(tokens[3]);
+        }
+        return;
+      }
+
+      if (tokens[0] == "import") {
+        if (tokens.size() > 1 && isIdentifier(tokens[1])) {
+          classNames.insert(tokens[1]);
+        }
+        return;
+      }
+
+      for (size_t index = 0; index < tokens.size(); ++index) {
+        auto token = tokens[index];
+        if (!isIdentifier(token) || isKeyword(token) || (index > 0 && tokens[index - 1] == ".")) {
+          continue;
+        }
+
+        // "as <type>", "new <type>", "<type>.<member>", and "<type>[[]] <name>" including return types before Function and Property
+        auto previous = (index > 0) ? tokens[index - 1] : std::string_view();
+        size_t nameIndex = skipArraySuffix(tokens, index + 1);
+        if (previous == "as" || previous == "new" || (index + 1 < tokens.size() && tokens[index + 1] == ".")
+          || (nameIndex < tokens.size() && isIdentifier(tokens[nameIndex]) && (!isKeyword(tokens[nameIndex]) || tokens[nameIndex] == "function" || tokens[nameIndex] == "property"))) {
+          classNames.insert(token);
+        }
+      }
+    }
+  }
+
+  DeclarationScanner::DeclarationScanner(scanned_callback_t&& scannedCallback)
+    : scannedCallback(std::move(scannedCallback)) {
+  }
+
+  DeclarationScanner::~DeclarationScanner() {
+    // Make sure worker thread has finished before members are destroyed
+    worker = std::jthread();
+  }
+
+  void DeclarationScanner::scan(std::string&& text) {
+    Lock lock(mutex);
+    pendingText = std::move(text);
+    hasPendingText = true;
+    if (!running) {
+      // Previous worker thread has finished or is finishing its callback, so joining it won't take long
+      running = true;
+      worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+    }
+  }
+
+  bool DeclarationScanner::isScanning() const {
+    Lock lock(mutex);
+    return running;
+  }
+
+  void DeclarationScanner::run(std::stop_token stopToken) {
+    std::string text;
+    while (!stopToken.stop_requested()) {
+      {
+        Lock lock(mutex);
+        text.swap(pendingText);
+        hasPendingText = false;
+      }
+
+      declarations.store(std::make_shared<const Declarations>(parse(text)), std::memory_order_release);
+
+      // Stop running before calling back if there is nothing else to scan, so that a scan requested upon callback isn't skipped
+      bool finished;
+      {
+        Lock lock(mutex);
+        finished = !hasPendingText;
+        running = !finished;
+      }
+      scannedCallback();
+      if (finished) {
+        return;
+      }
+    }
+
+    Lock lock(mutex);
+    running = false;
+  }
+
+  Declarations DeclarationScanner::parse(std::string_view text) {
+    Declarations declarations;
+
+    // Names are case-folded, so fold the whole text once and tokens can refer to it
+    std::string foldedText(text);
+    std::transform(foldedText.begin(), foldedText.end(), foldedText.begin(), [](char ch) { return static_cast<char>(std::tolower(static_cast<unsigned char>(ch))); });
+    forEachStatement(foldedText, [&](const std::vector<std::string_view>& tokens, size_t) { parseStatement(tokens, declarations); });
+
+    return declarations;
+  }
+
+  References DeclarationScanner::parseReferences(std::string_view text) {
+    References references;
+
+    std::string foldedText(text);
+    std::transform(foldedText.begin(), foldedText.end(), foldedText.begin(), [](char ch) { return static_cast<char>(std::tolower(static_cast<unsigned char>(ch))); });
+    std::set<std::string_view> classNames;
+    forEachStatement(foldedText, [&](const std::vector<std::string_view>& tokens, size_t) { addReferences(tokens, references, classNames); });
+
+    classNames.erase(references.scriptName);
+    references.classNames.assign(classNames.begin(), classNames.end());
+    return references;
+  }
+
+  void DeclarationScanner::forEachStatement(std::string_view script, const statement_handler_t& handler) {
+    std::vector<std::string_view> tokens;
+    size_t line = 0;
+    size_t statementLine = 0;
+    auto addToken = [&](size_t start, size_t end) {
+      if (tokens.empty()) {
+        statementLine = line;
+      }
+      tokens.push_back(script.substr(start, end - start));
+    };
+    auto skipTo = [&](size_t& pos, size_t end) {
+      line += std::count(script.begin() + pos, script.begin() + end, '\n');
+      pos = end;
+    };
+
+    size_t length = script.length();
+    size_t pos = 0;
+    while (pos < length) {
+      char ch = script[pos];
+      if (ch == '\n') {
+        if (!tokens.empty()) {
+          handler(tokens, statementLine);
+          tokens.clear();
+        }
+        ++line;
+        ++pos;
+      } else if (ch == ';') {
+        if (pos + 1 < length && script[pos + 1] == '/') {
+          // Multi-line comment ends with "/;", which can share "/" with the opening ";/"
+          size_t end = script.find("/;", pos + 1);
+          skipTo(pos, (end == std::string_view::npos) ? length : end + 2);
+        } else {
+          // Line comment runs to the end of line, which still ends the statement
+          size_t end = script.find('\n', pos);
+          pos = (end == std::string_view::npos) ? length : end;
+        }
+      } else if (ch == '{') {
+        // Documentation comment ends with "}"
+        size_t end = script.find('}', pos + 1);
+        skipTo(pos, (end == std::string_view::npos) ? length : end + 1);
+      } else if (ch == '"') {
+        // String ends with an unescaped double quote, and can't span lines
+        size_t start = pos++;
+        while (pos < length && script[pos] != '"' && script[pos] != '\n') {
+          pos += (script[pos] == '\\' && pos + 1 < length && script[pos + 1] != '\n') ? 2 : 1;
+        }
+        if (pos < length && script[pos] == '"') {
+          ++pos;
+        }
+        addToken(start, pos);
+      } else if (ch == '\\') {
+        // Line continuation joins next line to current statement
+        size_t end = script.find_first_not_of(" \t\r", pos + 1);
+        if (end != std::string_view::npos && script[end] == '\n') {
+          ++line;
+          pos = end + 1;
+        } else {
+          ++pos;
+        }
+      } else if (isIdentifierStart(ch) || std::isdigit(static_cast<unsigned char>(ch))) {
+        size_t start = pos;
+        while (pos < length && isIdentifierChar(script[pos])) {
+          ++pos;
+        }
+        addToken(start, pos);
+      } else if (std::isspace(static_cast<unsigned char>(ch))) {
+        ++pos;
+      } else {
+        addToken(pos, pos + 1);
+        ++pos;
+      }
+    }
+    if (!tokens.empty()) {
+      handler(tokens, statementLine);
+    }
+  }
+
+} // namespace
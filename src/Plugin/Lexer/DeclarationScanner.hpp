@@ -0,0 +1,107 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AtomTable.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace papyrus {
+
+  // Names declared in a script. All names are case-folded, and sets of names hold their atoms.
+  struct Declarations {
+    using names_t = std::unordered_set<atom_t>;
+
+    std::string scriptName;
+    names_t properties;
+    names_t functions;
+    names_t events;
+    names_t states;
+    names_t variables;  // Script variables, local variables and parameters
+  };
+
+  // Names a script uses that may refer to other scripts. All names are case-folded.
+  struct References {
+    std::string scriptName;
+    std::string parentName;               // Empty if the script doesn't extend another one
+    std::vector<std::string> classNames;  // Sorted, including parent and imported scripts, but not the script itself
+  };
+
+  // Scan a whole script for the names it declares on a worker thread, so that lexing a part of the document can still use all of
+  // them. Only the latest requested text is scanned, and the worker thread only runs when there is text to scan. Callers can check
+  // isScanning to avoid copying the text for a request while a scan is still running, and request it once it completes instead.
+  // This class doesn't depend on Windows API.
+  class DeclarationScanner {
+    public:
+      using declarations_t = std::shared_ptr<const Declarations>;
+      using scanned_callback_t = std::function<void()>;
+      using statement_handler_t = std::function<void(const std::vector<std::string_view>& tokens, size_t line)>;
+
+      // Callback is called on the worker thread after each scan. When the last requested scan completes, isScanning already
+      // returns false in the callback.
+      DeclarationScanner(scanned_callback_t&& scannedCallback);
+      ~DeclarationScanner();
+
+      // Disable all copy/move constructors/assignment operators
+      DeclarationScanner(DeclarationScanner&& other) = delete;
+
+      // Request a scan of given script text. It replaces any text that is not scanned yet.
+      void scan(std::string&& text);
+
+      // Whether a requested scan hasn't completed yet
+      bool isScanning() const;
+
+      // Get declarations from last scan, nullptr if no scan has completed yet
+      inline declarations_t getDeclarations() const { return declarations.load(std::memory_order_acquire); }
+
+      // Parse declarations in a script
+      static Declarations parse(std::string_view text);
+
+      // Parse names in a script that may refer to other scripts, i.e. its parent, imported scripts, and names used as types in
+      // declarations, casts and member accesses. Resolving which of them are actually scripts is up to the caller.
+      static References parseReferences(std::string_view text);
+
+      // Split a case-folded script into statements, i.e. logical lines with comments skipped and continued lines joined, and call
+      // handler with tokens of each statement and the line it starts on. Tokens refer to given text.
+      static void forEachStatement(std::string_view foldedText, const statement_handler_t& handler);
+
+    private:
+      void run(std::stop_token stopToken);
+
+      // Private members
+      //
+      scanned_callback_t scannedCallback;
+      mutable std::mutex mutex;
+      std::string pendingText;
+      bool hasPendingText {false};
+      bool running {false};
+      std::atomic<declarations_t> declarations;
+      std::jthread worker;
+  };
+
+} // namespace
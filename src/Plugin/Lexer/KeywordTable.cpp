@@ -0,0 +1,143 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "KeywordTable.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+namespace papyrus {
+
+  namespace {
+    // Maximum displacement value to try for a bucket before growing the table
+    constexpr uint32_t MAX_DISPLACEMENT = 1 << 16;
+
+    // Number of bits needed to have at least given number of entries
+    int bitsFor(size_t count) {
+      return std::max(1, static_cast<int>(std::bit_width(std::max(count, static_cast<size_t>(1)) - 1)));
+    }
+  }
+
+  void KeywordTable::add(std::string_view keyword, category_mask_t categories) {
+    pendingKeywords[utility::toLower(std::string(keyword))] |= categories;
+  }
+
+  void KeywordTable::clear() {
+    pendingKeywords.clear();
+    displacements.clear();
+    slots.clear();
+    overflow.clear();
+    keywordText.clear();
+  }
+
+  void KeywordTable::build() {
+    displacements.clear();
+    slots.clear();
+    overflow.clear();
+    keywordText.clear();
+    if (pendingKeywords.empty()) {
+      return;
+    }
+
+    std::vector<Slot> keys;
+    for (const auto& [keyword, categories] : pendingKeywords) {
+      Slot key {
+        .hash = utility::hashOf(keyword),
+        .offset = static_cast<uint32_t>(keywordText.size()),
+        .length = static_cast<uint32_t>(keyword.length()),
+        .categories = categories
+      };
+      keywordText += keyword;
+
+      // Keys with duplicate hash can never be separated by displacement
+      if (std::find_if(keys.begin(), keys.end(), [&](const auto& other) { return other.hash == key.hash; }) != keys.end()) {
+        overflow.push_back(key);
+      } else {
+        keys.push_back(key);
+      }
+    }
+
+    // About 4 keys per bucket, and load factor no more than 50%. Grow the table until all buckets can be placed.
+    bucketBits = bitsFor((keys.size() + 3) / 4);
+    slotBits = bitsFor(keys.size() * 2);
+    while (!place(keys)) {
+      slotBits++;
+    }
+  }
+
+  bool KeywordTable::place(const std::vector<Slot>& keys) {
+    std::vector<std::vector<size_t>> buckets(static_cast<size_t>(1) << bucketBits);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      buckets[bucketIndex(keys[i].hash)].push_back(i);
+    }
+
+    // Place larger buckets first, as they are harder to fit
+    std::vector<size_t> bucketOrder(buckets.size());
+    std::iota(bucketOrder.begin(), bucketOrder.end(), 0);
+    std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    displacements.assign(buckets.size(), 0);
+    slots.assign(static_cast<size_t>(1) << slotBits, Slot {});
+    std::vector<bool> occupied(slots.size(), false);
+    std::vector<size_t> candidateSlots;
+    for (size_t bucket : bucketOrder) {
+      if (buckets[bucket].empty()) {
+        break;
+      }
+
+      bool placed = false;
+      for (uint32_t displacement = 0; !placed && displacement < MAX_DISPLACEMENT; ++displacement) {
+        candidateSlots.clear();
+        placed = true;
+        for (size_t key : buckets[bucket]) {
+          size_t slot = slotIndex(keys[key].hash, displacement);
+          if (occupied[slot] || std::find(candidateSlots.begin(), candidateSlots.end(), slot) != candidateSlots.end()) {
+            placed = false;
+            break;
+          }
+          candidateSlots.push_back(slot);
+        }
+
+        if (placed) {
+          displacements[bucket] = displacement;
+          for (size_t i = 0; i < candidateSlots.size(); ++i) {
+            occupied[candidateSlots[i]] = true;
+            slots[candidateSlots[i]] = keys[buckets[bucket][i]];
+          }
+        }
+      }
+
+      if (!placed) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  KeywordTable::category_mask_t KeywordTable::lookupOverflow(std::string_view word, uint32_t hash) const noexcept {
+    for (const auto& key : overflow) {
+      if (key.hash == hash && std::string_view(keywordText).substr(key.offset, key.length) == word) {
+        return key.categories;
+      }
+    }
+    return 0;
+  }
+
+} // namespace
@@ -0,0 +1,91 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "..\Common\StringUtil.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // A perfect hash table that maps case-folded keywords to a bitmask of categories (e.g. word lists) they belong to, so a word can be
+  // classified with a single probe. Keys are grouped into buckets by hash, then each bucket gets a displacement value that moves all
+  // of its keys into free slots.
+  class KeywordTable {
+    public:
+      using category_mask_t = uint32_t;
+
+      // Add a keyword to given categories. Table needs to be built afterwards.
+      void add(std::string_view keyword, category_mask_t categories);
+
+      // Remove all keywords
+      void clear();
+
+      // Build the table with added keywords
+      void build();
+
+      // Get categories of a case-folded word, given its hash calculated by utility::hashOf
+      inline category_mask_t lookup(std::string_view word, uint32_t hash) const noexcept {
+        if (slots.empty()) {
+          return 0;
+        }
+
+        const Slot& slot = slots[slotIndex(hash, displacements[bucketIndex(hash)])];
+        if (slot.hash == hash && slot.length == word.length() && std::string_view(keywordText).substr(slot.offset, slot.length) == word) {
+          return slot.categories;
+        }
+        return overflow.empty() ? 0 : lookupOverflow(word, hash);
+      }
+      inline category_mask_t lookup(std::string_view word) const noexcept { return lookup(word, utility::hashOf(word)); }
+
+    private:
+      struct Slot {
+        uint32_t hash {0};
+        uint32_t offset {0};
+        uint32_t length {0};
+        category_mask_t categories {0};
+      };
+
+      inline size_t bucketIndex(uint32_t hash) const noexcept { return (hash * 0x85EBCA6Bu) >> (32 - bucketBits); }
+      inline size_t slotIndex(uint32_t hash, uint32_t displacement) const noexcept { return ((hash ^ displacement) * 0x9E3779B1u) >> (32 - slotBits); }
+
+      // Try placing all keys with current table size. Returns false if any bucket can't be placed.
+      bool place(const std::vector<Slot>& keys);
+
+      // Keys that have the same hash as another key can't be placed, which is very unlikely. They are looked up linearly.
+      category_mask_t lookupOverflow(std::string_view word, uint32_t hash) const noexcept;
+
+      // Private members
+      //
+      std::map<std::string, category_mask_t, std::less<>> pendingKeywords;
+
+      int bucketBits {1};
+      int slotBits {1};
+      std::vector<uint32_t> displacements;
+      std::vector<Slot> slots;
+      std::vector<Slot> overflow;
+      std::string keywordText;
+  };
+
+} // namespace
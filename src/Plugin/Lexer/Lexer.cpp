@@ -20,19 +20,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Lexer.hpp"
 
+#include "ByteScanner.hpp"
 #include "LexerIDs.hpp"
+#include "MemoryDocument.hpp"
 #include "..\Common\FileSystemUtil.hpp"
 #include "..\Common\Logger.hpp"
 #include "..\Common\StringUtil.hpp"
+#include "..\Common\ThreadPool.hpp"
 
-#include "..\..\external\gsl\include\gsl\util"
 #include "..\..\external\lexilla\LexerModule.h"
-#include "..\..\external\npp\Common.h"
 #include "..\..\external\scintilla\Scintilla.h"
 
+#ifdef _WIN32
+#include "..\Common\Resources.hpp"
+
+#include "..\..\external\gsl\include\gsl\util"
+#include "..\..\external\npp\Common.h"
+#endif
+
+#include <algorithm>
 #include <filesystem>
+#include <future>
 #include <map>
 #include <memory>
+#include <set>
 
 namespace papyrus {
 
@@ -41,22 +52,69 @@ namespace papyrus {
 
   // Static shared helper and other lexer data
   namespace {
+    // Number of lines Fold retrieves fold keywords for at once
+    constexpr Sci_Position FOLD_BATCH_LINES = 256;
+
+    // Fewest lines in a chunk when lexing in parallel, so that lexing it takes much longer than handing it over to another thread
+    constexpr Sci_Position PARALLEL_LEX_CHUNK_MIN_LINES = 5000;
+
     std::unique_ptr<Helper> helper;
     std::mutex lexerListMutex;
     std::vector<Lexer*> lexerList;
     std::mutex scriptNameMapMutex;
     std::map<npp_buffer_t, std::string> scriptNameMap;
+
+    // Class indexes of script directories that aren't import directories, keyed by case-folded directory
+    std::mutex scriptDirectoryClassIndexesMutex;
+    std::map<std::wstring, std::unique_ptr<ClassIndex>> scriptDirectoryClassIndexes;
+
+#ifdef _WIN32
+    // Remove trailing separator so directories from settings can be compared with script's parent path
+    std::wstring normalizeDirectory(const std::wstring& directory) {
+      auto path = std::filesystem::path(directory).lexically_normal();
+      if (!path.has_filename() && path.has_relative_path()) {
+        path = path.parent_path();
+      }
+      return path.wstring();
+    }
+#endif
+
+    // Find a class in a class index. If the index isn't ready yet, check file system directly.
+    bool findInClassIndex(const ClassIndex& classIndex, const std::vector<std::wstring>& directories, std::string_view className, std::wstring* filePath) {
+      auto result = classIndex.find(className, filePath);
+      if (result != ClassIndex::Result::NotReady) {
+        return result == ClassIndex::Result::Found;
+      }
+
+      // Find relative path from search directory. Support FO4's namespace.
+      std::filesystem::path relativePath;
+      auto pathComponents = utility::split(std::string(className), ":");
+      for (const auto& pathComponent : pathComponents) {
+        relativePath /= pathComponent;
+      }
+      relativePath.replace_extension(".psc");
+
+      for (const auto& directory : directories) {
+        std::wstring candidateFilePath = (std::filesystem::path(directory) / relativePath).wstring();
+        if (utility::fileExists(candidateFilePath)) {
+          if (filePath != nullptr) {
+            *filePath = candidateFilePath;
+          }
+          return true;
+        }
+      }
+      return false;
+    }
   }
 
   Lexer::Lexer()
-    : SimpleLexerBase(LEXER_NAME, SCLEX_PAPYRUS_SCRIPT),
-      instreWordLists{&wordListOperators, &wordListFlowControl},
-      typeWordLists{&wordListTypes, &wordListKeywords, &wordListKeywords2, &wordListFoldOpen, &wordListFoldMiddle, &wordListFoldClose} {
+    : SimpleLexerBase(LEXER_NAME, SCLEX_PAPYRUS_SCRIPT) {
     // Setup settings change listeners.
     if (isUsable() && !helper) {
       helper = std::make_unique<Helper>();
     }
 
+#ifdef _WIN32
     hoverEventSubscription = lexerData->hoverEventData.subscribe([&](auto eventData) {
       if (isUsable()) {
         detectBufferId();
@@ -76,6 +134,13 @@ namespace papyrus {
         }
       }
     });
+#endif
+
+    declarationsScannedSubscription = lexerData->declarationsScanned.subscribe([&](auto scannedBufferID) {
+      if (isUsable() && bufferID == scannedBufferID) {
+        handleDeclarationsScanned();
+      }
+    });
 
     // Add this instance to lexer list
     Lock lock(lexerListMutex);
@@ -83,8 +148,11 @@ namespace papyrus {
   }
 
   Lexer::~Lexer() {
+#ifdef _WIN32
     hoverEventSubscription->unsubscribe();
     changeEventSubscription->unsubscribe();
+#endif
+    declarationsScannedSubscription->unsubscribe();
 
     // Remove this instance from lexer list
     Lock lock(lexerListMutex);
@@ -100,7 +168,7 @@ namespace papyrus {
       // Since NPPN_EXTERNALLEXERBUFFER always happens right after a lexer is instantiated, we only need to check the last instance in lexer list.
       // Though, since this message can be received when another plugin's lexer is instantiated, we should prevent overwriting an already assigned buffer ID.
       Lexer* pLexer = lexerList.back();
-      if (pLexer->bufferID == 0) {
+      if (pLexer->bufferID == 0 && !pLexer->detached) {
         pLexer->bufferID = bufferID;
       }
     }
@@ -110,189 +178,94 @@ namespace papyrus {
     Lock lock(scriptNameMapMutex);
     utility::logger.log(L"[Retrieve] Buffer ID: " +  std::to_wstring(bufferID));
     if (scriptNameMap.contains(bufferID)) {
+#ifdef _WIN32
       utility::logger.log(L"[Retrieve] Script name: " + string2wstring(scriptNameMap[bufferID], SC_CP_UTF8));
+#endif
       return scriptNameMap[bufferID];
     } else {
       return std::string();
     }
   }
 
+  std::optional<BlockIndex::Block> Lexer::findBlock(npp_buffer_t bufferID, Sci_Position line, Sci_Position column) {
+    Lock lock(lexerListMutex);
+    auto iter = std::find_if(lexerList.begin(), lexerList.end(), [=](const Lexer* pLexer) { return pLexer->bufferID == bufferID; });
+    return (iter != lexerList.end()) ? (*iter)->blockIndex.findBlock(line, column) : std::nullopt;
+  }
+
+  std::vector<OccurrenceIndex::Occurrence> Lexer::findOccurrences(npp_buffer_t bufferID, Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) {
+    Lock lock(lexerListMutex);
+    auto iter = std::find_if(lexerList.begin(), lexerList.end(), [=](const Lexer* pLexer) { return pLexer->bufferID == bufferID; });
+    return (iter != lexerList.end()) ? (*iter)->occurrenceIndex.findOccurrences(line, column, firstLine, lastLine) : std::vector<OccurrenceIndex::Occurrence>();
+  }
+
   void SCI_METHOD Lexer::Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int, IDocument* pAccess) {
     if (isUsable()) {
       detectBufferId();
+      document = pAccess;
 
       Accessor accessor(pAccess, nullptr);
-      StyleContext styleContext(startPos, lengthDoc, accessor.StyleAt(startPos - 1), accessor);
+      auto startLine = accessor.GetLine(startPos);
+      auto endLine = accessor.GetLine(startPos + lengthDoc - 1);
 
-      // This state is saved in the line feed character. It can be used to initialize the state of the next line.
-      State messageStateLast = static_cast<State>(accessor.StyleAt(startPos - 1));
-      for (auto line = accessor.GetLine(startPos); line <= accessor.GetLine(startPos + lengthDoc - 1); ++line) {
-        auto tokens = tokenize(accessor, line);
-        State messageState = messageStateLast;
+      // Lex can only stop early when all changes are known, which requires buffer ID to receive content change events.
+      bool canStopEarly = !fullLexRequested && !propertyNamesChanged && (bufferID != 0 || detached);
 
-        // Styling
-        for (auto iterTokens = tokens.begin(); iterTokens != tokens.end(); ++iterTokens) {
-          const auto& tokenString = iterTokens->content;
+      // Lexing the whole document finds all names it references again
+      if (!canStopEarly && startPos == 0 && lengthDoc >= accessor.Length()) {
+        referencedNames.clear();
+      }
 
-          if (messageState == State::CommentDoc) {
-            colorToken(styleContext, *iterTokens, State::CommentDoc);
-            if (tokenString == "}") {
-              messageState = State::Default;
-            }
-          } else if (messageState == State::CommentMultiLine) {
-            colorToken(styleContext, *iterTokens, State::CommentMultiLine);
-              // A multi-line comment ends with "/;" and there can't be spaces in between.
-            if (tokenString == ";" && iterTokens != tokens.begin() && std::prev(iterTokens)->content == "/" && iterTokens->startPos == std::prev(iterTokens)->startPos + 1) {
-              messageState = State::Default;
-            }
-          } else if (messageState == State::Comment) {
-            colorToken(styleContext, *iterTokens, State::Comment);
-          } else if (messageState == State::String) {
-            colorToken(styleContext, *iterTokens, State::String);
-            if (tokenString == "\"") {
-              // This may be an escape for double quote. Check previous tokens.
-              int numBackslash = 0;
-              auto iterCheck = iterTokens;
-              while (iterCheck != tokens.begin()) {
-                if ((--iterCheck)->content == "\\") {
-                  numBackslash++;
-                } else {
-                  break;
-                }
-              }
-              if (numBackslash % 2 == 0) {
-                messageState = State::Default;
-              }
-            }
-          } else {
-            // Determine the type of the token and color it.
-            if (tokenString == "{") {
-              colorToken(styleContext, *iterTokens, messageState = State::CommentDoc);
-            } else if (tokenString == ";") {
-              // A multi-line comment starts with ";/" and there can't be spaces in between.
-              if (std::next(iterTokens) != tokens.end() && std::next(iterTokens)->content == "/" && iterTokens->startPos == std::next(iterTokens)->startPos - 1) {
-                colorToken(styleContext, *iterTokens, messageState = State::CommentMultiLine);
-              } else {
-                colorToken(styleContext, *iterTokens, messageState = State::Comment);
-              }
-            } else if (tokenString == "\"") {
-              colorToken(styleContext, *iterTokens, messageState = State::String);
-            } else if (iterTokens->tokenType == TokenType::Numeric) {
-              colorToken(styleContext, *iterTokens, State::Number);
-            } else if (iterTokens->tokenType == TokenType::Identifier) {
-              if (!wordListFlowControl.InList(tokenString.c_str()) && isalnum(tokenString.back()) && std::next(iterTokens) != tokens.end() && std::next(iterTokens)->content == "(") {
-                // If next token is ( and current token is an identifier but not if/elseif/while, it is a function name.
-                colorToken(styleContext, *iterTokens, State::Function);
-              } else if (wordListTypes.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Type);
-              } else if (wordListFlowControl.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::FlowControl);
-              } else if (wordListKeywords.InList(tokenString.c_str())) {
-                // Check if a new property needs to be added, and update existing property list
-                if (tokenString == "scriptname" && std::next(iterTokens) != tokens.end()) {
-                  const auto& fullScriptName = std::next(iterTokens)->content;
-                  auto detectedScriptName = utility::split(fullScriptName, ":").back();
-                  if (!utility::compare(scriptName, detectedScriptName)) {
-                    scriptName = detectedScriptName;
-                    detectBufferId();
-
-                    // Add full script name to map
-                    Lock lock(scriptNameMapMutex);
-                    scriptNameMap[bufferID] = fullScriptName;
-                  }
-                } else if (tokenString == "property" && std::next(iterTokens) != tokens.end() && std::next(iterTokens)->content != ";") {
-                  std::string propertyName = std::next(iterTokens)->content;
-                  auto iter = std::find_if(propertyLines.begin(), propertyLines.end(),
-                    [&](const auto& property) {
-                      return property.name == propertyName;
-                    }
-                  );
-                  if (iter != propertyLines.end()) {
-                    // See if there are properties marked as need to re-check due to line addition.
-                    if (iter->line < line) {
-                      iter = std::find_if(++iter, propertyLines.end(),
-                        [&](const auto& property) {
-                         return property.name == propertyName && iter->line > line; // Due to line addition
-                        }
-                      );
-                    }
-                    if (iter != propertyLines.end() && iter->needRecheck) {
-                      iter->line = line;
-                      iter->needRecheck = false;
-                    }
-                  } else {
-                    Property property {
-                      .name = propertyName,
-                      .line = line
-                    };
-                    propertyLines.push_back(property);
-                    propertyNames.insert(propertyName);
-                  }
-                }
+      // When the whole document needs to be lexed, e.g. when it's opened or restyled after settings change, large documents are lexed
+      // in parallel. Multi-byte DBCS characters can't be read from a copy of the document by position alone, so they aren't split.
+      if (!canStopEarly && startPos == 0 && lengthDoc >= accessor.Length() && accessor.Encoding() != EncodingType::dbcs && lexInParallel(pAccess, endLine + 1)) {
+        propertyNamesChanged = false;
+        fullLexRequested = false;
+        relexUntilLine = -1;
+        return;
+      }
 
-                colorToken(styleContext, *iterTokens, State::Keyword);
-              } else if (wordListKeywords2.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Keyword2);
-              } else if (wordListOperators.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Operator);
-              } else {
-                bool found = (propertyNames.find(tokenString) != propertyNames.end());
-                if (found) {
-                  colorToken(styleContext, *iterTokens, State::Property);
-                } else {
-                  if (lexerData->currentGame != game::Game::Auto) {
-                    if (lexerData->settings.enableClassNameCache) {
-                      auto& currentGameClassNames = helper->getClassNamesForGame(lexerData->currentGame);
-                      if (isNameInCache(tokenString, currentGameClassNames.first, currentGameClassNames.second)) {
-                        colorToken(styleContext, *iterTokens, State::Class);
-                        found = true;
-                      } else {
-                        auto& currentGameNonClassNames = helper->getNonClassNamesForGame(lexerData->currentGame);
-                        if (!isNameInCache(tokenString, currentGameNonClassNames.first, currentGameNonClassNames.second)) {
-                          if (!getClassFilePath(bufferID, tokenString).empty()) {
-                            colorToken(styleContext, *iterTokens, State::Class);
-                            addNameToCache(tokenString, currentGameClassNames.first, currentGameClassNames.second);
-                            found = true;
-                          }
-
-                          if (!found) {
-                            addNameToCache(tokenString, currentGameNonClassNames.first, currentGameNonClassNames.second);
-                          }
-                        }
-                      }
-                    } else if (!getClassFilePath(bufferID, tokenString).empty()) {
-                        colorToken(styleContext, *iterTokens, State::Class);
-                        found = true;
-                    }
-                  }
+      // Scan the whole document for declarations after it's changed. Without buffer ID, changes aren't known so always scan.
+      if (declarationsOutdated || (bufferID == 0 && !detached)) {
+        scanDeclarations(pAccess);
+      }
+      declarations = declarationScanner.getDeclarations();
 
-                  if (!found) {
-                    colorToken(styleContext, *iterTokens, State::Default);
-                  }
-                }
-              }
-            } else if (iterTokens->tokenType == TokenType::Special) {
-              if (wordListOperators.InList(iterTokens->content.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Operator);
-              } else {
-                colorToken(styleContext, *iterTokens, State::Default);
-              }
-            }
-          }
-        }
-        if (messageState == State::Comment || messageState == State::String) {
-          messageState = State::Default;
-        }
-        if (styleContext.ch == '\r') {
-          styleContext.Forward();
-        }
-        if (styleContext.ch == '\n') {
-          styleContext.SetState(std::to_underlying(messageState));
-          styleContext.Forward();
+      // Initialize state from the state saved at the end of previous line. If previous line hasn't been lexed by this lexer, fall back
+      // to the state saved in its line feed character.
+      State messageStateLast = static_cast<State>(accessor.StyleAt(startPos - 1));
+      if (startLine > 0) {
+        int previousLineState = accessor.GetLineState(startLine - 1);
+        if (previousLineState & LINE_STATE_LEXED) {
+          messageStateLast = static_cast<State>(previousLineState & LINE_STATE_MASK);
         }
-        messageStateLast = messageState;
       }
+      StyleContext styleContext(startPos, lengthDoc, std::to_underlying(messageStateLast), accessor);
+      propertyNamesChanged = false;
+
+      beginPass(lexPass);
+      auto line = lexLines(lexPass, accessor, styleContext, startLine, endLine, messageStateLast, canStopEarly, relexUntilLine);
       styleContext.Complete();
+
+      lastLexedLine = std::min(line, endLine);
+      blockIndex.replaceLines(startLine, lastLexedLine, lexPass.blockKeywords);
+      occurrenceIndex.replaceLines(startLine, lastLexedLine, lexPass.identifiers);
+      if (line > endLine && static_cast<Sci_Position>(startPos) + lengthDoc >= accessor.Length()) {
+        // Without buffer ID, lines may have been deleted without block index knowing, so there may be keywords after the last line
+        blockIndex.removeFrom(line);
+        occurrenceIndex.removeFrom(line);
+      }
+      endPass(lexPass);
+
+      if (line >= relexUntilLine) {
+        relexUntilLine = -1;
+      }
+      if (line < endLine) {
+        // Stopped early. Mark the rest of the range as styled with existing styles.
+        accessor.StartAt(startPos + lengthDoc);
+      } else if (static_cast<Sci_Position>(startPos) + lengthDoc >= accessor.Length()) {
+        fullLexRequested = false;
+      }
     }
   }
 
@@ -300,42 +273,53 @@ namespace papyrus {
     if (isUsable()) {
       Accessor accessor(pAccess, nullptr);
 
-      int levelPrev = accessor.LevelAt(accessor.GetLine(startPos)) & SC_FOLDLEVELNUMBERMASK;
+      // Lines after the ones last lexed still have the same fold keywords, so once one of them keeps its level, so do the rest. Unless
+      // fold middle setting changed, which changes levels of all lines with middle keywords.
+      bool canStopEarly = (foldMiddleEnabled == lexerData->settings.enableFoldMiddle);
+      foldMiddleEnabled = lexerData->settings.enableFoldMiddle;
+
+      auto firstLine = accessor.GetLine(startPos);
+      auto lastLine = accessor.GetLine(startPos + lengthDoc);
+      std::vector<BlockIndex::LineSummary> summaries;
+      int levelPrev = accessor.LevelAt(firstLine) & SC_FOLDLEVELNUMBERMASK;
       // Lines
-      for (auto line = accessor.GetLine(startPos); line <= accessor.GetLine(startPos + lengthDoc); ++line) {
-        int numFoldOpen = 0;
-        int numFoldClose = 0;
-        bool hasFoldMiddle = false;
-        // Chars
-        auto tokens = tokenize(accessor, line);
-        for (const Token& token : tokens) {
-          if (!isComment(accessor.StyleAt(token.startPos)) && accessor.StyleAt(token.startPos) != std::to_underlying(State::String)) {
-            if (wordListFoldOpen.InList(token.content.c_str())) {
-              numFoldOpen++;
-            } else if (wordListFoldClose.InList(token.content.c_str())) {
-              numFoldClose++;
-            } else if (lexerData->settings.enableFoldMiddle && wordListFoldMiddle.InList(token.content.c_str())) {
-              hasFoldMiddle = true;
-            }
-          }
+      for (auto line = firstLine; line <= lastLine; ++line) {
+        // Fold keywords outside of comments and strings have been collected by Lex. They are retrieved in batches, so that stopping
+        // early doesn't need keywords of all lines.
+        Sci_Position batchOffset = (line - firstLine) % FOLD_BATCH_LINES;
+        if (batchOffset == 0) {
+          summaries = blockIndex.getLineSummaries(line, std::min(line + FOLD_BATCH_LINES - 1, lastLine));
         }
+        const auto& summary = summaries[batchOffset];
+        bool hasFoldMiddle = lexerData->settings.enableFoldMiddle && summary.hasMiddle;
 
         // Skip the lines that have matching start and end keywords.
         int level = levelPrev;
-        int levelDelta = numFoldOpen - numFoldClose;
+        int levelDelta = summary.numOpen - summary.numClose;
         if (levelDelta > 0) {
           level |= SC_FOLDLEVELHEADERFLAG;
         }
-        if (hasFoldMiddle && numFoldOpen == 0 && numFoldClose == 0) {
+        if (hasFoldMiddle && summary.numOpen == 0 && summary.numClose == 0) {
           level--;
           level |= SC_FOLDLEVELHEADERFLAG;
         }
+        if (canStopEarly && line > lastLexedLine && accessor.LevelAt(line) == level) {
+          break;
+        }
         accessor.SetLevel(line, level);
         levelPrev += levelDelta;
       }
     }
   }
 
+  Sci_Position SCI_METHOD Lexer::WordListSet(int n, const char* wl) {
+    Sci_Position result = SimpleLexerBase::WordListSet(n, wl);
+    if (result >= 0) {
+      fullLexRequested = true;
+    }
+    return result;
+  }
+
   // Protected methods
   //
 
@@ -346,90 +330,564 @@ namespace papyrus {
   // Private methods
   //
 
-  std::vector<Lexer::Token> Lexer::tokenize(Accessor& accessor, Sci_Position line) const {
-    std::vector<Token> tokens;
+  void Lexer::beginPass(LexPass& pass) {
+    pass.keywordTable = getKeywordTable();
+    pass.declarations = declarations;
+    pass.properties = &properties;
+
+    // Class index of current script's directory only needs to be resolved once, rather than for every identifier
+    pass.scriptDirectoryClassIndex = (lexerData->currentGame != game::Game::Auto) ? getScriptDirectoryClassIndex(bufferID) : nullptr;
+
+    if (lexerData->currentGame != game::Game::Auto && lexerData->settings.enableClassNameCache) {
+      pass.classNamesCache = &helper->getClassNamesForGame(lexerData->currentGame);
+      pass.nonClassNamesCache = &helper->getNonClassNamesForGame(lexerData->currentGame);
+      pass.classNames = pass.classNamesCache->snapshot();
+      pass.nonClassNames = pass.nonClassNamesCache->snapshot();
+    } else {
+      pass.classNamesCache = nullptr;
+      pass.nonClassNamesCache = nullptr;
+    }
+  }
+
+  void Lexer::endPass(LexPass& pass) {
+    // Publish newly found names once, rather than updating caches for each name
+    if (pass.classNamesCache != nullptr) {
+      pass.classNamesCache->add(pass.pendingClassNames);
+      pass.nonClassNamesCache->add(pass.pendingNonClassNames);
+    }
+    pass.pendingClassNames.clear();
+    pass.pendingNonClassNames.clear();
+    pass.blockKeywords.clear();
+    pass.identifiers.clear();
+    referencedNames.merge(pass.referencedNames);
+    pass.referencedNames.clear();
+
+    if (!pass.fullScriptName.empty()) {
+      auto detectedScriptName = utility::split(pass.fullScriptName, ":").back();
+      if (!utility::compare(scriptName, detectedScriptName)) {
+        scriptName = detectedScriptName;
+        detectBufferId();
+
+        // Add full script name to map
+        Lock lock(scriptNameMapMutex);
+        scriptNameMap[bufferID] = pass.fullScriptName;
+      }
+      pass.fullScriptName.clear();
+      pass.scriptNameLine = -1;
+    }
+
+    statistics.classNameLookups += pass.statistics.classNameLookups;
+    statistics.classNameCacheHits += pass.statistics.classNameCacheHits;
+    pass.statistics = {};
+
+    // Don't hold on to snapshots, so that replaced versions can be freed
+    pass.keywordTable.reset();
+    pass.classNames.reset();
+    pass.nonClassNames.reset();
+    pass.declarations.reset();
+  }
+
+  bool Lexer::lexInParallel(IDocument* pAccess, Sci_Position lineCount) {
+    size_t numChunks = std::min(utility::ThreadPool::hardwareConcurrency(), static_cast<size_t>(lineCount / PARALLEL_LEX_CHUNK_MIN_LINES));
+    if (numChunks < 2) {
+      return false;
+    }
+
+    // Chunks are lexed on copies of their text, so that worker threads don't access Scintilla
+    std::string text(pAccess->Length(), '\0');
+    pAccess->GetCharRange(text.data(), 0, pAccess->Length());
+
+    // Properties defined in preceding chunks are unknown to a chunk, so they are looked up in declarations of the whole document.
+    // Scanner still scans the text, so that following Lex calls get the same declarations from it.
+    declarations = std::make_shared<const Declarations>(DeclarationScanner::parse(text));
+
+    struct Chunk {
+      Sci_Position startLine;
+      Sci_Position startPos;
+      std::unique_ptr<MemoryDocument> document;
+      LexPass pass;
+    };
+    std::vector<Chunk> chunks(numChunks);
+    for (size_t i = 0; i < numChunks; ++i) {
+      auto& chunk = chunks[i];
+      chunk.startLine = static_cast<Sci_Position>(lineCount * i / numChunks);
+      chunk.startPos = pAccess->LineStart(chunk.startLine);
+      Sci_Position endPos = pAccess->LineStart(static_cast<Sci_Position>(lineCount * (i + 1) / numChunks));
+      chunk.document = std::make_unique<MemoryDocument>(std::string_view(text).substr(chunk.startPos, endPos - chunk.startPos), pAccess->CodePage());
+      beginPass(chunk.pass);
+      chunk.pass.collectProperties = true;
+    }
+
+    if (declarationsOutdated || (bufferID == 0 && !detached)) {
+      scannedBufferID = bufferID;
+      declarationScanner.scan(std::move(text));
+      declarationsOutdated = false;
+    }
+
+    // Lex a chunk from its first line. Returns the line where it stopped.
+    auto lexChunk = [this](Chunk& chunk, State state, bool canStopEarly) {
+      Accessor accessor(chunk.document.get(), nullptr);
+      StyleContext styleContext(0, chunk.document->Length(), std::to_underlying(state), accessor);
+      auto line = lexLines(chunk.pass, accessor, styleContext, 0, chunk.document->LineFromPosition(chunk.document->Length() - 1), state, canStopEarly, -1);
+      styleContext.Complete();
+      return line;
+    };
+
+    // Chunks other than the first one are lexed assuming they don't start inside a comment, which is true for most line boundaries.
+    // This thread lexes the first chunk while waiting.
+    {
+      utility::ThreadPool threadPool(numChunks - 1);
+      std::vector<std::future<void>> results;
+      for (size_t i = 1; i < numChunks; ++i) {
+        results.push_back(threadPool.submit([&, i] { lexChunk(chunks[i], State::Default, false); }));
+      }
+      lexChunk(chunks[0], State::Default, false);
+      for (auto& result : results) {
+        result.get();
+      }
+    }
+
+    // Commit chunks in order
+    State state = State::Default;
+    for (auto& chunk : chunks) {
+      if (state != State::Default) {
+        // Previous chunk ends inside a comment. Relex this one until a line ends in the same state as it did when lexed from a wrong
+        // state, since the rest of the lines are styled the same. What was found in relexed lines is replaced.
+        auto definedProperties = std::exchange(chunk.pass.definedProperties, {});
+        auto fullScriptName = std::exchange(chunk.pass.fullScriptName, {});
+        auto scriptNameLine = std::exchange(chunk.pass.scriptNameLine, -1);
+        auto blockKeywords = std::exchange(chunk.pass.blockKeywords, {});
+        auto identifiers = std::exchange(chunk.pass.identifiers, {});
+
+        auto line = lexChunk(chunk, state, true);
+        for (auto& [name, propertyLine] : definedProperties) {
+          if (propertyLine > line) {
+            chunk.pass.definedProperties.emplace_back(name, propertyLine);
+          }
+        }
+        for (const auto& keyword : blockKeywords) {
+          if (keyword.line > line) {
+            chunk.pass.blockKeywords.push_back(keyword);
+          }
+        }
+        for (const auto& identifier : identifiers) {
+          if (identifier.line > line) {
+            chunk.pass.identifiers.push_back(identifier);
+          }
+        }
+        if (scriptNameLine > line && chunk.pass.fullScriptName.empty()) {
+          chunk.pass.fullScriptName = std::move(fullScriptName);
+          chunk.pass.scriptNameLine = scriptNameLine;
+        }
+      }
+
+      const MemoryDocument& chunkDocument = *chunk.document;
+      Sci_Position chunkEndLine = chunkDocument.LineFromPosition(chunkDocument.Length() - 1);
+      pAccess->StartStyling(chunk.startPos);
+      pAccess->SetStyles(chunkDocument.Length(), chunkDocument.getStyles().data());
+      for (Sci_Position line = 0; line <= chunkEndLine; ++line) {
+        pAccess->SetLineState(chunk.startLine + line, chunkDocument.GetLineState(line));
+      }
+      state = static_cast<State>(chunkDocument.GetLineState(chunkEndLine) & LINE_STATE_MASK);
+
+      for (const auto& [name, line] : chunk.pass.definedProperties) {
+        properties.define(name, chunk.startLine + line);
+      }
+      for (auto& keyword : chunk.pass.blockKeywords) {
+        keyword.line += chunk.startLine;
+      }
+      for (auto& identifier : chunk.pass.identifiers) {
+        identifier.line += chunk.startLine;
+      }
+      blockIndex.replaceLines(chunk.startLine, chunk.startLine + chunkEndLine, chunk.pass.blockKeywords);
+      occurrenceIndex.replaceLines(chunk.startLine, chunk.startLine + chunkEndLine, chunk.pass.identifiers);
+      if (&chunk == &chunks.back()) {
+        blockIndex.removeFrom(chunk.startLine + chunkEndLine + 1);
+        occurrenceIndex.removeFrom(chunk.startLine + chunkEndLine + 1);
+        lastLexedLine = chunk.startLine + chunkEndLine;
+      }
+      endPass(chunk.pass);
+    }
+    return true;
+  }
+
+  Sci_Position Lexer::lexLines(LexPass& pass, Accessor& accessor, StyleContext& styleContext, Sci_Position startLine, Sci_Position endLine, State messageStateLast,
+    bool canStopEarly, Sci_Position stopAfterLine) const {
+    const KeywordTable& keywordTable = *pass.keywordTable;
+    AtomTable& atomTable = AtomTable::instance();
+    Tokenizer& tokenizer = pass.tokenizer;
+    auto line = startLine;
+    for (; line <= endLine; ++line) {
+      const auto& tokens = tokenizer.tokenize(accessor, line, messageStateLast);
+      State messageState = messageStateLast;
+      Sci_Position lineStart = accessor.LineStart(line);
+
+      // Styling
+      for (auto iterTokens = tokens.begin(); iterTokens != tokens.end(); ++iterTokens) {
+        auto tokenString = tokenizer.tokenText(*iterTokens);
+
+        if (messageState == State::CommentDoc) {
+          colorToken(styleContext, *iterTokens, State::CommentDoc);
+          if (tokenString == "}") {
+            messageState = State::Default;
+          }
+        } else if (messageState == State::CommentMultiLine) {
+          colorToken(styleContext, *iterTokens, State::CommentMultiLine);
+            // A multi-line comment ends with "/;" and there can't be spaces in between.
+          if (tokenString == ";" && iterTokens != tokens.begin() && tokenizer.tokenText(*std::prev(iterTokens)) == "/" && iterTokens->startPos == std::prev(iterTokens)->startPos + 1) {
+            messageState = State::Default;
+          }
+        } else if (messageState == State::Comment) {
+          colorToken(styleContext, *iterTokens, State::Comment);
+        } else if (messageState == State::String) {
+          colorToken(styleContext, *iterTokens, State::String);
+          if (tokenString == "\"") {
+            // This may be an escape for double quote. Check previous tokens.
+            int numBackslash = 0;
+            auto iterCheck = iterTokens;
+            while (iterCheck != tokens.begin()) {
+              if (tokenizer.tokenText(*--iterCheck) == "\\") {
+                numBackslash++;
+              } else {
+                break;
+              }
+            }
+            if (numBackslash % 2 == 0) {
+              messageState = State::Default;
+            }
+          }
+        } else {
+          // Determine the type of the token and color it.
+          if (tokenString == "{") {
+            colorToken(styleContext, *iterTokens, messageState = State::CommentDoc);
+          } else if (tokenString == ";") {
+            // A multi-line comment starts with ";/" and there can't be spaces in between.
+            if (tokenizer.lineCharAt(iterTokens->startPos + 1) == '/') {
+              colorToken(styleContext, *iterTokens, messageState = State::CommentMultiLine);
+            } else {
+              colorToken(styleContext, *iterTokens, messageState = State::Comment);
+            }
+          } else if (tokenString == "\"") {
+            colorToken(styleContext, *iterTokens, messageState = State::String);
+          } else if (iterTokens->tokenType == TokenType::Numeric) {
+            colorToken(styleContext, *iterTokens, State::Number);
+          } else if (iterTokens->tokenType == TokenType::Identifier) {
+            auto categories = keywordTable.lookup(tokenString, iterTokens->hash);
+
+            // Collect fold keywords for block index
+            if (categories & (CATEGORY_FOLD_OPEN | CATEGORY_FOLD_MIDDLE | CATEGORY_FOLD_CLOSE)) {
+              atom_t name = atomTable.find(tokenString, iterTokens->hash);
+              if (name == AtomTable::NO_ATOM) {
+                name = atomTable.intern(tokenString, iterTokens->hash);
+              }
+              BlockIndex::Role role = (categories & CATEGORY_FOLD_OPEN) ? BlockIndex::Role::Open
+                : (categories & CATEGORY_FOLD_CLOSE) ? BlockIndex::Role::Close : BlockIndex::Role::Middle;
+              pass.blockKeywords.push_back({line, iterTokens->startPos - lineStart, iterTokens->length, name, role});
+            }
+
+            // Collect names for occurrence index. Keywords aren't names, and comments and strings never get here. Names aren't interned,
+            // since most identifiers, e.g. partially typed ones, are never declared anywhere.
+            if (categories == 0) {
+              pass.identifiers.push_back({line, static_cast<int32_t>(iterTokens->startPos - lineStart), static_cast<int32_t>(iterTokens->length), iterTokens->hash});
+            }
+
+            if (!(categories & CATEGORY_FLOW_CONTROL) && std::isalnum(static_cast<unsigned char>(tokenString.back())) && std::next(iterTokens) != tokens.end() && tokenizer.tokenText(*std::next(iterTokens)) == "(") {
+              // If next token is ( and current token is an identifier but not if/elseif/while, it is a function name.
+              colorToken(styleContext, *iterTokens, State::Function);
+            } else if (categories & CATEGORY_TYPE) {
+              colorToken(styleContext, *iterTokens, State::Type);
+            } else if (categories & CATEGORY_FLOW_CONTROL) {
+              colorToken(styleContext, *iterTokens, State::FlowControl);
+            } else if (categories & CATEGORY_KEYWORD) {
+              // Check if a new property needs to be added, and update existing property list
+              if (tokenizer.isToken(*iterTokens, "scriptname") && std::next(iterTokens) != tokens.end()) {
+                pass.fullScriptName = tokenizer.tokenText(*std::next(iterTokens));
+                pass.scriptNameLine = line;
+              } else if (tokenizer.isToken(*iterTokens, "property") && std::next(iterTokens) != tokens.end() && tokenizer.tokenText(*std::next(iterTokens)) != ";") {
+                atom_t propertyName = atomTable.intern(tokenizer.tokenText(*std::next(iterTokens)), std::next(iterTokens)->hash);
+                if (pass.collectProperties) {
+                  pass.definedProperties.emplace_back(propertyName, line);
+                } else if (pass.properties->define(propertyName, line)) {
+                  // Lines after this one may use the new property
+                  canStopEarly = false;
+                }
+              }
+
+              colorToken(styleContext, *iterTokens, State::Keyword);
+            } else if (categories & CATEGORY_KEYWORD2) {
+              colorToken(styleContext, *iterTokens, State::Keyword2);
+            } else if (categories & CATEGORY_OPERATOR) {
+              colorToken(styleContext, *iterTokens, State::Operator);
+            } else {
+              // Names that were never interned aren't in any name set
+              atom_t atom = atomTable.find(tokenString, iterTokens->hash);
+              bool found = atom != AtomTable::NO_ATOM
+                && (pass.properties->contains(atom) || (pass.declarations && pass.declarations->properties.contains(atom)));
+              if (found) {
+                colorToken(styleContext, *iterTokens, State::Property);
+              } else {
+                if (lexerData->currentGame != game::Game::Auto) {
+                  pass.referencedNames.add(iterTokens->hash);
+                  if (pass.classNames) {
+                    pass.statistics.classNameLookups++;
+                    if (pass.classNames->contains(atom)) {
+                      pass.statistics.classNameCacheHits++;
+                      colorToken(styleContext, *iterTokens, State::Class);
+                      found = true;
+                    } else if (pass.nonClassNames->contains(atom)) {
+                      pass.statistics.classNameCacheHits++;
+                    } else {
+                      // Class names are bounded by script files, so they are interned. Other names are only cached when they are
+                      // already interned, i.e. declared somewhere, otherwise every identifier ever typed would be kept.
+                      if (findClassFile(pass.scriptDirectoryClassIndex, tokenString)) {
+                        colorToken(styleContext, *iterTokens, State::Class);
+                        pass.pendingClassNames.push_back(atomTable.intern(tokenString, iterTokens->hash));
+                        found = true;
+                      } else if (atom != AtomTable::NO_ATOM) {
+                        pass.pendingNonClassNames.push_back(atom);
+                      }
+                    }
+                  } else if (findClassFile(pass.scriptDirectoryClassIndex, tokenString)) {
+                      colorToken(styleContext, *iterTokens, State::Class);
+                      found = true;
+                  }
+                }
+
+                if (!found) {
+                  colorToken(styleContext, *iterTokens, State::Default);
+                }
+              }
+            }
+          } else if (iterTokens->tokenType == TokenType::Special) {
+            if (keywordTable.lookup(tokenString, iterTokens->hash) & CATEGORY_OPERATOR) {
+              colorToken(styleContext, *iterTokens, State::Operator);
+            } else {
+              colorToken(styleContext, *iterTokens, State::Default);
+            }
+          }
+        }
+      }
+      if (messageState == State::Comment || messageState == State::String) {
+        messageState = State::Default;
+      }
+
+      // Trailing white spaces. Style them now so the whole line is styled even if Lex stops after this line.
+      auto lineEnd = accessor.LineEnd(line);
+      if (styleContext.currentPos < static_cast<Sci_PositionU>(lineEnd)) {
+        styleContext.SetState(std::to_underlying(State::Default));
+        styleContext.ForwardBytes(lineEnd - styleContext.currentPos);
+      }
+      if (styleContext.ch == '\r') {
+        styleContext.Forward();
+      }
+      if (styleContext.ch == '\n') {
+        styleContext.SetState(std::to_underlying(messageState));
+        styleContext.Forward();
+      }
+      messageStateLast = messageState;
+
+      // When a line after all changed lines ends in the same state as last time, the rest of the lines would be styled the same.
+      int lineState = LINE_STATE_LEXED | std::to_underlying(messageState);
+      int lastLineState = accessor.GetLineState(line);
+      accessor.SetLineState(line, lineState);
+      if (canStopEarly && line > stopAfterLine && line < endLine && lineState == lastLineState) {
+        break;
+      }
+    }
+    return line;
+  }
+
+  const std::vector<Lexer::Token>& Lexer::Tokenizer::tokenize(Accessor& accessor, Sci_Position line, State state) {
+    tokens.clear();
+    tokenTextBuffer.clear();
+
+    // Copy the line into line text buffer, so it can be scanned directly
+    auto lineStart = accessor.LineStart(line);
+    auto lineEnd = accessor.LineEnd(line);
+    lineTextStart = lineStart;
+    lineText.resize(lineEnd - lineStart);
+    accessor.MultiByteAccess()->GetCharRange(lineText.data(), lineStart, lineEnd - lineStart);
+    bool canScanBytes = accessor.Encoding() != EncodingType::dbcs;
+
     TokenType previousTokenType = TokenType::Special;
-    auto index = accessor.LineStart(line);
+    auto index = lineStart;
     auto indexNext = index;
     int ch = getNextChar(accessor, index, indexNext);
-    while (index < accessor.LineEnd(line)) {
+    while (index < lineEnd) {
       if (ch == '\r' || ch == '\n') {
         break;
       }
 
+      if (canScanBytes && (isComment(std::to_underlying(state)) || state == State::String)) {
+        // Inside a comment or a string. Skip to its end and make the body a single token, followed by the terminator tokens.
+        size_t bodyStart = index - lineStart;
+        size_t bodyEnd = lineText.length();
+        size_t terminatorLength = 0;
+        if (state == State::CommentDoc) {
+          size_t found = byte_scanner::find(lineText, bodyStart, '}');
+          if (found != std::string::npos) {
+            bodyEnd = found;
+            terminatorLength = 1;
+          }
+        } else if (state == State::CommentMultiLine) {
+          for (size_t found = byte_scanner::find(lineText, bodyStart, '/'); found != std::string::npos; found = byte_scanner::find(lineText, found + 1, '/')) {
+            if (found + 1 < lineText.length() && lineText[found + 1] == ';') {
+              bodyEnd = found;
+              terminatorLength = 2;
+              break;
+            }
+          }
+        } else if (state == State::String) {
+          for (size_t found = byte_scanner::find(lineText, bodyStart, '"'); found != std::string::npos; found = byte_scanner::find(lineText, found + 1, '"')) {
+            // Double quote is escaped if preceded by odd number of backslashes. Same as tokens, blanks in between are ignored.
+            int numBackslash = 0;
+            for (size_t i = found; i > bodyStart; --i) {
+              char previousChar = lineText[i - 1];
+              if (previousChar == '\\') {
+                numBackslash++;
+              } else if (previousChar != ' ' && previousChar != '\t') {
+                break;
+              }
+            }
+            if (numBackslash % 2 == 0) {
+              bodyEnd = found;
+              terminatorLength = 1;
+              break;
+            }
+          }
+        }
+
+        if (bodyEnd > bodyStart) {
+          Token& token = beginToken(TokenType::Body, index);
+          endToken(token, lineStart + bodyEnd);
+        }
+        for (size_t i = 0; i < terminatorLength; ++i) {
+          Token& token = beginToken(TokenType::Special, lineStart + bodyEnd + i);
+          appendToToken(token, lineText[bodyEnd + i]);
+          endToken(token, lineStart + bodyEnd + i + 1);
+        }
+        previousTokenType = TokenType::Special;
+        state = State::Default;
+
+        indexNext = lineStart + bodyEnd + terminatorLength;
+        ch = getNextChar(accessor, index, indexNext);
+        continue;
+      }
+
       bool processed = false;
       if (ch <= 255) {
         if (std::isblank(ch)) {
+          if (canScanBytes) {
+            indexNext = lineStart + byte_scanner::skipBlanks(lineText, index - lineStart);
+          }
           ch = getNextChar(accessor, index, indexNext);
           processed = true;
         } else if (std::isalpha(ch) || ch == '_') {
-          Token token {
-            .tokenType = TokenType::Identifier,
-            .startPos = index
-          };
+          Token& token = beginToken(TokenType::Identifier, index);
           while (ch <= 255 && (std::isalnum(ch) || ch == '_' || ch == ':')) {
-            token.content.push_back(std::tolower(ch)); // Papyrus script is case insensitive
+            appendToToken(token, static_cast<char>(std::tolower(ch))); // Papyrus script is case insensitive
             ch = getNextChar(accessor, index, indexNext);
           }
-          tokens.push_back(token);
+          endToken(token, index);
           previousTokenType = token.tokenType;
           processed = true;
         } else if (std::isdigit(ch) || (ch == '-' && previousTokenType == TokenType::Special)) { // For a minus sign to be treated as leading minus sign rather than minus operator, previous token cannot be an identifier or a number
-          Token token {
-            .tokenType = TokenType::Numeric,
-            .startPos = index
-          };
+          Token& token = beginToken(TokenType::Numeric, index);
           bool hasDigit = false;
           while (ch <= 255
             && (std::isdigit(ch)
               || (ch == '-' && index == token.startPos) // leading minus sign
               || (ch == '.' && hasDigit) // decimal point after at least a digit
-              || ((ch == 'x' || ch == 'X') && index == token.startPos + 1 && token.content.front() == '0') // 0x
-              || (std::isxdigit(ch) && token.content.size() > 1 && std::tolower(token.content.at(1)) == 'x'))) { // hex value after 0x
-            token.content.push_back(std::tolower(ch));
+              || ((ch == 'x' || ch == 'X') && index == token.startPos + 1 && tokenText(token).front() == '0') // 0x
+              || (std::isxdigit(ch) && token.textLength > 1 && tokenText(token).at(1) == 'x'))) { // hex value after 0x
+            appendToToken(token, static_cast<char>(std::tolower(ch)));
             if (!hasDigit && std::isdigit(ch)) {
               hasDigit = true;
             }
             ch = getNextChar(accessor, index, indexNext);
           }
+          endToken(token, index);
 
           // In the case when the token is a single '-', it's not numeric.
-          if (token.content.front() == '-' && token.content.size() == 1) {
+          if (tokenText(token) == "-") {
             token.tokenType = TokenType::Special;
           }
-          tokens.push_back(token);
           previousTokenType = token.tokenType;
           processed = true;
         }
       }
 
       if (!processed) {
-        Token token {
-          .tokenType = TokenType::Special,
-          .startPos = index
-        };
-        token.content.push_back(ch);
-        tokens.push_back(token);
-        previousTokenType = token.tokenType;
+        Token& token = beginToken(TokenType::Special, index);
+        if (ch <= 127) {
+          // Only ASCII characters are meaningful for word list lookups. Others are kept as empty text, since truncating them may
+          // produce a false match.
+          appendToToken(token, static_cast<char>(ch));
+        }
+
+        // Track the start of comments and strings the same way as Lex does
+        if (ch == '{') {
+          state = State::CommentDoc;
+        } else if (ch == ';') {
+          // Multi-line comment's leading "/" is left to the body, so ";/;" ends it right away, same as "/;" is checked in Lex
+          state = (lineCharAt(index + 1) == '/') ? State::CommentMultiLine : State::Comment;
+        } else if (ch == '"') {
+          state = State::String;
+        }
+
         ch = getNextChar(accessor, index, indexNext);
+        endToken(token, index);
+        previousTokenType = token.tokenType;
       }
     }
     return tokens;
   }
 
-  void Lexer::colorToken(StyleContext & styleContext, Token token, State state) const {
-    if (styleContext.currentPos < (Sci_PositionU)token.startPos) {
+  Lexer::Token& Lexer::Tokenizer::beginToken(TokenType tokenType, Sci_Position startPos) {
+    return tokens.emplace_back(Token {
+      .tokenType = tokenType,
+      .startPos = startPos,
+      .length = 0,
+      .textOffset = tokenTextBuffer.size(),
+      .textLength = 0,
+      .hash = 0
+    });
+  }
+
+  void Lexer::Tokenizer::appendToToken(Token& token, char ch) {
+    tokenTextBuffer.push_back(ch);
+    token.textLength++;
+  }
+
+  void Lexer::Tokenizer::endToken(Token& token, Sci_Position endPos) {
+    token.length = endPos - token.startPos;
+    token.hash = utility::hashOf(tokenText(token));
+  }
+
+  void Lexer::colorToken(StyleContext& styleContext, const Token& token, State state) const {
+    if (styleContext.currentPos < static_cast<Sci_PositionU>(token.startPos)) {
       // White spaces
       styleContext.SetState(std::to_underlying(State::Default));
-      styleContext.Forward(token.startPos - styleContext.currentPos);
+      styleContext.ForwardBytes(token.startPos - styleContext.currentPos);
     }
 
     styleContext.SetState(std::to_underlying(state));
-    styleContext.Forward(token.content.length());
+    styleContext.ForwardBytes(token.length);
   }
 
-  int Lexer::getNextChar(Accessor& accessor, Sci_Position& index, Sci_Position& indexNext) const {
+  int Lexer::Tokenizer::getNextChar(Accessor& accessor, Sci_Position& index, Sci_Position& indexNext) const {
     index = indexNext;
+
+    // ASCII characters in current line can be read from line text buffer directly
+    size_t offset = index - lineTextStart;
+    if (index >= lineTextStart && offset < lineText.length()) {
+      unsigned char ch = lineText[offset];
+      if (ch < 0x80 || accessor.Encoding() == EncodingType::eightBit) {
+        indexNext = index + 1;
+        return ch;
+      }
+    }
+
     if (accessor.Encoding() != EncodingType::eightBit) {
       Sci_Position length {};
       int ch = accessor.MultiByteAccess()->GetCharacterAndWidth(index, &length);
@@ -437,20 +895,11 @@ namespace papyrus {
       return ch;
     } else {
       indexNext = index + 1;
-      return accessor.SafeGetCharAt(index);
+      return static_cast<unsigned char>(accessor.SafeGetCharAt(index));
     }
   }
 
-  bool Lexer::isNameInCache(const std::string& name, const std::set<std::string>& namesCache, std::mutex& mutex) const {
-    Lock lock(mutex);
-    return namesCache.find(name) != namesCache.end();
-  }
-
-  void Lexer::addNameToCache(const std::string& name, std::set<std::string>& namesCache, std::mutex& mutex) {
-    Lock lock(mutex);
-    namesCache.insert(name);
-  }
-
+#ifdef _WIN32
   void Lexer::handleMouseHover(HWND handle, bool hovering, Sci_Position position) const {
     if (isUsable() && lexerData->settings.enableHover) {
       // Cancel any displayed call tips
@@ -480,14 +929,10 @@ namespace papyrus {
                 };
                 ::SendMessage(handle, SCI_GETTEXTRANGE, 0, reinterpret_cast<LPARAM>(&propertyNameTextRange));
 
-                auto iter = std::find_if(propertyLines.begin(), propertyLines.end(),
-                  [&](const auto& property) {
-                    return property.name == utility::toLower(propertyName);
-                  }
-                );
-                if (iter != propertyLines.end()) {
-                  Sci_Position propertyDefinitionStart = ::SendMessage(handle, SCI_POSITIONFROMLINE, iter->line, 0);
-                  Sci_Position propertyDefinitionEnd = ::SendMessage(handle, SCI_GETLINEENDPOSITION, iter->line, 0);
+                Sci_Position propertyLine = properties.getLine(AtomTable::instance().find(utility::toLower(propertyName)));
+                if (propertyLine >= 0) {
+                  Sci_Position propertyDefinitionStart = ::SendMessage(handle, SCI_POSITIONFROMLINE, propertyLine, 0);
+                  Sci_Position propertyDefinitionEnd = ::SendMessage(handle, SCI_GETLINEENDPOSITION, propertyLine, 0);
                   callTips = new char[propertyDefinitionEnd - propertyDefinitionStart + 1];
 
                   Sci_TextRange propertyDefinitionTextRange {
@@ -514,88 +959,164 @@ namespace papyrus {
   }
 
   void Lexer::handleContentChange(HWND handle, Sci_Position position, Sci_Position linesAdded) {
-    Sci_Position line = static_cast<Sci_Position>(::SendMessage(handle, SCI_LINEFROMPOSITION, position, 0));
+    handleLinesChange(static_cast<Sci_Position>(::SendMessage(handle, SCI_LINEFROMPOSITION, position, 0)), linesAdded);
+  }
+#endif
 
-    // Update property list
-    for (auto iter = propertyLines.begin(); iter != propertyLines.end();) {
-      if (iter->line >= line) {
-        // If property is within the # of lines deleted, or is on the line when changes were made, delete the property.
-        // Note, deleting the property on the line being edited won't be an issue because Lex will be called later.
-        if ((linesAdded < 0 && iter->line <= line - linesAdded) || (linesAdded == 0 && iter->line == line)) {
-          // Delete this property
-          propertyNames.erase(iter->name);
-          iter = propertyLines.erase(iter);
-          continue;
-        }
+  void Lexer::handleLinesChange(Sci_Position line, Sci_Position linesAdded) {
+    // Track the last changed line, so that Lex won't stop early before it
+    if (relexUntilLine >= line) {
+      relexUntilLine = std::max(relexUntilLine + linesAdded, line);
+    }
+    relexUntilLine = std::max(relexUntilLine, line + std::max(linesAdded, static_cast<Sci_Position>(0)));
 
-        if (iter->line == line) {
-          // Since it's not clear if the addition of lines happened before property definition or after, the property defined
-          // on the exact line where changes happened need to be re-checked in Lex.
-          iter->needRecheck = true;
-        }
+    declarationsOutdated = true;
 
-        // Update line #
-        iter->line += linesAdded;
-      }
-      ++iter;
+    // Update property list. Note, deleting the property on the line being edited won't be an issue because Lex will be called later.
+    if (properties.updateLines(line, linesAdded)) {
+      propertyNamesChanged = true;
     }
+    blockIndex.updateLines(line, linesAdded);
+    occurrenceIndex.updateLines(line, linesAdded);
+  }
+
+  void Lexer::handleDeclarationsScanned() {
+    auto scannedDeclarations = declarationScanner.getDeclarations();
+    if (document != nullptr && scannedDeclarations && (!declarations || declarations->properties != scannedDeclarations->properties)) {
+      // Lines using these properties may be styled differently now. Scintilla only restyles the visible part of the document right away.
+      propertyNamesChanged = true;
+      document->ChangeLexerState(0, document->Length());
+    }
+
+    // Changes made while the scan was running haven't been scanned yet
+    if (declarationsOutdated && document != nullptr) {
+      scanDeclarations(document);
+    }
+  }
+
+  void Lexer::scanDeclarations(IDocument* pAccess) {
+    // Copying the whole document on every Lex while typing costs more than the scan itself, so edits made while a scan is running
+    // are scanned together once it completes. Without buffer ID, completion isn't reported and next Lex scans them instead.
+    if (declarationScanner.isScanning()) {
+      declarationsOutdated = true;
+      return;
+    }
+
+    std::string text(pAccess->Length(), '\0');
+    pAccess->GetCharRange(text.data(), 0, pAccess->Length());
+    scannedBufferID = bufferID;
+    declarationScanner.scan(std::move(text));
+    declarationsOutdated = false;
+  }
+
+  bool Lexer::mayReference(const std::vector<std::string>& names) const {
+    return std::any_of(names.begin(), names.end(), [&](const auto& name) { return referencedNames.mayContain(utility::hashOf(name)); });
+  }
+
+  void Lexer::restyle() {
+    if (document != nullptr) {
+      // Scintilla only restyles the visible part of the document right away, and Lex must not stop early before reaching the rest
+      fullLexRequested = true;
+      document->ChangeLexerState(0, document->Length());
+    }
+  }
+
+  void Lexer::onDeclarationsScanned() const {
+#ifdef _WIN32
+    // Scan result can only be routed to this lexer by buffer ID. Without it, next Lex still uses the result.
+    npp_buffer_t scanBufferID = scannedBufferID;
+    if (scanBufferID != 0) {
+      ::PostMessage(lexerData->messageWindow, PPM_DECLARATIONS_SCANNED, static_cast<WPARAM>(scanBufferID), 0);
+    }
+#endif
   }
 
   // For Notepad++ 8.4.9 or older releases, before NPPN_EXTERNALLEXERBUFFER message was introduced
   void Lexer::detectBufferId() {
+#ifdef _WIN32
     // Can only detect buffer ID if script name is known
-    if (bufferID == 0 && !scriptName.empty()) {
+    if (bufferID == 0 && !detached && !scriptName.empty()) {
       // Check if the file name of the active document on current view matches detected script name
       npp_view_t currentView = static_cast<npp_view_t>(::SendMessage(lexerData->nppData._nppHandle, NPPM_GETCURRENTVIEW, 0, 0));
       npp_buffer_t candidateBufferID = utility::getActiveBufferIdOnView(lexerData->nppData._nppHandle, currentView);
       std::filesystem::path filePath = utility::getFilePathFromBuffer(lexerData->nppData._nppHandle, candidateBufferID);
       if (utility::compare(scriptName + ".psc", filePath.filename().string())) {
         bufferID = candidateBufferID;
+        fullLexRequested = true; // Changes before buffer ID is known were not tracked
       } else {
         // Does not match. Check the other view
         candidateBufferID = utility::getActiveBufferIdOnView(lexerData->nppData._nppHandle, currentView == MAIN_VIEW ? SUB_VIEW : MAIN_VIEW);
         filePath = utility::getFilePathFromBuffer(lexerData->nppData._nppHandle, candidateBufferID);
         if (utility::compare(scriptName + ".psc", filePath.filename().string())) {
           bufferID = candidateBufferID;
+          fullLexRequested = true;
         }
       }
     }
+#endif
   }
 
-  std::wstring Lexer::getClassFilePath(npp_buffer_t bufferID, std::string className) {
-    // Find relative path from search directory. Support FO4's namespace.
-    std::filesystem::path relativePath;
-    auto pathComponents = utility::split(className, ":");
-    for (const auto& pathComponent : pathComponents) {
-      relativePath /= pathComponent;
-    }
-    relativePath.replace_extension(".psc");
+#ifdef _WIN32
+  std::wstring Lexer::getClassFilePath(npp_buffer_t bufferID, std::string_view className) {
+    std::wstring filePath;
+    findClassFile(getScriptDirectoryClassIndex(bufferID), className, &filePath);
+    return filePath;
+  }
+#endif
 
+  bool Lexer::findClassFile(const ClassIndex* scriptDirectoryClassIndex, std::string_view className, std::wstring* filePath) {
     // PapyrusCompiler searches in current directory before searching in import directories.
+    if (scriptDirectoryClassIndex != nullptr && findInClassIndex(*scriptDirectoryClassIndex, scriptDirectoryClassIndex->getDirectories(), className, filePath)) {
+      return true;
+    }
+
+    return findInClassIndex(lexerData->classIndexes[lexerData->currentGame], lexerData->importDirectories[lexerData->currentGame], className, filePath);
+  }
+
+#ifdef _WIN32
+  const ClassIndex* Lexer::getScriptDirectoryClassIndex(npp_buffer_t bufferID) {
     auto currentBufferFilePath = utility::getFilePathFromBuffer(lexerData->nppData._nppHandle, bufferID);
-    if (!currentBufferFilePath.empty()) {
-      std::wstring filePath = std::filesystem::path(currentBufferFilePath).parent_path() / relativePath;
-      if (utility::fileExists(filePath)) {
-        return filePath;
-      }
+    if (currentBufferFilePath.empty()) {
+      return nullptr;
     }
 
-    // Find the relative path in configured import directories.
-    for (const auto& path : lexerData->importDirectories[lexerData->currentGame]) {
-      std::wstring filePath = std::filesystem::path(path) / relativePath;
-      if (utility::fileExists(filePath)) {
-        return filePath;
+    auto directory = std::filesystem::path(currentBufferFilePath).parent_path().wstring();
+    if (directory.empty()) {
+      return nullptr;
+    }
+
+    for (const auto& importDirectory : lexerData->importDirectories[lexerData->currentGame]) {
+      if (utility::compare(normalizeDirectory(importDirectory), directory)) {
+        return nullptr;
       }
     }
 
-    // Not found
-    return std::wstring();
+    // Index is built the first time a script in this directory is lexed. It's removed once no open script is in the directory, which
+    // only happens on the main thread between Lex calls, so returned pointer stays valid for the duration of a Lex call.
+    Lock lock(scriptDirectoryClassIndexesMutex);
+    auto& classIndex = scriptDirectoryClassIndexes[utility::toLower(directory)];
+    if (!classIndex) {
+      classIndex = std::make_unique<ClassIndex>();
+      classIndex->build({directory}, std::wstring(), [] {
+        ::PostMessage(lexerData->messageWindow, PPM_CLASSES_CHANGED, static_cast<WPARAM>(Game::Auto), 0);
+      });
+    }
+    return classIndex.get();
   }
+#else
+  const ClassIndex* Lexer::getScriptDirectoryClassIndex(npp_buffer_t) {
+    // Without Notepad++, documents aren't files, so they don't have a script directory
+    return nullptr;
+  }
+#endif
 
   // Helper class methods
   //
 
   Helper::Helper() {
+    LexerSettings& lexerSettings = const_cast<LexerSettings&>(lexerData->settings);
+
+#ifdef _WIN32
     lexerData->bufferActivated.subscribe([&](auto eventData) {
       if (isUsable()) {
         SavedScintillaSettings& savedScintillaSettings = (eventData.view == MAIN_VIEW) ? savedMainViewScintillaSettings : savedSecondViewScintillaSettings;
@@ -637,7 +1158,6 @@ namespace papyrus {
       }
     });
 
-    LexerSettings& lexerSettings = const_cast<LexerSettings&>(lexerData->settings);
     lexerSettings.enableClassLink.subscribe([&](auto eventData) {
       if (isUsable()) {
         if (getApplicableBufferIdOnView(MAIN_VIEW) != 0) {
@@ -720,6 +1240,13 @@ namespace papyrus {
       handleHotspotClick(eventData.scintillaHandle, eventData.bufferID, eventData.position);
     });
 
+    lexerData->bufferClosed.subscribe([&](auto bufferID) {
+      if (isUsable()) {
+        handleBufferClosed(bufferID);
+      }
+    });
+#endif
+
     lexerSettings.enableFoldMiddle.subscribe([&](auto) { restyleDocument(); });
 
     lexerSettings.enableClassNameCache.subscribe([&](auto eventData) {
@@ -729,20 +1256,41 @@ namespace papyrus {
       }
       restyleDocument();
     });
+
+    lexerSettings.classNameCacheSize.subscribe([&](auto) { updateClassNameCacheSize(); });
+
+    lexerData->classesChanged.subscribe([&](auto game) {
+      if (isUsable()) {
+        handleClassesChanged(game);
+      }
+    });
   }
 
+#ifdef _WIN32
   npp_buffer_t Helper::getApplicableBufferIdOnView(npp_view_t view) const {
     npp_buffer_t viewBufferID = utility::getActiveBufferIdOnView(lexerData->nppData._nppHandle, view);
     return (viewBufferID != 0 && lexerData->scriptLangID == static_cast<npp_lang_type_t>(::SendMessage(lexerData->nppData._nppHandle, NPPM_GETBUFFERLANGTYPE, static_cast<WPARAM>(viewBufferID), 0)) ? viewBufferID : 0);
   }
+#endif
 
   void Helper::restyleDocument() const {
     if (isUsable()) {
+      {
+        // Saved line states are stale after settings change
+        Lock lock(lexerListMutex);
+        for (auto pLexer : lexerList) {
+          pLexer->fullLexRequested = true;
+        }
+      }
+
+#ifdef _WIN32
       restyleDocument(MAIN_VIEW);
       restyleDocument(SUB_VIEW);
+#endif
     }
   }
 
+#ifdef _WIN32
   void Helper::restyleDocument(npp_view_t view) const {
     // Ask Scintilla to restyle current document on the given view, but only when it is using this lexer.
     if (getApplicableBufferIdOnView(view) != 0) {
@@ -750,27 +1298,152 @@ namespace papyrus {
       ::SendMessage(handle, SCI_COLOURISE, 0, -1);
     }
   }
+#endif
 
-  names_cache_t& Helper::getClassNamesForGame(Game game) {
+  NameCache& Helper::getClassNamesForGame(Game game) {
     Lock lock(classNamesMutex);
-    return classNames[game];
+    return classNames.try_emplace(game, lexerData->settings.classNameCacheSize).first->second;
   }
 
-  names_cache_t& Helper::getNonClassNamesForGame(Game game)  {
+  NameCache& Helper::getNonClassNamesForGame(Game game)  {
     Lock lock(nonClassNamesMutex);
-    return nonClassNames[game];
+    return nonClassNames.try_emplace(game, lexerData->settings.classNameCacheSize).first->second;
   }
 
   void Helper::clearClassNames() {
+    // Caches are cleared rather than removed, since a Lex in progress may still be using them
     Lock lock(classNamesMutex);
-    classNames.clear();
+    for (auto& [game, cache] : classNames) {
+      cache.clear();
+    }
   }
 
   void Helper::clearNonClassNames() {
     Lock lock(nonClassNamesMutex);
-    nonClassNames.clear();
+    for (auto& [game, cache] : nonClassNames) {
+      cache.clear();
+    }
+  }
+
+  void Helper::updateClassNameCacheSize() {
+    {
+      Lock lock(classNamesMutex);
+      for (auto& [game, cache] : classNames) {
+        cache.setMaxSize(lexerData->settings.classNameCacheSize);
+      }
+    }
+
+    Lock lock(nonClassNamesMutex);
+    for (auto& [game, cache] : nonClassNames) {
+      cache.setMaxSize(lexerData->settings.classNameCacheSize);
+    }
+  }
+
+#ifdef _WIN32
+  void Helper::handleBufferClosed(npp_buffer_t bufferID) {
+    // Notepad++ also notifies when a cloned buffer is closed on one view while it's still open on the other one
+    if (::SendMessage(lexerData->nppData._nppHandle, NPPM_GETPOSFROMBUFFERID, bufferID, 0) != -1) {
+      return;
+    }
+
+    {
+      Lock lock(scriptNameMapMutex);
+      scriptNameMap.erase(bufferID);
+    }
+
+    // Lexer of a closed buffer is normally released with its document, but in case it's kept, it must not handle events of a new
+    // buffer that gets the same ID. Meanwhile, find directories of scripts still open.
+    std::set<std::wstring> openDirectories;
+    {
+      Lock lock(lexerListMutex);
+      for (auto pLexer : lexerList) {
+        if (pLexer->bufferID == bufferID) {
+          pLexer->bufferID = 0;
+          pLexer->scriptName.clear();
+        } else if (pLexer->bufferID != 0) {
+          auto filePath = utility::getFilePathFromBuffer(lexerData->nppData._nppHandle, pLexer->bufferID);
+          if (!filePath.empty()) {
+            openDirectories.insert(utility::toLower(std::filesystem::path(filePath).parent_path().wstring()));
+          }
+        }
+      }
+    }
+
+    // Stop watching directories no open script is in. Lex isn't running, since this is handled on the main thread as well.
+    Lock lock(scriptDirectoryClassIndexesMutex);
+    std::erase_if(scriptDirectoryClassIndexes, [&](const auto& entry) { return !openDirectories.contains(entry.first); });
+  }
+#endif
+
+  void Helper::handleClassesChanged(Game game) {
+    std::vector<std::string> changedClassNames;
+    bool overflowed = false;
+    auto takeChanges = [&](ClassIndex& classIndex) {
+      auto changes = classIndex.takeChanges();
+      changedClassNames.insert(changedClassNames.end(), changes.classNames.begin(), changes.classNames.end());
+      overflowed |= changes.overflowed;
+    };
+    if (game != Game::Auto) {
+      takeChanges(lexerData->classIndexes[game]);
+    } else {
+      Lock lock(scriptDirectoryClassIndexesMutex);
+      for (auto& [directory, classIndex] : scriptDirectoryClassIndexes) {
+        takeChanges(*classIndex);
+      }
+    }
+    if (changedClassNames.empty() && !overflowed) {
+      return;
+    }
+
+    // Names that were never interned can't be in any cache
+    std::vector<atom_t> changedAtoms;
+    for (const auto& className : changedClassNames) {
+      if (atom_t atom = AtomTable::instance().find(className); atom != AtomTable::NO_ATOM) {
+        changedAtoms.push_back(atom);
+      }
+    }
+
+    // Classes in script directories are cached together with the ones in import directories, so they affect all games
+    {
+      Lock lock(classNamesMutex);
+      for (auto& [cacheGame, cache] : classNames) {
+        if (game == Game::Auto || cacheGame == game) {
+          if (overflowed) {
+            cache.clear();
+          } else {
+            cache.remove(changedAtoms);
+          }
+        }
+      }
+    }
+    {
+      Lock lock(nonClassNamesMutex);
+      for (auto& [cacheGame, cache] : nonClassNames) {
+        if (game == Game::Auto || cacheGame == game) {
+          if (overflowed) {
+            cache.clear();
+          } else {
+            cache.remove(changedAtoms);
+          }
+        }
+      }
+    }
+
+    // Documents are only styled with classes of current game
+    if (game != Game::Auto && game != lexerData->currentGame) {
+      return;
+    }
+
+    Lock lock(lexerListMutex);
+    for (auto pLexer : lexerList) {
+      // When some changes were lost, which classes changed is unknown
+      if (overflowed || pLexer->mayReference(changedClassNames)) {
+        pLexer->restyle();
+      }
+    }
   }
 
+#ifdef _WIN32
   void Helper::handleHotspotClick(HWND handle, npp_buffer_t bufferID, Sci_Position position) const {
     if (isUsable() && lexerData->settings.enableClassLink && lexerData->currentGame != game::Game::Auto) {
       // Change Scintilla word chars to include ':' to support FO4's namespaces.
@@ -802,12 +1475,13 @@ namespace papyrus {
         };
         ::SendMessage(handle, SCI_GETTEXTRANGE, 0, reinterpret_cast<LPARAM>(&textRange));
 
-        std::wstring filePath = getClassFilePath(bufferID, className);
+        std::wstring filePath = getClassFilePath(bufferID, utility::toLower(className));
         if (!filePath.empty()) {
           ::SendMessage(lexerData->nppData._nppHandle, NPPM_DOOPEN, 0, reinterpret_cast<LPARAM>(filePath.c_str()));
         }
       }
     }
   }
+#endif
 
 } // namespace
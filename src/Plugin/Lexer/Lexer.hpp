@@ -22,36 +22,54 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "SimpleLexerBase.hpp"
 
+#include "AtomTable.hpp"
+#include "BlockIndex.hpp"
+#include "DeclarationScanner.hpp"
 #include "LexerData.hpp"
+#include "NameCache.hpp"
+#include "OccurrenceIndex.hpp"
+#include "PropertyTable.hpp"
 
+#include "..\Common\StringUtil.hpp"
+
+#ifdef _WIN32
 #include "..\Common\NotepadPlusPlus.hpp"
+#else
+#include "..\Common\NotepadPlusPlusTypes.hpp"
+#endif
 
 #include "..\..\external\lexilla\Accessor.h"
 #include "..\..\external\lexilla\StyleContext.h"
-#include "..\..\external\lexilla\WordList.h"
 #include "..\..\external\scintilla\ILexer.h"
 
-#include <list>
+#include <atomic>
+#include <memory>
 #include <mutex>
-#include <set>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace papyrus {
 
-  using names_cache_t = std::pair<std::set<std::string>, std::mutex>;
-
   constexpr char LEXER_NAME[] = "Papyrus Script";
+#ifdef _WIN32
   constexpr TCHAR LEXER_STATUS_TEXT[] = L"Papyrus Script"; // Not required anymore, but kept for compatibility with Notepad++ 8.3 - 8.3.3
+#endif
 
   class Lexer : public SimpleLexerBase {
+    friend class LexerBenchmark;
+
     public:
       // A class that helps with management of shared Lexer data, since the handling are all static, and not tied to a specific
       // Lexer instance. For example, restyle currently displayed document, regardless if it's lexed by current Lexer instance.
       class Helper {
         public:
+#ifdef _WIN32
           struct SavedScintillaSettings {
             bool saved {false};
             int hotspotActiveForegroundColor {0};
@@ -59,45 +77,66 @@ namespace papyrus {
             bool hotspotActiveUnderline {false};
             int mouseDwellTime {0};
           };
+#endif
 
           Helper();
 
           // Only when configuration file exists under Notepad++'s plugin config folder can this lexer be used
           inline bool isUsable() const { return (lexerData != nullptr && lexerData->usable); }
 
-          // Get cached class/non-class names for a game
-          names_cache_t& getClassNamesForGame(Game game);
-          names_cache_t& getNonClassNamesForGame(Game game);
+          // Get cached class/non-class names for a game. Returned cache stays valid, so it only needs to be retrieved once per Lex.
+          NameCache& getClassNamesForGame(Game game);
+          NameCache& getNonClassNamesForGame(Game game);
 
         private:
+#ifdef _WIN32
           // Get current buffer ID on the given view, if it's a applicable
           npp_buffer_t getApplicableBufferIdOnView(npp_view_t view) const;
+#endif
 
           // Restyle currently displayed document, which includes Lex and Fold
           void restyleDocument() const;
+#ifdef _WIN32
           void restyleDocument(npp_view_t view) const;
+#endif
 
           // Clear cached class/non-class names
           void clearClassNames();
           void clearNonClassNames();
 
+          // Apply maximum number of cached names to class/non-class names caches
+          void updateClassNameCacheSize();
+
+#ifdef _WIN32
+          // Release what is kept for a buffer once Notepad++ closes it, since buffer IDs may be reused by buffers opened later
+          void handleBufferClosed(npp_buffer_t bufferID);
+#endif
+
+          // Apply classes added to or removed from directories of a game, or of open scripts when game is Auto, to cached names, and
+          // restyle documents that may reference them
+          void handleClassesChanged(Game game);
+
+#ifdef _WIN32
           // Hotspot click handler
           void handleHotspotClick(HWND handle, npp_buffer_t bufferID, Sci_Position position) const;
+#endif
 
           // Private members
           //
 
           // Cached names that are classes (i.e. files in import directories) per each game type, and names that aren't, for better performance.
-          // Caveat: when a new class is saved to the import directory it won't be reflected, so current file needs to be reloaded. This can be
-          // fixed by toggling off this option then toggling it back on in Settings dialog.
+          // Class indexes watch their directories, so names of classes added or removed later are updated in place. Each cache holds a
+          // limited number of names, evicting the least recently used ones. Mutexes only guard the maps, not the caches.
           std::mutex classNamesMutex;
-          std::map<Game, names_cache_t> classNames;
+          std::map<Game, NameCache> classNames;
           std::mutex nonClassNamesMutex;
-          std::map<Game, names_cache_t> nonClassNames;
+          std::map<Game, NameCache> nonClassNames;
 
+#ifdef _WIN32
           // Saved Scintilla settings before we make our own changes, in case some other plugins also change them
           Helper::SavedScintillaSettings savedMainViewScintillaSettings;
           Helper::SavedScintillaSettings savedSecondViewScintillaSettings;
+#endif
       };
 
       Lexer();
@@ -105,7 +144,9 @@ namespace papyrus {
 
       // Interface functions with Notepad++
       inline static char* name() { return const_cast<char*>(LEXER_NAME); }
+#ifdef _WIN32
       inline static TCHAR* statusText() { return const_cast<TCHAR*>(LEXER_STATUS_TEXT); }  // Not required anymore, but kept for compatibility with Notepad++ 8.3 - 8.3.3
+#endif
       inline static ILexer* factory() { return new Lexer(); }
 
       // Assign buffer ID to the latest instantiated lexer instance. This is triggered by NPPN_EXTERNALLEXERBUFFER message from Notepad++.
@@ -114,9 +155,26 @@ namespace papyrus {
       // Utility method to retrieve script name for a given buffer.
       static std::string getScriptName(npp_buffer_t bufferID);
 
+      // Utility method to retrieve the block a fold keyword at given position of a buffer belongs to, from blocks found by Lex.
+      // Returns nothing if there isn't a fold keyword there.
+      static std::optional<BlockIndex::Block> findBlock(npp_buffer_t bufferID, Sci_Position line, Sci_Position column);
+
+      // Same as above, for the document lexed by this lexer, e.g. when it isn't used on a Notepad++ buffer
+      inline std::optional<BlockIndex::Block> findBlock(Sci_Position line, Sci_Position column) { return blockIndex.findBlock(line, column); }
+
+      // Utility method to retrieve occurrences of the identifier at given position of a buffer on lines from firstLine to lastLine, from
+      // identifiers found by Lex. Returns nothing if there isn't an identifier there.
+      static std::vector<OccurrenceIndex::Occurrence> findOccurrences(npp_buffer_t bufferID, Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine);
+
+      // Same as above, for the document lexed by this lexer
+      inline std::vector<OccurrenceIndex::Occurrence> findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) const {
+        return occurrenceIndex.findOccurrences(line, column, firstLine, lastLine);
+      }
+
       // Lexer functions
       void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument* pAccess) override;
       void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument* pAccess) override;
+      Sci_Position SCI_METHOD WordListSet(int n, const char* wl) override;
 
       // Utility method to check whether a style (from StyleContext) is certain style type defined by this lexer
       inline static bool isKeyword(int style) {
@@ -138,9 +196,8 @@ namespace papyrus {
       // Only when configuration file exists under Notepad++'s plugin config folder can this lexer be used
       bool isUsable() const override;
 
-      // Get word lists pointers for instre1 & 2, type1 - 7
-      inline const std::vector<WordList*>& getInstreWordLists() const override { return instreWordLists; }
-      inline const std::vector<WordList*>& getTypeWordLists() const override { return typeWordLists; }
+      // Word lists for instre1 & 2, type1 - 6
+      inline int getWordListSetCount() const override { return 8; }
 
     private:
       // Lexer style states
@@ -164,74 +221,216 @@ namespace papyrus {
         Function
       };
 
-      // Defined properties in current Papyrus script
-      struct Property {
-        std::string name;
-        Sci_Position line;
-        bool needRecheck {false};
-      };
+      // Lexer state at the end of each line is saved in Scintilla's line state, so Lex can resume from any line, and can stop once
+      // a line ends in the same state as recorded last time. Fold keywords found by Lex are kept in block index for Fold to use.
+      static constexpr int LINE_STATE_MASK = 0xFF;    // State at the end of the line
+      static constexpr int LINE_STATE_LEXED = 0x100;  // Line has been lexed by this lexer
+
+      // Keyword table categories, one for each word list
+      static constexpr KeywordTable::category_mask_t CATEGORY_OPERATOR = 1 << 0;      // instre1
+      static constexpr KeywordTable::category_mask_t CATEGORY_FLOW_CONTROL = 1 << 1;  // instre2
+      static constexpr KeywordTable::category_mask_t CATEGORY_TYPE = 1 << 2;          // type1
+      static constexpr KeywordTable::category_mask_t CATEGORY_KEYWORD = 1 << 3;       // type2
+      static constexpr KeywordTable::category_mask_t CATEGORY_KEYWORD2 = 1 << 4;      // type3
+      static constexpr KeywordTable::category_mask_t CATEGORY_FOLD_OPEN = 1 << 5;     // type4
+      static constexpr KeywordTable::category_mask_t CATEGORY_FOLD_MIDDLE = 1 << 6;   // type5
+      static constexpr KeywordTable::category_mask_t CATEGORY_FOLD_CLOSE = 1 << 7;    // type6
 
       enum class TokenType {
         Identifier,
         Numeric,
-        Special
+        Special,
+        Body  // Body of a comment or a string
       };
 
+      // A token only records where it is in the document. Its case-folded text is stored in the lexer's token text buffer, and its
+      // hash is used to look it up in keyword table.
       struct Token {
-        std::string content;
         TokenType tokenType;
         Sci_Position startPos;
+        Sci_Position length;  // In bytes
+        size_t textOffset;    // Offset of case-folded text in token text buffer
+        size_t textLength;
+        uint32_t hash;        // Hash of case-folded text
+      };
+
+      // Splits text lines into tokens. It owns the buffers reused for each line, so that lexing a line doesn't need to allocate memory.
+      class Tokenizer {
+        public:
+          // Parse a text line and tokenize each word/symbol, etc. Returned tokens are valid until next call. Given the state at the start
+          // of the line, body of a comment or a string is returned as a single token, except for DBCS documents.
+          const std::vector<Token>& tokenize(Accessor& accessor, Sci_Position line, State state);
+
+          // Access case-folded text of a token
+          inline std::string_view tokenText(const Token& token) const { return std::string_view(tokenTextBuffer.data() + token.textOffset, token.textLength); }
+          inline bool isToken(const Token& token, std::string_view text) const { return token.hash == utility::hashOf(text) && tokenText(token) == text; }
+
+          // Get a char in the line being lexed
+          inline char lineCharAt(Sci_Position position) const {
+            return (position >= lineTextStart && position - lineTextStart < static_cast<Sci_Position>(lineText.length())) ? lineText[position - lineTextStart] : '\0';
+          }
+
+        private:
+          // Token building helpers used by tokenize
+          Token& beginToken(TokenType tokenType, Sci_Position startPos);
+          void appendToToken(Token& token, char ch);
+          void endToken(Token& token, Sci_Position endPos);
+
+          // Get next character (wide char supported)
+          int getNextChar(Accessor& accessor, Sci_Position& index, Sci_Position& indexNext) const;
+
+          // Private members
+          //
+          std::vector<Token> tokens;
+          std::string tokenTextBuffer;
+          std::string lineText;
+          Sci_Position lineTextStart {0};
       };
 
-      // Parse a text line and tokenize each word/symbol, etc.
-      std::vector<Token> tokenize(Accessor& accessor, Sci_Position line) const;
+      // Counters for measuring lexer performance
+      struct Statistics {
+        uint64_t classNameLookups {0};    // Identifiers checked against class/non-class names caches
+        uint64_t classNameCacheHits {0};  // Identifiers found in either cache, so no class lookup was needed
+      };
 
-      // Colorize a word/symbol in StyleContext to a provided state based on the given token.
-      void colorToken(StyleContext& styleContext, Token token, State state) const;
+      // Data used and collected while lexing a range of lines. Lex uses the lexer's own pass, while parallel lex uses one for each chunk
+      // so that chunks can be lexed on different threads. Only tokenizer and collected data are modified during lexing.
+      struct LexPass {
+        std::shared_ptr<const KeywordTable> keywordTable;
+        const ClassIndex* scriptDirectoryClassIndex {nullptr};
+        DeclarationScanner::declarations_t declarations;
+
+        // Class/non-class names caches of current game, and their snapshots for lookups without locking
+        NameCache* classNamesCache {nullptr};
+        NameCache* nonClassNamesCache {nullptr};
+        NameCache::snapshot_t classNames;
+        NameCache::snapshot_t nonClassNames;
 
-      // Get next character (wide char supported)
-      int getNextChar(Accessor& accessor, Sci_Position& index, Sci_Position& indexNext) const;
+        // Properties defined in current file. Chunks lexed in parallel only look them up, and collect the ones they find with their lines.
+        PropertyTable* properties {nullptr};
+        bool collectProperties {false};
+        std::vector<std::pair<atom_t, Sci_Position>> definedProperties;
 
-      // Check whether a given name is in a names cache
-      bool isNameInCache(const std::string& name, const std::set<std::string>& namesCache, std::mutex& mutex) const;
+        // Full script name found, including namespace, and the line defining it
+        std::string fullScriptName;
+        Sci_Position scriptNameLine {-1};
 
-      // Add a given name to a names cache
-      void addNameToCache(const std::string& name, std::set<std::string>& namesCache, std::mutex& mutex);
+        // Names found that are not in class/non-class names caches yet. They are added to the caches when the pass ends.
+        std::vector<atom_t> pendingClassNames;
+        std::vector<atom_t> pendingNonClassNames;
 
+        // Names checked for being classes
+        NameFilter referencedNames;
+
+        // Fold keywords found on lexed lines, which replace the ones in block index once lexed lines are known
+        std::vector<BlockIndex::Keyword> blockKeywords;
+
+        // Identifiers found on lexed lines, which replace the ones in occurrence index the same way
+        std::vector<OccurrenceIndex::Occurrence> identifiers;
+
+        Statistics statistics;
+        Tokenizer tokenizer;
+      };
+
+      // Prepare a pass for lexing current document, and publish what it collected after lexing. Both are done on the main thread.
+      void beginPass(LexPass& pass);
+      void endPass(LexPass& pass);
+
+      // Lex lines from startLine to endLine, given the state at the start of startLine. When canStopEarly is set, stop at a line after
+      // stopAfterLine that ends in the same line state as the one saved in the document. Returns the line where it stopped, or
+      // endLine + 1.
+      Sci_Position lexLines(LexPass& pass, Accessor& accessor, StyleContext& styleContext, Sci_Position startLine, Sci_Position endLine, State state,
+        bool canStopEarly, Sci_Position stopAfterLine) const;
+
+      // Lex a whole large document by splitting it into chunks of lines that are lexed in parallel, then committing their styles and
+      // line states in order. Returns false if the document isn't worth splitting.
+      bool lexInParallel(IDocument* pAccess, Sci_Position lineCount);
+
+      // Colorize a word/symbol in StyleContext to a provided state based on the given token.
+      void colorToken(StyleContext& styleContext, const Token& token, State state) const;
+
+#ifdef _WIN32
       // Mouse hover handler
       void handleMouseHover(HWND handle, bool hovering, Sci_Position position) const;
 
       // Content change handler. Update property list to make sure it's correct
       void handleContentChange(HWND handle, Sci_Position position, Sci_Position linesAdded);
+#endif
+      void handleLinesChange(Sci_Position line, Sci_Position linesAdded);
+
+      // Whether current document may reference any of given case-folded names as classes
+      bool mayReference(const std::vector<std::string>& names) const;
+
+      // Restyle the whole document, e.g. when classes it references were added or removed
+      void restyle();
+
+      // Declaration scan completion handler. Restyle the document if properties changed, and scan changes made during the scan.
+      void handleDeclarationsScanned();
+
+      // Request a scan of the whole document for declarations, unless a scan is still running
+      void scanDeclarations(IDocument* pAccess);
+
+      // Called on declaration scanner's worker thread. Notify the main thread to handle the scan result.
+      void onDeclarationsScanned() const;
 
       // Try to detect current document's Notepad++ buffer ID
       void detectBufferId();
 
-      // Utility method to retrieve the full path of a class. It supports FO4's namespaces
-      static std::wstring getClassFilePath(npp_buffer_t bufferID, std::string className);
+#ifdef _WIN32
+      // Utility method to retrieve the full path of a class. It supports FO4's namespaces. Class name needs to be case-folded.
+      static std::wstring getClassFilePath(npp_buffer_t bufferID, std::string_view className);
+#endif
+
+      // Find a case-folded class in current script's directory, then in current game's import directories. File path is filled in
+      // when found and filePath is provided.
+      static bool findClassFile(const ClassIndex* scriptDirectoryClassIndex, std::string_view className, std::wstring* filePath = nullptr);
+
+      // Get class index of the directory of a buffer's script, which PapyrusCompiler searches before import directories. Returns
+      // nullptr if the script isn't saved yet, or the directory is an import directory whose classes are in current game's index.
+      static const ClassIndex* getScriptDirectoryClassIndex(npp_buffer_t bufferID);
 
       // Private members
       //
 
-      // Word lists for different function groups
-      WordList wordListOperators;   // instre1
-      WordList wordListFlowControl; // instre2
-      WordList wordListTypes;       // type1
-      WordList wordListKeywords;    // type2
-      WordList wordListKeywords2;   // type3
-      WordList wordListFoldOpen;    // type4
-      WordList wordListFoldMiddle;  // type5
-      WordList wordListFoldClose;   // type6
+      // Properties defined in current file and the lines that define them
+      PropertyTable properties;
+
+      // Fold keywords in current file, paired into blocks
+      BlockIndex blockIndex;
+
+      // Identifiers in current file, for finding occurrences of a name
+      OccurrenceIndex occurrenceIndex;
+
+      // Last line lexed by last Lex, after which Fold can stop early, and whether fold middle setting was enabled when last folded
+      Sci_Position lastLexedLine {-1};
+      std::optional<bool> foldMiddleEnabled;
 
-      // Provide pointers to corresponding word lists to base class
-      const std::vector<WordList*> instreWordLists;
-      const std::vector<WordList*> typeWordLists;
+      // Declarations found by scanning the whole document, used together with properties found by Lex. Since Lex may only style
+      // visible lines, it would otherwise not know about properties declared after them.
+      DeclarationScanner::declarations_t declarations;
+      bool declarationsOutdated {true};
+      std::atomic<npp_buffer_t> scannedBufferID {0};
+      DeclarationScanner declarationScanner {[this] { onDeclarationsScanned(); }};
 
-      // Cache list of lines that define properties
-      std::list<Property> propertyLines;
+      // Document being lexed, so that the lexer can ask Scintilla to restyle it
+      IDocument* document {nullptr};
 
-      // Cache property names defined in current file, for better performance
-      std::set<std::string> propertyNames;
+      // Last line changed since last Lex. Lex can only stop early after passing this line.
+      Sci_Position relexUntilLine {-1};
+
+      // Whether line states can't be trusted, e.g. word lists or settings changed, so that Lex must not stop early until document end
+      bool fullLexRequested {true};
+
+      // Whether property names changed after last Lex, so the next Lex must not stop early
+      bool propertyNamesChanged {false};
+
+      // Names in current document that were checked for being classes, so it only needs to be restyled when those classes change
+      NameFilter referencedNames;
+
+      // Pass used by Lex. It's kept across calls so that its buffers are reused.
+      LexPass lexPass;
+
+      Statistics statistics;
 
       // Current script's name
       std::string scriptName {};
@@ -239,9 +438,15 @@ namespace papyrus {
       // Current document's buffer ID managed by Notepad++
       npp_buffer_t bufferID {0};
 
+      // Whether this lexer isn't used on a Notepad++ buffer, e.g. when benchmarking. Its owner reports content changes directly.
+      bool detached {false};
+
       // Subscriptions
+#ifdef _WIN32
       hover_event_topic_t::subscription_t hoverEventSubscription;
       change_event_topic_t::subscription_t changeEventSubscription;
+#endif
+      declarations_scanned_topic_t::subscription_t declarationsScannedSubscription;
   };
 
 } // namespace
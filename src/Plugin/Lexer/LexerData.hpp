@@ -19,12 +19,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "ClassIndex.hpp"
 #include "LexerSettings.hpp"
 #include "..\Common\Game.hpp"
-#include "..\Common\NotepadPlusPlus.hpp"
 #include "..\Common\Topic.hpp"
 
+#ifdef _WIN32
+#include "..\Common\NotepadPlusPlus.hpp"
+
 #include "..\..\external\npp\PluginInterface.h"
+#else
+#include "..\Common\NotepadPlusPlusTypes.hpp"
+
+#include "..\..\external\scintilla\Sci_Position.h"
+#endif
 
 #include <map>
 #include <memory>
@@ -43,6 +51,8 @@ namespace papyrus {
   };
   using buffer_activated_topic_t = utility::Topic<BufferActivationEventData>;
 
+#ifdef _WIN32
+  // Events that carry a Scintilla window, which only exist when lexer runs in Notepad++
   struct ClickEventData {
     HWND scintillaHandle;
     npp_buffer_t bufferID;
@@ -65,22 +75,45 @@ namespace papyrus {
     Sci_Position linesAdded;
   };
   using change_event_topic_t = utility::Topic<ChangeEventData>;
+#endif
+
+  using buffer_closed_topic_t = utility::Topic<npp_buffer_t>;
+
+  using declarations_scanned_topic_t = utility::Topic<npp_buffer_t>;
+
+  // Game whose import directories had classes added or removed, or Game::Auto for directories of open scripts
+  using classes_changed_topic_t = utility::Topic<Game>;
 
   // Pass data from plugin to lexer, e.g. settings, and event data received from NPP or Scintilla
   struct LexerData {
-    LexerData(const NppData& nppData, const LexerSettings& settings, Game currentGame = Game::Auto, game_import_dirs_t importDirectories = game_import_dirs_t(), bool usable = true)
-      : nppData(nppData), settings(settings), currentGame(currentGame), importDirectories(importDirectories), scriptLangID(0), usable(usable) {
+#ifdef _WIN32
+    LexerData(const NppData& nppData, HWND messageWindow, const LexerSettings& settings, Game currentGame = Game::Auto, game_import_dirs_t importDirectories = game_import_dirs_t(), bool usable = true)
+      : nppData(nppData), messageWindow(messageWindow), settings(settings), currentGame(currentGame), importDirectories(importDirectories), scriptLangID(0), usable(usable) {
     }
 
     const NppData& nppData;
+    HWND messageWindow;  // Plugin's message window, so that lexer's worker threads can post messages to be handled on main thread
+#else
+    // Without Notepad++, e.g. when lexer is benchmarked, lexers are only used on documents their owners create
+    LexerData(const LexerSettings& settings, Game currentGame = Game::Auto, game_import_dirs_t importDirectories = game_import_dirs_t(), bool usable = true)
+      : settings(settings), currentGame(currentGame), importDirectories(importDirectories), scriptLangID(0), usable(usable) {
+    }
+
+#endif
     const LexerSettings& settings;
     Game currentGame;
     game_import_dirs_t importDirectories;
+    std::map<Game, ClassIndex> classIndexes;  // Index of classes in each game's import directories
     npp_lang_type_t scriptLangID;
     buffer_activated_topic_t bufferActivated;
+    buffer_closed_topic_t bufferClosed;
+#ifdef _WIN32
     click_event_topic_t clickEventData;
     hover_event_topic_t hoverEventData;
     change_event_topic_t changeEventData;
+#endif
+    declarations_scanned_topic_t declarationsScanned;
+    classes_changed_topic_t classesChanged;
     bool usable;
   };
 
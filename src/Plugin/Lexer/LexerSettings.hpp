@@ -21,9 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "..\Common\PrimitiveTypeValueMonitor.hpp"
 
+#include <cstdint>
 #include <string>
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+using COLORREF = uint32_t;  // Same layout as Windows, 0x00BBGGRR
+#endif
 
 namespace papyrus {
 
@@ -33,9 +38,12 @@ namespace papyrus {
 
   constexpr int DEFAULT_HOVER_DELAY     = 300;
 
+  constexpr int DEFAULT_CLASS_NAME_CACHE_SIZE = 50000;  // Maximum number of names in each of class and non-class names caches
+
   struct LexerSettings {
     utility::PrimitiveTypeValueMonitor<bool>     enableFoldMiddle;
     utility::PrimitiveTypeValueMonitor<bool>     enableClassNameCache;
+    utility::PrimitiveTypeValueMonitor<int>      classNameCacheSize;
     utility::PrimitiveTypeValueMonitor<bool>     enableClassLink;
     utility::PrimitiveTypeValueMonitor<bool>     classLinkUnderline;
     utility::PrimitiveTypeValueMonitor<COLORREF> classLinkForegroundColor;
@@ -0,0 +1,219 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MemoryDocument.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  MemoryDocument::MemoryDocument(std::string_view text, int codePage)
+    : text(text), codePage(codePage) {
+    clearStyling();
+  }
+
+  Sci_Position MemoryDocument::insertText(Sci_Position position, std::string_view insertedText) {
+    position = std::clamp(position, static_cast<Sci_Position>(0), Length());
+    Sci_Position line = LineFromPosition(position);
+    Sci_Position linesAdded = std::count(insertedText.begin(), insertedText.end(), '\n');
+
+    text.insert(position, insertedText);
+    styles.insert(styles.begin() + position, insertedText.length(), 0);
+
+    // New lines haven't been lexed yet, and inherit fold level of the line they are split from
+    lineStates.insert(lineStates.begin() + line + 1, linesAdded, 0);
+    levels.insert(levels.begin() + line + 1, linesAdded, levels[line]);
+    updateLineStarts();
+
+    endStyled = std::min(endStyled, position);
+    return linesAdded;
+  }
+
+  Sci_Position MemoryDocument::deleteText(Sci_Position position, Sci_Position length) {
+    position = std::clamp(position, static_cast<Sci_Position>(0), Length());
+    length = std::min(length, Length() - position);
+    Sci_Position firstLine = LineFromPosition(position);
+    Sci_Position lastLine = LineFromPosition(position + length);
+
+    text.erase(position, length);
+    styles.erase(styles.begin() + position, styles.begin() + position + length);
+    lineStates.erase(lineStates.begin() + firstLine + 1, lineStates.begin() + lastLine + 1);
+    levels.erase(levels.begin() + firstLine + 1, levels.begin() + lastLine + 1);
+    updateLineStarts();
+
+    endStyled = std::min(endStyled, position);
+    return firstLine - lastLine;
+  }
+
+  void MemoryDocument::clearStyling() {
+    updateLineStarts();
+    styles.assign(text.length(), 0);
+    levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+    lineStates.assign(lineStarts.size(), 0);
+    endStyled = 0;
+    stylingPosition = 0;
+  }
+
+  void SCI_METHOD MemoryDocument::GetCharRange(char* buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+    for (Sci_Position i = 0; i < lengthRetrieve; ++i) {
+      buffer[i] = (position + i >= 0 && position + i < Length()) ? text[position + i] : '\0';
+    }
+  }
+
+  char SCI_METHOD MemoryDocument::StyleAt(Sci_Position position) const {
+    return (position >= 0 && position < Length()) ? styles[position] : 0;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::LineFromPosition(Sci_Position position) const {
+    auto iter = std::upper_bound(lineStarts.begin(), lineStarts.end(), position);
+    return (iter == lineStarts.begin()) ? 0 : static_cast<Sci_Position>(iter - lineStarts.begin()) - 1;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::LineStart(Sci_Position line) const {
+    if (line <= 0) {
+      return 0;
+    }
+    return (line < getLineCount()) ? lineStarts[line] : Length();
+  }
+
+  int SCI_METHOD MemoryDocument::GetLevel(Sci_Position line) const {
+    return (line >= 0 && line < getLineCount()) ? levels[line] : SC_FOLDLEVELBASE;
+  }
+
+  int SCI_METHOD MemoryDocument::SetLevel(Sci_Position line, int level) {
+    if (line >= 0 && line < getLineCount()) {
+      int previousLevel = levels[line];
+      levels[line] = level;
+      return previousLevel;
+    }
+    return SC_FOLDLEVELBASE;
+  }
+
+  int SCI_METHOD MemoryDocument::GetLineState(Sci_Position line) const {
+    return (line >= 0 && line < getLineCount()) ? lineStates[line] : 0;
+  }
+
+  int SCI_METHOD MemoryDocument::SetLineState(Sci_Position line, int state) {
+    if (line >= 0 && line < getLineCount()) {
+      int previousState = lineStates[line];
+      lineStates[line] = state;
+      return previousState;
+    }
+    return 0;
+  }
+
+  void SCI_METHOD MemoryDocument::StartStyling(Sci_Position position) {
+    stylingPosition = endStyled = std::clamp(position, static_cast<Sci_Position>(0), Length());
+  }
+
+  bool SCI_METHOD MemoryDocument::SetStyleFor(Sci_Position length, char style) {
+    length = std::min(length, Length() - stylingPosition);
+    std::fill_n(styles.begin() + stylingPosition, length, style);
+    stylingPosition = endStyled = stylingPosition + length;
+    return true;
+  }
+
+  bool SCI_METHOD MemoryDocument::SetStyles(Sci_Position length, const char* newStyles) {
+    length = std::min(length, Length() - stylingPosition);
+    std::copy_n(newStyles, length, styles.begin() + stylingPosition);
+    stylingPosition = endStyled = stylingPosition + length;
+    return true;
+  }
+
+  void SCI_METHOD MemoryDocument::ChangeLexerState(Sci_Position start, Sci_Position) {
+    endStyled = std::min(endStyled, start);
+  }
+
+  int SCI_METHOD MemoryDocument::GetLineIndentation(Sci_Position line) {
+    int indentation = 0;
+    for (Sci_Position position = LineStart(line); position < Length() && (text[position] == ' ' || text[position] == '\t'); ++position) {
+      indentation = (text[position] == '\t') ? (indentation / 8 + 1) * 8 : indentation + 1;
+    }
+    return indentation;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::LineEnd(Sci_Position line) const {
+    if (line + 1 >= getLineCount()) {
+      return Length();
+    }
+
+    Sci_Position end = lineStarts[line + 1] - 1;  // Line feed
+    if (end > lineStarts[line] && text[end - 1] == '\r') {
+      --end;
+    }
+    return end;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+    Sci_Position position = positionStart;
+    for (; characterOffset > 0 && position < Length(); --characterOffset) {
+      Sci_Position width;
+      GetCharacterAndWidth(position, &width);
+      position += width;
+    }
+    for (; characterOffset < 0 && position > 0; ++characterOffset) {
+      --position;
+      while (codePage == SC_CP_UTF8 && position > 0 && (static_cast<unsigned char>(text[position]) & 0xC0) == 0x80) {
+        --position;
+      }
+    }
+    return (characterOffset == 0) ? position : -1;
+  }
+
+  int SCI_METHOD MemoryDocument::GetCharacterAndWidth(Sci_Position position, Sci_Position* pWidth) const {
+    if (position < 0 || position >= Length()) {
+      if (pWidth != nullptr) {
+        *pWidth = 1;
+      }
+      return 0;
+    }
+
+    unsigned char leadByte = static_cast<unsigned char>(text[position]);
+    int width = 1;
+    int character = leadByte;
+    if (codePage == SC_CP_UTF8 && leadByte >= 0xC0) {
+      width = (leadByte >= 0xF0) ? 4 : (leadByte >= 0xE0) ? 3 : 2;
+      character = leadByte & (0x3F >> (width - 1));
+      for (int i = 1; i < width; ++i) {
+        if (position + i >= Length() || (static_cast<unsigned char>(text[position + i]) & 0xC0) != 0x80) {
+          // Invalid UTF-8 sequence. Treat lead byte as a single byte character.
+          width = 1;
+          character = leadByte;
+          break;
+        }
+        character = (character << 6) | (text[position + i] & 0x3F);
+      }
+    }
+
+    if (pWidth != nullptr) {
+      *pWidth = width;
+    }
+    return character;
+  }
+
+  void MemoryDocument::updateLineStarts() {
+    lineStarts.assign(1, 0);
+    for (size_t i = 0; i < text.length(); ++i) {
+      if (text[i] == '\n') {
+        lineStarts.push_back(static_cast<Sci_Position>(i + 1));
+      }
+    }
+  }
+
+} // namespace
@@ -0,0 +1,94 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>  // Scintilla's Sci_Position.h uses intptr_t without including it
+
+#include "..\..\external\scintilla\ILexer.h"
+#include "..\..\external\scintilla\Scintilla.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // A minimal in-memory implementation of Scintilla's document interface, holding text, styles, fold levels and line states, so that
+  // lexer can be run without a Scintilla window, e.g. for benchmarking. It tracks styled range the same way Scintilla does.
+  // Only UTF-8 and single byte code pages are supported.
+  class MemoryDocument : public Scintilla::IDocument {
+    public:
+      explicit MemoryDocument(std::string_view text, int codePage = SC_CP_UTF8);
+
+      // Insert/delete text. Returns number of lines added (negative if deleted). Styling is invalidated from the changed line, which is
+      // what Scintilla does before asking lexer to restyle.
+      Sci_Position insertText(Sci_Position position, std::string_view text);
+      Sci_Position deleteText(Sci_Position position, Sci_Position length);
+
+      // Forget all styles, levels and line states
+      void clearStyling();
+
+      inline Sci_Position getEndStyled() const noexcept { return endStyled; }
+      inline Sci_Position getLineCount() const noexcept { return static_cast<Sci_Position>(lineStarts.size()); }
+      inline const std::string& getText() const noexcept { return text; }
+      inline const std::vector<char>& getStyles() const noexcept { return styles; }
+
+      // IDocument interface
+      int SCI_METHOD Version() const override { return Scintilla::dvRelease4; }
+      void SCI_METHOD SetErrorStatus(int) override {}
+      Sci_Position SCI_METHOD Length() const override { return static_cast<Sci_Position>(text.length()); }
+      void SCI_METHOD GetCharRange(char* buffer, Sci_Position position, Sci_Position lengthRetrieve) const override;
+      char SCI_METHOD StyleAt(Sci_Position position) const override;
+      Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const override;
+      Sci_Position SCI_METHOD LineStart(Sci_Position line) const override;
+      int SCI_METHOD GetLevel(Sci_Position line) const override;
+      int SCI_METHOD SetLevel(Sci_Position line, int level) override;
+      int SCI_METHOD GetLineState(Sci_Position line) const override;
+      int SCI_METHOD SetLineState(Sci_Position line, int state) override;
+      void SCI_METHOD StartStyling(Sci_Position position) override;
+      bool SCI_METHOD SetStyleFor(Sci_Position length, char style) override;
+      bool SCI_METHOD SetStyles(Sci_Position length, const char* styles) override;
+      void SCI_METHOD DecorationSetCurrentIndicator(int) override {}
+      void SCI_METHOD DecorationFillRange(Sci_Position, int, Sci_Position) override {}
+      void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end) override;
+      int SCI_METHOD CodePage() const override { return codePage; }
+      bool SCI_METHOD IsDBCSLeadByte(char) const override { return false; }
+      const char* SCI_METHOD BufferPointer() override { return text.c_str(); }
+      int SCI_METHOD GetLineIndentation(Sci_Position line) override;
+      Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override;
+      Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const override;
+      int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position* pWidth) const override;
+
+    private:
+      void updateLineStarts();
+
+      // Private members
+      //
+      std::string text;
+      std::vector<char> styles;
+      std::vector<Sci_Position> lineStarts;
+      std::vector<int> levels;
+      std::vector<int> lineStates;
+      Sci_Position endStyled {0};
+      Sci_Position stylingPosition {0};
+      int codePage;
+  };
+
+} // namespace
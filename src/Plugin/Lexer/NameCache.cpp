@@ -0,0 +1,165 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NameCache.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  using Lock = std::lock_guard<std::mutex>;
+
+  NameCache::NameCache(size_t maxSize)
+    : maxSize(std::max(maxSize, static_cast<size_t>(1))) {
+    reset();
+  }
+
+  void NameCache::add(const std::vector<atom_t>& names) {
+    if (names.empty()) {
+      return;
+    }
+
+    Lock lock(writerMutex);
+    auto oldSnapshot = current.load(std::memory_order_relaxed);
+    auto slots = oldSnapshot->slots;
+
+    auto newRecent = std::make_shared<name_map_t>(*oldSnapshot->recent);
+    bool added = false;
+    for (atom_t name : names) {
+      if (name != AtomTable::NO_ATOM && findSlot(*oldSnapshot->base, *newRecent, *slots, name) < 0) {
+        uint32_t slot = allocateSlot(slots, *newRecent);
+        slots->names[slot].store(name, std::memory_order_relaxed);
+        slots->referenced[slot].store(false, std::memory_order_relaxed);
+        newRecent->insert_or_assign(name, slot);
+        added = true;
+      }
+    }
+    if (!added) {
+      return;
+    }
+
+    auto newSnapshot = std::make_shared<Snapshot>();
+    newSnapshot->slots = slots;
+    if (newRecent->size() > std::max(oldSnapshot->base->size() / MERGE_RATIO, MIN_RECENT_SIZE)) {
+      // Drop names whose slots were released while merging, since base set is copied anyway
+      auto newBase = std::make_shared<name_map_t>();
+      newBase->reserve(oldSnapshot->base->size() + newRecent->size());
+      for (const auto& [name, slot] : *oldSnapshot->base) {
+        if (slots->names[slot].load(std::memory_order_relaxed) == name) {
+          newBase->emplace(name, slot);
+        }
+      }
+      for (const auto& [name, slot] : *newRecent) {
+        if (slots->names[slot].load(std::memory_order_relaxed) == name) {
+          newBase->insert_or_assign(name, slot);
+        }
+      }
+      newSnapshot->base = std::move(newBase);
+      newSnapshot->recent = std::make_shared<name_map_t>();
+    } else {
+      newSnapshot->base = oldSnapshot->base;
+      newSnapshot->recent = std::move(newRecent);
+    }
+    current.store(std::move(newSnapshot), std::memory_order_release);
+  }
+
+  void NameCache::remove(const std::vector<atom_t>& names) {
+    Lock lock(writerMutex);
+    auto snapshot = current.load(std::memory_order_relaxed);
+    for (atom_t name : names) {
+      if (auto slot = findSlot(*snapshot->base, *snapshot->recent, *snapshot->slots, name); slot >= 0) {
+        snapshot->slots->names[slot].store(AtomTable::NO_ATOM, std::memory_order_relaxed);
+        freeSlots.push_back(static_cast<uint32_t>(slot));
+      }
+    }
+  }
+
+  void NameCache::clear() {
+    Lock lock(writerMutex);
+    reset();
+  }
+
+  void NameCache::setMaxSize(size_t newMaxSize) {
+    Lock lock(writerMutex);
+    maxSize = std::max(newMaxSize, static_cast<size_t>(1));
+    if (numAllocatedSlots > maxSize) {
+      reset();
+    }
+  }
+
+  // Private methods
+  //
+
+  uint32_t NameCache::allocateSlot(std::shared_ptr<Slots>& slots, name_map_t& recent) {
+    if (!freeSlots.empty()) {
+      uint32_t slot = freeSlots.back();
+      freeSlots.pop_back();
+      return slot;
+    }
+
+    if (numAllocatedSlots == slots->capacity && slots->capacity < maxSize) {
+      // Readers of older snapshots keep using the old slots, so only found names marked there are lost
+      auto newSlots = std::make_shared<Slots>(std::min(std::max(slots->capacity * 2, MIN_SLOTS), maxSize));
+      for (size_t i = 0; i < slots->capacity; ++i) {
+        newSlots->names[i].store(slots->names[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        newSlots->referenced[i].store(slots->referenced[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      }
+      slots = std::move(newSlots);
+    }
+    if (numAllocatedSlots < std::min(slots->capacity, maxSize)) {
+      return static_cast<uint32_t>(numAllocatedSlots++);
+    }
+
+    // All slots are used. Give names found since last sweep a second chance, which takes at most one more round.
+    while (slots->referenced[clockHand].exchange(false, std::memory_order_relaxed)) {
+      clockHand = (clockHand + 1) % numAllocatedSlots;
+    }
+    uint32_t slot = static_cast<uint32_t>(clockHand);
+    clockHand = (clockHand + 1) % numAllocatedSlots;
+
+    atom_t evictedName = slots->names[slot].load(std::memory_order_relaxed);
+    if (auto iter = recent.find(evictedName); iter != recent.end() && iter->second == slot) {
+      recent.erase(iter);
+    }
+    return slot;
+  }
+
+  int64_t NameCache::findSlot(const name_map_t& base, const name_map_t& recent, const Slots& slots, atom_t name) {
+    auto iter = recent.find(name);
+    if (iter == recent.end()) {
+      iter = base.find(name);
+      if (iter == base.end()) {
+        return -1;
+      }
+    }
+    return (slots.names[iter->second].load(std::memory_order_relaxed) == name) ? iter->second : -1;
+  }
+
+  void NameCache::reset() {
+    auto newSnapshot = std::make_shared<Snapshot>();
+    newSnapshot->base = std::make_shared<name_map_t>();
+    newSnapshot->recent = std::make_shared<name_map_t>();
+    newSnapshot->slots = std::make_shared<Slots>(std::min(MIN_SLOTS, maxSize));
+    numAllocatedSlots = 0;
+    freeSlots.clear();
+    clockHand = 0;
+    current.store(std::move(newSnapshot), std::memory_order_release);
+  }
+
+} // namespace
@@ -0,0 +1,164 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AtomTable.hpp"
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace papyrus {
+
+  // A read-mostly set of case-folded names shared by all lexer instances, stored as atoms. Readers take an immutable snapshot, so lookups
+  // never lock, while writers publish a new snapshot with added names. Newly added names go to a small "recent" set that is copied on
+  // each update, and it's merged into the large "base" set once it grows, so the cost of an update doesn't depend on the total number
+  // of names.
+  //
+  // The cache holds at most a given number of names, each one in a slot. Once all slots are used, adding a name evicts one that hasn't
+  // been found since the last time a CLOCK hand swept past its slot. Eviction and removal only release the slot, and lookups check
+  // that the slot still holds the name they found, so neither needs to copy the sets. Released names are dropped from the sets the
+  // next time recent set is merged.
+  class NameCache {
+    public:
+      class Snapshot {
+        public:
+          inline bool contains(atom_t name) const {
+            auto iter = recent->find(name);
+            if (iter == recent->end()) {
+              iter = base->find(name);
+              if (iter == base->end()) {
+                return false;
+              }
+            }
+
+            uint32_t slot = iter->second;
+            if (slots->names[slot].load(std::memory_order_relaxed) != name) {
+              return false;
+            }
+
+            // Only write when needed, so that lexers looking up the same names don't keep invalidating each other's cache lines
+            if (!slots->referenced[slot].load(std::memory_order_relaxed)) {
+              slots->referenced[slot].store(true, std::memory_order_relaxed);
+            }
+            return true;
+          }
+
+        private:
+          friend class NameCache;
+
+          // Name each slot holds, or NO_ATOM if it's free, and whether it was found since CLOCK hand last passed it. Slots are shared by
+          // snapshots, and replaced by a larger copy when more are needed.
+          struct Slots {
+            explicit Slots(size_t capacity)
+              : capacity(capacity), names(std::make_unique<std::atomic<atom_t>[]>(capacity)), referenced(std::make_unique<std::atomic<bool>[]>(capacity)) {}
+
+            const size_t capacity;
+            std::unique_ptr<std::atomic<atom_t>[]> names;
+            std::unique_ptr<std::atomic<bool>[]> referenced;
+          };
+          using name_map_t = std::unordered_map<atom_t, uint32_t>;  // Name to its slot
+
+          std::shared_ptr<const name_map_t> base;
+          std::shared_ptr<const name_map_t> recent;
+          std::shared_ptr<Slots> slots;
+      };
+      using snapshot_t = std::shared_ptr<const Snapshot>;
+
+      explicit NameCache(size_t maxSize);
+
+      // Disable all copy/move constructors/assignment operators
+      NameCache(NameCache&& other) = delete;
+
+      // Get current snapshot. It doesn't reflect names added afterwards, so it should only be held for the duration of a Lex call.
+      inline snapshot_t snapshot() const { return current.load(std::memory_order_acquire); }
+
+      // Add names and publish a new snapshot, evicting least recently found names if the cache is full. Names already in the cache
+      // are ignored.
+      void add(const std::vector<atom_t>& names);
+
+      // Remove names. Names not in the cache are ignored.
+      void remove(const std::vector<atom_t>& names);
+
+      // Remove all names
+      void clear();
+
+      // Change the maximum number of names. Cache is cleared if it already uses more slots than that.
+      void setMaxSize(size_t maxSize);
+
+    private:
+      using name_map_t = Snapshot::name_map_t;
+      using Slots = Snapshot::Slots;
+
+      // Recent set is merged into base set when it's larger than 1/MERGE_RATIO of base set, or MIN_RECENT_SIZE, whichever is larger
+      static constexpr size_t MERGE_RATIO = 8;
+      static constexpr size_t MIN_RECENT_SIZE = 256;
+
+      // Slots are allocated as needed, doubling each time, up to the maximum number of names
+      static constexpr size_t MIN_SLOTS = 1024;
+
+      // Get a slot for a new name, growing or evicting if needed. Names evicted from recent set are erased from it. Requires writer lock.
+      uint32_t allocateSlot(std::shared_ptr<Slots>& slots, name_map_t& recent);
+
+      // Get the slot of a name if the cache holds it, or -1. Requires writer lock.
+      static int64_t findSlot(const name_map_t& base, const name_map_t& recent, const Slots& slots, atom_t name);
+
+      // Replace everything with an empty snapshot. Requires writer lock.
+      void reset();
+
+      // Private members
+      //
+      std::mutex writerMutex;
+      std::atomic<snapshot_t> current;
+
+      // Slot allocation, only accessed by writers
+      size_t maxSize;
+      size_t numAllocatedSlots {0};
+      std::vector<uint32_t> freeSlots;
+      size_t clockHand {0};
+  };
+
+  // A fixed-size Bloom filter of case-folded name hashes, to tell whether a document may reference a name without keeping all names it
+  // references. It can report names that were never added, but never misses ones that were.
+  class NameFilter {
+    public:
+      inline void add(uint32_t nameHash) noexcept {
+        bits.set(nameHash & (SIZE - 1));
+        bits.set(secondIndex(nameHash));
+      }
+
+      inline bool mayContain(uint32_t nameHash) const noexcept { return bits.test(nameHash & (SIZE - 1)) && bits.test(secondIndex(nameHash)); }
+      inline void merge(const NameFilter& other) noexcept { bits |= other.bits; }
+      inline void clear() noexcept { bits.reset(); }
+
+    private:
+      static constexpr size_t SIZE = 4096;
+
+      // Use high bits after mixing, so the two indexes are mostly independent
+      inline static size_t secondIndex(uint32_t nameHash) noexcept { return (nameHash * 0x9E3779B1u) >> 20; }
+
+      std::bitset<SIZE> bits;
+  };
+
+} // namespace
@@ -0,0 +1,278 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OccurrenceIndex.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  void OccurrenceIndex::replaceLines(Sci_Position firstLine, Sci_Position lastLine, const std::vector<Occurrence>& lineOccurrences) {
+    node_index_t before, replaced, after;
+    split(root, firstLine, before, after);
+    split(after, lastLine + 1, replaced, after);
+
+    // Lines usually have the same identifiers after being lexed again
+    std::vector<Occurrence> replacedOccurrences;
+    collect(replaced, replacedOccurrences);
+    if (!std::equal(replacedOccurrences.begin(), replacedOccurrences.end(), lineOccurrences.begin(), lineOccurrences.end(), [](const Occurrence& occurrence1, const Occurrence& occurrence2) {
+      return occurrence1.line == occurrence2.line && occurrence1.column == occurrence2.column && occurrence1.length == occurrence2.length
+        && occurrence1.hash == occurrence2.hash;
+    })) {
+      freeTree(replaced);
+      replaced = NIL;
+      for (const auto& occurrence : lineOccurrences) {
+        replaced = merge(replaced, allocateNode(occurrence));
+      }
+    }
+
+    setRoot(merge(merge(before, replaced), after));
+  }
+
+  void OccurrenceIndex::updateLines(Sci_Position line, Sci_Position linesAdded) {
+    // Separate identifiers on affected lines from identifiers before and after them
+    Sci_Position lastLine = line + std::max(-linesAdded, static_cast<Sci_Position>(0));
+    node_index_t before, affected, after;
+    split(root, line, before, after);
+    split(after, lastLine + 1, affected, after);
+    freeTree(affected);
+
+    // Shift the rest of the identifiers, which is only applied to the root of them for now
+    if (after != NIL && linesAdded != 0) {
+      nodes[after].occurrence.line += linesAdded;
+      nodes[after].delta += linesAdded;
+    }
+
+    setRoot(merge(before, after));
+  }
+
+  void OccurrenceIndex::removeFrom(Sci_Position line) {
+    node_index_t kept, removed;
+    split(root, line, kept, removed);
+    freeTree(removed);
+    setRoot(kept);
+  }
+
+  void OccurrenceIndex::clear() {
+    nodes.clear();
+    freeNodes.clear();
+    postings.clear();
+    root = NIL;
+  }
+
+  std::vector<OccurrenceIndex::Occurrence> OccurrenceIndex::findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) const {
+    // Find the last identifier at or before the position. Pending deltas are added up on the way down rather than pushed down, so
+    // lookups don't change the tree.
+    node_index_t found = NIL;
+    Sci_Position foundLine = 0;
+    Sci_Position delta = 0;
+    for (node_index_t node = root; node != NIL;) {
+      const Node& current = nodes[node];
+      Sci_Position nodeLine = current.occurrence.line + delta;
+      delta += current.delta;
+      if (nodeLine < line || (nodeLine == line && current.occurrence.column <= column)) {
+        found = node;
+        foundLine = nodeLine;
+        node = current.right;
+      } else {
+        node = current.left;
+      }
+    }
+    if (found == NIL || foundLine != line || nodes[found].occurrence.column + nodes[found].occurrence.length <= column) {
+      return {};
+    }
+
+    // A name used on fewer lines than asked for is looked up through its posting list. Otherwise, e.g. a variable used all over a
+    // long script, it's cheaper to visit identifiers on those lines, which come in document order.
+    uint32_t hash = nodes[found].occurrence.hash;
+    const auto& posting = postings.at(hash);
+    std::vector<Occurrence> occurrences;
+    if (posting.size() > static_cast<size_t>(std::max(lastLine - firstLine + 1, static_cast<Sci_Position>(0)))) {
+      collectName(root, 0, hash, firstLine, lastLine, occurrences);
+      return occurrences;
+    }
+
+    for (node_index_t node : posting) {
+      if (Sci_Position nodeLine = lineOf(node); nodeLine >= firstLine && nodeLine <= lastLine) {
+        occurrences.push_back(nodes[node].occurrence);
+        occurrences.back().line = nodeLine;
+      }
+    }
+    std::sort(occurrences.begin(), occurrences.end(), [](const Occurrence& occurrence1, const Occurrence& occurrence2) {
+      return (occurrence1.line != occurrence2.line) ? occurrence1.line < occurrence2.line : occurrence1.column < occurrence2.column;
+    });
+    return occurrences;
+  }
+
+  // Private methods
+  //
+
+  void OccurrenceIndex::pushDown(node_index_t node) {
+    Node& current = nodes[node];
+    if (current.delta != 0) {
+      for (auto child : {current.left, current.right}) {
+        if (child != NIL) {
+          nodes[child].occurrence.line += current.delta;
+          nodes[child].delta += current.delta;
+        }
+      }
+      current.delta = 0;
+    }
+  }
+
+  void OccurrenceIndex::update(node_index_t node) {
+    // Only parent links need to be kept up to date, so lines of nodes in a posting list can be found from their ancestors
+    for (auto child : {nodes[node].left, nodes[node].right}) {
+      if (child != NIL) {
+        nodes[child].parent = node;
+      }
+    }
+  }
+
+  void OccurrenceIndex::split(node_index_t tree, Sci_Position line, node_index_t& left, node_index_t& right) {
+    if (tree == NIL) {
+      left = right = NIL;
+      return;
+    }
+
+    pushDown(tree);
+    if (nodes[tree].occurrence.line < line) {
+      split(nodes[tree].right, line, nodes[tree].right, right);
+      left = tree;
+    } else {
+      split(nodes[tree].left, line, left, nodes[tree].left);
+      right = tree;
+    }
+    update(tree);
+  }
+
+  OccurrenceIndex::node_index_t OccurrenceIndex::merge(node_index_t left, node_index_t right) {
+    if (left == NIL) {
+      return right;
+    }
+    if (right == NIL) {
+      return left;
+    }
+
+    if (nodes[left].priority > nodes[right].priority) {
+      pushDown(left);
+      nodes[left].right = merge(nodes[left].right, right);
+      update(left);
+      return left;
+    } else {
+      pushDown(right);
+      nodes[right].left = merge(left, nodes[right].left);
+      update(right);
+      return right;
+    }
+  }
+
+  void OccurrenceIndex::setRoot(node_index_t tree) {
+    root = tree;
+    if (root != NIL) {
+      nodes[root].parent = NIL;
+    }
+  }
+
+  Sci_Position OccurrenceIndex::lineOf(node_index_t node) const {
+    Sci_Position line = nodes[node].occurrence.line;
+    for (node_index_t ancestor = nodes[node].parent; ancestor != NIL; ancestor = nodes[ancestor].parent) {
+      line += nodes[ancestor].delta;
+    }
+    return line;
+  }
+
+  void OccurrenceIndex::collect(node_index_t tree, std::vector<Occurrence>& result) {
+    if (tree != NIL) {
+      pushDown(tree);
+      collect(nodes[tree].left, result);
+      result.push_back(nodes[tree].occurrence);
+      collect(nodes[tree].right, result);
+    }
+  }
+
+  void OccurrenceIndex::collectName(node_index_t tree, Sci_Position delta, uint32_t hash, Sci_Position firstLine, Sci_Position lastLine, std::vector<Occurrence>& result) const {
+    if (tree != NIL) {
+      const Node& current = nodes[tree];
+      Sci_Position line = current.occurrence.line + delta;
+      if (line >= firstLine) {
+        collectName(current.left, delta + current.delta, hash, firstLine, lastLine, result);
+      }
+      if (line >= firstLine && line <= lastLine && current.occurrence.hash == hash) {
+        result.push_back(current.occurrence);
+        result.back().line = line;
+      }
+      if (line <= lastLine) {
+        collectName(current.right, delta + current.delta, hash, firstLine, lastLine, result);
+      }
+    }
+  }
+
+  OccurrenceIndex::node_index_t OccurrenceIndex::allocateNode(const Occurrence& occurrence) {
+    node_index_t node;
+    if (!freeNodes.empty()) {
+      node = freeNodes.back();
+      freeNodes.pop_back();
+    } else {
+      node = static_cast<node_index_t>(nodes.size());
+      nodes.emplace_back();
+    }
+
+    auto& posting = postings[occurrence.hash];
+    nodes[node] = Node {
+      .occurrence = occurrence,
+      .delta = 0,
+      .priority = nextPriority(),
+      .left = NIL,
+      .right = NIL,
+      .parent = NIL,
+      .postingIndex = static_cast<uint32_t>(posting.size())
+    };
+    posting.push_back(node);
+    return node;
+  }
+
+  void OccurrenceIndex::freeTree(node_index_t tree) {
+    if (tree != NIL) {
+      freeTree(nodes[tree].left);
+      freeTree(nodes[tree].right);
+
+      // Move the last node of the posting list into the freed node's place
+      auto iter = postings.find(nodes[tree].occurrence.hash);
+      auto& posting = iter->second;
+      node_index_t last = posting.back();
+      posting[nodes[tree].postingIndex] = last;
+      nodes[last].postingIndex = nodes[tree].postingIndex;
+      posting.pop_back();
+      if (posting.empty()) {
+        postings.erase(iter);
+      }
+      freeNodes.push_back(tree);
+    }
+  }
+
+  uint32_t OccurrenceIndex::nextPriority() {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+  }
+
+} // namespace
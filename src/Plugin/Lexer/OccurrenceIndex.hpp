@@ -0,0 +1,110 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>  // Scintilla's Sci_Position.h uses intptr_t without including it
+
+#include "..\..\external\scintilla\Sci_Position.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace papyrus {
+
+  // Identifiers of a script found by Lex, i.e. names of properties, variables, functions and classes, but not keywords, comments or
+  // strings, since Lex only records identifiers it styles as code. Like BlockIndex, identifiers are kept in a treap in document order
+  // where shifting all lines after an edit is a pending delta on a subtree, so Lex only replaces identifiers of lines it lexes. Each
+  // name also has a posting list of its nodes, so occurrences of a name are found in O(k log n) for k occurrences, or for names used
+  // more often than that, by visiting only identifiers on the lines asked for, regardless of the size of the document.
+  //
+  // Names are kept as hashes rather than atoms, so identifiers that are typed and deleted again, or only used in this script, leave
+  // nothing behind once their lines are gone. Different names can share a hash, so occurrences need to be checked against the text.
+  class OccurrenceIndex {
+    public:
+      struct Occurrence {
+        Sci_Position line;
+        int32_t column;  // Offset from line start, in bytes
+        int32_t length;  // In bytes
+        uint32_t hash;   // Hash of case-folded identifier, calculated by utility::hashOf
+      };
+
+      // Replace identifiers on lines from firstLine to lastLine with given ones, which are in document order and on those lines
+      void replaceLines(Sci_Position firstLine, Sci_Position lastLine, const std::vector<Occurrence>& lineOccurrences);
+
+      // Update identifiers after lines are added (linesAdded > 0) or deleted (linesAdded < 0) at a line, or the line is changed
+      // (linesAdded == 0). Identifiers on deleted or changed lines are removed, since Lex will add them back if they are still there.
+      void updateLines(Sci_Position line, Sci_Position linesAdded);
+
+      // Remove identifiers on and after a line, e.g. ones left from lines deleted without notifying occurrence index
+      void removeFrom(Sci_Position line);
+
+      // Remove all identifiers
+      void clear();
+
+      // Get occurrences of the identifier at given position on lines from firstLine to lastLine in document order, or nothing if there
+      // isn't an identifier there. Identifiers that only share its hash are included as well.
+      std::vector<Occurrence> findOccurrences(Sci_Position line, Sci_Position column, Sci_Position firstLine, Sci_Position lastLine) const;
+
+      inline size_t size() const noexcept { return nodes.size() - freeNodes.size(); }
+
+    private:
+      using node_index_t = int32_t;
+      static constexpr node_index_t NIL = -1;
+
+      struct Node {
+        Occurrence occurrence;  // Line doesn't include pending deltas of ancestors
+        Sci_Position delta;     // Pending line delta of both subtrees
+        uint32_t priority;
+        node_index_t left;
+        node_index_t right;
+        node_index_t parent;
+        uint32_t postingIndex;  // Index in posting list of its hash
+      };
+
+      // Treap operations. Split puts nodes with line < given line to left tree, and the rest to right tree.
+      void pushDown(node_index_t node);
+      void update(node_index_t node);
+      void split(node_index_t tree, Sci_Position line, node_index_t& left, node_index_t& right);
+      node_index_t merge(node_index_t left, node_index_t right);
+      void setRoot(node_index_t tree);
+
+      // Get line of a node by adding pending deltas of its ancestors
+      Sci_Position lineOf(node_index_t node) const;
+
+      // Get identifiers in a tree, with pending deltas applied
+      void collect(node_index_t tree, std::vector<Occurrence>& result);
+
+      // Get identifiers with a hash on lines from firstLine to lastLine in a tree. Delta is the sum of pending deltas of its ancestors.
+      void collectName(node_index_t tree, Sci_Position delta, uint32_t hash, Sci_Position firstLine, Sci_Position lastLine, std::vector<Occurrence>& result) const;
+
+      node_index_t allocateNode(const Occurrence& occurrence);
+      void freeTree(node_index_t tree);
+      uint32_t nextPriority();
+
+      // Private members
+      //
+      std::vector<Node> nodes;
+      std::vector<node_index_t> freeNodes;
+      std::unordered_map<uint32_t, std::vector<node_index_t>> postings;  // Hash of a name to its nodes
+      node_index_t root {NIL};
+      uint32_t randomState {2463534242u};
+  };
+
+} // namespace
@@ -0,0 +1,245 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PropertyTable.hpp"
+
+#include <algorithm>
+
+namespace papyrus {
+
+  Sci_Position PropertyTable::getLine(atom_t name) const {
+    auto iter = names.find(name);
+    return (iter != names.end()) ? lineOf(iter->second) : -1;
+  }
+
+  bool PropertyTable::define(atom_t name, Sci_Position line) {
+    if (name == AtomTable::NO_ATOM) {
+      return false;
+    }
+
+    auto iter = names.find(name);
+    if (iter != names.end()) {
+      // Lines were added on the line this property was on. If it's found on the same line or after, that's where it is now.
+      node_index_t node = iter->second;
+      if (nodes[node].needRecheck && lineOf(node) >= line) {
+        remove(node);
+        nodes[node].needRecheck = false;
+        insert(node, line);
+      }
+      return false;
+    }
+
+    node_index_t node = allocateNode();
+    names.emplace(name, node);
+    nodes[node].name = name;
+    insert(node, line);
+    return true;
+  }
+
+  bool PropertyTable::updateLines(Sci_Position line, Sci_Position linesAdded) {
+    // Separate properties on affected lines from properties before and after them
+    Sci_Position lastLine = line + std::max(-linesAdded, static_cast<Sci_Position>(0));
+    node_index_t before, affected, after;
+    split(root, line, before, after);
+    split(after, lastLine + 1, affected, after);
+
+    bool removed = false;
+    if (affected != NIL) {
+      std::vector<node_index_t> affectedNodes;
+      collect(affected, affectedNodes);
+      if (linesAdded > 0) {
+        // Since it's not clear if the addition of lines happened before property definition or after, the property defined
+        // on the exact line where changes happened need to be re-checked in Lex.
+        for (auto node : affectedNodes) {
+          nodes[node].needRecheck = true;
+        }
+        after = merge(affected, after);
+      } else {
+        for (auto node : affectedNodes) {
+          names.erase(nodes[node].name);
+          freeNode(node);
+        }
+        removed = true;
+      }
+    }
+
+    // Shift the rest of the properties, which is only applied to the root of them for now
+    if (after != NIL && linesAdded != 0) {
+      nodes[after].line += linesAdded;
+      nodes[after].delta += linesAdded;
+    }
+
+    root = merge(before, after);
+    setParent(root, NIL);
+    return removed;
+  }
+
+  void PropertyTable::clear() {
+    nodes.clear();
+    freeNodes.clear();
+    names.clear();
+    root = NIL;
+  }
+
+  void PropertyTable::pushDown(node_index_t node) {
+    Node& current = nodes[node];
+    if (current.delta != 0) {
+      for (auto child : {current.left, current.right}) {
+        if (child != NIL) {
+          nodes[child].line += current.delta;
+          nodes[child].delta += current.delta;
+        }
+      }
+      current.delta = 0;
+    }
+  }
+
+  void PropertyTable::split(node_index_t tree, Sci_Position line, node_index_t& left, node_index_t& right) {
+    if (tree == NIL) {
+      left = right = NIL;
+      return;
+    }
+
+    pushDown(tree);
+    if (nodes[tree].line < line) {
+      split(nodes[tree].right, line, nodes[tree].right, right);
+      setParent(nodes[tree].right, tree);
+      left = tree;
+    } else {
+      split(nodes[tree].left, line, left, nodes[tree].left);
+      setParent(nodes[tree].left, tree);
+      right = tree;
+    }
+  }
+
+  PropertyTable::node_index_t PropertyTable::merge(node_index_t left, node_index_t right) {
+    if (left == NIL) {
+      return right;
+    }
+    if (right == NIL) {
+      return left;
+    }
+
+    if (nodes[left].priority > nodes[right].priority) {
+      pushDown(left);
+      node_index_t child = merge(nodes[left].right, right);
+      nodes[left].right = child;
+      setParent(child, left);
+      return left;
+    } else {
+      pushDown(right);
+      node_index_t child = merge(left, nodes[right].left);
+      nodes[right].left = child;
+      setParent(child, right);
+      return right;
+    }
+  }
+
+  void PropertyTable::setParent(node_index_t node, node_index_t parent) {
+    if (node != NIL) {
+      nodes[node].parent = parent;
+    }
+  }
+
+  void PropertyTable::insert(node_index_t node, Sci_Position line) {
+    Node& newNode = nodes[node];
+    newNode.line = line;
+    newNode.delta = 0;
+    newNode.left = newNode.right = NIL;
+
+    node_index_t before, after;
+    split(root, line, before, after);
+    root = merge(merge(before, node), after);
+    setParent(root, NIL);
+  }
+
+  void PropertyTable::remove(node_index_t node) {
+    // Separate properties on the same line, then put back all but the removed one
+    Sci_Position line = lineOf(node);
+    node_index_t before, sameLine, after;
+    split(root, line, before, after);
+    split(after, line + 1, sameLine, after);
+
+    std::vector<node_index_t> sameLineNodes;
+    collect(sameLine, sameLineNodes);
+    sameLine = NIL;
+    for (auto sameLineNode : sameLineNodes) {
+      if (sameLineNode != node) {
+        nodes[sameLineNode].left = nodes[sameLineNode].right = NIL;
+        sameLine = merge(sameLine, sameLineNode);
+      }
+    }
+
+    root = merge(merge(before, sameLine), after);
+    setParent(root, NIL);
+  }
+
+  Sci_Position PropertyTable::lineOf(node_index_t node) const {
+    Sci_Position line = nodes[node].line;
+    for (node_index_t parent = nodes[node].parent; parent != NIL; parent = nodes[parent].parent) {
+      line += nodes[parent].delta;
+    }
+    return line;
+  }
+
+  void PropertyTable::collect(node_index_t tree, std::vector<node_index_t>& result) {
+    if (tree != NIL) {
+      pushDown(tree);
+      collect(nodes[tree].left, result);
+      result.push_back(tree);
+      collect(nodes[tree].right, result);
+    }
+  }
+
+  PropertyTable::node_index_t PropertyTable::allocateNode() {
+    node_index_t node;
+    if (!freeNodes.empty()) {
+      node = freeNodes.back();
+      freeNodes.pop_back();
+    } else {
+      node = static_cast<node_index_t>(nodes.size());
+      nodes.emplace_back();
+    }
+
+    nodes[node] = Node {
+      .line = 0,
+      .delta = 0,
+      .priority = nextPriority(),
+      .left = NIL,
+      .right = NIL,
+      .parent = NIL,
+      .name = AtomTable::NO_ATOM,
+      .needRecheck = false
+    };
+    return node;
+  }
+
+  void PropertyTable::freeNode(node_index_t node) {
+    freeNodes.push_back(node);
+  }
+
+  uint32_t PropertyTable::nextPriority() {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+  }
+
+} // namespace
@@ -0,0 +1,98 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AtomTable.hpp"
+
+#include "..\..\external\scintilla\Sci_Position.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace papyrus {
+
+  // Properties defined in a script, indexed by both atom of case-folded name and the line they are defined on. Properties are kept in a treap
+  // ordered by line, where shifting all lines after an edit is recorded as a pending delta on a subtree and only applied when visited,
+  // so handling an edit, looking up a property, or adding one all take O(log n) regardless of number of properties.
+  class PropertyTable {
+    public:
+      // Whether a property name is defined
+      inline bool contains(atom_t name) const { return names.contains(name); }
+
+      // Get the line a property is defined on, or -1 if it's not defined
+      Sci_Position getLine(atom_t name) const;
+
+      // Record a property definition found on a line. Returns true if it's a new property.
+      bool define(atom_t name, Sci_Position line);
+
+      // Update properties after lines are added (linesAdded > 0) or deleted (linesAdded < 0) at a line, or the line is changed
+      // (linesAdded == 0). Properties defined on deleted or changed lines are removed, since Lex will add them back if they are
+      // still there. Returns true if any property is removed.
+      bool updateLines(Sci_Position line, Sci_Position linesAdded);
+
+      // Remove all properties
+      void clear();
+
+      inline size_t size() const noexcept { return names.size(); }
+
+    private:
+      using node_index_t = int32_t;
+      static constexpr node_index_t NIL = -1;
+
+      struct Node {
+        Sci_Position line;    // Line, not including pending deltas of ancestors
+        Sci_Position delta;   // Pending line delta of both subtrees
+        uint32_t priority;
+        node_index_t left;
+        node_index_t right;
+        node_index_t parent;
+        atom_t name;
+        bool needRecheck;     // Lines are added on the line this property is on, so Lex needs to find out where it actually is
+      };
+
+      // Treap operations. Split puts nodes with line < given line to left tree, and the rest to right tree.
+      void pushDown(node_index_t node);
+      void split(node_index_t tree, Sci_Position line, node_index_t& left, node_index_t& right);
+      node_index_t merge(node_index_t left, node_index_t right);
+      void setParent(node_index_t node, node_index_t parent);
+      void insert(node_index_t node, Sci_Position line);
+      void remove(node_index_t node);
+
+      // Get line of a node, including pending deltas of its ancestors
+      Sci_Position lineOf(node_index_t node) const;
+
+      // Get all nodes in a tree, with pending deltas applied
+      void collect(node_index_t tree, std::vector<node_index_t>& result);
+
+      node_index_t allocateNode();
+      void freeNode(node_index_t node);
+      uint32_t nextPriority();
+
+      // Private members
+      //
+      std::vector<Node> nodes;
+      std::vector<node_index_t> freeNodes;
+      node_index_t root {NIL};
+      std::unordered_map<atom_t, node_index_t> names;
+      uint32_t randomState {2463534242u};
+  };
+
+} // namespace
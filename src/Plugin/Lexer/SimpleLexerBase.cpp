@@ -21,47 +21,92 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "..\..\external\lexilla\LexerModule.h"
 
-#include <string>
+#include <algorithm>
+#include <map>
+#include <string_view>
+#include <vector>
 
 namespace papyrus {
 
+  using Lock = std::lock_guard<std::mutex>;
+
   // Internal static variables
   namespace {
     const char subStyleBases[] {0};
+    constexpr char WORD_SEPARATORS[] = " \t\r\n";
   }
 
   Sci_Position SCI_METHOD SimpleLexerBase::WordListSet(int n, const char *wl) {
-    if (isUsable()) {
-      WordList* wordList = nullptr;
-      if (n == 0 || n == 1) {
-        // instre1 and instre2
-        auto lists = getInstreWordLists();
-        if ((size_t)n < lists.size()) {
-          wordList = lists.at(n);
-        }
-      } else if (n < 9) {
-        // type1 - type7
-        n -= 2;
-        auto lists = getTypeWordLists();
-        if ((size_t)n < lists.size()) {
-          wordList = lists.at(n);
-        }
+    if (isUsable() && n >= 0 && n < std::min(getWordListSetCount(), MAX_WORD_LIST_SETS)) {
+      // Same as WordList, words can be separated by any white space and their order doesn't matter
+      std::vector<std::string_view> words;
+      std::string_view list(wl != nullptr ? wl : "");
+      for (size_t start = list.find_first_not_of(WORD_SEPARATORS); start != std::string_view::npos; ) {
+        size_t end = std::min(list.find_first_of(WORD_SEPARATORS, start), list.length());
+        words.push_back(list.substr(start, end - start));
+        start = list.find_first_not_of(WORD_SEPARATORS, end);
       }
+      std::sort(words.begin(), words.end());
 
-      if (wordList != nullptr) {
-        WordList newList;
-        newList.Set(wl);
-        if (newList != *wordList) {
-          wordList->Set(wl);
-          return 0;
+      std::string wordList;
+      for (auto word : words) {
+        if (!wordList.empty()) {
+          wordList += ' ';
         }
+        wordList += word;
+      }
+
+      if (wordList != keywords->wordLists[n]) {
+        word_lists_t wordLists = keywords->wordLists;
+        wordLists[n] = std::move(wordList);
+        keywords = getSharedKeywords(wordLists);
+        return 0;
       }
     }
     return -1;
   }
 
+  std::shared_ptr<const KeywordTable> SimpleLexerBase::getKeywordTable() const {
+    std::call_once(keywords->keywordTableBuilt, [&] {
+      for (int n = 0; n < MAX_WORD_LIST_SETS; ++n) {
+        std::string_view wordList = keywords->wordLists[n];
+        for (size_t start = 0; start < wordList.length(); ) {
+          size_t end = std::min(wordList.find(' ', start), wordList.length());
+          keywords->keywordTable.add(wordList.substr(start, end - start), 1 << n);
+          start = end + 1;
+        }
+      }
+      keywords->keywordTable.build();
+    });
+
+    // Share ownership of the keywords, so the table lives as long as it's held
+    return std::shared_ptr<const KeywordTable>(keywords, &keywords->keywordTable);
+  }
+
   const char * SCI_METHOD SimpleLexerBase::GetSubStyleBases() {
     return subStyleBases;
   }
 
+  // Private methods
+  //
+
+  std::shared_ptr<SimpleLexerBase::SharedKeywords> SimpleLexerBase::getSharedKeywords(const word_lists_t& wordLists) {
+    // Only keep track of keywords in use, so ones left behind by configuration changes are freed
+    static std::mutex sharedKeywordsMutex;
+    static std::map<word_lists_t, std::weak_ptr<SharedKeywords>> sharedKeywordsMap;
+
+    Lock lock(sharedKeywordsMutex);
+    std::erase_if(sharedKeywordsMap, [](const auto& entry) { return entry.second.expired(); });
+    if (auto iter = sharedKeywordsMap.find(wordLists); iter != sharedKeywordsMap.end()) {
+      if (auto keywords = iter->second.lock()) {
+        return keywords;
+      }
+    }
+
+    auto keywords = std::make_shared<SharedKeywords>();
+    keywords->wordLists = wordLists;
+    sharedKeywordsMap.insert_or_assign(wordLists, keywords);
+    return keywords;
+  }
+
 } // namespace
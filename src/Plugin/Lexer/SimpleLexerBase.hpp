@@ -19,14 +19,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "KeywordTable.hpp"
+
 #include "..\..\external\lexilla\Accessor.h"
-#include "..\..\external\lexilla\WordList.h"
 #include "..\..\external\scintilla\ILexer.h"
 #include "..\..\external\scintilla\Scintilla.h"
 
-#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace papyrus {
 
@@ -37,7 +43,7 @@ namespace papyrus {
 
   class SimpleLexerBase : public ILexer {
     public:
-      inline SimpleLexerBase(const char* name, int id) : name(name), id(id) {}
+      inline SimpleLexerBase(const char* name, int id) : name(name), id(id), keywords(getSharedKeywords({})) {}
       SimpleLexerBase() = delete;
 
       inline virtual ~SimpleLexerBase() {}
@@ -78,15 +84,36 @@ namespace papyrus {
       // Whether current lexer is usable.
       inline virtual bool isUsable() const { return true; }
 
-      // A list of WordList pointers for instre1 & 2. If not all instre word lists are supported, just return a partial list (e.g. empty). If a list is skipped, use nullptr.
-      virtual const std::vector<WordList*>& getInstreWordLists() const = 0;
+      // Number of word list sets supported, as passed to WordListSet. instre1 and instre2 are word list set 0 and 1, while type1 - type7
+      // are 2 - 8, so e.g. a lexer supporting instre1 - 2 and type1 - 4 returns 6.
+      virtual int getWordListSetCount() const = 0;
 
-      // A list of WordList pointers for type1 - 7. If not all instre word lists are supported, just return a partial list (e.g. type1 - 4). If a list is skipped, use nullptr.
-      virtual const std::vector<WordList*>& getTypeWordLists() const = 0;
+      // A keyword table built from all word lists. Words in word list set n (as passed to WordListSet) have category bit n set. Lexers
+      // with the same word lists share the same immutable table, which is replaced as a whole when any word list changes, so it stays
+      // valid for whoever holds it.
+      std::shared_ptr<const KeywordTable> getKeywordTable() const;
 
     private:
+      static constexpr int MAX_WORD_LIST_SETS = 9;
+
+      // Word lists with words separated by a single space, and the keyword table built from them on first use. Notepad++ creates a
+      // lexer for each buffer and sets the same word lists on all of them, so they share one copy.
+      using word_lists_t = std::array<std::string, MAX_WORD_LIST_SETS>;
+      struct SharedKeywords {
+        word_lists_t wordLists;
+        std::once_flag keywordTableBuilt;
+        KeywordTable keywordTable;
+      };
+
+      // Get shared keywords of given word lists, creating them if no lexer is using them
+      static std::shared_ptr<SharedKeywords> getSharedKeywords(const word_lists_t& wordLists);
+
+      // Private members
+      //
       const char* const name;
       const int id;
+
+      std::shared_ptr<SharedKeywords> keywords;
   };
 
 } // namespace
@@ -0,0 +1,488 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SymbolDatabase.hpp"
+
+#include "ClassIndex.hpp"
+#include "DeclarationScanner.hpp"
+
+#include "..\Common\StringUtil.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <unordered_set>
+
+namespace papyrus {
+
+  // File starts with a header, followed by directories, script records, symbol records, hash table of class names, and string pool.
+  // Offsets are from the start of file, and all sections are 8-byte aligned so records can be used in place.
+  struct SymbolDatabase::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t generation;
+    uint32_t fileSize;
+    uint32_t directoryCount;
+    uint32_t directoriesOffset;
+    uint32_t scriptCount;
+    uint32_t scriptsOffset;
+    uint32_t symbolCount;
+    uint32_t symbolsOffset;
+    uint32_t bucketCount;    // Power of 2
+    uint32_t bucketsOffset;  // Each bucket has index of a script + 1, or 0 if it's empty
+    uint32_t stringsOffset;
+    uint32_t stringsSize;
+  };
+
+  struct SymbolDatabase::StringRef {
+    uint32_t offset;  // In string pool
+    uint32_t length;
+  };
+
+  struct SymbolDatabase::ScriptRecord {
+    StringRef className;
+    StringRef parentName;
+    StringRef filePath;
+    int64_t lastWriteTime;
+    uint64_t fileSize;
+    uint32_t firstSymbol;
+    uint32_t symbolCount;
+  };
+
+  struct SymbolDatabase::SymbolRecord {
+    StringRef name;
+    StringRef signature;
+    uint32_t line;
+    SymbolKind kind;
+  };
+
+  namespace {
+    constexpr uint32_t MAGIC = 0x42445350;  // "PSDB"
+    constexpr size_t ALIGNMENT = 8;
+
+    inline size_t align(size_t offset) {
+      return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    // Check whether an array of given number of elements at given offset is within file
+    inline bool isInFile(size_t fileSize, uint32_t offset, uint32_t count, size_t elementSize) {
+      return offset % ALIGNMENT == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+    }
+
+    inline std::string toUtf8(const std::filesystem::path& path) {
+      auto u8Path = path.u8string();
+      return std::string(u8Path.begin(), u8Path.end());
+    }
+
+    inline bool isIdentifier(std::string_view token) {
+      return !token.empty() && (std::isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_');
+    }
+  }
+
+  // Collect records of a new database and write them to a file
+  class SymbolDatabase::Builder {
+    public:
+      void addDirectory(const std::wstring& directory) {
+        directories.push_back(addString(toUtf8(directory)));
+      }
+
+      void addScript(std::string_view className, std::string_view filePath, int64_t lastWriteTime, uint64_t fileSize) {
+        scripts.push_back(ScriptRecord {
+          .className = addString(className),
+          .parentName = StringRef(),
+          .filePath = addString(filePath),
+          .lastWriteTime = lastWriteTime,
+          .fileSize = fileSize,
+          .firstSymbol = static_cast<uint32_t>(symbols.size()),
+          .symbolCount = 0
+        });
+      }
+
+      void addSymbol(SymbolKind kind, std::string_view name, std::string_view signature, size_t line) {
+        symbols.push_back(SymbolRecord {
+          .name = addString(name),
+          .signature = addString(signature),
+          .line = static_cast<uint32_t>(line),
+          .kind = kind
+        });
+        scripts.back().symbolCount++;
+      }
+
+      // Copy a script and its symbols from another database
+      void copyScript(const SymbolDatabase& database, const Script& script) {
+        addScript(script.className, script.filePath, script.lastWriteTime, script.fileSize);
+        scripts.back().parentName = addString(script.parentName);
+        for (size_t i = script.firstSymbol; i < script.firstSymbol + script.symbolCount; ++i) {
+          auto symbol = database.getSymbol(i);
+          addSymbol(symbol.kind, symbol.name, symbol.signature, symbol.line);
+        }
+      }
+
+      // Parse text of the script added last for the class it extends and symbols it defines
+      void parseScript(std::string_view text);
+
+      bool write(const std::wstring& filePath, uint32_t generation) const;
+
+      inline size_t scriptCount() const noexcept { return scripts.size(); }
+
+    private:
+      StringRef addString(std::string_view str) {
+        StringRef ref {static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size())};
+        strings.append(str);
+        return ref;
+      }
+
+      // Private members
+      //
+      std::vector<StringRef> directories;
+      std::vector<ScriptRecord> scripts;
+      std::vector<SymbolRecord> symbols;
+      std::string strings;
+  };
+
+  void SymbolDatabase::Builder::parseScript(std::string_view text) {
+    std::string foldedText = utility::toLower(std::string(text));
+    bool inState = false;
+    bool inPropertyBlock = false;
+    DeclarationScanner::forEachStatement(foldedText, [&](const std::vector<std::string_view>& tokens, size_t line) {
+      // Signature is the statement as written, with whitespace between tokens collapsed
+      auto getSignature = [&]() {
+        std::string signature;
+        size_t end = 0;
+        for (auto token : tokens) {
+          size_t offset = token.data() - foldedText.data();
+          if (!signature.empty() && offset > end) {
+            signature.push_back(' ');
+          }
+          signature.append(text.substr(offset, token.size()));
+          end = offset + token.size();
+        }
+        return signature;
+      };
+
+      auto first = tokens[0];
+      if (first == "scriptname") {
+        if (tokens.size() > 3 && tokens[2] == "extends" && isIdentifier(tokens[3])) {
+          scripts.back().parentName = addString(tokens[3]);
+        }
+        return;
+      }
+
+      // Functions and events in states override those in the empty state, and functions in full properties are accessors, so only
+      // record what the script exposes
+      if (first == "state" || (first == "auto" && tokens.size() > 1 && tokens[1] == "state")) {
+        inState = true;
+        return;
+      } else if (first == "endstate") {
+        inState = false;
+        return;
+      } else if (first == "endproperty") {
+        inPropertyBlock = false;
+        return;
+      } else if (inState || inPropertyBlock) {
+        return;
+      }
+
+      if (first == "struct") {
+        if (tokens.size() > 1 && isIdentifier(tokens[1])) {
+          addSymbol(SymbolKind::Struct, tokens[1], getSignature(), line);
+        }
+        return;
+      }
+
+      if (first == "event") {
+        // Remote events are declared as "Event <type>.<name>(...)", so the name is the last identifier before "("
+        auto iter = std::find(tokens.begin(), tokens.end(), std::string_view("("));
+        if (iter != tokens.begin() + 1 && isIdentifier(*std::prev(iter))) {
+          addSymbol(SymbolKind::Event, *std::prev(iter), getSignature(), line);
+        }
+        return;
+      }
+
+      // Function and property may be preceded by a type: "[<type>[[]]] Function <name>(...)", "<type>[[]] Property <name>"
+      size_t index = 0;
+      if (isIdentifier(first) && first != "function" && first != "property") {
+        index = (tokens.size() > 2 && tokens[1] == "[" && tokens[2] == "]") ? 3 : 1;
+      }
+      if (index + 1 < tokens.size() && isIdentifier(tokens[index + 1])) {
+        if (tokens[index] == "function") {
+          addSymbol(SymbolKind::Function, tokens[index + 1], getSignature(), line);
+        } else if (tokens[index] == "property") {
+          addSymbol(SymbolKind::Property, tokens[index + 1], getSignature(), line);
+
+          // Auto properties don't have a body ending with "EndProperty"
+          inPropertyBlock = std::none_of(tokens.begin() + index + 2, tokens.end(), [](std::string_view token) { return token == "auto" || token == "autoreadonly"; });
+        }
+      }
+    });
+  }
+
+  bool SymbolDatabase::Builder::write(const std::wstring& filePath, uint32_t generation) const {
+    size_t directoriesOffset = align(sizeof(Header));
+    size_t scriptsOffset = align(directoriesOffset + directories.size() * sizeof(StringRef));
+    size_t symbolsOffset = align(scriptsOffset + scripts.size() * sizeof(ScriptRecord));
+    size_t bucketsOffset = align(symbolsOffset + symbols.size() * sizeof(SymbolRecord));
+    size_t bucketCount = std::bit_ceil(std::max<size_t>(scripts.size() * 2, 1));
+    size_t stringsOffset = align(bucketsOffset + bucketCount * sizeof(uint32_t));
+    size_t fileSize = stringsOffset + strings.size();
+    if (fileSize > UINT32_MAX) {
+      return false;
+    }
+
+    // Open addressing with linear probing, with at most half of buckets used
+    std::vector<uint32_t> buckets(bucketCount);
+    size_t mask = bucketCount - 1;
+    for (size_t i = 0; i < scripts.size(); ++i) {
+      const auto& className = scripts[i].className;
+      size_t bucket = utility::hashOf(std::string_view(strings).substr(className.offset, className.length)) & mask;
+      while (buckets[bucket] != 0) {
+        bucket = (bucket + 1) & mask;
+      }
+      buckets[bucket] = static_cast<uint32_t>(i + 1);
+    }
+
+    Header header {
+      .magic = 0,  // Written last, so a partially written file is never taken as valid
+      .version = VERSION,
+      .generation = generation,
+      .fileSize = static_cast<uint32_t>(fileSize),
+      .directoryCount = static_cast<uint32_t>(directories.size()),
+      .directoriesOffset = static_cast<uint32_t>(directoriesOffset),
+      .scriptCount = static_cast<uint32_t>(scripts.size()),
+      .scriptsOffset = static_cast<uint32_t>(scriptsOffset),
+      .symbolCount = static_cast<uint32_t>(symbols.size()),
+      .symbolsOffset = static_cast<uint32_t>(symbolsOffset),
+      .bucketCount = static_cast<uint32_t>(bucketCount),
+      .bucketsOffset = static_cast<uint32_t>(bucketsOffset),
+      .stringsOffset = static_cast<uint32_t>(stringsOffset),
+      .stringsSize = static_cast<uint32_t>(strings.size())
+    };
+
+    std::string buffer(fileSize, '\0');
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    std::memcpy(buffer.data() + directoriesOffset, directories.data(), directories.size() * sizeof(StringRef));
+    std::memcpy(buffer.data() + scriptsOffset, scripts.data(), scripts.size() * sizeof(ScriptRecord));
+    std::memcpy(buffer.data() + symbolsOffset, symbols.data(), symbols.size() * sizeof(SymbolRecord));
+    std::memcpy(buffer.data() + bucketsOffset, buckets.data(), buckets.size() * sizeof(uint32_t));
+    std::memcpy(buffer.data() + stringsOffset, strings.data(), strings.size());
+
+    // Fails if the file is still mapped by a database in use
+    std::ofstream stream(std::filesystem::path(filePath), std::ios::binary | std::ios::trunc);
+    if (!stream) {
+      return false;
+    }
+    stream.write(buffer.data(), buffer.size());
+    stream.flush();
+    stream.seekp(0);
+    stream.write(reinterpret_cast<const char*>(&MAGIC), sizeof(MAGIC));
+    stream.close();
+    return !stream.fail();
+  }
+
+  SymbolDatabase::SymbolDatabase(std::unique_ptr<utility::MappedFile>&& file, const Header* header, int slot)
+    : file(std::move(file)), header(header), strings(this->file->contents().substr(header->stringsOffset, header->stringsSize)), generation(header->generation), slot(slot) {
+  }
+
+  std::shared_ptr<const SymbolDatabase> SymbolDatabase::open(const std::wstring& filePath) {
+    auto first = openSlot(filePath, 0);
+    auto second = openSlot(filePath, 1);
+    return (!first || (second && second->generation > first->generation)) ? second : first;
+  }
+
+  std::shared_ptr<const SymbolDatabase> SymbolDatabase::update(std::stop_token stopToken, const std::wstring& filePath, const std::vector<std::wstring>& directories, std::shared_ptr<const SymbolDatabase> previous) {
+    Builder builder;
+    for (const auto& directory : directories) {
+      builder.addDirectory(directory);
+    }
+
+    std::unordered_set<std::string> classNames;
+    size_t reusedCount = 0;
+    for (const auto& directory : directories) {
+      std::error_code errorCode;
+      auto iter = std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, errorCode);
+      for (; !errorCode && iter != std::filesystem::recursive_directory_iterator(); iter.increment(errorCode)) {
+        if (stopToken.stop_requested()) {
+          return nullptr;
+        }
+
+        // Same as the compiler, if multiple directories have the same class, the first one wins
+        std::error_code fileErrorCode;
+        if (!iter->is_regular_file(fileErrorCode)) {
+          continue;
+        }
+        auto className = ClassIndex::getClassName(iter->path().lexically_relative(directory));
+        if (className.empty() || !classNames.insert(className).second) {
+          continue;
+        }
+
+        // Directory iteration already has modification time and size on Windows, so unchanged scripts are not even opened
+        auto scriptPath = toUtf8(iter->path());
+        int64_t lastWriteTime = iter->last_write_time(fileErrorCode).time_since_epoch().count();
+        uint64_t fileSize = iter->file_size(fileErrorCode);
+        if (fileErrorCode) {
+          continue;
+        }
+
+        if (previous) {
+          auto script = previous->findScript(className);
+          if (script && script->filePath == scriptPath && script->lastWriteTime == lastWriteTime && script->fileSize == fileSize) {
+            builder.copyScript(*previous, *script);
+            reusedCount++;
+            continue;
+          }
+        }
+
+        builder.addScript(className, scriptPath, lastWriteTime, fileSize);
+        std::ifstream stream(iter->path(), std::ios::binary);
+        builder.parseScript(std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+      }
+    }
+
+    if (previous && reusedCount == previous->scriptCount() && builder.scriptCount() == reusedCount && previous->isBuiltFrom(directories)) {
+      return previous;
+    }
+
+    // Write to the file not used by previous database, so it stays valid until the new one is complete
+    int newSlot = previous ? 1 - previous->slot : 0;
+    if (!builder.write(getSlotPath(filePath, newSlot), previous ? previous->generation + 1 : 1)) {
+      return nullptr;
+    }
+    return openSlot(filePath, newSlot);
+  }
+
+  bool SymbolDatabase::isBuiltFrom(const std::vector<std::wstring>& directories) const {
+    if (directories.size() != header->directoryCount) {
+      return false;
+    }
+
+    auto refs = reinterpret_cast<const StringRef*>(file->data() + header->directoriesOffset);
+    for (size_t i = 0; i < directories.size(); ++i) {
+      if (getString(refs[i]) != toUtf8(directories[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::optional<SymbolDatabase::Script> SymbolDatabase::findScript(std::string_view className) const {
+    auto buckets = reinterpret_cast<const uint32_t*>(file->data() + header->bucketsOffset);
+    size_t mask = header->bucketCount - 1;
+    size_t bucket = utility::hashOf(className) & mask;
+    for (size_t probes = 0; probes < header->bucketCount && buckets[bucket] != 0; ++probes) {
+      size_t index = buckets[bucket] - 1;
+      if (index < header->scriptCount && getString(getScriptRecord(index).className) == className) {
+        return getScript(index);
+      }
+      bucket = (bucket + 1) & mask;
+    }
+    return std::nullopt;
+  }
+
+  std::optional<SymbolDatabase::Symbol> SymbolDatabase::findSymbol(const Script& script, std::string_view name) const {
+    for (size_t i = script.firstSymbol; i < script.firstSymbol + script.symbolCount; ++i) {
+      if (getString(getSymbolRecord(i).name) == name) {
+        return getSymbol(i);
+      }
+    }
+    return std::nullopt;
+  }
+
+  SymbolDatabase::Script SymbolDatabase::getScript(size_t index) const {
+    const auto& record = getScriptRecord(index);
+
+    // Don't trust symbol range in file, so a corrupted file can't cause reading beyond mapped memory
+    uint32_t firstSymbol = std::min(record.firstSymbol, header->symbolCount);
+    return Script {
+      .className = getString(record.className),
+      .parentName = getString(record.parentName),
+      .filePath = getString(record.filePath),
+      .lastWriteTime = record.lastWriteTime,
+      .fileSize = record.fileSize,
+      .firstSymbol = firstSymbol,
+      .symbolCount = std::min(record.symbolCount, header->symbolCount - firstSymbol)
+    };
+  }
+
+  SymbolDatabase::Symbol SymbolDatabase::getSymbol(size_t index) const {
+    const auto& record = getSymbolRecord(index);
+    return Symbol {
+      .kind = record.kind,
+      .name = getString(record.name),
+      .signature = getString(record.signature),
+      .line = record.line
+    };
+  }
+
+  size_t SymbolDatabase::scriptCount() const noexcept {
+    return header->scriptCount;
+  }
+
+  size_t SymbolDatabase::symbolCount() const noexcept {
+    return header->symbolCount;
+  }
+
+  // Private methods
+  //
+
+  std::shared_ptr<const SymbolDatabase> SymbolDatabase::openSlot(const std::wstring& filePath, int slot) {
+    auto file = std::make_unique<utility::MappedFile>(getSlotPath(filePath, slot));
+    if (!file->isValid() || file->size() < sizeof(Header)) {
+      return nullptr;
+    }
+
+    // Only check header, so opening takes constant time. Records are bounds-checked when used.
+    auto header = reinterpret_cast<const Header*>(file->data());
+    size_t fileSize = file->size();
+    if (header->magic != MAGIC || header->version != VERSION || header->fileSize != fileSize
+      || !isInFile(fileSize, header->directoriesOffset, header->directoryCount, sizeof(StringRef))
+      || !isInFile(fileSize, header->scriptsOffset, header->scriptCount, sizeof(ScriptRecord))
+      || !isInFile(fileSize, header->symbolsOffset, header->symbolCount, sizeof(SymbolRecord))
+      || !std::has_single_bit(header->bucketCount) || !isInFile(fileSize, header->bucketsOffset, header->bucketCount, sizeof(uint32_t))
+      || header->stringsOffset > fileSize || header->stringsSize > fileSize - header->stringsOffset) {
+      return nullptr;
+    }
+
+    return std::shared_ptr<const SymbolDatabase>(new SymbolDatabase(std::move(file), header, slot));
+  }
+
+  std::wstring SymbolDatabase::getSlotPath(const std::wstring& filePath, int slot) {
+    return filePath + L"." + std::to_wstring(slot);
+  }
+
+  std::string_view SymbolDatabase::getString(const StringRef& ref) const noexcept {
+    if (ref.offset > strings.size() || ref.length > strings.size() - ref.offset) {
+      return std::string_view();
+    }
+    return strings.substr(ref.offset, ref.length);
+  }
+
+  const SymbolDatabase::ScriptRecord& SymbolDatabase::getScriptRecord(size_t index) const noexcept {
+    return reinterpret_cast<const ScriptRecord*>(file->data() + header->scriptsOffset)[index];
+  }
+
+  const SymbolDatabase::SymbolRecord& SymbolDatabase::getSymbolRecord(size_t index) const noexcept {
+    return reinterpret_cast<const SymbolRecord*>(file->data() + header->symbolsOffset)[index];
+  }
+
+} // namespace
@@ -0,0 +1,126 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "..\Common\MappedFile.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // Kinds of symbols recorded for a script
+  enum class SymbolKind : uint32_t {
+    Function,
+    Event,
+    Property,
+    Struct
+  };
+
+  // A persistent database of all scripts under a list of directories, e.g. a game's import directories. For each script it records the
+  // class, the class it extends, and functions, events, properties and structs defined in it, along with their signatures and lines.
+  //
+  // The database file is memory-mapped read-only, so opening it takes constant time regardless of its size, and lookups return views
+  // into the mapped file without copying. Updating it only parses scripts whose modification time or size changed, and writes a new
+  // file. Two files are used in turn, so that a new database can be written while the previous one is still mapped and in use. The
+  // one with the later generation is opened.
+  //
+  // Class and symbol names are case-folded, same as ClassIndex. Signatures are as written in scripts, with continued lines joined.
+  //
+  class SymbolDatabase {
+    public:
+      struct Script {
+        std::string_view className;
+        std::string_view parentName;  // Empty if the class doesn't extend another one
+        std::string_view filePath;    // UTF-8
+        int64_t lastWriteTime;
+        uint64_t fileSize;
+        uint32_t firstSymbol;
+        uint32_t symbolCount;
+      };
+
+      struct Symbol {
+        SymbolKind kind;
+        std::string_view name;
+        std::string_view signature;
+        uint32_t line;  // 0-based
+      };
+
+      // Bump when file format or what is recorded changes, so old files are rebuilt
+      static constexpr uint32_t VERSION = 1;
+
+      // Open the latest valid database at given path. Returns nullptr if there isn't one, e.g. it doesn't exist, is corrupted, or is
+      // of a different version.
+      static std::shared_ptr<const SymbolDatabase> open(const std::wstring& filePath);
+
+      // Scan given directories and write an up-to-date database at given path, reusing records of scripts in previous database that
+      // haven't changed. If nothing changed, previous database is returned as is. Returns nullptr if stopped or writing failed.
+      static std::shared_ptr<const SymbolDatabase> update(std::stop_token stopToken, const std::wstring& filePath, const std::vector<std::wstring>& directories, std::shared_ptr<const SymbolDatabase> previous);
+
+      // Disable all copy/move constructors/assignment operators
+      SymbolDatabase(SymbolDatabase&& other) = delete;
+
+      // Whether this database was built from given directories, in the same order
+      bool isBuiltFrom(const std::vector<std::wstring>& directories) const;
+
+      // Look up a case-folded class name
+      std::optional<Script> findScript(std::string_view className) const;
+
+      // Look up a case-folded symbol name defined in given script. Symbols inherited from parent classes are not included.
+      std::optional<Symbol> findSymbol(const Script& script, std::string_view name) const;
+
+      Script getScript(size_t index) const;
+      Symbol getSymbol(size_t index) const;
+      size_t scriptCount() const noexcept;
+      size_t symbolCount() const noexcept;
+
+      inline uint32_t getGeneration() const noexcept { return generation; }
+
+    private:
+      struct Header;
+      struct StringRef;
+      struct ScriptRecord;
+      struct SymbolRecord;
+      class Builder;
+
+      SymbolDatabase(std::unique_ptr<utility::MappedFile>&& file, const Header* header, int slot);
+
+      static std::shared_ptr<const SymbolDatabase> openSlot(const std::wstring& filePath, int slot);
+      static std::wstring getSlotPath(const std::wstring& filePath, int slot);
+
+      std::string_view getString(const StringRef& ref) const noexcept;
+      const ScriptRecord& getScriptRecord(size_t index) const noexcept;
+      const SymbolRecord& getSymbolRecord(size_t index) const noexcept;
+
+      // Private members
+      //
+      std::unique_ptr<utility::MappedFile> file;
+      const Header* header;
+      std::string_view strings;
+      uint32_t generation;
+      int slot;
+  };
+
+} // namespace
@@ -35,11 +35,13 @@ https://www.creationkit.com/fallout4/index.php?title=Category:Papyrus
 #include "Common\Resources.hpp"
 #include "Common\StringUtil.hpp"
 #include "Common\Version.hpp"
+#include "Compiler\BuildPlanner.hpp"
 #include "Compiler\CompilationRequest.hpp"
 #include "Lexer\Lexer.hpp"
 #include "Lexer\LexerData.hpp"
 
 #include "..\external\gsl\include\gsl\util"
+#include "..\external\npp\Common.h"
 #include "..\external\npp\NppDarkMode.h"
 #include "..\external\tinyxml2\tinyxml2.h"
 #include "..\external\XMessageBox\XMessageBox.h"
@@ -50,6 +52,8 @@ https://www.creationkit.com/fallout4/index.php?title=Category:Papyrus
 #include <string>
 #include <vector>
 
+#include <shlobj.h>
+
 papyrus::Plugin papyrusPlugin;
 
 namespace papyrus {
@@ -66,11 +70,37 @@ namespace papyrus {
       L"Install function list support..."
     };
     std::wstring configPath;
+
+    // Posted with PPM_BATCH_FILE_COMPILED, and owned by the message's handler
+    struct BatchCompiledEvent {
+      CompilationRequest request;
+      CompilationResult result;
+      BatchCompiler::Progress progress;
+    };
+
+    std::wstring batchProgressText(const BatchCompiler::Progress& progress) {
+      std::wstring text = std::to_wstring(progress.completed) + L"/" + std::to_wstring(progress.total) + L" scripts";
+      if (progress.failed > 0) {
+        text += L", " + std::to_wstring(progress.failed) + L" failed";
+      }
+      if (progress.cached > 0) {
+        text += L", " + std::to_wstring(progress.cached) + L" unchanged";
+      }
+      if (progress.skipped > 0) {
+        text += L", " + std::to_wstring(progress.skipped) + L" skipped";
+      }
+      return text;
+    }
   }
 
   Plugin::Plugin()
     : funcs{
       FuncItem{ L"Compile", compileMenuFunc, 0, false, new ShortcutKey{true, false, true, 0x43} },
+      FuncItem{ L"Compile all open scripts", compileOpenScriptsMenuFunc, 0, false, nullptr },
+      FuncItem{ L"Compile folder...", compileFolderMenuFunc, 0, false, nullptr },
+      FuncItem{ L"Build changed scripts in folder...", buildFolderMenuFunc, 0, false, nullptr },
+      FuncItem{ L"Compile file list...", compileFileListMenuFunc, 0, false, nullptr },
+      FuncItem{ L"Cancel batch compilation", cancelBatchCompilationMenuFunc, 0, false, nullptr },
       FuncItem{ L"Go to matched keyword", goToMatchMenuFunc, 0, false, new ShortcutKey{true, true, false, 0xDC} },
       FuncItem{ L"Settings...", settingsMenuFunc, 0, false, nullptr },
       FuncItem{}, // Separator1
@@ -93,6 +123,15 @@ namespace papyrus {
   }
 
   void Plugin::cleanUp() {
+    // Stop planning a build, which uses compiler. Planning checks for stop between scripts, so it won't take long.
+    buildPlanner = std::jthread();
+    isPlanningBuild = false;
+
+    // Stop batch compilation. Compilations already running still finish, and destroying batch compiler waits for them.
+    if (batchCompiler) {
+      batchCompiler->cancel();
+      batchCompiler.reset();
+    }
   }
 
   void Plugin::setNppData(NppData data) {
@@ -129,6 +168,8 @@ namespace papyrus {
         case SCN_UPDATEUI: {
           if (notification->updated & SC_UPDATE_SELECTION) {
             handleSelectionChange(notification);
+          } else if (notification->updated & SC_UPDATE_V_SCROLL) {
+            handleScroll(notification);
           }
           break;
         }
@@ -150,6 +191,12 @@ namespace papyrus {
           break;
         }
 
+        case NPPN_SHUTDOWN: {
+          // Threads can't be waited for when DLL is being unloaded, so clean up while Notepad++ is still running
+          cleanUp();
+          break;
+        }
+
         case NPPN_EXTERNALLEXERBUFFER: {
           Lexer::assignBufferID(notification->nmhdr.idFrom);
           break;
@@ -162,6 +209,11 @@ namespace papyrus {
           break;
         }
 
+        case NPPN_FILECLOSED: {
+          lexerData->bufferClosed = static_cast<npp_buffer_t>(notification->nmhdr.idFrom);
+          break;
+        }
+
         case NPPN_LANGCHANGED: {
           handleBufferActivation(notification->nmhdr.idFrom, true);
           break;
@@ -209,10 +261,11 @@ namespace papyrus {
   //
 
   void Plugin::initializeComponents() {
-    lexerData = std::make_unique<LexerData>(nppData, settings.lexerSettings);
+    lexerData = std::make_unique<LexerData>(nppData, messageWindow, settings.lexerSettings);
     errorsWindow = std::make_unique<ErrorsWindow>(myInstance, nppData._nppHandle, messageWindow);
     errorAnnotator = std::make_unique<ErrorAnnotator>(nppData, settings.errorAnnotatorSettings);
-    keywordMatcher = std::make_unique<KeywordMatcher>(nppData, settings.keywordMatcherSettings);
+    keywordMatcher = std::make_unique<KeywordMatcher>(nppData, messageWindow, settings.keywordMatcherSettings);
+    occurrenceHighlighter = std::make_unique<OccurrenceHighlighter>(nppData, settings.keywordMatcherSettings);
     settingsDialog.init(myInstance, nppData._nppHandle);
     aboutDialog.init(myInstance, nppData._nppHandle);
 
@@ -235,7 +288,23 @@ namespace papyrus {
       onSettingsUpdated();
 
       // Only initialize compiler when settings are ready.
-      compiler = std::make_unique<Compiler>(messageWindow, settings.compilerSettings);
+      compiler = std::make_unique<Compiler>(messageWindow, settings.compilerSettings, std::filesystem::path(configPath) / PLUGIN_NAME L"-CompileCache");
+      batchCompiler = std::make_unique<BatchCompiler>(
+        [this](const CompilationRequest& request) { return compiler->compile(request); },
+        // Reports are posted rather than sent, since batch compiler waits for workers when it's destroyed on UI thread
+        [this](const CompilationRequest& request, const CompilationResult& result, const BatchCompiler::Progress& progress) {
+          auto event = std::make_unique<BatchCompiledEvent>(request, result, progress);
+          if (::PostMessage(messageWindow, PPM_BATCH_FILE_COMPILED, reinterpret_cast<WPARAM>(event.get()), 0)) {
+            event.release();
+          }
+        },
+        [this](const BatchCompiler::Progress& progress) {
+          auto finalProgress = std::make_unique<BatchCompiler::Progress>(progress);
+          if (::PostMessage(messageWindow, PPM_BATCH_FINISHED, reinterpret_cast<WPARAM>(finalProgress.get()), 0)) {
+            finalProgress.release();
+          }
+        }
+      );
     }
   }
 
@@ -381,13 +450,20 @@ namespace papyrus {
         if (keywordMatcher) {
           keywordMatched = keywordMatcher->match(scintillaHandle);
         }
-      } else if (isPapyrusScriptFile && fromLangChange && keywordMatcher) {
-        // Papyrus script file changed to other language, clear keyword matching.
-        keywordMatcher->clear();
+        if (occurrenceHighlighter) {
+          occurrenceHighlighter->highlight(scintillaHandle);
+        }
+      } else if (isPapyrusScriptFile && fromLangChange) {
+        // Papyrus script file changed to other language, clear keyword matching and occurrence highlighting.
+        if (keywordMatcher) {
+          keywordMatcher->clear();
+        }
+        if (occurrenceHighlighter) {
+          occurrenceHighlighter->clear();
+        }
       }
 
-      HMENU menu = reinterpret_cast<HMENU>(::SendMessage(nppData._nppHandle, NPPM_GETMENUHANDLE, 0, 0));
-      ::EnableMenuItem(menu, funcs[std::to_underlying(Menu::GoToMatch)]._cmdID, MF_BYCOMMAND | (keywordMatched ? MF_ENABLED : MF_DISABLED));
+      updateGoToMatchMenu(keywordMatched);
 
       // Only Papyrus script and assembly files can be annotated.
       if ((isPapyrusScriptFile || utility::endsWith(filePath, L".pas")) && !fromLangChange && errorAnnotator) {
@@ -447,15 +523,37 @@ namespace papyrus {
       };
       lexerData->changeEventData = changeEventData;
     }
+
+    if (keywordMatcher) {
+      keywordMatcher->handleContentChange(static_cast<HWND>(notification->nmhdr.hwndFrom), notification->position, notification->length, (notification->modificationType & SC_MOD_INSERTTEXT) != 0);
+    }
+    if (occurrenceHighlighter) {
+      occurrenceHighlighter->handleContentChange(static_cast<HWND>(notification->nmhdr.hwndFrom), notification->position, notification->length, (notification->modificationType & SC_MOD_INSERTTEXT) != 0);
+    }
   }
 
   void Plugin::handleSelectionChange(SCNotification* notification) {
     // Only handle selection change if it's from a document buffer shown on current view and is managed by this plugin's lexer.
     bool keywordMatched = false;
-    if (isCurrentBufferManaged(static_cast<HWND>(notification->nmhdr.hwndFrom)) && keywordMatcher) {
-      keywordMatched = keywordMatcher->match(static_cast<HWND>(notification->nmhdr.hwndFrom));
+    if (isCurrentBufferManaged(static_cast<HWND>(notification->nmhdr.hwndFrom))) {
+      if (keywordMatcher) {
+        keywordMatched = keywordMatcher->match(static_cast<HWND>(notification->nmhdr.hwndFrom));
+      }
+      if (occurrenceHighlighter) {
+        occurrenceHighlighter->highlight(static_cast<HWND>(notification->nmhdr.hwndFrom));
+      }
+    }
+    updateGoToMatchMenu(keywordMatched);
+  }
+
+  void Plugin::handleScroll(SCNotification* notification) {
+    // Lines scrolled into view may have identifiers that weren't known before they were styled
+    if (isCurrentBufferManaged(static_cast<HWND>(notification->nmhdr.hwndFrom)) && occurrenceHighlighter) {
+      occurrenceHighlighter->highlight(static_cast<HWND>(notification->nmhdr.hwndFrom));
     }
+  }
 
+  void Plugin::updateGoToMatchMenu(bool keywordMatched) {
     HMENU menu = reinterpret_cast<HMENU>(::SendMessage(nppData._nppHandle, NPPM_GETMENUHANDLE, 0, 0));
     ::EnableMenuItem(menu, funcs[std::to_underlying(Menu::GoToMatch)]._cmdID, MF_BYCOMMAND | (keywordMatched ? MF_ENABLED : MF_DISABLED));
   }
@@ -476,6 +574,19 @@ namespace papyrus {
       while (std::getline(stream, path, L';')) {
         lexerData->importDirectories[game].push_back(path);
       }
+
+      // Only rebuild class index when import directories actually changed, as it scans all scripts in them. Symbol database of each
+      // game is kept in plugin config folder so next session can use it right away.
+      auto& classIndex = lexerData->classIndexes[game];
+      if (classIndex.getDirectories() != lexerData->importDirectories[game]) {
+        std::wstring databaseFilePath;
+        if (!configPath.empty()) {
+          databaseFilePath = std::filesystem::path(configPath) / (PLUGIN_NAME L"-" + game::gameNames[std::to_underlying(game)].first + L".symbols");
+        }
+        classIndex.build(lexerData->importDirectories[game], databaseFilePath, [window = messageWindow, game] {
+          ::PostMessage(window, PPM_CLASSES_CHANGED, static_cast<WPARAM>(game), 0);
+        });
+      }
     }
   }
 
@@ -573,6 +684,104 @@ namespace papyrus {
     isCompilingCurrentFile = false;
   }
 
+  void Plugin::startBatchCompilation(const std::vector<std::wstring>& filePaths, bool incremental) {
+    if (!compiler || !batchCompiler) {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Waiting for completing Papyrus settings..."));
+      return;
+    }
+
+    if (batchCompiler->isRunning() || isPlanningBuild) {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Already compiling in batch!"));
+      return;
+    }
+
+    if (activeCompilationRequest.bufferID != 0) {
+      std::wstring errorMsg(L"Can't start batch compilation due to active compilation of " + activeCompilationRequest.filePath);
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(errorMsg.c_str()));
+      return;
+    }
+
+    std::vector<CompilationRequest> requests;
+    for (const auto& filePath : filePaths) {
+      auto [detectedGame, useAutoModeOutputDirectory] = detectGameType(filePath, settings.compilerSettings);
+      if (detectedGame != Game::Auto) {
+        requests.push_back(CompilationRequest {
+          .game = detectedGame,
+          .filePath { filePath },
+          .useAutoModeOutputDirectory = useAutoModeOutputDirectory
+        });
+      }
+    }
+
+    if (requests.empty()) {
+      LPCWSTR errorMsg = filePaths.empty() ? L"No Papyrus script to compile!" : L"Cannot start compilation because no game is configured. Please at least enable one game in Settings dialog!";
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(errorMsg));
+      return;
+    }
+
+    if (errorsWindow) {
+      errorsWindow->clear();
+      errorsWindow->hide();
+    }
+
+    if (errorAnnotator) {
+      errorAnnotator->clear();
+    }
+
+    // Compile saved contents of modified scripts.
+    ::SendMessage(nppData._nppHandle, NPPM_SAVEALLFILES, 0, 0);
+
+    batchHasUnparsableLines = false;
+    if (incremental) {
+      // Finding changed scripts reads all of them and the scripts they depend on, so it's done on a worker thread, and the plan is
+      // posted back to start compiling. Previous planner has finished or been asked to stop, so joining it won't take long.
+      std::wstring msg(L"Checking " + std::to_wstring(requests.size()) + L" scripts for changes...");
+      isPlanningBuild = true;
+      buildPlanner = std::jthread([this, requests = std::move(requests), planID = ++buildPlanID](std::stop_token stopToken) mutable {
+        auto plan = std::make_unique<BuildPlanner::Plan>(BuildPlanner::plan(std::move(requests),
+          [this](const CompilationRequest& request, const std::string& scriptName) {
+            return compiler->getTarget(request, scriptName);
+          },
+          stopToken
+        ));
+        if (!stopToken.stop_requested() && ::PostMessage(messageWindow, PPM_BUILD_PLANNED, reinterpret_cast<WPARAM>(plan.get()), static_cast<LPARAM>(planID))) {
+          plan.release();
+        }
+      });
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+      return;
+    }
+
+    std::wstring msg(L"Compiling " + std::to_wstring(requests.size()) + L" scripts...");
+    if (batchCompiler->start(std::move(requests), settings.compilerSettings.batchCompilationJobs)) {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+    }
+  }
+
+  bool Plugin::selectFolderScripts(LPCWSTR title, std::vector<std::wstring>& filePaths) {
+    BROWSEINFO browseInfo {
+      .hwndOwner = nppData._nppHandle,
+      .lpszTitle = title,
+      .ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE
+    };
+    PIDLIST_ABSOLUTE folder = ::SHBrowseForFolder(&browseInfo);
+    if (folder) {
+      auto autoCleanup = gsl::finally([&] { ::CoTaskMemFree(folder); });
+      wchar_t folderPath[MAX_PATH];
+      if (::SHGetPathFromIDList(folder, folderPath)) {
+        std::error_code errorCode;
+        auto iter = std::filesystem::recursive_directory_iterator(folderPath, std::filesystem::directory_options::skip_permission_denied, errorCode);
+        for (; !errorCode && iter != std::filesystem::recursive_directory_iterator(); iter.increment(errorCode)) {
+          if (iter->is_regular_file(errorCode) && utility::endsWith(iter->path().wstring(), L".psc")) {
+            filePaths.push_back(iter->path().wstring());
+          }
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
   LRESULT CALLBACK Plugin::messageHandleProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam) {
     return papyrusPlugin.handleOwnMessage(window, message, wParam, lParam);
   }
@@ -585,11 +794,16 @@ namespace papyrus {
           errorsWindow->hide();
         }
 
-        std::wstring msg(L"Compilation ");
-        if (wParam == PARAM_COMPILATION_WITH_ANONYMIZATION) {
-          msg += L"and anonymization ";
+        std::wstring msg;
+        if (wParam == PARAM_COMPILATION_CACHED) {
+          msg = L"Script unchanged, previous compilation output restored";
+        } else {
+          msg = L"Compilation ";
+          if (wParam == PARAM_COMPILATION_WITH_ANONYMIZATION) {
+            msg += L"and anonymization ";
+          }
+          msg += L"succeeded";
         }
-        msg += L"succeeded";
         if (!isCompilingCurrentFile) {
           msg += L": " + activeCompilationRequest.filePath;
         }
@@ -607,6 +821,8 @@ namespace papyrus {
             errorsWindow->show(*errors);
 
             if (errorAnnotator) {
+              // Replace errors annotated while compiling with the complete list.
+              errorAnnotator->clear();
               errorAnnotator->annotate(*errors);
             }
           }
@@ -625,6 +841,18 @@ namespace papyrus {
         return 0;
       }
 
+      case PPM_COMPILATION_ERROR: {
+        // Show errors as soon as compiler reports them, while it's still running.
+        const Error* error = reinterpret_cast<const Error*>(wParam);
+        if (errorsWindow) {
+          errorsWindow->add({ *error });
+        }
+        if (errorAnnotator) {
+          errorAnnotator->annotate({ *error });
+        }
+        return 0;
+      }
+
       case PPM_COMPILER_NOT_FOUND: {
         clearActiveCompilation();
         ::MessageBox(nppData._nppHandle, L"Can't find the compiler executable", PLUGIN_NAME L" plugin", MB_ICONERROR | MB_OK);
@@ -652,6 +880,114 @@ namespace papyrus {
         return 0;
       }
 
+      case PPM_BATCH_FILE_COMPILED: {
+        std::unique_ptr<BatchCompiledEvent> event(reinterpret_cast<BatchCompiledEvent*>(wParam));
+        const CompilationResult& result = event->result;
+        std::vector<Error> errors;
+        switch (result.status) {
+          case CompilationResult::Status::Succeeded: {
+            break;
+          }
+
+          case CompilationResult::Status::Failed: {
+            errors = result.errors;
+            batchHasUnparsableLines = batchHasUnparsableLines || result.hasUnparsableLines;
+            break;
+          }
+
+          case CompilationResult::Status::AnonymizationFailed: {
+            errors.push_back(Error {
+              .message = L"Compilation succeeded but anonymization failed: " + result.message + L" File: " + event->request.filePath
+            });
+            break;
+          }
+
+          case CompilationResult::Status::CompilerNotFound: {
+            // Every other script would fail the same way.
+            if (batchCompiler) {
+              batchCompiler->cancel();
+            }
+            errors.push_back(Error {
+              .message = L"Can't find the compiler executable. File: " + event->request.filePath
+            });
+            break;
+          }
+
+          case CompilationResult::Status::OtherError: {
+            errors.push_back(Error {
+              .message = result.title + L" " + result.message + L" File: " + event->request.filePath
+            });
+            break;
+          }
+        }
+
+        if (!errors.empty()) {
+          if (errorsWindow) {
+            errorsWindow->add(errors);
+          }
+          if (errorAnnotator) {
+            errorAnnotator->annotate(errors);
+          }
+        }
+
+        std::wstring msg(L"Compiling... " + batchProgressText(event->progress));
+        ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+        return 0;
+      }
+
+      case PPM_BATCH_FINISHED: {
+        std::unique_ptr<BatchCompiler::Progress> progress(reinterpret_cast<BatchCompiler::Progress*>(wParam));
+        std::wstring msg((progress->failed > 0 ? L"Batch compilation failed: " : progress->skipped > 0 ? L"Batch compilation cancelled: " : L"Batch compilation succeeded: ") + batchProgressText(*progress));
+        ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+
+        if (batchHasUnparsableLines) {
+          ::MessageBox(nppData._nppHandle, L"There are unparsable compilation errors.", PLUGIN_NAME L" plugin", MB_ICONERROR | MB_OK);
+        }
+        return 0;
+      }
+
+      case PPM_BUILD_PLANNED: {
+        std::unique_ptr<BuildPlanner::Plan> plan(reinterpret_cast<BuildPlanner::Plan*>(wParam));
+        if (!isPlanningBuild || static_cast<size_t>(lParam) != buildPlanID || !batchCompiler) {
+          // Planning was cancelled
+          return 0;
+        }
+        isPlanningBuild = false;
+
+        if (plan->requests.empty()) {
+          std::wstring msg(L"All " + std::to_wstring(plan->upToDate) + L" scripts are up to date.");
+          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+          return 0;
+        }
+
+        std::wstring msg(L"Compiling " + std::to_wstring(plan->requests.size()) + L" changed scripts, " + std::to_wstring(plan->upToDate) + L" up to date...");
+        if (batchCompiler->start(std::move(plan->requests), settings.compilerSettings.batchCompilationJobs, std::move(plan->dependencies))) {
+          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+        }
+        return 0;
+      }
+
+      case PPM_DECLARATIONS_SCANNED: {
+        if (lexerData) {
+          lexerData->declarationsScanned = static_cast<npp_buffer_t>(wParam);
+        }
+        return 0;
+      }
+
+      case PPM_CLASSES_CHANGED: {
+        if (lexerData) {
+          lexerData->classesChanged = static_cast<Game>(wParam);
+        }
+        return 0;
+      }
+
+      case PPM_MATCH_KEYWORD: {
+        if (keywordMatcher && keywordMatcher->resumeMatch()) {
+          updateGoToMatchMenu(keywordMatcher->isMatched());
+        }
+        return 0;
+      }
+
       case PPM_JUMP_TO_ERROR: {
         Error* error = reinterpret_cast<Error*>(wParam);
         if (!error->file.empty()) {
@@ -852,7 +1188,9 @@ namespace papyrus {
 
   void Plugin::compile() {
     if (compiler) {
-      if (activeCompilationRequest.bufferID == 0) {
+      if (batchCompiler && batchCompiler->isRunning()) {
+        ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Can't start compilation while compiling in batch!"));
+      } else if (activeCompilationRequest.bufferID == 0) {
         // Get current file path.
         wchar_t filePath[MAX_PATH];
         if (::SendMessage(nppData._nppHandle, NPPM_GETFULLCURRENTPATH, MAX_PATH, reinterpret_cast<LPARAM>(filePath))) {
@@ -910,6 +1248,97 @@ namespace papyrus {
     }
   }
 
+  void Plugin::compileOpenScriptsMenuFunc() {
+    papyrusPlugin.compileOpenScripts();
+  }
+
+  void Plugin::compileOpenScripts() {
+    // Same as compiling current file, only Papyrus scripts lexed by this plugin's lexer are compiled, unless compiling unmanaged files is allowed.
+    detectLangID();
+    std::vector<std::wstring> filePaths;
+    for (npp_buffer_t bufferID : utility::getOpenBufferIDs(nppData._nppHandle)) {
+      std::wstring filePath = utility::getFilePathFromBuffer(nppData._nppHandle, bufferID);
+      npp_lang_type_t langID = static_cast<npp_lang_type_t>(::SendMessage(nppData._nppHandle, NPPM_GETBUFFERLANGTYPE, static_cast<WPARAM>(bufferID), 0));
+      if (utility::endsWith(filePath, L".psc") && (langID == scriptLangID || settings.compilerSettings.allowUnmanagedSource)) {
+        filePaths.push_back(filePath);
+      }
+    }
+    startBatchCompilation(filePaths);
+  }
+
+  void Plugin::compileFolderMenuFunc() {
+    papyrusPlugin.compileFolder();
+  }
+
+  void Plugin::compileFolder() {
+    std::vector<std::wstring> filePaths;
+    if (selectFolderScripts(L"Select a folder to compile all Papyrus scripts in it, including subfolders", filePaths)) {
+      startBatchCompilation(filePaths);
+    }
+  }
+
+  void Plugin::buildFolderMenuFunc() {
+    papyrusPlugin.buildFolder();
+  }
+
+  void Plugin::buildFolder() {
+    std::vector<std::wstring> filePaths;
+    if (selectFolderScripts(L"Select a folder to compile Papyrus scripts in it, including subfolders, that changed since last compiled", filePaths)) {
+      startBatchCompilation(filePaths, true);
+    }
+  }
+
+  void Plugin::compileFileListMenuFunc() {
+    papyrusPlugin.compileFileList();
+  }
+
+  void Plugin::compileFileList() {
+    wchar_t listFilePath[MAX_PATH] {};
+    OPENFILENAME openFileName {
+      .lStructSize = sizeof(OPENFILENAME),
+      .hwndOwner = nppData._nppHandle,
+      .lpstrFilter = L"Text files (*.txt)\0*.txt\0All files (*.*)\0*.*\0",
+      .lpstrFile = listFilePath,
+      .nMaxFile = MAX_PATH,
+      .lpstrTitle = L"Select a file listing Papyrus scripts to compile, one per line",
+      .Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST
+    };
+    if (::GetOpenFileName(&openFileName)) {
+      // Relative paths are relative to the list file's folder. Blank lines and lines starting with ";" are skipped.
+      std::filesystem::path listDirectory = std::filesystem::path(listFilePath).parent_path();
+      std::vector<std::wstring> filePaths;
+      std::ifstream listFile(listFilePath);
+      std::string line;
+      while (std::getline(listFile, line)) {
+        std::wstring filePath = string2wstring(line, SC_CP_UTF8);
+        filePath.erase(0, filePath.find_first_not_of(L" \t\r"));
+        filePath.erase(filePath.find_last_not_of(L" \t\r") + 1);
+        if (!filePath.empty() && !filePath.starts_with(L";")) {
+          filePaths.push_back((listDirectory / filePath).lexically_normal().wstring());
+        }
+      }
+      startBatchCompilation(filePaths);
+    }
+  }
+
+  void Plugin::cancelBatchCompilationMenuFunc() {
+    papyrusPlugin.cancelBatchCompilation();
+  }
+
+  void Plugin::cancelBatchCompilation() {
+    if (isPlanningBuild) {
+      // Nothing is compiled yet, so just drop the plan
+      buildPlanner.request_stop();
+      isPlanningBuild = false;
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Batch compilation cancelled."));
+    } else if (batchCompiler && batchCompiler->isRunning()) {
+      batchCompiler->cancel();
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Cancelling batch compilation..."));
+    } else {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"No batch compilation to cancel!"));
+    }
+  }
+
   void Plugin::goToMatchMenuFunc() {
     papyrusPlugin.goToMatch();
   }
@@ -25,9 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Common\Timer.hpp"
 #include "CompilationErrorHandling\ErrorAnnotator.hpp"
 #include "CompilationErrorHandling\ErrorsWindow.hpp"
+#include "Compiler\BatchCompiler.hpp"
 #include "Compiler\Compiler.hpp"
 #include "Compiler\CompilerSettings.hpp"
 #include "KeywordMatcher\KeywordMatcher.hpp"
+#include "KeywordMatcher\OccurrenceHighlighter.hpp"
 #include "Settings\Settings.hpp"
 #include "Settings\SettingsDialog.hpp"
 #include "UI\AboutDialog.hpp"
@@ -36,6 +38,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "..\external\npp\PluginInterface.h"
 
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Plugin constants
 //
@@ -63,6 +68,11 @@ namespace papyrus {
     private:
       enum class Menu {
         Compile,
+        CompileOpenScripts,
+        CompileFolder,
+        BuildFolder,
+        CompileFileList,
+        CancelBatchCompilation,
         GoToMatch,
         Options,
         Seperator1,
@@ -102,6 +112,12 @@ namespace papyrus {
       // Scintilla notification SCN_UPDATEUI handler, when selection updated
       void handleSelectionChange(SCNotification* notification);
 
+      // Scintilla notification SCN_UPDATEUI handler, when scrolled vertically
+      void handleScroll(SCNotification* notification);
+
+      // Enable "Go to match" menu item only when keyword at caret is matched
+      void updateGoToMatchMenu(bool keywordMatched);
+
       // Handle setting changes
       void onSettingsUpdated();
       void updateLexerDataGameSettings(Game game, const CompilerSettings::GameSettings& gameSettings);
@@ -123,6 +139,14 @@ namespace papyrus {
       // in NPP it can be properly handled
       void clearActiveCompilation();
 
+      // Start compiling given script files in batch. If incremental, only scripts whose outputs are older than their sources or sources
+      // of scripts they depend on are compiled, after the scripts they depend on. Finding those scripts is done on a worker thread, and
+      // compiling starts when the plan is posted back.
+      void startBatchCompilation(const std::vector<std::wstring>& filePaths, bool incremental = false);
+
+      // Let user select a folder, and get all script files in it, including subfolders. Returns false if no folder is selected.
+      bool selectFolderScripts(LPCWSTR title, std::vector<std::wstring>& filePaths);
+
       // Plugin's own message handling
       static LRESULT CALLBACK messageHandleProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam);
       LRESULT handleOwnMessage(HWND window, UINT message, WPARAM wparam, LPARAM lparam);
@@ -144,6 +168,16 @@ namespace papyrus {
 
       static void compileMenuFunc();
       void compile();
+      static void compileOpenScriptsMenuFunc();
+      void compileOpenScripts();
+      static void compileFolderMenuFunc();
+      void compileFolder();
+      static void buildFolderMenuFunc();
+      void buildFolder();
+      static void compileFileListMenuFunc();
+      void compileFileList();
+      static void cancelBatchCompilationMenuFunc();
+      void cancelBatchCompilation();
       static void goToMatchMenuFunc();
       void goToMatch();
       static void settingsMenuFunc();
@@ -171,10 +205,16 @@ namespace papyrus {
       std::unique_ptr<Compiler> compiler;
       CompilationRequest activeCompilationRequest;
       bool isCompilingCurrentFile {false};
+      std::unique_ptr<BatchCompiler> batchCompiler;
+      bool batchHasUnparsableLines {false};
+      std::jthread buildPlanner;  // Plans incremental builds, so reading all scripts doesn't block UI
+      bool isPlanningBuild {false};
+      size_t buildPlanID {0};     // Identifies current plan, so a plan posted before it's cancelled isn't used
 
       std::unique_ptr<ErrorsWindow> errorsWindow;
       std::unique_ptr<ErrorAnnotator> errorAnnotator;
       std::unique_ptr<KeywordMatcher> keywordMatcher;
+      std::unique_ptr<OccurrenceHighlighter> occurrenceHighlighter;
       std::list<Error> activatedErrorsTrackingList;
       std::unique_ptr<utility::Timer> jumpToErrorLineTimer;
 
@@ -50,6 +50,7 @@ namespace papyrus {
 
     storage.putString(L"lexer.enableFoldMiddle", utility::boolToStr(lexerSettings.enableFoldMiddle));
     storage.putString(L"lexer.enableClassNameCache", utility::boolToStr(lexerSettings.enableClassNameCache));
+    storage.putString(L"lexer.classNameCacheSize", std::to_wstring(lexerSettings.classNameCacheSize));
     storage.putString(L"lexer.enableClassLink", utility::boolToStr(lexerSettings.enableClassLink));
     storage.putString(L"lexer.classLinkUnderline", utility::boolToStr(lexerSettings.classLinkUnderline));
     storage.putString(L"lexer.classLinkForegroundColor" + themeSuffix, utility::colorToHexStr(lexerSettings.classLinkForegroundColor));
@@ -68,6 +69,10 @@ namespace papyrus {
     storage.putString(L"keywordMatcher.matchedIndicatorForegroundColor" + themeSuffix, utility::colorToHexStr(keywordMatcherSettings.matchedIndicatorForegroundColor));
     storage.putString(L"keywordMatcher.unmatchedIndicatorStyle", std::to_wstring(keywordMatcherSettings.unmatchedIndicatorStyle));
     storage.putString(L"keywordMatcher.unmatchedIndicatorForegroundColor" + themeSuffix, utility::colorToHexStr(keywordMatcherSettings.unmatchedIndicatorForegroundColor));
+    storage.putString(L"keywordMatcher.enableOccurrenceHighlighting", utility::boolToStr(keywordMatcherSettings.enableOccurrenceHighlighting));
+    storage.putString(L"keywordMatcher.defaultOccurrenceIndicatorID", std::to_wstring(keywordMatcherSettings.defaultOccurrenceIndicatorID));
+    storage.putString(L"keywordMatcher.occurrenceIndicatorStyle", std::to_wstring(keywordMatcherSettings.occurrenceIndicatorStyle));
+    storage.putString(L"keywordMatcher.occurrenceIndicatorForegroundColor" + themeSuffix, utility::colorToHexStr(keywordMatcherSettings.occurrenceIndicatorForegroundColor));
 
     storage.putString(L"errorAnnotator.enableAnnotation", utility::boolToStr(errorAnnotatorSettings.enableAnnotation));
     storage.putString(L"errorAnnotator.annotationForegroundColor" + themeSuffix, utility::colorToHexStr(errorAnnotatorSettings.annotationForegroundColor));
@@ -81,6 +86,8 @@ namespace papyrus {
     storage.putString(L"errorAnnotator.indicatorForegroundColor" + themeSuffix, utility::colorToHexStr(errorAnnotatorSettings.indicatorForegroundColor));
 
     storage.putString(L"compiler.common.allowUnmanagedSource", utility::boolToStr(compilerSettings.allowUnmanagedSource));
+    storage.putString(L"compiler.common.batchCompilationJobs", std::to_wstring(compilerSettings.batchCompilationJobs));
+    storage.putString(L"compiler.common.useCompileCache", utility::boolToStr(compilerSettings.useCompileCache));
     storage.putString(L"compiler.common.gameMode", game::gameNames[std::to_underlying(compilerSettings.gameMode)].first);
     storage.putString(L"compiler.auto.defaultGame", game::gameNames[std::to_underlying(compilerSettings.autoModeDefaultGame)].first);
     storage.putString(L"compiler.auto.outputDirectory", compilerSettings.autoModeOutputDirectory);
@@ -120,6 +127,17 @@ namespace papyrus {
       updated = true;
     }
 
+    if (storage.getString(L"lexer.classNameCacheSize", value)) {
+      lexerSettings.classNameCacheSize = std::stoi(value);
+      if (lexerSettings.classNameCacheSize <= 0) {
+        lexerSettings.classNameCacheSize = DEFAULT_CLASS_NAME_CACHE_SIZE;
+        updated = true;
+      }
+    } else {
+      lexerSettings.classNameCacheSize = DEFAULT_CLASS_NAME_CACHE_SIZE;
+      updated = true;
+    }
+
     if (storage.getString(L"lexer.enableClassLink", value)) {
       lexerSettings.enableClassLink = utility::strToBool(value);
     } else {
@@ -233,6 +251,35 @@ namespace papyrus {
       updated = true;
     }
 
+    if (storage.getString(L"keywordMatcher.enableOccurrenceHighlighting", value)) {
+      keywordMatcherSettings.enableOccurrenceHighlighting = utility::strToBool(value);
+    } else {
+      keywordMatcherSettings.enableOccurrenceHighlighting = true;
+      updated = true;
+    }
+
+    if (storage.getString(L"keywordMatcher.defaultOccurrenceIndicatorID", value)) {
+      keywordMatcherSettings.defaultOccurrenceIndicatorID = std::stoi(value);
+    } else {
+      keywordMatcherSettings.defaultOccurrenceIndicatorID = DEFAULT_OCCURRENCE_INDICATOR;
+      updated = true;
+    }
+    if (keywordMatcherSettings.defaultOccurrenceIndicatorID < 9 || keywordMatcherSettings.defaultOccurrenceIndicatorID > 20) {
+      keywordMatcherSettings.defaultOccurrenceIndicatorID = DEFAULT_OCCURRENCE_INDICATOR;
+      updated = true;
+    }
+
+    if (storage.getString(L"keywordMatcher.occurrenceIndicatorStyle", value)) {
+      keywordMatcherSettings.occurrenceIndicatorStyle = std::stoi(value);
+      if (keywordMatcherSettings.occurrenceIndicatorStyle > INDIC_GRADIENTCENTRE) {
+        keywordMatcherSettings.occurrenceIndicatorStyle = INDIC_STRAIGHTBOX;
+        updated = true;
+      }
+    } else {
+      keywordMatcherSettings.occurrenceIndicatorStyle = INDIC_STRAIGHTBOX;
+      updated = true;
+    }
+
     // Error annotator settings
     //
     if (storage.getString(L"errorAnnotator.enableAnnotation", value)) {
@@ -319,6 +366,24 @@ namespace papyrus {
       updated = true;
     }
 
+    if (storage.getString(L"compiler.common.batchCompilationJobs", value)) {
+      compilerSettings.batchCompilationJobs = std::stoi(value);
+      if (compilerSettings.batchCompilationJobs <= 0 || compilerSettings.batchCompilationJobs > MAX_BATCH_COMPILATION_JOBS) {
+        compilerSettings.batchCompilationJobs = DEFAULT_BATCH_COMPILATION_JOBS;
+        updated = true;
+      }
+    } else {
+      compilerSettings.batchCompilationJobs = DEFAULT_BATCH_COMPILATION_JOBS;
+      updated = true;
+    }
+
+    if (storage.getString(L"compiler.common.useCompileCache", value)) {
+      compilerSettings.useCompileCache = utility::strToBool(value);
+    } else {
+      compilerSettings.useCompileCache = true;
+      updated = true;
+    }
+
     if (storage.getString(L"compiler.common.gameMode", value)) {
       auto iter = game::gameAliases.find(value);
       if (iter != game::gameAliases.end()) {
@@ -437,6 +502,14 @@ namespace papyrus {
       updated = true;
     }
 
+    baseKey = L"keywordMatcher.occurrenceIndicatorForegroundColor";
+    if (storage.getString(baseKey + themeSuffix, value)) {
+      keywordMatcherSettings.occurrenceIndicatorForegroundColor = utility::hexStrToColor(value);
+    } else {
+      keywordMatcherSettings.occurrenceIndicatorForegroundColor = NppDarkMode::isEnabled() ? 0x80C080 : 0x00C000; // BGR
+      updated = true;
+    }
+
     baseKey = L"errorAnnotator.annotationForegroundColor";
     if (storage.getString(baseKey + themeSuffix, value)) {
       errorAnnotatorSettings.annotationForegroundColor = utility::hexStrToColor(value);
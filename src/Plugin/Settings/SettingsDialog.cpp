@@ -77,6 +77,7 @@ namespace papyrus {
     classLinkBgColorPicker.destroy();
     matchedIndicatorFgColorPicker.destroy();
     unmatchedIndicatorFgColorPicker.destroy();
+    occurrenceIndicatorFgColorPicker.destroy();
     annotationFgColorPicker.destroy();
     annotationBgColorPicker.destroy();
     errorIndicatorFgColorPicker.destroy();
@@ -98,6 +99,7 @@ namespace papyrus {
     if (isTabDialogCreated(std::to_underlying(Tab::KeywordMatcher))) {
         matchedIndicatorFgColorPicker.setColour(settings.keywordMatcherSettings.matchedIndicatorForegroundColor);
         unmatchedIndicatorFgColorPicker.setColour(settings.keywordMatcherSettings.unmatchedIndicatorForegroundColor);
+        occurrenceIndicatorFgColorPicker.setColour(settings.keywordMatcherSettings.occurrenceIndicatorForegroundColor);
     }
 
     if (isTabDialogCreated(std::to_underlying(Tab::ErrorAnnotator))) {
@@ -133,8 +135,10 @@ namespace papyrus {
         setChecked(tab, IDC_SETTINGS_LEXER_FOLD_MIDDLE, settings.lexerSettings.enableFoldMiddle);
         createToolTip(tab, IDC_SETTINGS_LEXER_FOLD_MIDDLE, IDS_SETTINGS_LEXER_FOLD_MIDDLE_TOOLTIP);
 
+        enableGroup(Group::ClassNameCache, settings.lexerSettings.enableClassNameCache);
         setChecked(tab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHING, settings.lexerSettings.enableClassNameCache);
         createToolTip(tab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHING, IDS_SETTINGS_LEXER_CLASS_NAME_CACHING_TOOLTIP);
+        setText(tab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHE_SIZE, std::to_wstring(settings.lexerSettings.classNameCacheSize));
 
         enableGroup(Group::ClassLink, settings.lexerSettings.enableClassLink);
         setChecked(tab, IDC_SETTINGS_LEXER_CLASS_LINK, settings.lexerSettings.enableClassLink);
@@ -183,6 +187,13 @@ namespace papyrus {
         initDropdownList(tab, IDC_SETTINGS_MATCHER_UNMATCHED_STYLE_DROPDOWN, indicatorStyles, settings.keywordMatcherSettings.unmatchedIndicatorStyle);
         initColorPicker(tab, unmatchedIndicatorFgColorPicker, IDC_SETTINGS_MATCHER_UNMATCHED_FGCOLOR_LABEL);
         unmatchedIndicatorFgColorPicker.setColour(settings.keywordMatcherSettings.unmatchedIndicatorForegroundColor);
+
+        enableGroup(Group::Occurrences, settings.keywordMatcherSettings.enableOccurrenceHighlighting);
+        setChecked(tab, IDC_SETTINGS_MATCHER_OCCURRENCES, settings.keywordMatcherSettings.enableOccurrenceHighlighting);
+        createToolTip(tab, IDC_SETTINGS_MATCHER_OCCURRENCES, IDS_SETTINGS_MATCHER_OCCURRENCES_TOOLTIP);
+        initDropdownList(tab, IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_DROPDOWN, indicatorStyles, settings.keywordMatcherSettings.occurrenceIndicatorStyle);
+        initColorPicker(tab, occurrenceIndicatorFgColorPicker, IDC_SETTINGS_MATCHER_OCCURRENCE_FGCOLOR_LABEL);
+        occurrenceIndicatorFgColorPicker.setColour(settings.keywordMatcherSettings.occurrenceIndicatorForegroundColor);
         break;
 
       case std::to_underlying(Tab::ErrorAnnotator):
@@ -213,6 +224,10 @@ namespace papyrus {
         enableGroup(Group::GameFO4, settings.compilerSettings.fo4.enabled);
 
         setChecked(tab, IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE, settings.compilerSettings.allowUnmanagedSource);
+        setText(tab, IDC_SETTINGS_COMPILER_BATCH_JOBS, std::to_wstring(settings.compilerSettings.batchCompilationJobs));
+        createToolTip(tab, IDC_SETTINGS_COMPILER_BATCH_JOBS, IDS_SETTINGS_COMPILER_BATCH_JOBS_TOOLTIP);
+        setChecked(tab, IDC_SETTINGS_COMPILER_USE_CACHE, settings.compilerSettings.useCompileCache);
+        createToolTip(tab, IDC_SETTINGS_COMPILER_USE_CACHE, IDS_SETTINGS_COMPILER_USE_CACHE_TOOLTIP);
         setChecked(tab, IDC_SETTINGS_COMPILER_RADIO_AUTO + std::to_underlying(settings.compilerSettings.gameMode), true);
         setText(tab, IDC_SETTINGS_COMPILER_AUTO_DEFAULT_OUTPUT, settings.compilerSettings.autoModeOutputDirectory);
         updateAutoModeDefaultGame();
@@ -268,6 +283,12 @@ namespace papyrus {
           return FALSE;
         }
 
+        case IDC_SETTINGS_LEXER_CLASS_NAME_CACHING: {
+          // Caching itself is only changed when settings are saved
+          enableGroup(Group::ClassNameCache, getChecked(tab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHING));
+          return FALSE;
+        }
+
         case IDC_SETTINGS_LEXER_CLASS_LINK: {
           settings.lexerSettings.enableClassLink = getChecked(tab, IDC_SETTINGS_LEXER_CLASS_LINK);
           enableGroup(Group::ClassLink, settings.lexerSettings.enableClassLink);
@@ -291,6 +312,12 @@ namespace papyrus {
           return FALSE;
         }
 
+        case IDC_SETTINGS_MATCHER_OCCURRENCES: {
+          settings.keywordMatcherSettings.enableOccurrenceHighlighting = getChecked(tab, IDC_SETTINGS_MATCHER_OCCURRENCES);
+          enableGroup(Group::Occurrences, settings.keywordMatcherSettings.enableOccurrenceHighlighting);
+          return FALSE;
+        }
+
         case IDC_SETTINGS_MATCHER_KEYWORD_IF: {
           // Enable/disable Else/ElseIf support based on If/EndIf support.
           bool allowIf = getChecked(tab, IDC_SETTINGS_MATCHER_KEYWORD_IF);
@@ -386,6 +413,8 @@ namespace papyrus {
             settings.keywordMatcherSettings.matchedIndicatorForegroundColor = matchedIndicatorFgColorPicker.getColour();
           } else if (window == unmatchedIndicatorFgColorPicker.getHSelf()) {
             settings.keywordMatcherSettings.unmatchedIndicatorForegroundColor = unmatchedIndicatorFgColorPicker.getColour();
+          } else if (window == occurrenceIndicatorFgColorPicker.getHSelf()) {
+            settings.keywordMatcherSettings.occurrenceIndicatorForegroundColor = occurrenceIndicatorFgColorPicker.getColour();
           } else if (window == annotationFgColorPicker.getHSelf()) {
             settings.errorAnnotatorSettings.annotationForegroundColor = annotationFgColorPicker.getColour();
           } else if (window == annotationBgColorPicker.getHSelf()) {
@@ -414,6 +443,14 @@ namespace papyrus {
           return FALSE;
         }
 
+        case IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_DROPDOWN: {
+          int selectedIndex = getDropdownSelectedIndex(tab, IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_DROPDOWN);
+          if (selectedIndex != CB_ERR) {
+            settings.keywordMatcherSettings.occurrenceIndicatorStyle = selectedIndex;
+          }
+          return FALSE;
+        }
+
         case IDC_SETTINGS_ANNOTATOR_INDICATOR_STYLE_DROPDOWN: {
           int selectedIndex = getDropdownSelectedIndex(tab, IDC_SETTINGS_ANNOTATOR_INDICATOR_STYLE_DROPDOWN);
           if (selectedIndex != CB_ERR) {
@@ -440,6 +477,13 @@ namespace papyrus {
 
   void SettingsDialog::enableGroup(Group group, bool enabled) const {
     switch (group) {
+      case Group::ClassNameCache: {
+        constexpr tab_id_t tab = std::to_underlying(Tab::Lexer);
+        setControlEnabled(tab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHE_SIZE_LABEL, enabled);
+        setControlEnabled(tab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHE_SIZE, enabled);
+        break;
+      }
+
       case Group::ClassLink: {
         constexpr tab_id_t tab = std::to_underlying(Tab::Lexer);
         setControlEnabled(tab, IDC_SETTINGS_LEXER_CLASS_LINK_UNDERLINE, enabled);
@@ -487,6 +531,15 @@ namespace papyrus {
         break;
       }
 
+      case Group::Occurrences: {
+        constexpr tab_id_t tab = std::to_underlying(Tab::KeywordMatcher);
+        setControlEnabled(tab, IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_LABEL, enabled);
+        setControlEnabled(tab, IDC_SETTINGS_MATCHER_OCCURRENCE_STYLE_DROPDOWN, enabled);
+        setControlEnabled(tab, IDC_SETTINGS_MATCHER_OCCURRENCE_FGCOLOR_LABEL, enabled);
+        ::EnableWindow(occurrenceIndicatorFgColorPicker.getHSelf(), enabled);
+        break;
+      }
+
       case Group::Annotation: {
         constexpr tab_id_t tab = std::to_underlying(Tab::ErrorAnnotator);
         setControlEnabled(tab, IDC_SETTINGS_ANNOTATOR_ANNOTATION_FGCOLOR_LABEL, enabled);
@@ -707,7 +760,16 @@ namespace papyrus {
         return false;
       }
 
+      std::wstring classNameCacheSizeStr = getText(lexerTab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHE_SIZE);
+      int classNameCacheSize {};
+      std::wistringstream(classNameCacheSizeStr) >> classNameCacheSize;
+      if (!utility::isNumber(classNameCacheSizeStr) || classNameCacheSize <= 0) {
+        ::MessageBox(getHSelf(), L"Maximum cached names needs to be a positive number", L"Invalid setting", MB_ICONERROR | MB_OK);
+        return false;
+      }
+
       settings.lexerSettings.enableClassNameCache = getChecked(lexerTab, IDC_SETTINGS_LEXER_CLASS_NAME_CACHING);
+      settings.lexerSettings.classNameCacheSize = classNameCacheSize;
       settings.lexerSettings.classLinkClickModifier = SCMOD_NORM |
         (getChecked(lexerTab, IDC_SETTINGS_LEXER_CLASS_LINK_MODIFIER_SHIFT) ? SCMOD_SHIFT : SCMOD_NORM) |
         (getChecked(lexerTab, IDC_SETTINGS_LEXER_CLASS_LINK_MODIFIER_CTRL) ? SCMOD_CTRL : SCMOD_NORM) |
@@ -757,12 +819,22 @@ namespace papyrus {
 
     constexpr tab_id_t compilerTab = std::to_underlying(Tab::Compiler);
     if (isTabDialogCreated(compilerTab)) {
+      std::wstring batchJobsStr = getText(compilerTab, IDC_SETTINGS_COMPILER_BATCH_JOBS);
+      int batchJobs {};
+      std::wistringstream(batchJobsStr) >> batchJobs;
+      if (!utility::isNumber(batchJobsStr) || batchJobs <= 0 || batchJobs > MAX_BATCH_COMPILATION_JOBS) {
+        ::MessageBox(getHSelf(), L"Parallel compilations needs to be a number between 1 and 64", L"Invalid setting", MB_ICONERROR | MB_OK);
+        return false;
+      }
+
       settings.compilerSettings.gameMode =
         getChecked(compilerTab, IDC_SETTINGS_COMPILER_RADIO_SKYRIM) ? Game::Skyrim :
         getChecked(compilerTab, IDC_SETTINGS_COMPILER_RADIO_SSE) ? Game::SkyrimSE :
         getChecked(compilerTab, IDC_SETTINGS_COMPILER_RADIO_FO4) ? Game::Fallout4 :
         Game::Auto;
       settings.compilerSettings.allowUnmanagedSource = getChecked(compilerTab, IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE);
+      settings.compilerSettings.batchCompilationJobs = batchJobs;
+      settings.compilerSettings.useCompileCache = getChecked(compilerTab, IDC_SETTINGS_COMPILER_USE_CACHE);
       settings.compilerSettings.autoModeOutputDirectory = getText(compilerTab, IDC_SETTINGS_COMPILER_AUTO_DEFAULT_OUTPUT);
       settings.compilerSettings.autoModeDefaultGame = game::games[getText(compilerTab, IDC_SETTINGS_COMPILER_AUTO_DEFAULT_GAME_DROPDOWN)];
     }
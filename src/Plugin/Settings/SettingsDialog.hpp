@@ -61,9 +61,11 @@ namespace papyrus {
       };
 
       enum class Group {
+        ClassNameCache,
         ClassLink,
         Hover,
         Matcher,
+        Occurrences,
         Annotation,
         Indication,
         GameAuto,
@@ -100,6 +102,7 @@ namespace papyrus {
       ColourPicker classLinkBgColorPicker;
       ColourPicker matchedIndicatorFgColorPicker;
       ColourPicker unmatchedIndicatorFgColorPicker;
+      ColourPicker occurrenceIndicatorFgColorPicker;
       ColourPicker annotationFgColorPicker;
       ColourPicker annotationBgColorPicker;
       ColourPicker errorIndicatorFgColorPicker;
@@ -0,0 +1,317 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestUtil.hpp"
+
+#include "Plugin/Compiler/BatchCompiler.hpp"
+#include "Plugin/Compiler/CompilerProcess.hpp"
+#include "Plugin/Compiler/CompilerSettings.hpp"
+#include "Plugin/Compiler/ErrorParser.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+
+using papyrus::BatchCompiler;
+using papyrus::CompilationRequest;
+using papyrus::CompilationResult;
+using papyrus::CompilerOutput;
+using papyrus::CompilerOutputStream;
+using papyrus::CompilerProcess;
+using papyrus::ErrorParser;
+
+namespace {
+
+  // Runs a batch with a stand-in compiler that fails scripts named in failures, and records what happened
+  class BatchRun {
+    public:
+      std::mutex mutex;
+      std::vector<std::wstring> started;
+      std::vector<std::wstring> finished;
+      std::vector<BatchCompiler::Progress> reports;
+      std::optional<BatchCompiler::Progress> finalProgress;
+      std::atomic<int> numFinishedReports {0};
+      std::vector<std::wstring> failures;
+      std::function<void(const std::wstring&)> onCompile;
+      bool reportsOverlapped {false};
+
+      BatchCompiler batchCompiler {
+        [this](const CompilationRequest& request) {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            started.push_back(request.filePath);
+          }
+          if (onCompile) {
+            onCompile(request.filePath);
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+          std::lock_guard<std::mutex> lock(mutex);
+          finished.push_back(request.filePath);
+          CompilationResult result;
+          if (std::find(failures.begin(), failures.end(), request.filePath) != failures.end()) {
+            result.status = CompilationResult::Status::Failed;
+          }
+          return result;
+        },
+        [this](const CompilationRequest&, const CompilationResult&, const BatchCompiler::Progress& progress) {
+          report(progress);
+        },
+        [this](const BatchCompiler::Progress& progress) {
+          finalProgress = progress;
+          numFinishedReports++;
+        }
+      };
+
+      bool start(const std::vector<std::wstring>& names, size_t maxJobs, std::vector<std::vector<size_t>>&& dependencies = {}) {
+        std::vector<CompilationRequest> requests;
+        for (const auto& name : names) {
+          requests.push_back(CompilationRequest {
+            .filePath = name
+          });
+        }
+        return batchCompiler.start(std::move(requests), maxJobs, std::move(dependencies));
+      }
+
+      bool waitUntilFinished() {
+        return test::waitFor([&] { return !batchCompiler.isRunning(); });
+      }
+
+      // Index of a script in the order scripts finished, or -1 if it wasn't compiled
+      int finishedOrder(const std::wstring& name) {
+        auto iter = std::find(finished.begin(), finished.end(), name);
+        return iter == finished.end() ? -1 : static_cast<int>(iter - finished.begin());
+      }
+
+      int startedOrder(const std::wstring& name) {
+        auto iter = std::find(started.begin(), started.end(), name);
+        return iter == started.end() ? -1 : static_cast<int>(iter - started.begin());
+      }
+
+    private:
+      void report(const BatchCompiler::Progress& progress) {
+        // Reports are made one at a time, so this is never entered twice at the same time
+        if (inReport.exchange(true)) {
+          reportsOverlapped = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        reports.push_back(progress);
+        inReport = false;
+      }
+
+      std::atomic<bool> inReport {false};
+  };
+
+  bool reportsInOrder(const std::vector<BatchCompiler::Progress>& reports) {
+    for (size_t i = 1; i < reports.size(); ++i) {
+      if (reports[i].completed <= reports[i - 1].completed) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void testIndependentScripts() {
+    BatchRun run;
+    std::vector<std::wstring> names;
+    for (int i = 0; i < 50; ++i) {
+      names.push_back(L"script" + std::to_wstring(i));
+    }
+    test::check(run.start(names, 8), "batch starts");
+    test::check(!run.start(names, 8), "second batch doesn't start while running");
+    test::check(run.waitUntilFinished(), "batch finishes");
+
+    test::check(run.finished.size() == names.size(), "all scripts are compiled");
+    test::check(run.reports.size() == names.size(), "each compiled script is reported");
+    test::check(!run.reportsOverlapped, "reports are made one at a time");
+    test::check(reportsInOrder(run.reports), "reports are in order of progress");
+    test::check(run.numFinishedReports == 1 && run.finalProgress && run.finalProgress->completed == 50 && run.finalProgress->failed == 0, "final report counts all scripts");
+    test::check(run.start(names, 8), "next batch starts after last one finished");
+    test::check(run.waitUntilFinished(), "next batch finishes");
+  }
+
+  void testDependencyOrder() {
+    // d depends on c, which depends on a and b. e doesn't depend on anything.
+    BatchRun run;
+    test::check(run.start({L"a", L"b", L"c", L"d", L"e"}, 4, {{}, {}, {0, 1}, {2}, {}}), "batch with dependencies starts");
+    test::check(run.waitUntilFinished(), "batch with dependencies finishes");
+
+    test::check(run.finished.size() == 5, "all scripts with dependencies are compiled");
+    test::check(run.startedOrder(L"c") > run.finishedOrder(L"a") && run.startedOrder(L"c") > run.finishedOrder(L"b"), "script starts after all it depends on finished");
+    test::check(run.startedOrder(L"d") > run.finishedOrder(L"c"), "script starts after indirect dependency finished");
+    test::check(run.finalProgress && run.finalProgress->completed == 5 && run.finalProgress->skipped == 0, "nothing is skipped");
+  }
+
+  void testSkippedDependants() {
+    // b and c depend on a directly or indirectly, and are skipped when it fails. d doesn't depend on it.
+    BatchRun run;
+    run.failures = {L"a"};
+    test::check(run.start({L"a", L"b", L"c", L"d"}, 2, {{}, {0}, {1}, {}}), "batch with failure starts");
+    test::check(run.waitUntilFinished(), "batch with failure finishes");
+
+    test::check(run.finishedOrder(L"b") == -1 && run.finishedOrder(L"c") == -1, "dependants of failed script aren't compiled");
+    test::check(run.finishedOrder(L"d") != -1, "independent script is still compiled");
+    test::check(run.reports.size() == 2, "only compiled scripts are reported");
+    test::check(run.finalProgress && run.finalProgress->completed == 4 && run.finalProgress->failed == 1 && run.finalProgress->skipped == 2, "skipped dependants are counted");
+  }
+
+  void testCancel() {
+    BatchRun run;
+    std::binary_semaphore firstStarted(0);
+    std::binary_semaphore resume(0);
+    run.onCompile = [&](const std::wstring& name) {
+      if (name == L"script0") {
+        firstStarted.release();
+        resume.acquire();
+      }
+    };
+
+    std::vector<std::wstring> names;
+    std::vector<std::vector<size_t>> dependencies;
+    for (size_t i = 0; i < 10; ++i) {
+      names.push_back(L"script" + std::to_wstring(i));
+      dependencies.push_back(i < 5 ? std::vector<size_t>() : std::vector<size_t> {i - 5});
+    }
+    test::check(run.start(names, 1, std::move(dependencies)), "batch to cancel starts");
+    firstStarted.acquire();
+    run.batchCompiler.cancel();
+    resume.release();
+    test::check(run.waitUntilFinished(), "cancelled batch finishes");
+
+    test::check(run.finished == std::vector<std::wstring> {L"script0"}, "only the running script finishes");
+    test::check(run.numFinishedReports == 1 && run.finalProgress && run.finalProgress->completed == 10 && run.finalProgress->skipped == 9, "queued and waiting scripts are skipped");
+  }
+
+  void testDestroyWhileRunning() {
+    // Destroying waits for running compilations, and drops the rest without reporting them
+    std::atomic<int> numCompiled {0};
+    {
+      BatchRun run;
+      std::binary_semaphore started(0);
+      run.onCompile = [&](const std::wstring&) {
+        started.release();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        numCompiled++;
+      };
+      std::vector<std::wstring> names(20, L"script");
+      test::check(run.start(names, 2), "batch to destroy starts");
+      started.acquire();
+    }
+    test::check(numCompiled > 0 && numCompiled < 20, "destroying skips scripts not started yet");
+  }
+
+  // Compile a script with stand-in compiler, handling its output the same way Compiler does with PapyrusCompiler's
+  CompilationResult compileWithStandIn(const CompilationRequest& request, const std::wstring& outputDirectory) {
+    static const papyrus::CompilerSettings::GameSettings gameSettings;
+    std::wstring commandLine = L"\"" + std::filesystem::path(STAND_IN_COMPILER_PATH).wstring() + L"\" \"" + request.filePath + L"\" -o=\"" + outputDirectory + L"\"";
+
+    CompilationResult result;
+    ErrorParser errorParser(gameSettings, outputDirectory);
+    CompilerOutput output;
+    std::wstring errorMsg;
+    unsigned long errorCode {};
+    auto outputCallback = [&](CompilerOutputStream stream, std::string_view data) {
+      if (stream == CompilerOutputStream::StandardError) {
+        errorParser.parse(data);
+      }
+    };
+    if (!CompilerProcess::run(commandLine, outputDirectory, output, errorMsg, errorCode, outputCallback)) {
+      result.status = CompilationResult::Status::OtherError;
+      result.title = errorMsg;
+    } else if (!output.standardError.empty()) {
+      errorParser.finish(output.standardError, result);
+    }
+    return result;
+  }
+
+  void testStandInCompiler() {
+    // Scripts 3 and 7 have errors, the others compile
+    test::TempDirectory temp;
+    std::wstring outputDirectory = (temp.getPath() / "output").wstring();
+    std::filesystem::create_directories(outputDirectory);
+    std::vector<CompilationRequest> requests;
+    for (int i = 0; i < 12; ++i) {
+      std::string content = "ScriptName Script" + std::to_string(i) + "\nFunction Test()\n";
+      if (i == 3) {
+        content += "  Error: variable x is undefined\n  x = 1 Error: type mismatch\n";
+      } else if (i == 7) {
+        content += "Error: missing EndFunction\n";
+      }
+      requests.push_back(CompilationRequest {
+        .filePath = temp.writeFile("Script" + std::to_string(i) + ".psc", content).wstring()
+      });
+    }
+    std::wstring script3 = requests[3].filePath;
+    std::wstring script7 = requests[7].filePath;
+
+    std::mutex mutex;
+    std::map<std::wstring, CompilationResult> results;
+    std::optional<BatchCompiler::Progress> finalProgress;
+    BatchCompiler batchCompiler(
+      [&](const CompilationRequest& request) { return compileWithStandIn(request, outputDirectory); },
+      [&](const CompilationRequest& request, const CompilationResult& result, const BatchCompiler::Progress&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[request.filePath] = result;
+      },
+      [&](const BatchCompiler::Progress& progress) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finalProgress = progress;
+      }
+    );
+    test::check(batchCompiler.start(std::move(requests), 4), "batch with stand-in compiler starts");
+    test::check(test::waitFor([&] { return !batchCompiler.isRunning(); }), "batch with stand-in compiler finishes");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    test::check(finalProgress && finalProgress->completed == 12 && finalProgress->failed == 2, "failed scripts are counted");
+    test::check(results.size() == 12, "each script is reported");
+
+    const auto& errors3 = results[script3].errors;
+    test::check(results[script3].status == CompilationResult::Status::Failed && errors3.size() == 2, "all errors of a script are reported");
+    test::check(errors3.size() == 2
+      && errors3[0].file == script3 && errors3[0].line == 3 && errors3[0].column == 3 && errors3[0].message == L"variable x is undefined"
+      && errors3[1].file == script3 && errors3[1].line == 4 && errors3[1].column == 9 && errors3[1].message == L"type mismatch",
+      "errors have their file, line, column and message");
+
+    const auto& errors7 = results[script7].errors;
+    test::check(errors7.size() == 1 && errors7[0].file == script7 && errors7[0].line == 3, "errors are reported for the script that has them");
+
+    int numCompiled = 0;
+    for (const auto& [filePath, result] : results) {
+      if (filePath != script3 && filePath != script7) {
+        numCompiled += (result.status == CompilationResult::Status::Succeeded && result.errors.empty()) ? 1 : 0;
+      }
+    }
+    test::check(numCompiled == 10, "scripts without errors succeed");
+    test::check(std::filesystem::exists(std::filesystem::path(outputDirectory) / "Script0.pex"), "compiler output is written");
+  }
+
+} // namespace
+
+int main() {
+  testIndependentScripts();
+  testDependencyOrder();
+  testSkippedDependants();
+  testCancel();
+  testDestroyWhileRunning();
+  testStandInCompiler();
+  return test::result();
+}
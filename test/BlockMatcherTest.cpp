@@ -0,0 +1,152 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LexerTestUtil.hpp"
+#include "TestUtil.hpp"
+
+#include "Plugin/KeywordMatcher/BlockMatcher.hpp"
+#include "Plugin/KeywordMatcher/KeywordMatcherSettings.hpp"
+#include "Plugin/Lexer/LexerData.hpp"
+#include "Plugin/Lexer/LexerSettings.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace papyrus {
+
+  std::unique_ptr<LexerData> lexerData;
+
+} // namespace
+
+using papyrus::BlockMatcher;
+
+namespace {
+
+  struct MatchedScript : test::LexedScript {
+    using LexedScript::LexedScript;
+
+    BlockMatcher::Result match(Sci_PositionCR position) {
+      auto target = BlockMatcher::findTarget(matcherDocument, position, papyrus::KEYWORD_ALL);
+      return target ? BlockMatcher::match(matcherDocument, *target) : BlockMatcher::Result();
+    }
+  };
+
+  bool hasRange(const BlockMatcher::Result& result, Sci_PositionCR start) {
+    return std::any_of(result.ranges.begin(), result.ranges.end(), [&](const auto& range) { return range.cpMin == start; });
+  }
+
+  void testIfBlock() {
+    MatchedScript script(
+      "ScriptName Test\n"
+      "Function Test(Int x)\n"
+      "  If x == 0\n"
+      "  ElseIf x == 1\n"
+      "  Else\n"
+      "  EndIf\n"
+      "EndFunction\n");
+    Sci_PositionCR ifPos = script.find("If x");
+    Sci_PositionCR elseIfPos = script.find("ElseIf");
+    Sci_PositionCR elsePos = script.find("Else\n");
+    Sci_PositionCR endIfPos = script.find("EndIf");
+
+    auto result = script.match(ifPos);
+    test::check(result.matched && result.complete && result.matchedPos == endIfPos, "If is matched with EndIf");
+    test::check(result.ranges.size() == 4 && hasRange(result, elseIfPos) && hasRange(result, elsePos), "If highlights its middle keywords");
+
+    result = script.match(elseIfPos);
+    test::check(result.matched && result.matchedPos == ifPos, "ElseIf goes to its If");
+    test::check(hasRange(result, endIfPos) && hasRange(result, elsePos), "ElseIf highlights the rest of its block");
+
+    result = script.match(elsePos + 1);
+    test::check(result.matched && result.matchedPos == ifPos, "Else is matched from the middle of the word");
+
+    result = script.match(endIfPos);
+    test::check(result.matched && result.matchedPos == ifPos, "EndIf is matched with If");
+
+    auto target = BlockMatcher::findTarget(script.matcherDocument, elseIfPos, papyrus::KEYWORD_IF);
+    test::check(!target, "ElseIf isn't matched unless Else is enabled");
+  }
+
+  void testFunctionAndProperty() {
+    MatchedScript script(
+      "ScriptName Test\n"
+      "Function Helper() Native\n"
+      "Int Property Count Auto\n"
+      "Int Property Total\n"
+      "  Int Function Get()\n"
+      "    Return Count\n"
+      "  EndFunction\n"
+      "EndProperty\n");
+
+    auto result = script.match(script.find("Function"));
+    test::check(result.matched && result.matchedPos == script.find("Native"), "Function is closed by Native");
+    result = script.match(script.find("Native"));
+    test::check(result.matched && result.matchedPos == script.find("Function"), "Native is matched with Function");
+
+    result = script.match(script.find("Property"));
+    test::check(result.matched && result.matchedPos == script.find("Auto"), "Property is closed by Auto");
+    result = script.match(script.find("Auto"));
+    test::check(result.matched && result.matchedPos == script.find("Property"), "Auto is matched with Property");
+
+    result = script.match(script.find("Property", 1));
+    test::check(result.matched && result.matchedPos == script.find("EndProperty"), "full property is closed by EndProperty");
+    result = script.match(script.find("Function", 1));
+    test::check(result.matched && result.matchedPos == script.find("EndFunction"), "function in property is closed by EndFunction");
+  }
+
+  void testAutoState() {
+    MatchedScript script(
+      "ScriptName Test\n"
+      "Auto State Waiting\n"
+      "  Event OnInit()\n"
+      "  EndEvent\n"
+      "EndState\n");
+
+    auto result = script.match(script.find("State"));
+    test::check(result.matched && result.matchedPos == script.find("EndState"), "Auto State is closed by EndState");
+    result = script.match(script.find("EndState"));
+    test::check(result.matched && result.matchedPos == script.find("State"), "EndState is matched with State");
+    result = script.match(script.find("Auto"));
+    test::check(!result.matched, "Auto of a state isn't matched as a property");
+  }
+
+  void testUnmatchedAtEnd() {
+    MatchedScript script(
+      "ScriptName Test\n"
+      "Function Test(Int x)\n"
+      "  While x > 0\n"
+      "    If x == 1\n");
+
+    for (const char* word : {"Function", "While", "If x"}) {
+      auto result = script.match(script.find(word));
+      test::check(!result.matched && result.complete, word);
+      test::check(result.ranges.size() == 1, "unmatched keyword only highlights itself");
+    }
+  }
+
+} // namespace
+
+int main() {
+  papyrus::lexerData = std::make_unique<papyrus::LexerData>(papyrus::LexerSettings());
+  testIfBlock();
+  testFunctionAndProperty();
+  testAutoState();
+  testUnmatchedAtEnd();
+  return test::result();
+}
@@ -0,0 +1,181 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestUtil.hpp"
+
+#include "Plugin/Compiler/BuildPlanner.hpp"
+
+#include <algorithm>
+#include <map>
+
+using papyrus::BuildPlanner;
+using papyrus::CompilationRequest;
+using papyrus::CompilationTarget;
+
+namespace {
+
+  using file_time_t = std::filesystem::file_time_type;
+
+  // Scripts in a project directory, with outputs in a separate directory. File names are lower case, since referenced scripts are looked
+  // for on file system by case-folded names, which is case-sensitive on some platforms.
+  struct Project {
+    test::TempDirectory temp;
+    file_time_t sourceTime {file_time_t::clock::now() - std::chrono::hours(1)};
+
+    void writeScript(const std::string& name, std::string_view content) {
+      auto filePath = temp.writeFile("scripts/" + name + ".psc", content);
+      std::filesystem::last_write_time(filePath, sourceTime);
+    }
+
+    // Write outputs of all scripts, newer than all sources
+    void writeOutputs(const std::vector<std::string>& names) {
+      for (const auto& name : names) {
+        auto filePath = temp.writeFile("output/" + name + ".pex", "compiled");
+        std::filesystem::last_write_time(filePath, sourceTime + std::chrono::minutes(1));
+      }
+    }
+
+    // Make a script newer than all outputs
+    void touchScript(const std::string& name) {
+      std::filesystem::last_write_time(temp.getPath() / "scripts" / (name + ".psc"), sourceTime + std::chrono::minutes(2));
+    }
+
+    BuildPlanner::Plan plan(const std::vector<std::string>& names, std::stop_token stopToken = {}) {
+      std::vector<CompilationRequest> requests;
+      for (const auto& name : names) {
+        requests.push_back(CompilationRequest {
+          .filePath = (temp.getPath() / "scripts" / (name + ".psc")).wstring()
+        });
+      }
+      return BuildPlanner::plan(std::move(requests),
+        [&](const CompilationRequest& request, const std::string&) {
+          return CompilationTarget {
+            .workingDirectory = (temp.getPath() / "scripts").wstring(),
+            .searchDirectories = {(temp.getPath() / "scripts").wstring()},
+            .outputDirectory = (temp.getPath() / "output").wstring(),
+            .outputFile = (temp.getPath() / "output" / std::filesystem::path(request.filePath).stem()).wstring() + L".pex"
+          };
+        },
+        stopToken
+      );
+    }
+  };
+
+  // Names of planned scripts in plan order, and names of scripts each of them waits for
+  struct PlanNames {
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<std::string>> dependencies;
+
+    explicit PlanNames(const BuildPlanner::Plan& plan) {
+      for (size_t i = 0; i < plan.requests.size(); ++i) {
+        auto name = std::filesystem::path(plan.requests[i].filePath).stem().string();
+        order.push_back(name);
+        auto& names = dependencies[name];
+        for (size_t dependency : plan.dependencies[i]) {
+          test::check(dependency < i, "scripts only wait for earlier scripts");
+          names.push_back(std::filesystem::path(plan.requests[dependency].filePath).stem().string());
+        }
+        std::sort(names.begin(), names.end());
+      }
+    }
+
+    size_t position(const std::string& name) const {
+      return std::find(order.begin(), order.end(), name) - order.begin();
+    }
+  };
+
+  void testDependencyOrder() {
+    Project project;
+    project.writeScript("base", "ScriptName Base\n");
+    project.writeScript("mid", "ScriptName Mid extends Base\n");
+    project.writeScript("leaf", "ScriptName Leaf\nMid Property M Auto\n");
+    project.writeScript("shape", "ScriptName Shape\nLeaf:Point Function GetOrigin()\nEndFunction\n");
+    project.writeScript("lone", "ScriptName Lone\n");
+
+    PlanNames plan(project.plan({"leaf", "lone", "mid", "base", "shape"}));
+    test::check(plan.order.size() == 5, "scripts without output are all compiled");
+    test::check(plan.position("base") < plan.position("mid") && plan.position("mid") < plan.position("leaf"), "parent comes before child");
+    test::check(plan.position("leaf") < plan.position("shape"), "script declaring a struct comes before its users");
+    test::check(plan.dependencies["mid"] == std::vector<std::string> {"base"}, "child waits for parent");
+    test::check(plan.dependencies["leaf"] == std::vector<std::string> {"mid"}, "script only waits for nearest compiled dependencies");
+    test::check(plan.dependencies["lone"].empty(), "unrelated script doesn't wait");
+  }
+
+  void testChangedScripts() {
+    Project project;
+    project.writeScript("base", "ScriptName Base\n");
+    project.writeScript("child", "ScriptName Child extends Base\n");
+    project.writeScript("other", "ScriptName Other\n");
+    project.writeOutputs({"base", "child", "other"});
+
+    auto plan = project.plan({"base", "child", "other"});
+    test::check(plan.requests.empty() && plan.upToDate == 3, "scripts with newer outputs are up to date");
+
+    project.touchScript("base");
+    PlanNames changed(project.plan({"base", "child", "other"}));
+    test::check(changed.order == std::vector<std::string> {"base", "child"}, "changed script and its dependants are compiled");
+  }
+
+  void testCycles() {
+    Project project;
+    project.writeScript("first", "ScriptName First\nSecond Property S Auto\n");
+    project.writeScript("second", "ScriptName Second\nFunction F()\n  First f = None\nEndFunction\n");
+    project.writeScript("user", "ScriptName User extends First\n");
+
+    PlanNames plan(project.plan({"user", "first", "second"}));
+    test::check(plan.order.size() == 3, "scripts referencing each other are compiled");
+    test::check(plan.dependencies["first"].empty() && plan.dependencies["second"].empty(), "scripts referencing each other don't wait for each other");
+    test::check(plan.dependencies["user"] == std::vector<std::string> {"first", "second"}, "dependant waits for the whole cycle");
+  }
+
+  void testLongChain() {
+    // Dependencies are followed without recursion, so a long chain doesn't depend on how large the thread's stack is
+    constexpr size_t LENGTH = 5000;
+    Project project;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < LENGTH; ++i) {
+      names.push_back("s" + std::to_string(i));
+      project.writeScript(names.back(), "ScriptName " + names.back() + (i > 0 ? " extends s" + std::to_string(i - 1) : "") + "\n");
+    }
+    std::reverse(names.begin(), names.end());
+
+    PlanNames plan(project.plan(names));
+    std::reverse(names.begin(), names.end());
+    test::check(plan.order == names, "long chain is compiled from its root");
+  }
+
+  void testStop() {
+    Project project;
+    project.writeScript("base", "ScriptName Base\n");
+    std::stop_source stopSource;
+    stopSource.request_stop();
+    auto plan = project.plan({"base"}, stopSource.get_token());
+    test::check(plan.requests.empty() && plan.upToDate == 0, "stopped planning returns an empty plan");
+  }
+
+} // namespace
+
+int main() {
+  testDependencyOrder();
+  testChangedScripts();
+  testCycles();
+  testLongChain();
+  testStop();
+  return test::result();
+}
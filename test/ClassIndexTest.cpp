@@ -0,0 +1,163 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestUtil.hpp"
+
+#include "Plugin/Lexer/ClassIndex.hpp"
+
+#include <atomic>
+
+using papyrus::ClassIndex;
+
+namespace {
+
+  // Scripts in two import directories, where the first one has precedence
+  struct ScriptTree {
+    test::TempDirectory temp;
+    std::wstring firstDirectory;
+    std::wstring secondDirectory;
+
+    ScriptTree() {
+      firstDirectory = (temp.getPath() / "first").wstring();
+      secondDirectory = (temp.getPath() / "second").wstring();
+      temp.writeFile("first/Actor.psc", "ScriptName Actor extends ObjectReference\n");
+      temp.writeFile("first/MyMod/Helper.psc", "ScriptName MyMod:Helper\nFunction Help()\nEndFunction\n");
+      temp.writeFile("first/Readme.txt", "Not a script\n");
+      temp.writeFile("second/Actor.psc", "ScriptName Actor\n");
+      temp.writeFile("second/Quest.PSC", "ScriptName Quest\n");
+    }
+
+    std::vector<std::wstring> directories() const { return {firstDirectory, secondDirectory}; }
+  };
+
+  void testClassNames() {
+    test::check(ClassIndex::getClassName("Actor.psc") == "actor", "class name is case-folded");
+    test::check(ClassIndex::getClassName("MyMod/Sub/Helper.PSC") == "mymod:sub:helper", "sub-directories are namespaces");
+    test::check(ClassIndex::getClassName("Actor.pex").empty(), "only scripts have class names");
+    test::check(ClassIndex::getClassName("psc").empty(), "file without extension isn't a script");
+  }
+
+  void checkLookups(const ClassIndex& classIndex, const ScriptTree& tree, std::string_view description) {
+    std::wstring filePath;
+    test::check(classIndex.find("actor", &filePath) == ClassIndex::Result::Found, description);
+    test::check(std::filesystem::path(filePath).parent_path() == std::filesystem::path(tree.firstDirectory), "first directory wins");
+    test::check(classIndex.find("mymod:helper") == ClassIndex::Result::Found, "namespaced class is found");
+    test::check(classIndex.find("helper") == ClassIndex::Result::NotFound, "namespaced class needs its namespace");
+    test::check(classIndex.find("quest") == ClassIndex::Result::Found, "extension is case-insensitive");
+    test::check(classIndex.find("readme") == ClassIndex::Result::NotFound, "other files aren't classes");
+    test::check(classIndex.size() == 3, "all scripts are indexed once");
+  }
+
+  void testInMemoryIndex() {
+    ScriptTree tree;
+    ClassIndex classIndex;
+    classIndex.build(tree.directories());
+    test::check(test::waitFor([&] { return classIndex.find("actor") != ClassIndex::Result::NotReady; }), "in-memory index gets ready");
+    checkLookups(classIndex, tree, "in-memory index finds class");
+    test::check(classIndex.getDatabase() == nullptr, "no database without a file");
+  }
+
+  void testDatabase() {
+    ScriptTree tree;
+    std::wstring databaseFilePath = (tree.temp.getPath() / "symbols.db").wstring();
+    {
+      ClassIndex classIndex;
+      classIndex.build(tree.directories(), databaseFilePath);
+      test::check(test::waitFor([&] { return classIndex.getDatabase() != nullptr; }), "database is written");
+      checkLookups(classIndex, tree, "database finds class");
+
+      auto database = classIndex.getDatabase();
+      auto script = database->findScript("mymod:helper");
+      test::check(script && database->findSymbol(*script, "help"), "database records functions");
+    }
+
+    // Database left by previous session serves lookups right away
+    ClassIndex classIndex;
+    classIndex.build(tree.directories(), databaseFilePath);
+    test::check(classIndex.find("actor") == ClassIndex::Result::Found, "existing database is used before update finishes");
+
+    // Database of other directories isn't used for lookups
+    ClassIndex otherIndex;
+    otherIndex.build({tree.secondDirectory}, databaseFilePath);
+    test::check(test::waitFor([&] { return otherIndex.find("actor") != ClassIndex::Result::NotReady; }), "database is rebuilt for other directories");
+    test::check(otherIndex.find("mymod:helper") == ClassIndex::Result::NotFound, "rebuilt database only has scripts of its directories");
+  }
+
+  // Scripts of a large mod setup, spread over namespace directories like FO4's, with a few loose ones in the import directory itself
+  void testScale() {
+    constexpr int NUM_NAMESPACES = 100;
+    constexpr int SCRIPTS_PER_NAMESPACE = 300;
+    constexpr auto MAX_BUILD_TIME = std::chrono::seconds(10);
+
+    test::TempDirectory temp;
+    for (int i = 0; i < NUM_NAMESPACES; ++i) {
+      auto directory = temp.getPath() / ("Mod" + std::to_string(i));
+      std::filesystem::create_directories(directory);
+      for (int j = 0; j < SCRIPTS_PER_NAMESPACE; ++j) {
+        std::ofstream(directory / ("Script" + std::to_string(j) + ".psc"), std::ios::binary) << "ScriptName Script\n";
+      }
+    }
+    temp.writeFile("Actor.psc", "ScriptName Actor\n");
+
+    auto start = std::chrono::steady_clock::now();
+    ClassIndex classIndex;
+    classIndex.build({temp.getPath().wstring()});
+    bool ready = test::waitFor([&] { return classIndex.find("actor") != ClassIndex::Result::NotReady; });
+    auto buildTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Indexed " << classIndex.size() << " scripts in " << buildTime.count() << " ms" << std::endl;
+    test::check(ready && buildTime < MAX_BUILD_TIME, "large index is built in time");
+    test::check(classIndex.size() == NUM_NAMESPACES * SCRIPTS_PER_NAMESPACE + 1, "all scripts of large index are indexed");
+
+    std::wstring filePath;
+    test::check(classIndex.find("mod0:script0", &filePath) == ClassIndex::Result::Found
+      && std::filesystem::path(filePath) == temp.getPath() / "Mod0" / "Script0.psc", "first script is found with its path");
+    test::check(classIndex.find("mod99:script299") == ClassIndex::Result::Found, "last script is found");
+    test::check(classIndex.find("actor") == ClassIndex::Result::Found, "loose script is found");
+    test::check(classIndex.find("script0") == ClassIndex::Result::NotFound, "namespaced script isn't found without its namespace");
+    test::check(classIndex.find("mod0:script300") == ClassIndex::Result::NotFound, "missing script isn't found");
+  }
+
+  void testWatchedChanges() {
+    ScriptTree tree;
+    std::atomic<int> numNotifications {0};
+    ClassIndex classIndex;
+    classIndex.build(tree.directories(), std::wstring(), [&] { numNotifications++; });
+    test::check(test::waitFor([&] { return classIndex.find("actor") != ClassIndex::Result::NotReady; }), "watched index gets ready");
+
+    // Let watchers take their first look before changing anything. File name is lower case, since changed classes are checked on file
+    // system by class name, which is case-sensitive on some platforms.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    tree.temp.writeFile("second/added.psc", "ScriptName Added\n");
+    test::check(test::waitFor([&] { return numNotifications > 0; }), "added script is reported");
+
+    auto changes = classIndex.takeChanges();
+    test::check(!changes.overflowed && changes.classNames == std::vector<std::string> {"added"}, "changes name added class");
+    test::check(classIndex.find("added") == ClassIndex::Result::Found, "added class is found");
+  }
+
+} // namespace
+
+int main() {
+  testClassNames();
+  testInMemoryIndex();
+  testDatabase();
+  testScale();
+  testWatchedChanges();
+  return test::result();
+}
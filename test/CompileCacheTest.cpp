@@ -0,0 +1,113 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestUtil.hpp"
+
+#include "Plugin/Compiler/CompileCache.hpp"
+
+#include <sstream>
+
+using papyrus::CompileCache;
+
+namespace {
+
+  // A script directory with a stand-in compiler. File names are lower case, since referenced scripts are looked for on file system by
+  // case-folded names, which is case-sensitive on some platforms.
+  struct Project {
+    test::TempDirectory temp;
+    std::wstring scriptDirectory;
+    std::wstring compilerPath;
+    CompileCache cache;
+
+    Project()
+      : scriptDirectory((temp.getPath() / "scripts").wstring()),
+        compilerPath(temp.writeFile("compiler.exe", "compiler").wstring()),
+        cache((temp.getPath() / "cache").wstring()) {
+      temp.writeFile("scripts/main.psc", "ScriptName Main extends Base\nShapes:Point Function GetOrigin()\nEndFunction\nShapes#Size size\n");
+      temp.writeFile("scripts/base.psc", "ScriptName Base\n");
+      temp.writeFile("scripts/shapes.psc", "ScriptName Shapes\nStruct Point\n  Float X\nEndStruct\nStruct Size\n  Float Width\nEndStruct\n");
+      temp.writeFile("scripts/unrelated.psc", "ScriptName Unrelated\n");
+    }
+
+    CompileCache::key_t getKey(std::string_view description, const std::wstring& commandLine = L"main.psc") {
+      CompileCache::key_t key {};
+      test::check(cache.getKey(scriptPath("main.psc"), commandLine, compilerPath, L"", {scriptDirectory}, key), description);
+      return key;
+    }
+
+    // Rewrite a script with different size, so the change is seen even if modification time doesn't change
+    void changeScript(const std::string& fileName, std::string_view addition) {
+      std::ifstream file(temp.getPath() / "scripts" / fileName, std::ios::binary);
+      std::stringstream content;
+      content << file.rdbuf();
+      file.close();
+      temp.writeFile("scripts/" + fileName, content.str() + std::string(addition));
+    }
+
+    std::wstring scriptPath(const std::string& fileName) const { return (temp.getPath() / "scripts" / fileName).wstring(); }
+  };
+
+  void testUnchangedScripts() {
+    Project project;
+    auto key = project.getKey("key of unchanged scripts");
+    test::check(project.getKey("key calculated again") == key, "same scripts have the same key");
+    project.changeScript("unrelated.psc", "Int Count\n");
+    test::check(project.getKey("key after unrelated change") == key, "change of unrelated script keeps the key");
+    test::check(project.getKey("key of other arguments", L"main.psc -op") != key, "command line is part of the key");
+  }
+
+  void testChangedDependencies() {
+    Project project;
+    auto key = project.getKey("key before parent changes");
+    project.changeScript("base.psc", "Function Added()\nEndFunction\n");
+    auto parentChangedKey = project.getKey("key after parent changes");
+    test::check(parentChangedKey != key, "change of parent changes the key");
+
+    // Both "Shapes:Point" and "Shapes#Size" are structs of Shapes, so changing it must not give a stale key
+    project.changeScript("shapes.psc", "Struct Color\n  Int Value\nEndStruct\n");
+    auto structChangedKey = project.getKey("key after struct script changes");
+    test::check(structChangedKey != parentChangedKey, "change of script declaring a used struct changes the key");
+
+    // "Shapes:Point" would now be a script of its own, which the compiler uses instead
+    project.temp.writeFile("scripts/shapes/point.psc", "ScriptName Shapes:Point\n");
+    test::check(project.getKey("key after namespaced script is added") != structChangedKey, "added script that takes precedence changes the key");
+  }
+
+  void testStoreAndRestore() {
+    Project project;
+    auto key = project.getKey("key to store");
+    auto outputPath = project.temp.writeFile("output/main.pex", "compiled");
+    project.cache.store(key, outputPath.wstring());
+
+    std::filesystem::remove(outputPath);
+    test::check(project.cache.restore(key, outputPath.wstring()), "stored output is restored");
+    std::ifstream file(outputPath, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    test::check(content == "compiled", "restored output has stored content");
+    test::check(!project.cache.restore(key + 1, outputPath.wstring()), "output of other key isn't restored");
+  }
+
+} // namespace
+
+int main() {
+  testUnchangedScripts();
+  testChangedDependencies();
+  testStoreAndRestore();
+  return test::result();
+}
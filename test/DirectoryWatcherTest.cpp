@@ -0,0 +1,106 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestUtil.hpp"
+
+#include "Plugin/Common/DirectoryWatcher.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using utility::DirectoryWatcher;
+
+namespace {
+
+  // Changes are expected well before the watcher would have polled
+  constexpr auto MAX_REPORT_TIME = std::chrono::seconds(2);
+
+  using change_t = std::pair<DirectoryWatcher::Change, std::filesystem::path>;
+
+  class ChangeRecorder {
+    public:
+      DirectoryWatcher::change_callback_t callback() {
+        return [this](DirectoryWatcher::Change change, const std::filesystem::path& relativePath) {
+          std::lock_guard<std::mutex> lock(mutex);
+          changes.emplace_back(change, relativePath);
+        };
+      }
+
+      // Wait until given change is reported, and remove it with everything reported before it
+      bool take(DirectoryWatcher::Change change, const std::filesystem::path& relativePath) {
+        return test::waitFor([&] {
+          std::lock_guard<std::mutex> lock(mutex);
+          auto iter = std::find(changes.begin(), changes.end(), change_t(change, relativePath));
+          if (iter == changes.end()) {
+            return false;
+          }
+          changes.erase(changes.begin(), iter + 1);
+          return true;
+        }, MAX_REPORT_TIME);
+      }
+
+    private:
+      std::mutex mutex;
+      std::vector<change_t> changes;
+  };
+
+  void testChanges() {
+    test::TempDirectory temp;
+    std::filesystem::create_directories(temp.getPath() / "Existing" / "Sub");
+    ChangeRecorder recorder;
+    DirectoryWatcher watcher(temp.getPath().wstring(), recorder.callback());
+
+    // Let watcher take its first look before changing anything
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    temp.writeFile("Added.psc", "ScriptName Added\n");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "Added.psc"), "added file is reported");
+
+    temp.writeFile("Existing/Sub/Nested.psc", "ScriptName Nested\n");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "Existing/Sub/Nested.psc"), "file added to existing subdirectory is reported");
+
+    std::filesystem::rename(temp.getPath() / "Added.psc", temp.getPath() / "Renamed.psc");
+    test::check(recorder.take(DirectoryWatcher::Change::Removed, "Added.psc"), "old name of renamed file is reported as removed");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "Renamed.psc"), "new name of renamed file is reported as added");
+
+    std::filesystem::remove(temp.getPath() / "Renamed.psc");
+    test::check(recorder.take(DirectoryWatcher::Change::Removed, "Renamed.psc"), "removed file is reported");
+
+    std::filesystem::create_directories(temp.getPath() / "New");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "New"), "added directory is reported");
+    temp.writeFile("New/Script.psc", "ScriptName Script\n");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "New/Script.psc"), "file added to new directory is reported");
+
+    // Subdirectories of a moved directory are reported with their new paths
+    std::filesystem::rename(temp.getPath() / "Existing", temp.getPath() / "New" / "Moved");
+    test::check(recorder.take(DirectoryWatcher::Change::Removed, "Existing"), "moved directory is reported as removed");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "New/Moved"), "moved directory is reported as added");
+    temp.writeFile("New/Moved/Sub/Later.psc", "ScriptName Later\n");
+    test::check(recorder.take(DirectoryWatcher::Change::Added, "New/Moved/Sub/Later.psc"), "file added to moved directory has its new path");
+  }
+
+} // namespace
+
+int main() {
+#ifdef __linux__
+  testChanges();
+#endif
+  return test::result();
+}
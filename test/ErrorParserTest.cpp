@@ -0,0 +1,142 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestUtil.hpp"
+
+#include "Plugin/Compiler/CompilerProcess.hpp"
+#include "Plugin/Compiler/CompilerSettings.hpp"
+#include "Plugin/Compiler/ErrorParser.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+using papyrus::CompilationResult;
+using papyrus::CompilerOutput;
+using papyrus::CompilerOutputStream;
+using papyrus::CompilerProcess;
+using papyrus::CompilerSettings;
+using papyrus::Error;
+using papyrus::ErrorParser;
+
+namespace {
+
+  bool sameError(const Error& error1, const Error& error2) {
+    return error1.file == error2.file && error1.line == error2.line && error1.column == error2.column && error1.message == error2.message;
+  }
+
+  void testChunks() {
+    CompilerSettings::GameSettings gameSettings;
+    gameSettings.optimizeFlag = true;
+    std::vector<Error> reported;
+    ErrorParser parser(gameSettings, L"out", [&](const Error& error) { reported.push_back(error); });
+
+    // Chunks split lines in the middle, including the line numbers of errors. Second error is reported twice.
+    std::string output =
+      "Starting 1 compile threads for 1 files...\n"
+      "C:\\Mod\\Quest.psc(12,5): variable x is undefined\n"
+      "Assembly failed: Quest.pas(30) : invalid opcode\n"
+      "C:\\Mod\\Quest.psc(x,5): not a line number\n"
+      "C:\\Mod\\Quest.psc(14,9): type mismatch\n"
+      "C:\\Mod\\Quest.psc(14,9): type mismatch\n";
+    constexpr size_t CHUNK_SIZE = 7;
+    size_t firstErrorEnd = output.find('\n', output.find(".psc("));
+    for (size_t chunkStart = 0; chunkStart < output.size(); chunkStart += CHUNK_SIZE) {
+      parser.parse(std::string_view(output).substr(chunkStart, CHUNK_SIZE));
+      if (chunkStart <= firstErrorEnd && firstErrorEnd < chunkStart + CHUNK_SIZE) {
+        test::check(reported.size() == 1, "error is reported as soon as its line is complete");
+      }
+    }
+
+    test::check(reported.size() == 3, "each distinct error is reported once before finish");
+    test::check(reported.size() == 3 && sameError(reported[0], Error {.file = L"C:\\Mod\\Quest.psc", .message = L"variable x is undefined", .line = 12, .column = 5}),
+      "error split across chunks is parsed");
+    test::check(reported.size() == 3 && reported[1].file == (std::filesystem::path(L"out") / L"Assembly failed: Quest.pas").wstring()
+      && reported[1].line == 30 && reported[1].column == 1, ".pas error is found in output directory, without column");
+    test::check(reported.size() == 3 && sameError(reported[2], Error {.file = L"C:\\Mod\\Quest.psc", .message = L"type mismatch", .line = 14, .column = 9}),
+      "error after unparsable line is parsed");
+
+    CompilationResult result;
+    parser.finish(output, result);
+    test::check(reported.size() == 3, "finish doesn't report errors again");
+    test::check(result.status == CompilationResult::Status::Failed && result.hasUnparsableLines, "unparsable line is flagged");
+    test::check(result.errors.size() == 3 && sameError(result.errors[0], reported[0]) && sameError(result.errors[2], reported[2]), "result has reported errors");
+  }
+
+  void testIncompleteLastLine() {
+    CompilerSettings::GameSettings gameSettings;
+    std::vector<Error> reported;
+    ErrorParser parser(gameSettings, L"out", [&](const Error& error) { reported.push_back(error); });
+    std::string output = "C:\\Mod\\Quest.psc(3,1): missing EndFunction";
+    parser.parse(output);
+    test::check(reported.empty(), "incomplete line waits for the rest of it");
+
+    CompilationResult result;
+    parser.finish(output, result);
+    test::check(reported.size() == 1 && result.errors.size() == 1 && result.errors[0].line == 3, "last line without line break is parsed by finish");
+  }
+
+  void testNothingParsable() {
+    CompilerSettings::GameSettings gameSettings;
+    ErrorParser parser(gameSettings, L"out");
+    std::string output = "Compiler crashed\n";
+    parser.parse(output);
+    CompilationResult result;
+    parser.finish(output, result);
+    test::check(result.errors.size() == 1 && result.errors[0].file.empty() && result.errors[0].message == L"Compiler crashed\n", "whole output is the error when nothing can be parsed");
+  }
+
+  void testStreamingFromProcess() {
+    // Compiler reports an error, floods stdout with more than a pipe holds, then keeps running for a while. This runs the process runner
+    // of the platform the test is built on, so the Windows one is only covered when tests are built on Windows.
+    test::TempDirectory temp;
+    std::wstring scriptPath = temp.writeFile("Quest.psc", "ScriptName Quest\nError: first error\nFlood: 1048576\nSleep: 1500\nError: second error\n").wstring();
+    std::wstring commandLine = L"\"" + std::filesystem::path(STAND_IN_COMPILER_PATH).wstring() + L"\" \"" + scriptPath + L"\" -o=\"" + temp.getPath().wstring() + L"\"";
+
+    CompilerSettings::GameSettings gameSettings;
+    std::mutex mutex;
+    std::vector<std::chrono::steady_clock::time_point> reportTimes;
+    ErrorParser parser(gameSettings, temp.getPath().wstring(), [&](const Error&) {
+      std::lock_guard<std::mutex> lock(mutex);
+      reportTimes.push_back(std::chrono::steady_clock::now());
+    });
+    CompilerOutput output;
+    std::wstring errorMsg;
+    unsigned long errorCode {};
+    bool succeeded = CompilerProcess::run(commandLine, temp.getPath().wstring(), output, errorMsg, errorCode, [&](CompilerOutputStream stream, std::string_view data) {
+      if (stream == CompilerOutputStream::StandardError) {
+        parser.parse(data);
+      }
+    });
+    auto exitTime = std::chrono::steady_clock::now();
+
+    test::check(succeeded, "compiler flooding stdout runs to completion");
+    test::check(output.standardOutput.size() > 1048576, "flooded stdout is captured");
+    test::check(reportTimes.size() == 2 && exitTime - reportTimes[0] > std::chrono::seconds(1), "first error is reported while compiler is still running");
+  }
+
+} // namespace
+
+int main() {
+  testChunks();
+  testIncompleteLastLine();
+  testNothingParsable();
+  testStreamingFromProcess();
+  return test::result();
+}
@@ -0,0 +1,69 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Plugin/KeywordMatcher/MemoryMatcherDocument.hpp"
+#include "Plugin/Lexer/Lexer.hpp"
+#include "Plugin/Lexer/MemoryDocument.hpp"
+
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace test {
+
+  // Same word lists as lexer's config file
+  constexpr const char* WORD_LISTS[] {
+    "( ) [ ] , = + - * / % . ! > < | & as is",
+    "if else elseif endif while endwhile",
+    "bool float int string var",
+    "scriptname extends import debugonly betaonly default event endevent state endstate function endfunction global native struct endstruct "
+      "property endproperty auto autoreadonly conditional hidden const mandatory group endgroup collapsed collapsedonref collapsedonbase "
+      "new return length",
+    "none parent self true false",
+    "if while function struct property group event state",
+    "else elseif",
+    "endif endwhile endfunction native endstruct endproperty auto autoreadonly endgroup endevent endstate"
+  };
+
+  // A script lexed as a whole by a lexer that isn't used on a Notepad++ buffer. Test program needs to set up papyrus::lexerData first.
+  struct LexedScript {
+    papyrus::MemoryDocument document;
+    papyrus::Lexer lexer;
+    papyrus::MemoryMatcherDocument matcherDocument;
+
+    explicit LexedScript(std::string_view script) : document(script), matcherDocument(document, lexer) {
+      for (int i = 0; i < static_cast<int>(std::size(WORD_LISTS)); ++i) {
+        lexer.WordListSet(i, WORD_LISTS[i]);
+      }
+      matcherDocument.styleLines(document.getLineCount());
+    }
+
+    // Position of the given occurrence of a word in script, counting from 0
+    Sci_PositionCR find(std::string_view word, int occurrence = 0) const {
+      size_t position = document.getText().find(word);
+      for (int i = 0; i < occurrence && position != std::string::npos; ++i) {
+        position = document.getText().find(word, position + 1);
+      }
+      return static_cast<Sci_PositionCR>(position);
+    }
+  };
+
+} // namespace
@@ -0,0 +1,112 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LexerTestUtil.hpp"
+#include "TestUtil.hpp"
+
+#include "Plugin/KeywordMatcher/OccurrenceMatcher.hpp"
+#include "Plugin/Lexer/AtomTable.hpp"
+#include "Plugin/Lexer/LexerData.hpp"
+#include "Plugin/Lexer/LexerSettings.hpp"
+
+#include <memory>
+#include <string>
+
+namespace papyrus {
+
+  std::unique_ptr<LexerData> lexerData;
+
+} // namespace
+
+using papyrus::AtomTable;
+using papyrus::OccurrenceMatcher;
+
+namespace {
+
+  struct HighlightedScript : test::LexedScript {
+    explicit HighlightedScript(std::string_view script) : LexedScript(script) {
+      matcherDocument.setVisibleLines(0, document.getLineCount());
+    }
+
+    // Start positions of highlighted occurrences of the name at position
+    std::vector<Sci_PositionCR> highlight(Sci_PositionCR position) {
+      std::vector<Sci_PositionCR> starts;
+      for (const auto& range : OccurrenceMatcher::match(matcherDocument, position).ranges) {
+        starts.push_back(range.cpMin);
+      }
+      return starts;
+    }
+  };
+
+  void testOccurrences() {
+    HighlightedScript script(
+      "ScriptName Test\n"
+      "Int Property Count Auto\n"
+      "Function Test(Int x)\n"
+      "  count = Helper(x)\n"
+      "  Debug.Trace(COUNT)\n"
+      "EndFunction\n");
+    std::vector<Sci_PositionCR> counts {script.find("Count"), script.find("count"), script.find("COUNT")};
+    test::check(script.highlight(script.find("count") + 2) == counts, "declared name is found regardless of case");
+
+    std::vector<Sci_PositionCR> helpers {script.find("Helper")};
+    test::check(script.highlight(script.find("Helper")) == helpers, "undeclared name is found");
+    test::check(script.highlight(script.find("Function")).empty(), "keywords aren't names");
+  }
+
+  void testSameHash() {
+    // Both pairs of names have the same FNV-1a hash, the first one with names of different lengths
+    HighlightedScript script(
+      "ScriptName Test\n"
+      "Function Test()\n"
+      "  costarring(liquid)\n"
+      "  declinate(macallums)\n"
+      "  macallums(declinate, liquid)\n"
+      "EndFunction\n");
+    std::vector<Sci_PositionCR> liquids {script.find("liquid"), script.find("liquid", 1)};
+    test::check(script.highlight(script.find("liquid")) == liquids, "name of other length with same hash isn't highlighted");
+    std::vector<Sci_PositionCR> declinates {script.find("declinate"), script.find("declinate", 1)};
+    test::check(script.highlight(script.find("declinate")) == declinates, "name of same length with same hash isn't highlighted");
+    std::vector<Sci_PositionCR> macallums {script.find("macallums"), script.find("macallums", 1)};
+    test::check(script.highlight(script.find("macallums", 1)) == macallums, "names with same hash are told apart both ways");
+  }
+
+  void testUndeclaredNamesNotInterned() {
+    // Undeclared identifiers, e.g. what's left of a name while it's being typed, only live as long as the document has them
+    std::string text = "ScriptName Test\nFunction Test()\n";
+    for (int i = 0; i < 1000; ++i) {
+      text += "  Undeclared" + std::to_string(i) + "()\n";
+    }
+    text += "EndFunction\n";
+
+    size_t atomsBefore = AtomTable::instance().size();
+    HighlightedScript script(text);
+    test::check(AtomTable::instance().size() < atomsBefore + 10, "undeclared names aren't interned");
+    test::check(script.highlight(script.find("Undeclared999")).size() == 1, "undeclared names are still highlighted");
+  }
+
+} // namespace
+
+int main() {
+  papyrus::lexerData = std::make_unique<papyrus::LexerData>(papyrus::LexerSettings());
+  testOccurrences();
+  testSameHash();
+  testUndeclaredNamesNotInterned();
+  return test::result();
+}
@@ -0,0 +1,82 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Stand-in for PapyrusCompiler, so compilation can be tested through real processes on any platform. It takes the same command line:
+//
+//   StandInCompiler <script> -i=<import directories> -o=<output directory> [other flags, which are ignored]
+//
+// Each line of the script with "Error:" on it is reported on stderr as a compilation error at that line and column, in the same format
+// as PapyrusCompiler. A script without errors is compiled to an empty .pex file in output directory. Lines can also make the compiler
+// misbehave while it's running:
+//
+//   Sleep: <milliseconds>   Wait before going on to the next line, e.g. so errors already reported can be seen before it exits
+//   Flood: <bytes>          Write that much on stdout, e.g. more than a pipe holds
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <script> -i=<import directories> -o=<output directory>" << std::endl;
+    return 2;
+  }
+
+  std::filesystem::path scriptPath = std::filesystem::absolute(argv[1]);
+  std::filesystem::path outputDirectory;
+  for (int i = 2; i < argc; ++i) {
+    if (std::string_view(argv[i]).starts_with("-o=")) {
+      outputDirectory = argv[i] + 3;
+    }
+  }
+
+  std::cout << "Starting 1 compile threads for 1 files..." << std::endl;
+  std::cout << "Compiling \"" << scriptPath.stem().string() << "\"..." << std::endl;
+  std::ifstream script(scriptPath);
+  if (!script) {
+    std::cerr << "<unknown>(0,0): unable to locate script " << scriptPath.stem().string() << std::endl;
+    return 1;
+  }
+
+  int numErrors = 0;
+  std::string line;
+  for (int lineNumber = 1; std::getline(script, line); ++lineNumber) {
+    if (size_t column = line.find("Error:"); column != std::string::npos) {
+      std::cerr << scriptPath.string() << '(' << lineNumber << ',' << column + 1 << "): " << line.substr(column + 7) << std::endl;
+      numErrors++;
+    } else if (line.starts_with("Sleep: ")) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(std::stoi(line.substr(7))));
+    } else if (line.starts_with("Flood: ")) {
+      std::cout << std::string(std::stoul(line.substr(7)), '.') << std::endl;
+    }
+  }
+
+  if (numErrors > 0) {
+    std::cout << "No output generated for " << scriptPath.stem().string() << ", compilation failed." << std::endl;
+    return 1;
+  }
+
+  std::ofstream(outputDirectory / scriptPath.filename().replace_extension(".pex"), std::ios::binary);
+  std::cout << "Compilation succeeded." << std::endl;
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace test {
+
+  inline int failures = 0;
+
+  // Report a failed check with its location, and keep going so all failures are reported
+  inline void check(bool condition, std::string_view description, std::source_location location = std::source_location::current()) {
+    if (!condition) {
+      std::cerr << location.file_name() << ':' << location.line() << ": check failed: " << description << std::endl;
+      failures++;
+    }
+  }
+
+  // Return value of a test program's main
+  inline int result() {
+    if (failures > 0) {
+      std::cerr << failures << " check(s) failed" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  // Wait until condition is met, up to given timeout. Returns whether it's met.
+  inline bool waitFor(const std::function<bool()>& condition, std::chrono::milliseconds timeout = std::chrono::seconds(30)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+  }
+
+  // A uniquely named directory under system's temp directory, which is removed with everything in it when destroyed
+  class TempDirectory {
+    public:
+      TempDirectory() {
+        std::random_device random;
+        path = std::filesystem::temp_directory_path() / ("papyrus-test-" + std::to_string(random()) + std::to_string(random()));
+        std::filesystem::create_directories(path);
+      }
+
+      ~TempDirectory() {
+        std::error_code errorCode;
+        std::filesystem::remove_all(path, errorCode);
+      }
+
+      TempDirectory(TempDirectory&& other) = delete;
+
+      inline const std::filesystem::path& getPath() const noexcept { return path; }
+
+      // Write a file at given path relative to this directory, creating parent directories as needed
+      std::filesystem::path writeFile(const std::filesystem::path& relativePath, std::string_view content) const {
+        auto filePath = path / relativePath;
+        std::filesystem::create_directories(filePath.parent_path());
+        std::ofstream(filePath, std::ios::binary) << content;
+        return filePath;
+      }
+
+    private:
+      std::filesystem::path path;
+  };
+
+} // namespace